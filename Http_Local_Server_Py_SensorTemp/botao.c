@@ -0,0 +1,97 @@
+#include "pico/stdlib.h"
+#include "hardware/gpio.h"
+#include "hardware/sync.h"
+#include "botao.h"
+
+/***************************************************************
+ * VARIÁVEIS INTERNAS
+ *
+ * A IRQ de GPIO e a do alarme têm a mesma prioridade e não se
+ * interrompem; o laço principal só mexe em fila_ini.
+ **************************************************************/
+static uint pino;
+static volatile bool estado;               // Último estado estável informado
+static alarm_id_t alarme;                  // Alarme de debounce pendente (0 se nenhum)
+static uint64_t t_borda;                   // Primeira borda da sequência atual
+
+static botao_evento_t fila[BOTAO_FILA];
+static volatile uint8_t fila_ini;          // Próximo a ler (laço principal)
+static volatile uint8_t fila_fim;          // Próximo a escrever (IRQ)
+static volatile uint32_t perdidos;
+
+/***************************************************************
+ * FUNÇÕES INTERNAS
+ **************************************************************/
+/**
+ * Alarme de debounce: o pino ficou BOTAO_DEBOUNCE_US sem bordas
+ */
+static int64_t nivel_estavel(__unused alarm_id_t id, __unused void *dados) {
+    alarme = 0;
+    bool pressionado = !gpio_get(pino);
+    if (pressionado == estado) {
+        return 0;                          // Trepidação que voltou ao estado anterior
+    }
+    estado = pressionado;
+
+    uint8_t proximo = (fila_fim + 1) % BOTAO_FILA;
+    if (proximo == fila_ini) {
+        perdidos++;
+        return 0;
+    }
+    fila[fila_fim].t_us = t_borda;
+    fila[fila_fim].pressionado = pressionado;
+    __compiler_memory_barrier();
+    fila_fim = proximo;
+    __sev();                               // Acorda o laço principal se estiver em WFE
+    return 0;
+}
+
+/**
+ * IRQ de borda: marca o início da sequência e adia o alarme
+ */
+static void borda(uint gpio, __unused uint32_t eventos) {
+    if (gpio != pino) {
+        return;
+    }
+    if (alarme > 0) {
+        cancel_alarm(alarme);
+    } else {
+        t_borda = time_us_64();
+    }
+    alarme = add_alarm_in_us(BOTAO_DEBOUNCE_US, nivel_estavel, NULL, true);
+    if (alarme < 0) {
+        alarme = 0;                        // Sem alarmes livres: a próxima borda tenta de novo
+    }
+}
+
+/***************************************************************
+ * API PÚBLICA
+ **************************************************************/
+void botao_iniciar(uint gpio) {
+    pino = gpio;
+    gpio_init(pino);
+    gpio_set_dir(pino, GPIO_IN);
+    gpio_pull_up(pino);
+    sleep_us(10);                          // Pull-up carregar a entrada antes da 1ª leitura
+    estado = !gpio_get(pino);
+    gpio_set_irq_enabled_with_callback(pino, GPIO_IRQ_EDGE_RISE | GPIO_IRQ_EDGE_FALL, true, borda);
+}
+
+bool botao_pressionado(void) {
+    return estado;
+}
+
+bool botao_obter_evento(botao_evento_t *ev) {
+    uint8_t ini = fila_ini;
+    if (ini == fila_fim) {
+        return false;
+    }
+    *ev = fila[ini];
+    __compiler_memory_barrier();
+    fila_ini = (ini + 1) % BOTAO_FILA;
+    return true;
+}
+
+uint32_t botao_eventos_perdidos(void) {
+    return perdidos;
+}
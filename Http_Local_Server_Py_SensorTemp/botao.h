@@ -0,0 +1,64 @@
+#ifndef BOTAO_H
+#define BOTAO_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "pico/types.h"
+
+/***************************************************************
+ * BOTÃO POR INTERRUPÇÃO, COM DEBOUNCE
+ *
+ * Cada borda do pino (subida ou descida) dispara a IRQ de GPIO,
+ * que guarda o instante da primeira borda da sequência e
+ * (re)arma um alarme de hardware de BOTAO_DEBOUNCE_US. Enquanto
+ * o contato trepida, o alarme é adiado; quando dispara, o nível do
+ * pino está estável e, se for diferente do último estado
+ * informado, vira um evento na fila com o instante (µs desde o
+ * boot) da borda que iniciou a mudança.
+ *
+ * Toques mais curtos que BOTAO_DEBOUNCE_US são tratados como ruído.
+ * A fila é preenchida pelas IRQs e lida pelo laço principal; se
+ * ela encher, os eventos novos são descartados e contados em
+ * botao_eventos_perdidos().
+ *
+ * Botão ativo em nível baixo (pull-up interno).
+ **************************************************************/
+#ifndef BOTAO_DEBOUNCE_US
+#define BOTAO_DEBOUNCE_US 5000       // Tempo sem bordas para considerar o nível estável
+#endif
+
+#ifndef BOTAO_FILA
+#define BOTAO_FILA 16                // Eventos guardados até o laço principal ler
+#endif
+
+typedef struct {
+    uint64_t t_us;                   // Instante da primeira borda da mudança (µs desde o boot)
+    bool pressionado;
+} botao_evento_t;
+
+/**
+ * Configura o pino com pull-up e habilita a interrupção nas duas bordas
+ * @param gpio Pino do botão
+ */
+void botao_iniciar(uint gpio);
+
+/**
+ * Estado estável mais recente (após o debounce)
+ * @return true se o botão está pressionado
+ */
+bool botao_pressionado(void);
+
+/**
+ * Retira o evento mais antigo da fila
+ * @param ev Recebe o evento
+ * @return false se a fila está vazia
+ */
+bool botao_obter_evento(botao_evento_t *ev);
+
+/**
+ * Eventos descartados com a fila cheia desde o início
+ * @return Quantidade de eventos perdidos
+ */
+uint32_t botao_eventos_perdidos(void);
+
+#endif
@@ -0,0 +1,103 @@
+#include <stdio.h>
+#include <string.h>
+#include "comandos.h"
+
+/***************************************************************
+ * VARIÁVEIS INTERNAS (uma conexão por vez)
+ **************************************************************/
+static comandos_executar_fn executar;
+static json_fluxo_t parser;
+static EXAMPLE_HTTP_BODY_CONSUMER_T consumidor;
+static bool resposta_json;                 // A resposta atual é application/json
+static uint16_t executados;
+
+static char cmd[COMANDOS_NOME_MAX];        // Campos do comando em leitura
+static char valor[JSON_FLUXO_VALOR_MAX];
+static json_tipo_t tipo_valor;
+
+/***************************************************************
+ * FUNÇÕES INTERNAS
+ **************************************************************/
+/**
+ * Recebe cada valor do JSON; só interessam comandos[i].cmd,
+ * comandos[i].valor e o fim do objeto comandos[i]
+ */
+static void valor_json(__unused void *arg, const char *caminho, json_tipo_t tipo, const char *texto) {
+    const char *campo = strchr(caminho, ']');
+    if (strncmp(caminho, "comandos[", 9) != 0 || !campo) {
+        return;
+    }
+    campo++;
+    if (tipo == JSON_FIM_OBJETO && *campo == '\0') {
+        if (cmd[0]) {
+            executar(cmd, valor, tipo_valor);
+            executados++;
+        }
+        cmd[0] = '\0';
+        valor[0] = '\0';
+        tipo_valor = JSON_NULO;
+    } else if (strcmp(campo, ".cmd") == 0 && tipo == JSON_TEXTO) {
+        snprintf(cmd, sizeof(cmd), "%s", texto);
+    } else if (strcmp(campo, ".valor") == 0 && tipo != JSON_FIM_OBJETO) {
+        snprintf(valor, sizeof(valor), "%s", texto);
+        tipo_valor = tipo;
+    }
+}
+
+/**
+ * Prepara o parser e os campos para um documento novo
+ */
+static void recomecar(void) {
+    json_fluxo_iniciar(&parser, valor_json, NULL);
+    cmd[0] = '\0';
+    valor[0] = '\0';
+    tipo_valor = JSON_NULO;
+    executados = 0;
+}
+
+static err_t fatia(__unused void *arg, const uint8_t *dados, u16_t len) {
+    return json_fluxo_alimentar(&parser, dados, len) == JSON_ERRO ? ERR_VAL : ERR_OK;
+}
+
+/**
+ * Cabeçalhos de uma resposta nova: prepara o parser, ou descarta o corpo se não for JSON
+ */
+static err_t cabecalhos(__unused httpc_state_t *conexao, __unused void *arg, struct pbuf *hdr, u16_t hdr_len,
+                        __unused u32_t content_len) {
+    static const char tipo_json[] = "application/json";
+    resposta_json = pbuf_memfind(hdr, tipo_json, sizeof(tipo_json) - 1, 0) < hdr_len;
+    recomecar();
+    consumidor.received = 0;
+    consumidor.err = resposta_json ? ERR_OK : ERR_VAL;
+    return ERR_OK;
+}
+
+/***************************************************************
+ * FUNÇÕES PÚBLICAS
+ **************************************************************/
+void comandos_iniciar(EXAMPLE_HTTP_KEEPALIVE_T *ka, comandos_executar_fn executar_fn) {
+    executar = executar_fn;
+    consumidor.slice_fn = fatia;
+    consumidor.arg = NULL;
+    ka->headers_fn = cabecalhos;
+    ka->recv_fn = http_client_receive_slices_fn;
+    ka->callback_arg = &consumidor;
+}
+
+uint16_t comandos_concluir(void) {
+    if (resposta_json && json_fluxo_terminar(&parser) == JSON_ERRO) {
+        printf("Resposta JSON inválida ou incompleta (byte %lu de %lu)\n",
+               (unsigned long)parser.posicao, (unsigned long)consumidor.received);
+    }
+    resposta_json = false;
+    return executados;
+}
+
+uint16_t comandos_processar(comandos_executar_fn executar_fn, const uint8_t *dados, uint16_t len) {
+    executar = executar_fn;
+    recomecar();
+    if (json_fluxo_alimentar(&parser, dados, len) == JSON_ERRO || json_fluxo_terminar(&parser) == JSON_ERRO) {
+        printf("Comandos: JSON inválido ou incompleto (byte %lu de %u)\n", (unsigned long)parser.posicao, len);
+    }
+    return executados;
+}
@@ -0,0 +1,64 @@
+#ifndef COMANDOS_H
+#define COMANDOS_H
+
+#include <stdbool.h>
+#include "example_http_client_util.h"
+#include "json_fluxo.h"
+
+/***************************************************************
+ * COMANDOS DO SERVIDOR NA RESPOSTA DAS MENSAGENS
+ *
+ * O servidor responde às mensagens (GET /mensagem e POST /lote)
+ * com um JSON que pode levar instruções para a Pico:
+ *   {"status":"Lote recebido","comandos":[{"cmd":"led","valor":1}]}
+ *
+ * O corpo é lido em fatias, direto dos pbufs, pelo parser
+ * incremental (json_fluxo.h), sem guardar a resposta: cada objeto
+ * de "comandos" é executado assim que fecha, ainda durante a
+ * recepção. Respostas que não são application/json são ignoradas.
+ *
+ * Os comandos rodam no contexto do lwIP (callback de recepção),
+ * então a função de execução não pode bloquear.
+ *
+ * O mesmo JSON também pode chegar inteiro numa mensagem MQTT
+ * (comandos_processar).
+ **************************************************************/
+#ifndef COMANDOS_NOME_MAX
+#define COMANDOS_NOME_MAX 24
+#endif
+
+/**
+ * Executa um comando recebido
+ * @param cmd Nome do comando ("cmd")
+ * @param valor Valor do comando como texto ("valor"; vazio se ausente)
+ * @param tipo Tipo JSON do valor
+ */
+typedef void (*comandos_executar_fn)(const char *cmd, const char *valor, json_tipo_t tipo);
+
+/**
+ * Liga a recepção de comandos às respostas de uma conexão keep-alive
+ * (usa headers_fn, recv_fn e callback_arg dela)
+ * @param ka Conexão keep-alive
+ * @param executar Função chamada para cada comando
+ */
+void comandos_iniciar(EXAMPLE_HTTP_KEEPALIVE_T *ka, comandos_executar_fn executar);
+
+/**
+ * Fecha a resposta atual, depois que a requisição terminou, e avisa
+ * se o JSON veio incompleto ou inválido
+ * @return Comandos executados nessa resposta
+ */
+uint16_t comandos_concluir(void);
+
+/**
+ * Executa os comandos de um JSON completo, ex.: o conteúdo de uma
+ * mensagem MQTT. Usa o mesmo parser das respostas: não chamar com uma
+ * resposta HTTP em leitura
+ * @param executar_fn Função chamada para cada comando
+ * @param dados JSON (não precisa terminar em zero)
+ * @param len Tamanho do JSON
+ * @return Comandos executados
+ */
+uint16_t comandos_processar(comandos_executar_fn executar_fn, const uint8_t *dados, uint16_t len);
+
+#endif
@@ -5,10 +5,19 @@
  */
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include "pico/async_context.h"
+#include "pico/time.h"
 #include "lwip/altcp.h"
 #include "lwip/altcp_tls.h"
+#include "lwip/dns.h"
+#include "lwip/prot/dns.h"
+#include "lwip/timeouts.h"
+#include "lwip/udp.h"
+#if LWIP_ALTCP && LWIP_ALTCP_TLS && LWIP_ALTCP_TLS_MBEDTLS
+#include "mbedtls/platform.h"
+#endif
 #include "example_http_client_util.h"
 
 
@@ -16,14 +25,6 @@
 #define HTTP_INFO printf
 #endif
 
-#ifndef HTTP_INFOC
-#define HTTP_INFOC putchar
-#endif
-
-#ifndef HTTP_INFOC
-#define HTTP_INFOC putchar
-#endif
-
 #ifndef HTTP_DEBUG
 #ifdef NDEBUG
 #define HTTP_DEBUG
@@ -36,26 +37,61 @@
 #define HTTP_ERROR printf
 #endif
 
+// Hand the bytes [offset, offset + len) of a pbuf chain to a function, one contiguous piece per pbuf
+err_t http_client_pbuf_slices(const struct pbuf *p, u16_t offset, u16_t len, http_client_slice_fn slice_fn, void *arg) {
+    for (const struct pbuf *q = p; q && len > 0; q = q->next) {
+        if (offset >= q->len) {
+            offset -= q->len;
+            continue;
+        }
+        u16_t n = LWIP_MIN((u16_t)(q->len - offset), len);
+        err_t err = slice_fn(arg, (const uint8_t*)q->payload + offset, n);
+        if (err != ERR_OK) {
+            return err;
+        }
+        len -= n;
+        offset = 0;
+    }
+    return ERR_OK;
+}
+
+// Body data to a consumer, slice by slice
+err_t http_client_receive_slices_fn(void *arg, struct altcp_pcb *conn, struct pbuf *p, __unused err_t err) {
+    EXAMPLE_HTTP_BODY_CONSUMER_T *consumer = (EXAMPLE_HTTP_BODY_CONSUMER_T*)arg;
+    if (!p) {
+        return ERR_OK;
+    }
+    if (consumer->err == ERR_OK) {
+        consumer->err = http_client_pbuf_slices(p, 0, p->tot_len, consumer->slice_fn, consumer->arg);
+        consumer->received += p->tot_len;
+    }
+    if (conn) {
+        altcp_recved(conn, p->tot_len);
+    }
+    pbuf_free(p);
+    return ERR_OK; // Never refuse the data: lwIP would hand it over again
+}
+
+static err_t print_slice_fn(__unused void *arg, const uint8_t *data, u16_t len) {
+    HTTP_INFO("%.*s", (int)len, (const char*)data);
+    return ERR_OK;
+}
+
 // Print headers to stdout
 err_t http_client_header_print_fn(__unused httpc_state_t *connection, __unused void *arg, struct pbuf *hdr, u16_t hdr_len, __unused u32_t content_len) {
     HTTP_INFO("\nheaders %u\n", hdr_len);
-    u16_t offset = 0;
-    while (offset < hdr->tot_len && offset < hdr_len) {
-        char c = (char)pbuf_get_at(hdr, offset++);
-        HTTP_INFOC(c);
-    }
+    http_client_pbuf_slices(hdr, 0, hdr_len, print_slice_fn, NULL);
     return ERR_OK;
 }
 
 // Print body to stdout
-err_t http_client_receive_print_fn(__unused void *arg, __unused struct altcp_pcb *conn, struct pbuf *p, err_t err) {
+err_t http_client_receive_print_fn(__unused void *arg, struct altcp_pcb *conn, struct pbuf *p, err_t err) {
     HTTP_INFO("\ncontent err %d\n", err);
     if (!p) return ERR_OK;
 
-    u16_t offset = 0;
-    while (offset < p->tot_len) {
-        char c = (char)pbuf_get_at(p, offset++);
-        HTTP_INFOC(c);
+    http_client_pbuf_slices(p, 0, p->tot_len, print_slice_fn, NULL);
+    if (conn) {
+        altcp_recved(conn, p->tot_len);
     }
 
     // IMPORTANTE: liberar o buffer depois de usá-lo
@@ -66,6 +102,598 @@ err_t http_client_receive_print_fn(__unused void *arg, __unused struct altcp_pcb
 
 
 
+// ---------------------------------------------------------------------------
+// TLS: long-lived configuration, session resumption and handshake statistics
+// ---------------------------------------------------------------------------
+
+#if LWIP_ALTCP && LWIP_ALTCP_TLS && LWIP_ALTCP_TLS_MBEDTLS
+
+#ifndef MBEDTLS_PRIVATE
+#define MBEDTLS_PRIVATE(member) member // mbedtls 2.x
+#endif
+
+#if defined(MBEDTLS_PLATFORM_MEMORY)
+// Count what mbedtls allocates. Each block is prefixed with its size
+#define TLS_HEAP_HEADER 8
+static size_t tls_heap_in_use;
+static size_t tls_heap_peak;
+
+static void *tls_heap_calloc(size_t n, size_t size) {
+    if (size && n > (SIZE_MAX - TLS_HEAP_HEADER) / size) {
+        return NULL;
+    }
+    size_t len = n * size;
+    uint8_t *block = calloc(1, len + TLS_HEAP_HEADER);
+    if (!block) {
+        return NULL;
+    }
+    *(size_t*)block = len;
+    tls_heap_in_use += len;
+    if (tls_heap_in_use > tls_heap_peak) {
+        tls_heap_peak = tls_heap_in_use;
+    }
+    return block + TLS_HEAP_HEADER;
+}
+
+static void tls_heap_free(void *ptr) {
+    if (ptr) {
+        uint8_t *block = (uint8_t*)ptr - TLS_HEAP_HEADER;
+        tls_heap_in_use -= *(size_t*)block;
+        free(block);
+    }
+}
+#endif
+
+size_t http_client_tls_heap_in_use(void) {
+#if defined(MBEDTLS_PLATFORM_MEMORY)
+    return tls_heap_in_use;
+#else
+    return 0;
+#endif
+}
+
+static EXAMPLE_HTTP_TLS_SESSION_T *tls_cache_find(EXAMPLE_HTTP_TLS_CACHE_T *cache, const char *hostname) {
+    for (int i = 0; i < HTTP_CLIENT_TLS_SESSIONS; i++) {
+        if (cache->sessions[i].valid && !strcmp(cache->sessions[i].hostname, hostname)) {
+            return &cache->sessions[i];
+        }
+    }
+    return NULL;
+}
+
+// Keep the session negotiated by a full handshake, replacing the host's old one or the least recently used
+static void tls_cache_store(EXAMPLE_HTTP_TLS_CACHE_T *cache, const char *hostname, mbedtls_ssl_context *ssl) {
+    if (strlen(hostname) >= HTTP_CLIENT_TLS_HOSTNAME_MAX) {
+        return;
+    }
+    EXAMPLE_HTTP_TLS_SESSION_T *entry = tls_cache_find(cache, hostname);
+    if (!entry) {
+        entry = &cache->sessions[0];
+        for (int i = 0; i < HTTP_CLIENT_TLS_SESSIONS; i++) {
+            if (!cache->sessions[i].valid) {
+                entry = &cache->sessions[i];
+                break;
+            }
+            if (cache->sessions[i].last_used < entry->last_used) {
+                entry = &cache->sessions[i];
+            }
+        }
+    }
+    mbedtls_ssl_session_free(&entry->session);
+    mbedtls_ssl_session_init(&entry->session);
+    entry->valid = mbedtls_ssl_get_session(ssl, &entry->session) == 0;
+    strcpy(entry->hostname, hostname);
+    entry->last_used = ++cache->stamp;
+}
+
+static void tls_conn_handshake_done(EXAMPLE_HTTP_TLS_CONN_T *conn) {
+    conn->done = true;
+    conn->handshake_us = (uint32_t)(time_us_64() - conn->t_start);
+#if defined(MBEDTLS_PLATFORM_MEMORY)
+    conn->heap_peak = tls_heap_peak;
+#endif
+    // A resumed session keeps the master secret of the session that was offered
+    const mbedtls_ssl_session *session = conn->ssl->MBEDTLS_PRIVATE(session);
+    conn->resumed = conn->offered && session &&
+                    !memcmp(session->MBEDTLS_PRIVATE(master), conn->offered_master, sizeof(conn->offered_master));
+    HTTP_DEBUG("tls %s handshake %u us, heap peak %u\n", conn->resumed ? "resumed" : "full",
+               conn->handshake_us, (unsigned)conn->heap_peak);
+
+    EXAMPLE_HTTP_TLS_CACHE_T *cache = conn->cache;
+    if (!cache) {
+        return;
+    }
+    if (conn->resumed) {
+        cache->resumed_handshakes++;
+        cache->resumed_us += conn->handshake_us;
+        cache->resumed_heap_peak = LWIP_MAX(cache->resumed_heap_peak, conn->heap_peak);
+    } else {
+        cache->full_handshakes++;
+        cache->full_us += conn->handshake_us;
+        cache->full_heap_peak = LWIP_MAX(cache->full_heap_peak, conn->heap_peak);
+        tls_cache_store(cache, conn->hostname, conn->ssl);
+    }
+}
+
+// Sits between mbedtls and the altcp layer: the first write is the ClientHello, and the
+// first write after the handshake is over (the request) marks its end
+static int tls_conn_send(void *ctx, const unsigned char *buf, size_t len) {
+    EXAMPLE_HTTP_TLS_CONN_T *conn = (EXAMPLE_HTTP_TLS_CONN_T*)ctx;
+    if (!conn->t_start) {
+        conn->t_start = time_us_64();
+    } else if (!conn->done && conn->ssl->MBEDTLS_PRIVATE(state) == MBEDTLS_SSL_HANDSHAKE_OVER) {
+        tls_conn_handshake_done(conn);
+    }
+    return conn->bio_send(conn->bio, buf, len);
+}
+
+static int tls_conn_recv(void *ctx, unsigned char *buf, size_t len) {
+    EXAMPLE_HTTP_TLS_CONN_T *conn = (EXAMPLE_HTTP_TLS_CONN_T*)ctx;
+    return conn->bio_recv(conn->bio, buf, len);
+}
+
+// Set sni on a new TLS connection, offer the cached session and start measuring the handshake
+static void tls_conn_attach(EXAMPLE_HTTP_TLS_CONN_T *conn, EXAMPLE_HTTP_TLS_CACHE_T *cache, struct altcp_pcb *pcb,
+                            const char *hostname) {
+    mbedtls_ssl_context *ssl = (mbedtls_ssl_context*)altcp_tls_context(pcb);
+    mbedtls_ssl_set_hostname(ssl, hostname);
+
+    memset(conn, 0, sizeof(*conn));
+    conn->cache = cache;
+    conn->hostname = hostname;
+    conn->ssl = ssl;
+    EXAMPLE_HTTP_TLS_SESSION_T *entry = cache ? tls_cache_find(cache, hostname) : NULL;
+    if (entry && mbedtls_ssl_set_session(ssl, &entry->session) == 0) {
+        conn->offered = true;
+        memcpy(conn->offered_master, entry->session.MBEDTLS_PRIVATE(master), sizeof(conn->offered_master));
+        entry->last_used = ++cache->stamp;
+    }
+    conn->bio = ssl->MBEDTLS_PRIVATE(p_bio);
+    conn->bio_send = ssl->MBEDTLS_PRIVATE(f_send);
+    conn->bio_recv = ssl->MBEDTLS_PRIVATE(f_recv);
+    mbedtls_ssl_set_bio(ssl, conn, tls_conn_send, tls_conn_recv, NULL);
+#if defined(MBEDTLS_PLATFORM_MEMORY)
+    tls_heap_peak = tls_heap_in_use;
+#endif
+}
+
+// A connection that offered a session failed before finishing the handshake: the server may
+// not accept the session, so do not offer it again
+static void tls_conn_failed(EXAMPLE_HTTP_TLS_CONN_T *conn) {
+    if (conn->cache && conn->offered && !conn->done) {
+        http_client_tls_cache_forget(conn->cache, conn->hostname);
+    }
+}
+
+void http_client_tls_init(void) {
+#if defined(MBEDTLS_PLATFORM_MEMORY)
+    // Blocks allocated before this point have no size header and must never reach tls_heap_free
+    static bool heap_hooked;
+    if (!heap_hooked) {
+        mbedtls_platform_set_calloc_free(tls_heap_calloc, tls_heap_free);
+        heap_hooked = true;
+    }
+#endif
+}
+
+int http_client_tls_cache_init(EXAMPLE_HTTP_TLS_CACHE_T *cache, const uint8_t *ca, size_t ca_len) {
+    memset(cache, 0, sizeof(*cache));
+    http_client_tls_init();
+    for (int i = 0; i < HTTP_CLIENT_TLS_SESSIONS; i++) {
+        mbedtls_ssl_session_init(&cache->sessions[i].session);
+    }
+    cache->config = altcp_tls_create_config_client(ca, ca_len);
+    return cache->config ? ERR_OK : ERR_MEM;
+}
+
+void http_client_tls_cache_forget(EXAMPLE_HTTP_TLS_CACHE_T *cache, const char *hostname) {
+    EXAMPLE_HTTP_TLS_SESSION_T *entry = tls_cache_find(cache, hostname);
+    if (entry) {
+        mbedtls_ssl_session_free(&entry->session);
+        mbedtls_ssl_session_init(&entry->session);
+        entry->valid = false;
+    }
+}
+
+void http_client_tls_cache_deinit(EXAMPLE_HTTP_TLS_CACHE_T *cache) {
+    for (int i = 0; i < HTTP_CLIENT_TLS_SESSIONS; i++) {
+        mbedtls_ssl_session_free(&cache->sessions[i].session);
+        cache->sessions[i].valid = false;
+    }
+    if (cache->config) {
+        altcp_tls_free_config(cache->config);
+        cache->config = NULL;
+    }
+}
+#endif
+
+// ---------------------------------------------------------------------------
+// DNS cache: answers kept for their TTL, failures for a while, names in use
+// looked up again before they expire
+// ---------------------------------------------------------------------------
+
+// lwIP's resolver does not give its callers the TTL of an answer, so the cache
+// sends its own A queries (wire format and constants from lwip/prot/dns.h)
+
+#define DNS_CACHE_SIZEOF_QUERY 4    // type + class after the name
+#define DNS_CACHE_SIZEOF_ANSWER 10  // type + class + ttl + length after the name
+
+typedef enum {
+    DNS_ENTRY_EMPTY,
+    DNS_ENTRY_RESOLVED,
+    DNS_ENTRY_FAILED,
+} dns_entry_state_t;
+
+typedef struct {
+    char hostname[HTTP_CLIENT_DNS_HOSTNAME_MAX];
+    ip_addr_t addr;
+    dns_entry_state_t state;
+    bool querying;
+    bool used; // Looked up since the last answer, worth refreshing
+    uint8_t tries;
+    uint8_t server;
+    uint16_t txid;
+    uint64_t expires_us;
+    uint64_t refresh_us;
+    EXAMPLE_HTTP_DNS_WAITER_T *waiters;
+} dns_cache_entry_t;
+
+static dns_cache_entry_t dns_cache[HTTP_CLIENT_DNS_ENTRIES];
+static struct udp_pcb *dns_cache_pcb;
+static EXAMPLE_HTTP_DNS_STATS_T dns_cache_stats;
+
+static void dns_cache_send(dns_cache_entry_t *e);
+static void dns_cache_retry_fn(void *arg);
+static void dns_cache_recv_fn(void *arg, struct udp_pcb *pcb, struct pbuf *p, const ip_addr_t *addr, u16_t port);
+
+// Make a fresh address visible to lwIP's resolver (and so to httpc), or withdraw it
+static void dns_cache_publish(dns_cache_entry_t *e, bool fresh) {
+#if DNS_LOCAL_HOSTLIST && DNS_LOCAL_HOSTLIST_IS_DYNAMIC
+    dns_local_removehost(e->hostname, NULL);
+    if (fresh && dns_local_addhost(e->hostname, &e->addr) != ERR_OK) {
+        HTTP_ERROR("dns cache: local host list full\n");
+    }
+#else
+    (void)e;
+    (void)fresh;
+#endif
+}
+
+// Report the outcome to everyone waiting. They may look names up again from their callback
+static void dns_cache_notify(dns_cache_entry_t *e, bool found) {
+    char hostname[HTTP_CLIENT_DNS_HOSTNAME_MAX];
+    ip_addr_t addr;
+    strcpy(hostname, e->hostname);
+    ip_addr_copy(addr, e->addr);
+    EXAMPLE_HTTP_DNS_WAITER_T *waiter = e->waiters;
+    e->waiters = NULL;
+    while (waiter) {
+        EXAMPLE_HTTP_DNS_WAITER_T *next = waiter->next;
+        waiter->linked = false;
+        waiter->found_fn(hostname, found ? &addr : NULL, waiter->arg);
+        waiter = next;
+    }
+}
+
+static void dns_cache_stop(dns_cache_entry_t *e) {
+    e->querying = false;
+    sys_untimeout(dns_cache_retry_fn, e);
+}
+
+// Not used since the last answer: let the entry expire, and leave the local host list then
+static void dns_cache_expire_fn(void *arg) {
+    dns_cache_entry_t *e = (dns_cache_entry_t*)arg;
+    if (e->state == DNS_ENTRY_RESOLVED && !e->querying) {
+        dns_cache_publish(e, false);
+    }
+}
+
+static void dns_cache_query(dns_cache_entry_t *e) {
+    e->querying = true;
+    e->tries = 0;
+    e->txid = (uint16_t)LWIP_RAND();
+    dns_cache_send(e);
+}
+
+static void dns_cache_refresh_fn(void *arg) {
+    dns_cache_entry_t *e = (dns_cache_entry_t*)arg;
+    if (e->state != DNS_ENTRY_RESOLVED || e->querying) {
+        return;
+    }
+    if (e->used) {
+        dns_cache_stats.refreshes++;
+        dns_cache_query(e);
+    } else {
+        sys_timeout((u32_t)((e->expires_us - e->refresh_us) / 1000), dns_cache_expire_fn, e);
+    }
+}
+
+static void dns_cache_resolved(dns_cache_entry_t *e, const ip_addr_t *addr, u32_t ttl) {
+    ttl = LWIP_MAX(HTTP_CLIENT_DNS_MIN_TTL_S, LWIP_MIN(ttl, HTTP_CLIENT_DNS_MAX_TTL_S));
+    u32_t refresh_ms = ttl * 10 * HTTP_CLIENT_DNS_REFRESH_PERCENT;
+    uint64_t now = time_us_64();
+    HTTP_DEBUG("dns cache: %s is %s for %u s\n", e->hostname, ipaddr_ntoa(addr), (unsigned)ttl);
+    dns_cache_stop(e);
+    ip_addr_copy(e->addr, *addr);
+    e->state = DNS_ENTRY_RESOLVED;
+    e->used = false;
+    e->expires_us = now + ttl * 1000000ull;
+    e->refresh_us = now + refresh_ms * 1000ull;
+    sys_untimeout(dns_cache_refresh_fn, e);
+    sys_untimeout(dns_cache_expire_fn, e);
+    sys_timeout(refresh_ms, dns_cache_refresh_fn, e);
+    dns_cache_publish(e, true);
+    dns_cache_notify(e, true);
+}
+
+static void dns_cache_failed(dns_cache_entry_t *e, u32_t ttl) {
+    uint64_t now = time_us_64();
+    dns_cache_stop(e);
+    if (e->state == DNS_ENTRY_RESOLVED && now < e->expires_us) {
+        // A background refresh failed: keep the address until it expires. Nobody waits on a fresh entry
+        return;
+    }
+    HTTP_DEBUG("dns cache: %s not found, retry in %u s\n", e->hostname, (unsigned)ttl);
+    e->state = DNS_ENTRY_FAILED;
+    e->expires_us = now + LWIP_MIN(ttl, HTTP_CLIENT_DNS_MAX_TTL_S) * 1000000ull;
+    sys_untimeout(dns_cache_refresh_fn, e);
+    sys_untimeout(dns_cache_expire_fn, e);
+    dns_cache_publish(e, false);
+    dns_cache_notify(e, false);
+}
+
+// Send the query of an entry to its current server, and arm the retry. After
+// HTTP_CLIENT_DNS_TRIES the lookup fails and the failure is cached
+static void dns_cache_send(dns_cache_entry_t *e) {
+    if (e->tries++ >= HTTP_CLIENT_DNS_TRIES) {
+        dns_cache_failed(e, HTTP_CLIENT_DNS_NEGATIVE_TTL_S);
+        return;
+    }
+    if (e->tries > 1) {
+        e->server++; // Rotate over the configured servers
+    }
+    const ip_addr_t *server = NULL;
+    for (u8_t i = 0; i < DNS_MAX_SERVERS && !server; i++) {
+        u8_t n = (u8_t)((e->server + i) % DNS_MAX_SERVERS);
+        if (!ip_addr_isany(dns_getserver(n))) {
+            e->server = n;
+            server = dns_getserver(n);
+        }
+    }
+    if (!dns_cache_pcb) {
+        dns_cache_pcb = udp_new_ip_type(IPADDR_TYPE_ANY);
+        if (dns_cache_pcb) {
+            udp_bind(dns_cache_pcb, IP_ANY_TYPE, 0);
+            udp_recv(dns_cache_pcb, dns_cache_recv_fn, NULL);
+        }
+    }
+    size_t name_len = strlen(e->hostname);
+    struct pbuf *p = NULL;
+    if (server && dns_cache_pcb) {
+        p = pbuf_alloc(PBUF_TRANSPORT, (u16_t)(SIZEOF_DNS_HDR + name_len + 2 + DNS_CACHE_SIZEOF_QUERY), PBUF_RAM);
+    }
+    if (p) {
+        struct dns_hdr hdr;
+        memset(&hdr, 0, sizeof(hdr));
+        hdr.id = lwip_htons(e->txid);
+        hdr.flags1 = DNS_FLAG1_RD;
+        hdr.numquestions = PP_HTONS(1);
+        u8_t *q = (u8_t*)p->payload;
+        memcpy(q, &hdr, SIZEOF_DNS_HDR);
+        // www.example.com -> 3www7example3com0
+        u8_t *label = q + SIZEOF_DNS_HDR;
+        u8_t *out = label + 1;
+        for (const char *c = e->hostname; *c; c++) {
+            if (*c == '.') {
+                *label = (u8_t)(out - label - 1);
+                label = out++;
+            } else {
+                *out++ = (u8_t)*c;
+            }
+        }
+        *label = (u8_t)(out - label - 1);
+        *out++ = 0;
+        *out++ = 0;
+        *out++ = DNS_RRTYPE_A;
+        *out++ = 0;
+        *out++ = DNS_RRCLASS_IN;
+        dns_cache_stats.queries++;
+        udp_sendto(dns_cache_pcb, p, server, DNS_SERVER_PORT);
+        pbuf_free(p);
+    }
+    // Also when nothing could be sent: the next try may have a server or memory
+    sys_timeout(HTTP_CLIENT_DNS_RETRY_MS, dns_cache_retry_fn, e);
+}
+
+static void dns_cache_retry_fn(void *arg) {
+    dns_cache_send((dns_cache_entry_t*)arg);
+}
+
+static u16_t dns_cache_get16(const struct pbuf *p, u32_t offset) {
+    return (u16_t)(pbuf_get_at(p, (u16_t)offset) << 8 | pbuf_get_at(p, (u16_t)(offset + 1)));
+}
+
+static u32_t dns_cache_get32(const struct pbuf *p, u32_t offset) {
+    return (u32_t)dns_cache_get16(p, offset) << 16 | dns_cache_get16(p, offset + 2);
+}
+
+// Offset just past the (possibly compressed) name at offset, 0 if it runs off the packet
+static u32_t dns_cache_skip_name(const struct pbuf *p, u32_t offset) {
+    while (offset < p->tot_len) {
+        u8_t n = pbuf_get_at(p, (u16_t)offset);
+        if ((n & 0xc0) == 0xc0) {
+            return offset + 2; // Pointer: the rest of the name is elsewhere
+        }
+        offset += 1 + n;
+        if (n == 0) {
+            return offset;
+        }
+    }
+    return 0;
+}
+
+static void dns_cache_answer(dns_cache_entry_t *e, const struct pbuf *p, const struct dns_hdr *hdr) {
+    u8_t rcode = hdr->flags2 & DNS_FLAG2_ERR_MASK;
+    if (rcode != DNS_FLAG2_ERR_NONE && rcode != DNS_FLAG2_ERR_NAME) {
+        // Server failure or refusal: ask the next server now
+        sys_untimeout(dns_cache_retry_fn, e);
+        dns_cache_send(e);
+        return;
+    }
+    u32_t offset = SIZEOF_DNS_HDR;
+    for (u16_t i = lwip_ntohs(hdr->numquestions); i > 0 && offset; i--) {
+        offset = dns_cache_skip_name(p, offset);
+        offset = offset ? offset + DNS_CACHE_SIZEOF_QUERY : 0;
+    }
+    u16_t answers = lwip_ntohs(hdr->numanswers);
+    u16_t records = (u16_t)(answers + lwip_ntohs(hdr->numauthrr));
+    u32_t ttl = HTTP_CLIENT_DNS_MAX_TTL_S;
+    u32_t negative_ttl = HTTP_CLIENT_DNS_NEGATIVE_TTL_S;
+    for (u16_t i = 0; i < records && offset; i++) {
+        offset = dns_cache_skip_name(p, offset);
+        if (!offset || offset + DNS_CACHE_SIZEOF_ANSWER > p->tot_len) {
+            break;
+        }
+        u16_t type = dns_cache_get16(p, offset);
+        u16_t cls = dns_cache_get16(p, offset + 2);
+        u32_t record_ttl = dns_cache_get32(p, offset + 4);
+        u16_t len = dns_cache_get16(p, offset + 8);
+        offset += DNS_CACHE_SIZEOF_ANSWER;
+        if (offset + len > p->tot_len || cls != DNS_RRCLASS_IN) {
+            offset += len;
+            continue;
+        }
+        if (i < answers && type == DNS_RRTYPE_CNAME) {
+            ttl = LWIP_MIN(ttl, record_ttl); // The alias can change too
+        } else if (i < answers && type == DNS_RRTYPE_A && len == 4) {
+            ip_addr_t addr;
+            IP_ADDR4(&addr, pbuf_get_at(p, (u16_t)offset), pbuf_get_at(p, (u16_t)(offset + 1)),
+                     pbuf_get_at(p, (u16_t)(offset + 2)), pbuf_get_at(p, (u16_t)(offset + 3)));
+            dns_cache_resolved(e, &addr, LWIP_MIN(ttl, record_ttl));
+            return;
+        } else if (i >= answers && type == DNS_RRTYPE_SOA && len >= 4) {
+            // Negative TTL: the lesser of the SOA's own TTL and its MINIMUM field (RFC 2308)
+            negative_ttl = LWIP_MIN(record_ttl, dns_cache_get32(p, offset + len - 4));
+        }
+        offset += len;
+    }
+    // No address: the name, or its A record, does not exist
+    dns_cache_failed(e, negative_ttl);
+}
+
+static void dns_cache_recv_fn(__unused void *arg, __unused struct udp_pcb *pcb, struct pbuf *p, const ip_addr_t *addr, u16_t port) {
+    struct dns_hdr hdr;
+    if (port == DNS_SERVER_PORT && pbuf_copy_partial(p, &hdr, SIZEOF_DNS_HDR, 0) == SIZEOF_DNS_HDR &&
+        (hdr.flags1 & DNS_FLAG1_RESPONSE)) {
+        for (int i = 0; i < HTTP_CLIENT_DNS_ENTRIES; i++) {
+            dns_cache_entry_t *e = &dns_cache[i];
+            if (e->querying && e->txid == lwip_ntohs(hdr.id) && ip_addr_cmp(addr, dns_getserver(e->server))) {
+                dns_cache_answer(e, p, &hdr);
+                break;
+            }
+        }
+    }
+    pbuf_free(p);
+}
+
+// Labels of 1 to 63 characters, short enough to be kept
+static bool dns_cache_name_valid(const char *hostname) {
+    size_t label = 0;
+    size_t len = 0;
+    for (const char *c = hostname; *c; c++, len++) {
+        if (*c == '.') {
+            if (label == 0) {
+                return false;
+            }
+            label = 0;
+        } else if (++label > 63) {
+            return false;
+        }
+    }
+    return label > 0 && len < HTTP_CLIENT_DNS_HOSTNAME_MAX;
+}
+
+static dns_cache_entry_t *dns_cache_find(const char *hostname) {
+    for (int i = 0; i < HTTP_CLIENT_DNS_ENTRIES; i++) {
+        if (dns_cache[i].hostname[0] && strcmp(dns_cache[i].hostname, hostname) == 0) {
+            return &dns_cache[i];
+        }
+    }
+    return NULL;
+}
+
+// Take the entry that expires first (empty ones never had a time) and give it to hostname
+static dns_cache_entry_t *dns_cache_alloc(const char *hostname) {
+    dns_cache_entry_t *e = NULL;
+    for (int i = 0; i < HTTP_CLIENT_DNS_ENTRIES; i++) {
+        if (!dns_cache[i].querying && (!e || dns_cache[i].expires_us < e->expires_us)) {
+            e = &dns_cache[i];
+        }
+    }
+    if (!e) {
+        return NULL;
+    }
+    if (e->state == DNS_ENTRY_RESOLVED) {
+        dns_cache_publish(e, false);
+    }
+    sys_untimeout(dns_cache_refresh_fn, e);
+    sys_untimeout(dns_cache_expire_fn, e);
+    memset(e, 0, sizeof(*e));
+    strcpy(e->hostname, hostname);
+    return e;
+}
+
+err_t http_client_dns_lookup(const char *hostname, ip_addr_t *addr, EXAMPLE_HTTP_DNS_WAITER_T *waiter,
+                             http_client_dns_found_fn found_fn, void *arg) {
+    if (ipaddr_aton(hostname, addr)) {
+        return ERR_OK;
+    }
+    if (!dns_cache_name_valid(hostname)) {
+        HTTP_ERROR("dns cache: cannot look up %s\n", hostname);
+        return ERR_VAL;
+    }
+    uint64_t now = time_us_64();
+    dns_cache_entry_t *e = dns_cache_find(hostname);
+    if (e && e->state == DNS_ENTRY_RESOLVED && now < e->expires_us) {
+        dns_cache_stats.hits++;
+        e->used = true;
+        if (now >= e->refresh_us && !e->querying) {
+            dns_cache_stats.refreshes++;
+            dns_cache_query(e); // In the background: the current address is still good
+        }
+        ip_addr_copy(*addr, e->addr);
+        return ERR_OK;
+    }
+    if (e && e->state == DNS_ENTRY_FAILED && now < e->expires_us) {
+        dns_cache_stats.negative_hits++;
+        return ERR_ARG;
+    }
+    if (!e) {
+        e = dns_cache_alloc(hostname);
+        if (!e) {
+            return ERR_MEM;
+        }
+    } else if (e->state == DNS_ENTRY_RESOLVED) {
+        dns_cache_publish(e, false); // Expired
+    }
+    dns_cache_stats.misses++;
+    if (!e->querying) {
+        dns_cache_query(e);
+    }
+    if (!waiter->linked) {
+        waiter->found_fn = found_fn;
+        waiter->arg = arg;
+        waiter->next = e->waiters;
+        waiter->linked = true;
+        e->waiters = waiter;
+    }
+    return ERR_INPROGRESS;
+}
+
+const EXAMPLE_HTTP_DNS_STATS_T *http_client_dns_stats(void) {
+    return &dns_cache_stats;
+}
+
 static err_t internal_header_fn(httpc_state_t *connection, void *arg, struct pbuf *hdr, u16_t hdr_len, u32_t content_len) {
     assert(arg);
     EXAMPLE_HTTP_REQUEST_T *req = (EXAMPLE_HTTP_REQUEST_T*)arg;
@@ -90,11 +718,17 @@ static void internal_result_fn(void *arg, httpc_result_t httpc_result, u32_t rx_
     HTTP_DEBUG("result %d len %u server_response %u err %d\n", httpc_result, rx_content_len, srv_res, err);
     req->complete = true;
     req->result = httpc_result;
+#if LWIP_ALTCP && LWIP_ALTCP_TLS && LWIP_ALTCP_TLS_MBEDTLS
+    if (req->tls_config && httpc_result != HTTPC_RESULT_OK) {
+        tls_conn_failed(&req->tls_conn);
+    }
+#endif
     if (req->result_fn) {
         req->result_fn(req->callback_arg, httpc_result, rx_content_len, srv_res, err);
     }
 }
 
+#if LWIP_ALTCP && LWIP_ALTCP_TLS
 // Override altcp_tls_alloc to set sni
 static struct altcp_pcb *altcp_tls_alloc_sni(void *arg, u8_t ip_type) {
     assert(arg);
@@ -104,14 +738,47 @@ static struct altcp_pcb *altcp_tls_alloc_sni(void *arg, u8_t ip_type) {
         HTTP_ERROR("Failed to allocate PCB\n");
         return NULL;
     }
+#if LWIP_ALTCP_TLS_MBEDTLS
+    tls_conn_attach(&req->tls_conn, req->tls_cache, pcb, req->hostname);
+#else
     mbedtls_ssl_set_hostname(altcp_tls_context(pcb), req->hostname);
+#endif
     return pcb;
 }
+#endif
+
+// Connect once the name is in the DNS cache: httpc resolves it again, from the local host list
+static err_t internal_request_start(EXAMPLE_HTTP_REQUEST_T *req) {
+#if LWIP_ALTCP && LWIP_ALTCP_TLS
+    const uint16_t default_port = req->tls_config ? 443 : 80;
+#else
+    const uint16_t default_port = 80;
+#endif
+    return httpc_get_file_dns(req->hostname, req->port ? req->port : default_port, req->url, &req->settings, internal_recv_fn, req, NULL);
+}
+
+static void internal_dns_found(__unused const char *hostname, const ip_addr_t *addr, void *arg) {
+    EXAMPLE_HTTP_REQUEST_T *req = (EXAMPLE_HTTP_REQUEST_T*)arg;
+    if (!addr) {
+        internal_result_fn(req, HTTPC_RESULT_ERR_HOSTNAME, 0, 0, ERR_ARG);
+        return;
+    }
+    err_t err = internal_request_start(req);
+    if (err != ERR_OK) {
+        HTTP_ERROR("http request failed: %d\n", err);
+        internal_result_fn(req, HTTPC_RESULT_ERR_CONNECT, 0, 0, err);
+    }
+}
 
 // Make a http request, complete when req->complete returns true
 int http_client_request_async(async_context_t *context, EXAMPLE_HTTP_REQUEST_T *req) {
 #if LWIP_ALTCP
-    const uint16_t default_port = req->tls_config ? 443 : 80;
+#if LWIP_ALTCP_TLS && LWIP_ALTCP_TLS_MBEDTLS
+    if (req->tls_cache && !req->tls_config) {
+        req->tls_config = req->tls_cache->config;
+    }
+    memset(&req->tls_conn, 0, sizeof(req->tls_conn));
+#endif
     if (req->tls_config) {
         if (!req->tls_allocator.alloc) {
             req->tls_allocator.alloc = altcp_tls_alloc_sni;
@@ -119,14 +786,18 @@ int http_client_request_async(async_context_t *context, EXAMPLE_HTTP_REQUEST_T *
         }
         req->settings.altcp_allocator = &req->tls_allocator;
     }
-#else
-    const uint16_t default_port = 80;
 #endif
     req->complete = false;
     req->settings.headers_done_fn = req->headers_fn ? internal_header_fn : NULL;
     req->settings.result_fn = internal_result_fn;
     async_context_acquire_lock_blocking(context);
-    err_t ret = httpc_get_file_dns(req->hostname, req->port ? req->port : default_port, req->url, &req->settings, internal_recv_fn, req, NULL);
+    ip_addr_t addr;
+    err_t ret = http_client_dns_lookup(req->hostname, &addr, &req->dns_waiter, internal_dns_found, req);
+    if (ret == ERR_OK) {
+        ret = internal_request_start(req);
+    } else if (ret == ERR_INPROGRESS) {
+        ret = ERR_OK; // Started from internal_dns_found
+    }
     async_context_release_lock(context);
     if (ret != ERR_OK) {
         HTTP_ERROR("http request failed: %d", ret);
@@ -147,3 +818,547 @@ int http_client_request_sync(async_context_t *context, EXAMPLE_HTTP_REQUEST_T *r
     }
     return req->result;
 }
+
+// ---------------------------------------------------------------------------
+// Keep-alive client: one persistent connection, successive requests on it
+// ---------------------------------------------------------------------------
+
+static void keepalive_connect(EXAMPLE_HTTP_KEEPALIVE_T *ka);
+
+// Release the connection. Returns true if it had to be aborted (callers in a
+// recv/poll callback must then return ERR_ABRT)
+static bool keepalive_drop(EXAMPLE_HTTP_KEEPALIVE_T *ka, bool abort) {
+    bool aborted = false;
+    if (ka->pcb) {
+        struct altcp_pcb *pcb = ka->pcb;
+        altcp_arg(pcb, NULL);
+        altcp_recv(pcb, NULL);
+        altcp_err(pcb, NULL);
+        altcp_poll(pcb, NULL, 0);
+        if (abort || altcp_close(pcb) != ERR_OK) {
+            altcp_abort(pcb);
+            aborted = true;
+        }
+    }
+    ka->pcb = NULL;
+    ka->connected = false;
+    ka->served = 0;
+    if (ka->rx_headers) {
+        pbuf_free(ka->rx_headers);
+        ka->rx_headers = NULL;
+    }
+    return aborted;
+}
+
+// End the current request and report it. Returns true if the connection was aborted
+static bool keepalive_finish(EXAMPLE_HTTP_KEEPALIVE_T *ka, httpc_result_t result, err_t err) {
+    bool aborted = false;
+#if LWIP_ALTCP && LWIP_ALTCP_TLS && LWIP_ALTCP_TLS_MBEDTLS
+    if (ka->tls_config && result != HTTPC_RESULT_OK) {
+        tls_conn_failed(&ka->tls_conn);
+    }
+#endif
+    if (result != HTTPC_RESULT_OK || ka->close_after) {
+        aborted = keepalive_drop(ka, result != HTTPC_RESULT_OK);
+    }
+    ka->latency_us = (uint32_t)(time_us_64() - ka->t_start);
+    ka->busy = false;
+    ka->complete = true;
+    ka->result = result;
+    if (result == HTTPC_RESULT_OK) {
+        ka->requests++;
+    }
+    HTTP_DEBUG("keepalive result %d status %u len %u %u us\n", result, ka->status, ka->rx_content_len, ka->latency_us);
+    if (ka->result_fn) {
+        ka->result_fn(ka->callback_arg, result, ka->rx_content_len, ka->status, err);
+    }
+    return aborted;
+}
+
+// The connection went away without a response: retry once if it was a reused
+// connection (the server may close an idle keep-alive at any time), else fail
+static void keepalive_lost(EXAMPLE_HTTP_KEEPALIVE_T *ka, bool reused, err_t err) {
+    if (reused && !ka->retried && ka->rx_total == 0) {
+        HTTP_DEBUG("keepalive connection closed by server, reconnecting\n");
+        ka->retried = true;
+        keepalive_connect(ka);
+    } else {
+        keepalive_finish(ka, reused || ka->rx_total ? HTTPC_RESULT_ERR_CLOSED : HTTPC_RESULT_ERR_CONNECT, err);
+    }
+}
+
+static err_t keepalive_send(EXAMPLE_HTTP_KEEPALIVE_T *ka) {
+    if (ka->request_len + ka->body_len > altcp_sndbuf(ka->pcb)) {
+        return ERR_MEM;
+    }
+    err_t err = altcp_write(ka->pcb, ka->request, ka->request_len,
+                            TCP_WRITE_FLAG_COPY | (ka->body_len ? TCP_WRITE_FLAG_MORE : 0));
+    if (err == ERR_OK && ka->body_len) {
+        err = altcp_write(ka->pcb, ka->body, ka->body_len, TCP_WRITE_FLAG_COPY);
+    }
+    if (err == ERR_OK) {
+        err = altcp_output(ka->pcb);
+    }
+    return err;
+}
+
+// Parse the status line and the headers we care about. Returns false if the
+// response cannot be handled
+static bool keepalive_parse_headers(EXAMPLE_HTTP_KEEPALIVE_T *ka, u16_t hdr_len) {
+    char hdr[HTTP_KEEPALIVE_HEADER_MAX + 1];
+    u16_t len = pbuf_copy_partial(ka->rx_headers, hdr, LWIP_MIN(hdr_len, HTTP_KEEPALIVE_HEADER_MAX), 0);
+    hdr[len] = '\0';
+
+    unsigned major, minor, status;
+    if (sscanf(hdr, "HTTP/%u.%u %u", &major, &minor, &status) != 3) {
+        return false;
+    }
+    ka->status = status;
+    ka->content_len = 0xFFFFFFFFu; // Unknown: read until the server closes
+    ka->close_after = major == 1 && minor == 0; // HTTP/1.0 closes unless told otherwise
+
+    for (char *line = strstr(hdr, "\r\n"); line; line = strstr(line, "\r\n")) {
+        line += 2;
+        if (!lwip_strnicmp(line, "Content-Length:", 15)) {
+            ka->content_len = strtoul(line + 15, NULL, 10);
+        } else if (!lwip_strnicmp(line, "Connection:", 11)) {
+            const char *v = line + 11;
+            while (*v == ' ') v++;
+            if (!lwip_strnicmp(v, "close", 5)) {
+                ka->close_after = true;
+            } else if (!lwip_strnicmp(v, "keep-alive", 10)) {
+                ka->close_after = false;
+            }
+        } else if (!lwip_strnicmp(line, "Transfer-Encoding:", 18)) {
+            return false; // Chunked bodies are not supported
+        }
+    }
+    // 1xx, 204 and 304 have no body
+    if (status < 200 || status == 204 || status == 304) {
+        ka->content_len = 0;
+    }
+    if (ka->content_len == 0xFFFFFFFFu) {
+        ka->close_after = true;
+    }
+    return true;
+}
+
+// Pass body data to the application. Returns true if the connection was aborted
+static bool keepalive_body(EXAMPLE_HTTP_KEEPALIVE_T *ka, struct pbuf *p) {
+    if (p && p->tot_len) {
+        if (ka->content_len != 0xFFFFFFFFu && p->tot_len > ka->content_len - ka->rx_content_len) {
+            pbuf_realloc(p, (u16_t)(ka->content_len - ka->rx_content_len)); // Ignore anything past the body
+        }
+        ka->rx_content_len += p->tot_len;
+        if (ka->recv_fn) {
+            ka->recv_fn(ka->callback_arg, NULL, p, ERR_OK); // Already acknowledged in keepalive_recv_fn
+        } else {
+            pbuf_free(p);
+        }
+    } else if (p) {
+        pbuf_free(p);
+    }
+    if (ka->content_len != 0xFFFFFFFFu && ka->rx_content_len >= ka->content_len) {
+        return keepalive_finish(ka, HTTPC_RESULT_OK, ERR_OK);
+    }
+    return false;
+}
+
+static err_t keepalive_recv_fn(void *arg, struct altcp_pcb *pcb, struct pbuf *p, err_t err) {
+    EXAMPLE_HTTP_KEEPALIVE_T *ka = (EXAMPLE_HTTP_KEEPALIVE_T*)arg;
+    if (!p) {
+        // Closed by the server
+        bool reused = ka->served > 0;
+        bool busy = ka->busy;
+        bool aborted = keepalive_drop(ka, false);
+        if (busy) {
+            if (ka->headers_done && ka->content_len == 0xFFFFFFFFu) {
+                keepalive_finish(ka, HTTPC_RESULT_OK, ERR_OK); // Body delimited by the close
+            } else {
+                keepalive_lost(ka, reused, ERR_CLSD);
+            }
+        }
+        return aborted ? ERR_ABRT : ERR_OK;
+    }
+    altcp_recved(pcb, p->tot_len);
+    if (!ka->busy) {
+        pbuf_free(p); // Nothing was asked for
+        return ERR_OK;
+    }
+    ka->rx_total += p->tot_len;
+
+    if (ka->headers_done) {
+        return keepalive_body(ka, p) ? ERR_ABRT : ERR_OK;
+    }
+
+    // Accumulate until the end of the headers
+    if (ka->rx_headers) {
+        pbuf_cat(ka->rx_headers, p);
+    } else {
+        ka->rx_headers = p;
+    }
+    u16_t end = pbuf_memfind(ka->rx_headers, "\r\n\r\n", 4, 0);
+    if (end == 0xFFFF) {
+        if (ka->rx_headers->tot_len > HTTP_KEEPALIVE_HEADER_MAX) {
+            return keepalive_finish(ka, HTTPC_RESULT_ERR_SVR_RESP, ERR_OK) ? ERR_ABRT : ERR_OK;
+        }
+        return ERR_OK;
+    }
+    u16_t hdr_len = end + 4;
+    if (!keepalive_parse_headers(ka, hdr_len)) {
+        HTTP_ERROR("keepalive: unsupported response\n");
+        return keepalive_finish(ka, HTTPC_RESULT_ERR_SVR_RESP, ERR_OK) ? ERR_ABRT : ERR_OK;
+    }
+    ka->headers_done = true;
+    ka->served++;
+    if (ka->headers_fn) {
+        if (ka->headers_fn(NULL, ka->callback_arg, ka->rx_headers, hdr_len,
+                           ka->content_len == 0xFFFFFFFFu ? 0 : ka->content_len) != ERR_OK) {
+            return keepalive_finish(ka, HTTPC_RESULT_LOCAL_ABORT, ERR_OK) ? ERR_ABRT : ERR_OK;
+        }
+    }
+    struct pbuf *body = pbuf_free_header(ka->rx_headers, hdr_len);
+    ka->rx_headers = NULL;
+    return keepalive_body(ka, body) ? ERR_ABRT : ERR_OK;
+}
+
+static void keepalive_err_fn(void *arg, err_t err) {
+    EXAMPLE_HTTP_KEEPALIVE_T *ka = (EXAMPLE_HTTP_KEEPALIVE_T*)arg;
+    // The pcb has already been freed
+    bool reused = ka->served > 0;
+    bool connected = ka->connected;
+    ka->pcb = NULL;
+    keepalive_drop(ka, false);
+    if (ka->busy) {
+        if (connected) {
+            keepalive_lost(ka, reused, err);
+        } else {
+            keepalive_finish(ka, HTTPC_RESULT_ERR_CONNECT, err);
+        }
+    }
+}
+
+static err_t keepalive_poll_fn(void *arg, __unused struct altcp_pcb *pcb) {
+    EXAMPLE_HTTP_KEEPALIVE_T *ka = (EXAMPLE_HTTP_KEEPALIVE_T*)arg;
+    uint32_t timeout_ms = ka->timeout_ms ? ka->timeout_ms : HTTP_KEEPALIVE_TIMEOUT_MS;
+    if (ka->busy && time_us_64() - ka->t_start > (uint64_t)timeout_ms * 1000) {
+        HTTP_ERROR("keepalive: request timed out\n");
+        return keepalive_finish(ka, HTTPC_RESULT_ERR_TIMEOUT, ERR_TIMEOUT) ? ERR_ABRT : ERR_OK;
+    }
+    return ERR_OK;
+}
+
+static err_t keepalive_connected_fn(void *arg, __unused struct altcp_pcb *pcb, err_t err) {
+    EXAMPLE_HTTP_KEEPALIVE_T *ka = (EXAMPLE_HTTP_KEEPALIVE_T*)arg;
+    if (err != ERR_OK) {
+        return err; // Reported through the err callback
+    }
+    ka->connected = true;
+    if (ka->busy && keepalive_send(ka) != ERR_OK) {
+        return keepalive_finish(ka, HTTPC_RESULT_ERR_CONNECT, ERR_CONN) ? ERR_ABRT : ERR_OK;
+    }
+    return ERR_OK;
+}
+
+static void keepalive_connect_addr(EXAMPLE_HTTP_KEEPALIVE_T *ka) {
+#if LWIP_ALTCP && LWIP_ALTCP_TLS
+#if LWIP_ALTCP_TLS_MBEDTLS
+    if (ka->tls_cache && !ka->tls_config) {
+        ka->tls_config = ka->tls_cache->config;
+    }
+#endif
+    const uint16_t default_port = ka->tls_config ? 443 : 80;
+    if (ka->tls_config) {
+        ka->pcb = altcp_tls_new(ka->tls_config, IP_GET_TYPE(&ka->addr));
+        if (ka->pcb) {
+#if LWIP_ALTCP_TLS_MBEDTLS
+            tls_conn_attach(&ka->tls_conn, ka->tls_cache, ka->pcb, ka->hostname);
+#else
+            mbedtls_ssl_set_hostname(altcp_tls_context(ka->pcb), ka->hostname);
+#endif
+        }
+    } else
+#else
+    const uint16_t default_port = 80;
+#endif
+    {
+        ka->pcb = altcp_tcp_new_ip_type(IP_GET_TYPE(&ka->addr));
+    }
+    if (!ka->pcb) {
+        keepalive_finish(ka, HTTPC_RESULT_ERR_MEM, ERR_MEM);
+        return;
+    }
+    ka->connections++;
+    altcp_arg(ka->pcb, ka);
+    altcp_recv(ka->pcb, keepalive_recv_fn);
+    altcp_err(ka->pcb, keepalive_err_fn);
+    altcp_poll(ka->pcb, keepalive_poll_fn, 2);
+    altcp_nagle_disable(ka->pcb); // Each request is a single small write
+    err_t err = altcp_connect(ka->pcb, &ka->addr, ka->port ? ka->port : default_port, keepalive_connected_fn);
+    if (err != ERR_OK) {
+        keepalive_drop(ka, true);
+        keepalive_finish(ka, HTTPC_RESULT_ERR_CONNECT, err);
+    }
+}
+
+static void keepalive_dns_found(__unused const char *name, const ip_addr_t *ipaddr, void *arg) {
+    EXAMPLE_HTTP_KEEPALIVE_T *ka = (EXAMPLE_HTTP_KEEPALIVE_T*)arg;
+    if (!ka->busy) {
+        return;
+    }
+    if (!ipaddr) {
+        keepalive_finish(ka, HTTPC_RESULT_ERR_HOSTNAME, ERR_ARG);
+        return;
+    }
+    ip_addr_copy(ka->addr, *ipaddr);
+    keepalive_connect_addr(ka);
+}
+
+static void keepalive_connect(EXAMPLE_HTTP_KEEPALIVE_T *ka) {
+    keepalive_drop(ka, false);
+    ka->headers_done = false;
+    ka->rx_total = 0;
+    err_t err = http_client_dns_lookup(ka->hostname, &ka->addr, &ka->dns_waiter, keepalive_dns_found, ka);
+    if (err == ERR_INPROGRESS) {
+        ka->lookups++;
+        return;
+    }
+    if (err != ERR_OK) {
+        keepalive_finish(ka, HTTPC_RESULT_ERR_HOSTNAME, err);
+        return;
+    }
+    keepalive_connect_addr(ka);
+}
+
+// Make a GET request on the keep-alive connection, complete when ka->complete returns true
+// Send the request already formatted in ka->request
+static int keepalive_start(async_context_t *context, EXAMPLE_HTTP_KEEPALIVE_T *ka, int len) {
+    if (len < 0 || len >= (int)sizeof(ka->request)) {
+        HTTP_ERROR("keepalive: url too long\n");
+        return ERR_VAL;
+    }
+    ka->request_len = (uint16_t)len;
+    ka->t_start = time_us_64();
+    ka->complete = false;
+    ka->busy = true;
+    ka->retried = false;
+    ka->headers_done = false;
+    ka->status = 0;
+    ka->rx_content_len = 0;
+    ka->rx_total = 0;
+
+    async_context_acquire_lock_blocking(context);
+    if (ka->pcb && ka->connected) {
+        if (keepalive_send(ka) != ERR_OK) {
+            keepalive_lost(ka, true, ERR_CONN); // Reconnect and send there
+        }
+    } else if (!ka->pcb) {
+        keepalive_connect(ka);
+    }
+    // else: still connecting, the request goes out when the connection is established
+    async_context_release_lock(context);
+    return ERR_OK;
+}
+
+int http_client_keepalive_request_async(async_context_t *context, EXAMPLE_HTTP_KEEPALIVE_T *ka, const char *url) {
+    assert(ka && ka->hostname && url);
+    if (ka->busy) {
+        return ERR_INPROGRESS;
+    }
+    ka->body = NULL;
+    ka->body_len = 0;
+    int len = snprintf(ka->request, sizeof(ka->request),
+                       "GET %s HTTP/1.1\r\n"
+                       "Host: %s\r\n"
+                       "Connection: keep-alive\r\n"
+                       "\r\n",
+                       url, ka->hostname);
+    return keepalive_start(context, ka, len);
+}
+
+int http_client_keepalive_post_async(async_context_t *context, EXAMPLE_HTTP_KEEPALIVE_T *ka, const char *url,
+                                     const char *content_type, const void *body, uint16_t body_len) {
+    assert(ka && ka->hostname && url && content_type && (body || !body_len));
+    if (ka->busy) {
+        return ERR_INPROGRESS;
+    }
+    ka->body = (const uint8_t*)body;
+    ka->body_len = body_len;
+    int len = snprintf(ka->request, sizeof(ka->request),
+                       "POST %s HTTP/1.1\r\n"
+                       "Host: %s\r\n"
+                       "Connection: keep-alive\r\n"
+                       "Content-Type: %s\r\n"
+                       "Content-Length: %u\r\n"
+                       "\r\n",
+                       url, ka->hostname, content_type, body_len);
+    if (len > 0 && len + body_len > TCP_SND_BUF) {
+        HTTP_ERROR("keepalive: body too large\n");
+        return ERR_MEM;
+    }
+    return keepalive_start(context, ka, len);
+}
+
+// Make a GET request on the keep-alive connection and only return when it has completed
+int http_client_keepalive_request_sync(async_context_t *context, EXAMPLE_HTTP_KEEPALIVE_T *ka, const char *url) {
+    int ret = http_client_keepalive_request_async(context, ka, url);
+    if (ret != 0) {
+        return ret;
+    }
+    while(!ka->complete) {
+        async_context_poll(context);
+        async_context_wait_for_work_ms(context, 1000);
+    }
+    return ka->result;
+}
+
+// Make a POST request on the keep-alive connection and only return when it has completed
+int http_client_keepalive_post_sync(async_context_t *context, EXAMPLE_HTTP_KEEPALIVE_T *ka, const char *url,
+                                    const char *content_type, const void *body, uint16_t body_len) {
+    int ret = http_client_keepalive_post_async(context, ka, url, content_type, body, body_len);
+    if (ret != 0) {
+        return ret;
+    }
+    while(!ka->complete) {
+        async_context_poll(context);
+        async_context_wait_for_work_ms(context, 1000);
+    }
+    return ka->result;
+}
+
+void http_client_keepalive_close(async_context_t *context, EXAMPLE_HTTP_KEEPALIVE_T *ka) {
+    async_context_acquire_lock_blocking(context);
+    keepalive_drop(ka, false);
+    async_context_release_lock(context);
+}
+
+// ---------------------------------------------------------------------------
+// Request queue: fixed pool of slots, bounded number of requests in flight
+// ---------------------------------------------------------------------------
+
+static err_t queue_header_fn(httpc_state_t *connection, void *arg, struct pbuf *hdr, u16_t hdr_len, u32_t content_len) {
+    EXAMPLE_HTTP_QUEUE_T *queue = ((EXAMPLE_HTTP_QUEUE_SLOT_T*)arg)->queue;
+    return queue->headers_fn(connection, queue->callback_arg, hdr, hdr_len, content_len);
+}
+
+static err_t queue_recv_fn(void *arg, struct altcp_pcb *conn, struct pbuf *p, err_t err) {
+    EXAMPLE_HTTP_QUEUE_T *queue = ((EXAMPLE_HTTP_QUEUE_SLOT_T*)arg)->queue;
+    if (queue->recv_fn) {
+        return queue->recv_fn(queue->callback_arg, conn, p, err);
+    }
+    if (p) {
+        altcp_recved(conn, p->tot_len);
+        pbuf_free(p);
+    }
+    return ERR_OK;
+}
+
+// Release the slot and report the request. The slot may be reused by the callback
+static void queue_complete(EXAMPLE_HTTP_QUEUE_SLOT_T *slot, httpc_result_t result, uint32_t status) {
+    EXAMPLE_HTTP_QUEUE_T *queue = slot->queue;
+    uint32_t latency_us = (uint32_t)(time_us_64() - slot->t_submit);
+    http_client_queue_done_fn done_fn = slot->done_fn;
+    void *arg = slot->done_arg;
+    slot->used = false;
+    queue->in_flight--;
+    queue->completed++;
+    if (queue->waiting) {
+        async_context_set_work_pending(queue->context, &queue->worker);
+    }
+    if (done_fn) {
+        done_fn(arg, result, status, latency_us);
+    }
+}
+
+static void queue_result_fn(void *arg, httpc_result_t httpc_result, __unused u32_t rx_content_len, u32_t srv_res, __unused err_t err) {
+    queue_complete((EXAMPLE_HTTP_QUEUE_SLOT_T*)arg, httpc_result, srv_res);
+}
+
+// Start waiting requests while there is room. Runs in the async context, never from an httpc
+// callback, so a request is not started while lwIP is still tearing down the previous one
+static void queue_dispatch(async_context_t *context, async_when_pending_worker_t *worker) {
+    EXAMPLE_HTTP_QUEUE_T *queue = (EXAMPLE_HTTP_QUEUE_T*)worker->user_data;
+    const uint8_t max_in_flight = queue->max_in_flight ? queue->max_in_flight : 1;
+    while (queue->waiting && queue->in_flight < max_in_flight) {
+        EXAMPLE_HTTP_QUEUE_SLOT_T *slot = &queue->slots[queue->order[queue->next]];
+        queue->next = (queue->next + 1) % HTTP_CLIENT_QUEUE_SLOTS;
+        queue->waiting--;
+        queue->in_flight++;
+        int ret = http_client_request_async(context, &slot->req);
+        if (ret != ERR_OK) {
+            // httpc does not call the result callback when it fails to start
+            queue_complete(slot, ret == ERR_MEM ? HTTPC_RESULT_ERR_MEM : HTTPC_RESULT_ERR_CONNECT, 0);
+        }
+    }
+}
+
+int http_client_queue_submit(async_context_t *context, EXAMPLE_HTTP_QUEUE_T *queue, const char *url,
+                             http_client_queue_done_fn done_fn, void *arg) {
+    assert(queue && queue->hostname && url);
+    size_t url_len = strlen(url);
+    if (url_len >= HTTP_CLIENT_QUEUE_URL_MAX) {
+        HTTP_ERROR("queue: url too long\n");
+        return ERR_VAL;
+    }
+
+    async_context_acquire_lock_blocking(context);
+    if (!queue->context) {
+        queue->context = context;
+        queue->worker.do_work = queue_dispatch;
+        queue->worker.user_data = queue;
+        async_context_add_when_pending_worker(context, &queue->worker);
+    }
+    int index = -1;
+    for (int i = 0; i < HTTP_CLIENT_QUEUE_SLOTS; i++) {
+        if (!queue->slots[i].used) {
+            index = i;
+            break;
+        }
+    }
+    if (index < 0) {
+        queue->rejected++;
+        async_context_release_lock(context);
+        return ERR_MEM;
+    }
+
+    EXAMPLE_HTTP_QUEUE_SLOT_T *slot = &queue->slots[index];
+    memset(&slot->req, 0, sizeof(slot->req));
+    memcpy(slot->url, url, url_len + 1);
+    slot->req.hostname = queue->hostname;
+    slot->req.url = slot->url;
+    slot->req.port = queue->port;
+    slot->req.headers_fn = queue->headers_fn ? queue_header_fn : NULL;
+    slot->req.recv_fn = queue_recv_fn;
+    slot->req.result_fn = queue_result_fn;
+    slot->req.callback_arg = slot;
+#if LWIP_ALTCP && LWIP_ALTCP_TLS
+    slot->req.tls_config = queue->tls_config;
+#if LWIP_ALTCP_TLS_MBEDTLS
+    slot->req.tls_cache = queue->tls_cache;
+#endif
+#endif
+    slot->queue = queue;
+    slot->done_fn = done_fn;
+    slot->done_arg = arg;
+    slot->t_submit = time_us_64();
+    slot->used = true;
+
+    queue->order[(queue->next + queue->waiting) % HTTP_CLIENT_QUEUE_SLOTS] = (uint8_t)index;
+    queue->waiting++;
+    queue->submitted++;
+    async_context_set_work_pending(context, &queue->worker);
+    async_context_release_lock(context);
+    return ERR_OK;
+}
+
+unsigned http_client_queue_free_slots(const EXAMPLE_HTTP_QUEUE_T *queue) {
+    unsigned free_slots = 0;
+    for (int i = 0; i < HTTP_CLIENT_QUEUE_SLOTS; i++) {
+        free_slots += !queue->slots[i].used;
+    }
+    return free_slots;
+}
+
+bool http_client_queue_idle(const EXAMPLE_HTTP_QUEUE_T *queue) {
+    return queue->waiting == 0 && queue->in_flight == 0;
+}
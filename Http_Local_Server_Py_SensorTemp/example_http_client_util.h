@@ -7,8 +7,221 @@
 #ifndef EXAMPLE_HTTP_CLIENT_UTIL_H
 #define EXAMPLE_HTTP_CLIENT_UTIL_H
 
+#include <stdbool.h>
+#include "pico/async_context.h"
 #include "lwip/apps/http_client.h"
 
+#if LWIP_ALTCP && LWIP_ALTCP_TLS && LWIP_ALTCP_TLS_MBEDTLS
+#include "mbedtls/ssl.h"
+
+/*! \brief Number of hosts whose TLS session is kept for resumption
+ *  \ingroup pico_lwip
+ */
+#ifndef HTTP_CLIENT_TLS_SESSIONS
+#define HTTP_CLIENT_TLS_SESSIONS 2
+#endif
+
+/*! \brief Longest host name that can have a cached TLS session
+ *  \ingroup pico_lwip
+ */
+#ifndef HTTP_CLIENT_TLS_HOSTNAME_MAX
+#define HTTP_CLIENT_TLS_HOSTNAME_MAX 64
+#endif
+
+/*! \brief TLS session kept for one host
+ *  \ingroup pico_lwip
+ */
+typedef struct EXAMPLE_HTTP_TLS_SESSION {
+    char hostname[HTTP_CLIENT_TLS_HOSTNAME_MAX];
+    mbedtls_ssl_session session;
+    bool valid;
+    uint32_t last_used;
+} EXAMPLE_HTTP_TLS_SESSION_T;
+
+/*! \brief Long-lived TLS client state shared by many connections
+ *  \ingroup pico_lwip
+ *
+ * Holds one \em altcp_tls_config, so the CA chain is parsed (and the random generator seeded)
+ * once instead of for every request, and the last session negotiated with each host. A later
+ * connection to the same host offers that session (session ID or ticket), so a server that still
+ * knows it skips the certificate exchange and the key agreement: an abbreviated handshake.
+ * A session that fails to resume is replaced by the one from the new full handshake.
+ *
+ * Set up with \em http_client_tls_cache_init and pass it in the \em tls_cache field of a request,
+ * keep-alive connection or queue. Use from the async context only (requests take the lock).
+ */
+typedef struct EXAMPLE_HTTP_TLS_CACHE {
+    /*!
+     * Configuration used by every connection, created by \em http_client_tls_cache_init
+     */
+    struct altcp_tls_config *config;
+    /*!
+     * Handshakes that negotiated a new session
+     */
+    uint32_t full_handshakes;
+    /*!
+     * Handshakes that resumed a cached session
+     */
+    uint32_t resumed_handshakes;
+    /*!
+     * Sum of the full handshake times, in microseconds
+     */
+    uint64_t full_us;
+    /*!
+     * Sum of the resumed handshake times, in microseconds
+     */
+    uint64_t resumed_us;
+    /*!
+     * Highest mbedtls heap use seen during a full handshake, in bytes (0 without MBEDTLS_PLATFORM_MEMORY)
+     */
+    size_t full_heap_peak;
+    /*!
+     * Highest mbedtls heap use seen during a resumed handshake, in bytes (0 without MBEDTLS_PLATFORM_MEMORY)
+     */
+    size_t resumed_heap_peak;
+
+    // Internal state
+    uint32_t stamp;
+    EXAMPLE_HTTP_TLS_SESSION_T sessions[HTTP_CLIENT_TLS_SESSIONS];
+} EXAMPLE_HTTP_TLS_CACHE_T;
+
+/*! \brief Handshake of one TLS connection, as measured by the client
+ *  \ingroup pico_lwip
+ *
+ * Only valid once \em done is set. Fields after \em heap_peak are internal.
+ */
+typedef struct EXAMPLE_HTTP_TLS_CONN {
+    /*!
+     * The handshake completed
+     */
+    bool done;
+    /*!
+     * The handshake resumed the session cached for the host
+     */
+    bool resumed;
+    /*!
+     * Time from the ClientHello to the end of the handshake, in microseconds
+     */
+    uint32_t handshake_us;
+    /*!
+     * Highest mbedtls heap use during the handshake, in bytes (0 without MBEDTLS_PLATFORM_MEMORY)
+     */
+    size_t heap_peak;
+
+    // Internal state
+    EXAMPLE_HTTP_TLS_CACHE_T *cache;
+    const char *hostname;
+    mbedtls_ssl_context *ssl;
+    void *bio;
+    mbedtls_ssl_send_t *bio_send;
+    mbedtls_ssl_recv_t *bio_recv;
+    uint64_t t_start;
+    bool offered;
+    unsigned char offered_master[48];
+} EXAMPLE_HTTP_TLS_CONN_T;
+#endif
+
+/*! \brief Number of host names kept in the DNS cache
+ *  \ingroup pico_lwip
+ */
+#ifndef HTTP_CLIENT_DNS_ENTRIES
+#define HTTP_CLIENT_DNS_ENTRIES 4
+#endif
+
+/*! \brief Longest host name the DNS cache can keep, including the terminator
+ *  \ingroup pico_lwip
+ */
+#ifndef HTTP_CLIENT_DNS_HOSTNAME_MAX
+#define HTTP_CLIENT_DNS_HOSTNAME_MAX 64
+#endif
+
+/*! \brief Shortest time an answer is kept, in seconds, whatever its TTL
+ *  \ingroup pico_lwip
+ */
+#ifndef HTTP_CLIENT_DNS_MIN_TTL_S
+#define HTTP_CLIENT_DNS_MIN_TTL_S 10
+#endif
+
+/*! \brief Longest time an answer is kept, in seconds, whatever its TTL
+ *  \ingroup pico_lwip
+ */
+#ifndef HTTP_CLIENT_DNS_MAX_TTL_S
+#define HTTP_CLIENT_DNS_MAX_TTL_S 86400
+#endif
+
+/*! \brief Time a failed lookup is remembered, in seconds, when the server gives no SOA record or does not answer
+ *  \ingroup pico_lwip
+ */
+#ifndef HTTP_CLIENT_DNS_NEGATIVE_TTL_S
+#define HTTP_CLIENT_DNS_NEGATIVE_TTL_S 30
+#endif
+
+/*! \brief Fraction of the TTL, in percent, after which a name still in use is looked up again in the background
+ *  \ingroup pico_lwip
+ */
+#ifndef HTTP_CLIENT_DNS_REFRESH_PERCENT
+#define HTTP_CLIENT_DNS_REFRESH_PERCENT 75
+#endif
+
+/*! \brief Time to wait for a DNS answer before asking again, in milliseconds
+ *  \ingroup pico_lwip
+ */
+#ifndef HTTP_CLIENT_DNS_RETRY_MS
+#define HTTP_CLIENT_DNS_RETRY_MS 1000
+#endif
+
+/*! \brief Queries sent for one lookup before it fails, rotating over the configured DNS servers
+ *  \ingroup pico_lwip
+ */
+#ifndef HTTP_CLIENT_DNS_TRIES
+#define HTTP_CLIENT_DNS_TRIES 4
+#endif
+
+/*! \brief Function called when a DNS cache lookup that had to wait completes
+ *  \ingroup pico_lwip
+ *
+ * @param hostname the name looked up
+ * @param addr its address, or null if the lookup failed
+ * @param arg argument given to \em http_client_dns_lookup
+ */
+typedef void (*http_client_dns_found_fn)(const char *hostname, const ip_addr_t *addr, void *arg);
+
+/*! \brief Caller waiting for a DNS cache lookup (internal, embedded in requests and connections)
+ *  \ingroup pico_lwip
+ */
+typedef struct EXAMPLE_HTTP_DNS_WAITER {
+    struct EXAMPLE_HTTP_DNS_WAITER *next;
+    http_client_dns_found_fn found_fn;
+    void *arg;
+    bool linked;
+} EXAMPLE_HTTP_DNS_WAITER_T;
+
+/*! \brief Counters of the DNS cache
+ *  \ingroup pico_lwip
+ */
+typedef struct EXAMPLE_HTTP_DNS_STATS {
+    /*!
+     * Lookups answered from a fresh entry
+     */
+    uint32_t hits;
+    /*!
+     * Lookups refused straight away because the name failed recently
+     */
+    uint32_t negative_hits;
+    /*!
+     * Lookups that had to wait for a query
+     */
+    uint32_t misses;
+    /*!
+     * Queries started in the background for names about to expire
+     */
+    uint32_t refreshes;
+    /*!
+     * DNS queries sent, retries included
+     */
+    uint32_t queries;
+} EXAMPLE_HTTP_DNS_STATS_T;
+
 /*! \brief Parameters used to make HTTP request
  *  \ingroup pico_lwip
  */
@@ -54,11 +267,26 @@ typedef struct EXAMPLE_HTTP_REQUEST {
      * TLS allocator, used internall for setting TLS server name indication
      */
     altcp_allocator_t tls_allocator;
+#if LWIP_ALTCP_TLS_MBEDTLS
+    /*!
+     * TLS configuration and session cache, can be null. If set and \em tls_config is null, its
+     * configuration is used and the cached session for the host is offered for resumption
+     */
+    EXAMPLE_HTTP_TLS_CACHE_T *tls_cache;
+    /*!
+     * Handshake of the last TLS request
+     */
+    EXAMPLE_HTTP_TLS_CONN_T tls_conn;
+#endif
 #endif
     /*!
      * LwIP HTTP client settings
      */
     httpc_connection_t settings;
+    /*!
+     * Lookup of the host name in the DNS cache, used internally
+     */
+    EXAMPLE_HTTP_DNS_WAITER_T dns_waiter;
     /*!
      * Flag to indicate when the request is complete
      */
@@ -97,6 +325,71 @@ int http_client_request_async(struct async_context *context, EXAMPLE_HTTP_REQUES
  */
 int http_client_request_sync(struct async_context *context, EXAMPLE_HTTP_REQUEST_T *req);
 
+/*! \brief Function given each contiguous piece of a pbuf chain
+ *  \ingroup pico_lwip
+ *
+ * @param arg argument given with the function
+ * @param data start of the piece, only valid during the call
+ * @param len length of the piece in bytes
+ * @return ERR_OK to carry on, anything else to stop
+ */
+typedef err_t (*http_client_slice_fn)(void *arg, const uint8_t *data, u16_t len);
+
+/*! \brief Walk part of a pbuf chain one contiguous slice at a time
+ *  \ingroup pico_lwip
+ *
+ * Each pbuf payload is handed over in place, without copying, instead of reading the chain byte by
+ * byte with \em pbuf_get_at (which walks the chain from the start on every call).
+ *
+ * @param p pbuf chain
+ * @param offset first byte to hand over
+ * @param len number of bytes to hand over, stops early at the end of the chain
+ * @param slice_fn function called with each slice
+ * @param arg argument for \em slice_fn
+ * @return ERR_OK, or the first error returned by \em slice_fn
+ */
+err_t http_client_pbuf_slices(const struct pbuf *p, u16_t offset, u16_t len, http_client_slice_fn slice_fn, void *arg);
+
+/*! \brief Streaming consumer of response bodies
+ *  \ingroup pico_lwip
+ *
+ * Use \em http_client_receive_slices_fn as the recv callback of a request, keep-alive connection or
+ * queue, with a pointer to this as the callback argument: the body reaches \em slice_fn as it arrives,
+ * one slice per pbuf, and nothing is buffered. Reset \em received and \em err before each response,
+ * e.g. from the headers callback.
+ */
+typedef struct EXAMPLE_HTTP_BODY_CONSUMER {
+    /*!
+     * Function called with each slice of the body
+     */
+    http_client_slice_fn slice_fn;
+    /*!
+     * Argument for \em slice_fn
+     */
+    void *arg;
+    /*!
+     * Bytes of the body received, including any after an error
+     */
+    uint32_t received;
+    /*!
+     * First error returned by \em slice_fn. Once set, the rest of the body is dropped (set it beforehand to skip a body)
+     */
+    err_t err;
+} EXAMPLE_HTTP_BODY_CONSUMER_T;
+
+/*! \brief A http recv callback that hands the body to a \em EXAMPLE_HTTP_BODY_CONSUMER_T
+ *  \ingroup pico_lwip
+ *
+ * Acknowledges the data when given the connection, and frees the pbuf.
+ *
+ * @param arg the \em EXAMPLE_HTTP_BODY_CONSUMER_T
+ * @param conn http client connection, or null if the data was already acknowledged
+ * @param p body pbuf(s)
+ * @param err Error code in the case of an error
+ * @return always ERR_OK
+ */
+err_t http_client_receive_slices_fn(void *arg, struct altcp_pcb *conn, struct pbuf *p, err_t err);
+
 /*! \brief A http header callback that can be passed to \em http_client_init or \em http_client_init_secure
  *  \ingroup pico_http_client
  *
@@ -123,4 +416,434 @@ err_t http_client_header_print_fn(httpc_state_t *connection, void *arg, struct p
  */
 err_t http_client_receive_print_fn(void *arg, struct altcp_pcb *conn, struct pbuf *p, err_t err);
 
+/*! \brief Default time allowed for one request on a keep-alive connection
+ *  \ingroup pico_lwip
+ */
+#ifndef HTTP_KEEPALIVE_TIMEOUT_MS
+#define HTTP_KEEPALIVE_TIMEOUT_MS 10000
+#endif
+
+/*! \brief Maximum size of the request line and headers sent on a keep-alive connection
+ *  \ingroup pico_lwip
+ */
+#ifndef HTTP_KEEPALIVE_REQUEST_MAX
+#define HTTP_KEEPALIVE_REQUEST_MAX 256
+#endif
+
+/*! \brief Maximum size of the response headers parsed on a keep-alive connection
+ *  \ingroup pico_lwip
+ */
+#ifndef HTTP_KEEPALIVE_HEADER_MAX
+#define HTTP_KEEPALIVE_HEADER_MAX 512
+#endif
+
+/*! \brief Persistent HTTP/1.1 connection to a single server
+ *  \ingroup pico_lwip
+ *
+ * Unlike \em http_client_request_async, which connects and closes the connection for every
+ * request, this client writes successive requests on the same connection. It reconnects only when the connection fails or the server closes it;
+ * a request that finds a reused connection already closed by the server is retried once on a new
+ * connection, as browsers do.
+ *
+ * GET and POST requests, one at a time. The response body must be delimited by Content-Length or by the server
+ * closing the connection (chunked bodies are rejected with HTTPC_RESULT_ERR_SVR_RESP).
+ *
+ * Initialise to zero and set at least \em hostname. Fields after \em result are internal.
+ */
+typedef struct EXAMPLE_HTTP_KEEPALIVE {
+    /*!
+     * The name or IP address of the server, e.g. 192.168.0.10
+     */
+    const char *hostname;
+    /*!
+     * The port to use. A default port is chosen if this is set to zero
+     */
+    uint16_t port;
+    /*!
+     * Function to callback with headers, can be null. The connection argument is always null
+     * @see httpc_headers_done_fn
+     */
+    httpc_headers_done_fn headers_fn;
+    /*!
+     * Function to callback with the response body, can be null. It must free the pbuf. The connection
+     * argument is null: the data has already been acknowledged
+     * @see altcp_recv_fn
+     */
+    altcp_recv_fn recv_fn;
+    /*!
+     * Function to callback with final results of each request, can be null
+     * @see httpc_result_fn
+     */
+    httpc_result_fn result_fn;
+    /*!
+     * Callback to pass to calback functions
+     */
+    void *callback_arg;
+    /*!
+     * Time allowed for a request, including any reconnection. HTTP_KEEPALIVE_TIMEOUT_MS if zero
+     */
+    uint32_t timeout_ms;
+#if LWIP_ALTCP && LWIP_ALTCP_TLS
+    /*!
+     * TLS configuration, can be null for plain http
+     */
+    struct altcp_tls_config *tls_config;
+#if LWIP_ALTCP_TLS_MBEDTLS
+    /*!
+     * TLS configuration and session cache, can be null. Used as for \em EXAMPLE_HTTP_REQUEST_T
+     */
+    EXAMPLE_HTTP_TLS_CACHE_T *tls_cache;
+    /*!
+     * Handshake of the current connection
+     */
+    EXAMPLE_HTTP_TLS_CONN_T tls_conn;
+#endif
+#endif
+    /*!
+     * Flag to indicate when the current request is complete
+     */
+    int complete;
+    /*!
+     * Overall result of the last request, only valid when complete is set
+     */
+    httpc_result_t result;
+    /*!
+     * HTTP status code of the last response (0 if none was received)
+     */
+    uint32_t status;
+    /*!
+     * Time from the call to the end of the response for the last request, in microseconds
+     */
+    uint32_t latency_us;
+    /*!
+     * Requests completed successfully
+     */
+    uint32_t requests;
+    /*!
+     * Connections opened (the first one included)
+     */
+    uint32_t connections;
+    /*!
+     * Host name lookups that had to wait for a DNS query
+     */
+    uint32_t lookups;
+
+    // Internal state
+    struct altcp_pcb *pcb;
+    ip_addr_t addr;
+    EXAMPLE_HTTP_DNS_WAITER_T dns_waiter;
+    bool connected;
+    bool busy;
+    bool retried;
+    bool headers_done;
+    bool close_after;
+    uint16_t served;
+    uint16_t request_len;
+    uint16_t body_len;
+    const uint8_t *body;
+    uint32_t content_len;
+    uint32_t rx_content_len;
+    uint32_t rx_total;
+    uint64_t t_start;
+    struct pbuf *rx_headers;
+    char request[HTTP_KEEPALIVE_REQUEST_MAX];
+} EXAMPLE_HTTP_KEEPALIVE_T;
+
+/*! \brief Perform a GET request on a keep-alive connection asynchronously
+ *  \ingroup pico_lwip
+ *
+ * Connects first if there is no open connection to the server.
+ *
+ * @param context async context
+ * @param ka keep-alive connection, initialised to zero with hostname set
+ * @param url The url to request, e.g. /mensagem?msg=ok
+ * @return If zero is returned the request has been made and is complete when \em ka->complete is true or the result callback has been called.
+ *  A non-zero return value indicates an error.
+ */
+int http_client_keepalive_request_async(struct async_context *context, EXAMPLE_HTTP_KEEPALIVE_T *ka, const char *url);
+
+/*! \brief Perform a GET request on a keep-alive connection synchronously
+ *  \ingroup pico_lwip
+ *
+ * @param context async context
+ * @param ka keep-alive connection, initialised to zero with hostname set
+ * @param url The url to request, e.g. /mensagem?msg=ok
+ * @return The overall result of the request. Zero indicates success.
+ */
+int http_client_keepalive_request_sync(struct async_context *context, EXAMPLE_HTTP_KEEPALIVE_T *ka, const char *url);
+
+/*! \brief Perform a POST request on a keep-alive connection asynchronously
+ *  \ingroup pico_lwip
+ *
+ * Connects first if there is no open connection to the server. The body is copied into the
+ * connection's send buffer, so it must fit there (TCP_SND_BUF), and it must stay valid until the
+ * request is complete because it is sent again if the request is retried on a new connection.
+ *
+ * @param context async context
+ * @param ka keep-alive connection, initialised to zero with hostname set
+ * @param url The url to post to, e.g. /lote
+ * @param content_type Value of the Content-Type header, e.g. application/json
+ * @param body The request body
+ * @param body_len Length of the body in bytes
+ * @return If zero is returned the request has been made and is complete when \em ka->complete is true or the result callback has been called.
+ *  A non-zero return value indicates an error.
+ */
+int http_client_keepalive_post_async(struct async_context *context, EXAMPLE_HTTP_KEEPALIVE_T *ka, const char *url,
+                                     const char *content_type, const void *body, uint16_t body_len);
+
+/*! \brief Perform a POST request on a keep-alive connection synchronously
+ *  \ingroup pico_lwip
+ *
+ * @param context async context
+ * @param ka keep-alive connection, initialised to zero with hostname set
+ * @param url The url to post to, e.g. /lote
+ * @param content_type Value of the Content-Type header, e.g. application/json
+ * @param body The request body
+ * @param body_len Length of the body in bytes
+ * @return The overall result of the request. Zero indicates success.
+ */
+int http_client_keepalive_post_sync(struct async_context *context, EXAMPLE_HTTP_KEEPALIVE_T *ka, const char *url,
+                                    const char *content_type, const void *body, uint16_t body_len);
+
+/*! \brief Close a keep-alive connection
+ *  \ingroup pico_lwip
+ *
+ * The next request opens a new connection. Must not be called while a request is in progress.
+ *
+ * @param context async context
+ * @param ka keep-alive connection
+ */
+void http_client_keepalive_close(struct async_context *context, EXAMPLE_HTTP_KEEPALIVE_T *ka);
+
+/*! \brief Number of request slots in a request queue
+ *  \ingroup pico_lwip
+ */
+#ifndef HTTP_CLIENT_QUEUE_SLOTS
+#define HTTP_CLIENT_QUEUE_SLOTS 8
+#endif
+
+/*! \brief Maximum length of a url in a request queue, including the terminator
+ *  \ingroup pico_lwip
+ */
+#ifndef HTTP_CLIENT_QUEUE_URL_MAX
+#define HTTP_CLIENT_QUEUE_URL_MAX 128
+#endif
+
+/*! \brief Function called when a queued request completes
+ *  \ingroup pico_lwip
+ *
+ * Called from the async context (with its lock held), so it must not block. It may submit new requests.
+ *
+ * @param arg argument given to \em http_client_queue_submit
+ * @param result overall result of the request
+ * @param status HTTP status code of the response (0 if none was received)
+ * @param latency_us time from submission to completion, queueing included
+ */
+typedef void (*http_client_queue_done_fn)(void *arg, httpc_result_t result, uint32_t status, uint32_t latency_us);
+
+struct EXAMPLE_HTTP_QUEUE;
+
+/*! \brief One request slot of a request queue (internal)
+ *  \ingroup pico_lwip
+ */
+typedef struct EXAMPLE_HTTP_QUEUE_SLOT {
+    EXAMPLE_HTTP_REQUEST_T req;
+    struct EXAMPLE_HTTP_QUEUE *queue;
+    http_client_queue_done_fn done_fn;
+    void *done_arg;
+    uint64_t t_submit;
+    bool used;
+    char url[HTTP_CLIENT_QUEUE_URL_MAX];
+} EXAMPLE_HTTP_QUEUE_SLOT_T;
+
+/*! \brief Queue of GET requests run with bounded concurrency
+ *  \ingroup pico_lwip
+ *
+ * Requests are copied into a fixed pool of HTTP_CLIENT_QUEUE_SLOTS slots (no allocation) and started
+ * in submission order with \em http_client_request_async, at most \em max_in_flight at a time. Each
+ * in-flight request uses its own connection, so \em max_in_flight must stay below the number of TCP
+ * PCBs lwIP has (MEMP_NUM_TCP_PCB). When every slot is taken, \em http_client_queue_submit fails
+ * with ERR_MEM: the caller should hold on to its data and try again later.
+ *
+ * Initialise to zero and set at least \em hostname. Fields after \em rejected are internal.
+ */
+typedef struct EXAMPLE_HTTP_QUEUE {
+    /*!
+     * The name of the host, e.g. 192.168.0.10
+     */
+    const char *hostname;
+    /*!
+     * The port to use. A default port is chosen if this is set to zero
+     */
+    uint16_t port;
+    /*!
+     * Requests in flight at the same time. 1 if zero
+     */
+    uint8_t max_in_flight;
+    /*!
+     * Function to callback with headers, can be null
+     * @see httpc_headers_done_fn
+     */
+    httpc_headers_done_fn headers_fn;
+    /*!
+     * Function to callback with response bodies, can be null. It must free the pbuf
+     * @see altcp_recv_fn
+     */
+    altcp_recv_fn recv_fn;
+    /*!
+     * Argument for \em headers_fn and \em recv_fn
+     */
+    void *callback_arg;
+#if LWIP_ALTCP && LWIP_ALTCP_TLS
+    /*!
+     * TLS configuration, can be null for plain http
+     */
+    struct altcp_tls_config *tls_config;
+#if LWIP_ALTCP_TLS_MBEDTLS
+    /*!
+     * TLS configuration and session cache shared by the queued requests, can be null
+     */
+    EXAMPLE_HTTP_TLS_CACHE_T *tls_cache;
+#endif
+#endif
+    /*!
+     * Requests accepted by \em http_client_queue_submit
+     */
+    uint32_t submitted;
+    /*!
+     * Requests completed, successfully or not
+     */
+    uint32_t completed;
+    /*!
+     * Requests refused because the queue was full
+     */
+    uint32_t rejected;
+
+    // Internal state
+    async_context_t *context;
+    async_when_pending_worker_t worker;
+    uint8_t in_flight;
+    uint8_t waiting;
+    uint8_t next;
+    uint8_t order[HTTP_CLIENT_QUEUE_SLOTS];
+    EXAMPLE_HTTP_QUEUE_SLOT_T slots[HTTP_CLIENT_QUEUE_SLOTS];
+} EXAMPLE_HTTP_QUEUE_T;
+
+/*! \brief Queue a GET request
+ *  \ingroup pico_lwip
+ *
+ * The url is copied, so the caller's buffer can be reused straight away. The request is started
+ * from the async context as soon as fewer than \em max_in_flight requests are in flight.
+ *
+ * @param context async context
+ * @param queue request queue, initialised to zero with hostname set
+ * @param url The url to request, e.g. /mensagem?msg=ok
+ * @param done_fn Function to call when the request completes, can be null
+ * @param arg Argument for \em done_fn
+ * @return Zero if the request was queued, ERR_MEM if the queue is full (back-pressure) or ERR_VAL if the url is too long
+ */
+int http_client_queue_submit(async_context_t *context, EXAMPLE_HTTP_QUEUE_T *queue, const char *url,
+                             http_client_queue_done_fn done_fn, void *arg);
+
+/*! \brief Number of free request slots
+ *  \ingroup pico_lwip
+ *
+ * @param queue request queue
+ * @return How many requests can be submitted before the queue refuses them
+ */
+unsigned http_client_queue_free_slots(const EXAMPLE_HTTP_QUEUE_T *queue);
+
+/*! \brief Check whether all queued requests have completed
+ *  \ingroup pico_lwip
+ *
+ * @param queue request queue
+ * @return true if nothing is waiting or in flight
+ */
+bool http_client_queue_idle(const EXAMPLE_HTTP_QUEUE_T *queue);
+
+/*! \brief Look a host name up in the DNS cache
+ *  \ingroup pico_lwip
+ *
+ * The cache sends its own A queries to the servers set with \em dns_setserver, so it sees the TTL of
+ * each answer: an address is kept for that TTL (clamped to HTTP_CLIENT_DNS_MIN_TTL_S..HTTP_CLIENT_DNS_MAX_TTL_S),
+ * and a name that does not exist for the negative TTL of the zone's SOA record (RFC 2308), or for
+ * HTTP_CLIENT_DNS_NEGATIVE_TTL_S if the servers give none or do not answer. A name looked up again
+ * after HTTP_CLIENT_DNS_REFRESH_PERCENT of its TTL is queried again in the background, while the
+ * cached address is still handed out, so periodic requests never wait for DNS.
+ *
+ * Fresh addresses are also published in lwIP's local host list (DNS_LOCAL_HOSTLIST_IS_DYNAMIC), so
+ * \em httpc_get_file_dns and \em dns_gethostbyname find them without a query. Use from the async
+ * context only (requests take the lock). IPv4 only.
+ *
+ * @param hostname name or dotted IP address
+ * @param addr receives the address when ERR_OK is returned
+ * @param waiter storage for the pending lookup, must stay valid until \em found_fn is called
+ * @param found_fn function called if ERR_INPROGRESS is returned
+ * @param arg argument for \em found_fn
+ * @return ERR_OK if \em addr was filled in, ERR_INPROGRESS if \em found_fn will be called,
+ *  ERR_ARG if the name failed recently, ERR_MEM if the cache has no free entry
+ */
+err_t http_client_dns_lookup(const char *hostname, ip_addr_t *addr, EXAMPLE_HTTP_DNS_WAITER_T *waiter,
+                             http_client_dns_found_fn found_fn, void *arg);
+
+/*! \brief Counters of the DNS cache since boot
+ *  \ingroup pico_lwip
+ *
+ * @return the counters
+ */
+const EXAMPLE_HTTP_DNS_STATS_T *http_client_dns_stats(void);
+
+#if LWIP_ALTCP && LWIP_ALTCP_TLS && LWIP_ALTCP_TLS_MBEDTLS
+/*! \brief Install the mbedtls allocator that counts heap use
+ *  \ingroup pico_lwip
+ *
+ * Call it before anything allocates from mbedtls, i.e. before the first
+ * altcp_tls_create_config_client, \em http_client_tls_cache_init or TLS connection. The counting
+ * allocator prefixes each block with its size, so a block allocated earlier (e.g. a plain
+ * \em tls_config) would corrupt the heap when mbedtls frees it. Later calls do nothing.
+ * Does nothing unless mbedtls is built with MBEDTLS_PLATFORM_MEMORY.
+ */
+void http_client_tls_init(void);
+
+/*! \brief Create the TLS configuration of a session cache
+ *  \ingroup pico_lwip
+ *
+ * Calls \em http_client_tls_init; a program that also creates a plain \em tls_config must
+ * call that itself first.
+ *
+ * @param cache cache to initialise
+ * @param ca PEM or DER root certificate(s) used to verify servers, can be null to skip verification
+ * @param ca_len length of \em ca, including the terminating NUL for PEM
+ * @return Zero on success, ERR_MEM if the configuration could not be created
+ */
+int http_client_tls_cache_init(EXAMPLE_HTTP_TLS_CACHE_T *cache, const uint8_t *ca, size_t ca_len);
+
+/*! \brief Drop the session cached for a host, so the next connection makes a full handshake
+ *  \ingroup pico_lwip
+ *
+ * @param cache session cache
+ * @param hostname host name
+ */
+void http_client_tls_cache_forget(EXAMPLE_HTTP_TLS_CACHE_T *cache, const char *hostname);
+
+/*! \brief Free the sessions and the configuration of a session cache
+ *  \ingroup pico_lwip
+ *
+ * No connection may still be using the cache.
+ *
+ * @param cache session cache
+ */
+void http_client_tls_cache_deinit(EXAMPLE_HTTP_TLS_CACHE_T *cache);
+
+/*! \brief Bytes currently allocated by mbedtls
+ *  \ingroup pico_lwip
+ *
+ * Counted once \em http_client_tls_init has run, and only if mbedtls is built with
+ * MBEDTLS_PLATFORM_MEMORY; zero otherwise.
+ *
+ * @return Bytes in use
+ */
+size_t http_client_tls_heap_in_use(void);
+#endif
+
 #endif
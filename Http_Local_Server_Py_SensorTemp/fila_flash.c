@@ -0,0 +1,339 @@
+#include <assert.h>
+#include <stddef.h>
+#include <string.h>
+#include "pico/stdlib.h"
+#include "hardware/flash.h"
+#include "hardware/sync.h"
+#include "fila_flash.h"
+
+/***************************************************************
+ * FORMATO NA FLASH
+ *
+ * Setor (4 KB) = 128 posições de 32 bytes; a posição 0 é o
+ * cabeçalho, as demais são registros. Posição toda em 0xFF = vazia.
+ **************************************************************/
+#define REGIAO_INICIO (PICO_FLASH_SIZE_BYTES - FILA_FLASH_SETORES * FLASH_SECTOR_SIZE)
+#define REGISTRO_TAM 32
+#define POR_PAGINA (FLASH_PAGE_SIZE / REGISTRO_TAM)
+#define POR_SETOR (FLASH_SECTOR_SIZE / REGISTRO_TAM)
+#define MARCA_SETOR 0x414C4946u            // "FILA"
+
+typedef struct {
+    uint32_t marca;
+    uint32_t geracao;                      // Cresce a cada setor aberto para escrita
+    uint32_t reservado[6];
+} cabecalho_t;
+
+typedef struct {
+    uint32_t boot;
+    uint32_t seq;
+    uint64_t t_us;
+    int32_t valor;
+    uint8_t tipo;
+    uint8_t reservado[7];
+    uint32_t verificacao;                  // FNV-1a dos bytes anteriores
+} registro_t;
+
+static_assert(sizeof(cabecalho_t) == REGISTRO_TAM, "cabeçalho deve ocupar uma posição");
+static_assert(sizeof(registro_t) == REGISTRO_TAM, "registro deve ocupar uma posição");
+static_assert(FILA_FLASH_SETORES >= 2, "a fila precisa de ao menos 2 setores");
+
+typedef enum {
+    SETOR_LIVRE,                           // Apagado
+    SETOR_DADOS,                           // Tem registros ainda não entregues (ou é o de escrita)
+    SETOR_SUJO,                            // Entregue ou inválido: apagar antes de reusar
+} estado_setor_t;
+
+/***************************************************************
+ * VARIÁVEIS INTERNAS
+ **************************************************************/
+static uint8_t estado[FILA_FLASH_SETORES];
+static uint32_t geracao;                   // Do setor de escrita
+
+static uint16_t setor_escrita;
+static uint16_t pos_escrita;               // Próxima posição a preencher (pode estar só na página em RAM)
+static uint16_t pos_gravada;               // Posições [0, pos_gravada) já gravadas na flash
+static uint8_t pagina[FLASH_PAGE_SIZE] __attribute__((aligned(4)));
+
+static uint16_t setor_leitura;
+static uint16_t pos_leitura;               // Próximo registro a entregar
+
+static uint32_t pendentes;
+static uint32_t descartadas;
+
+/***************************************************************
+ * FUNÇÕES INTERNAS
+ **************************************************************/
+static const void *endereco(uint16_t setor, uint16_t pos) {
+    return (const void *)(XIP_BASE + REGIAO_INICIO + (uint32_t)setor * FLASH_SECTOR_SIZE + pos * REGISTRO_TAM);
+}
+
+static uint32_t fnv1a(const void *dados, size_t tam) {
+    const uint8_t *p = dados;
+    uint32_t h = 2166136261u;
+    while (tam--) {
+        h = (h ^ *p++) * 16777619u;
+    }
+    return h;
+}
+
+static bool registro_valido(const registro_t *r) {
+    return r->verificacao == fnv1a(r, offsetof(registro_t, verificacao));
+}
+
+static bool vazio(const void *dados, size_t tam) {
+    const uint32_t *p = dados;
+    for (size_t i = 0; i < tam / 4; i++) {
+        if (p[i] != 0xFFFFFFFFu) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Grava a página em RAM na posição indicada do setor de escrita (~1 ms)
+ */
+static void programar_pagina(uint16_t pos_inicio) {
+    uint32_t deslocamento = REGIAO_INICIO + (uint32_t)setor_escrita * FLASH_SECTOR_SIZE + pos_inicio * REGISTRO_TAM;
+    uint32_t irq = save_and_disable_interrupts();
+    flash_range_program(deslocamento, pagina, FLASH_PAGE_SIZE);
+    restore_interrupts(irq);
+}
+
+/**
+ * Apaga um setor (~50 ms com interrupções desligadas)
+ */
+static void apagar(uint16_t setor) {
+    uint32_t irq = save_and_disable_interrupts();
+    flash_range_erase(REGIAO_INICIO + (uint32_t)setor * FLASH_SECTOR_SIZE, FLASH_SECTOR_SIZE);
+    restore_interrupts(irq);
+    estado[setor] = SETOR_LIVRE;
+}
+
+/**
+ * Grava os registros que estão na página em RAM, mesmo incompleta;
+ * as posições vazias que sobram na página não são reaproveitadas
+ */
+static void descarregar(void) {
+    uint16_t inicio = pos_gravada;
+    uint16_t primeiro = inicio == 0 ? 1 : inicio;          // Posição 0 é o cabeçalho
+    if (pos_escrita <= primeiro) {
+        return;
+    }
+    programar_pagina(inicio);
+    pos_escrita = (uint16_t)((inicio / POR_PAGINA + 1) * POR_PAGINA);
+    pos_gravada = pos_escrita;
+    memset(pagina, 0xFF, sizeof(pagina));
+}
+
+/**
+ * Passa a escrever no próximo setor do rodízio
+ * @return false se ele ainda tem registros não entregues (fila cheia)
+ */
+static bool abrir_proximo_setor(void) {
+    uint16_t proximo = (setor_escrita + 1) % FILA_FLASH_SETORES;
+    if (estado[proximo] == SETOR_DADOS) {
+        return false;
+    }
+    if (estado[proximo] == SETOR_SUJO) {
+        apagar(proximo);                   // A manutenção não deu conta: apaga no caminho de gravação
+    }
+    estado[proximo] = SETOR_DADOS;
+    setor_escrita = proximo;
+    geracao++;
+
+    memset(pagina, 0xFF, sizeof(pagina));
+    cabecalho_t cab = { .marca = MARCA_SETOR, .geracao = geracao };
+    memset(cab.reservado, 0xFF, sizeof(cab.reservado));
+    memcpy(pagina, &cab, sizeof(cab));
+    pos_escrita = 1;
+    pos_gravada = 0;
+    return true;
+}
+
+/**
+ * Procura o próximo registro válido a partir de (*setor, *pos) sem
+ * passar do que já está gravado; avança (*setor, *pos) até ele
+ * @return O registro, ou NULL no fim da fila
+ */
+static const registro_t *proximo_registro(uint16_t *setor, uint16_t *pos) {
+    for (;;) {
+        if (*setor == setor_escrita && *pos >= pos_gravada) {
+            return NULL;
+        }
+        if (*pos >= POR_SETOR) {
+            *setor = (*setor + 1) % FILA_FLASH_SETORES;
+            *pos = 1;
+            continue;
+        }
+        const registro_t *r = endereco(*setor, *pos);
+        if (registro_valido(r)) {
+            return r;
+        }
+        (*pos)++;                          // Vazio ou corrompido (ex.: queda de energia gravando)
+    }
+}
+
+/***************************************************************
+ * API PÚBLICA
+ **************************************************************/
+void fila_flash_iniciar(void) {
+    memset(pagina, 0xFF, sizeof(pagina));
+    pendentes = 0;
+    descartadas = 0;
+
+    // Classifica os setores e acha o mais antigo e o mais novo com dados
+    bool achou = false;
+    uint16_t mais_antigo = 0, mais_novo = 0;
+    uint32_t ger_min = 0, ger_max = 0;
+    for (uint16_t s = 0; s < FILA_FLASH_SETORES; s++) {
+        const cabecalho_t *cab = endereco(s, 0);
+        if (cab->marca == MARCA_SETOR) {
+            estado[s] = SETOR_DADOS;
+            if (!achou || cab->geracao < ger_min) {
+                ger_min = cab->geracao;
+                mais_antigo = s;
+            }
+            if (!achou || cab->geracao > ger_max) {
+                ger_max = cab->geracao;
+                mais_novo = s;
+            }
+            achou = true;
+        } else {
+            estado[s] = vazio(endereco(s, 0), FLASH_SECTOR_SIZE) ? SETOR_LIVRE : SETOR_SUJO;
+        }
+    }
+
+    if (!achou) {
+        // Fila vazia: finge um setor de escrita cheio para o próximo gravar abrir o setor 0
+        setor_escrita = FILA_FLASH_SETORES - 1;
+        pos_escrita = pos_gravada = POR_SETOR;
+        setor_leitura = setor_escrita;
+        pos_leitura = POR_SETOR;
+        geracao = 0;
+        return;
+    }
+
+    // Setores com dados fora do arco mais antigo → mais novo sobraram de um rodízio anterior
+    for (uint16_t s = 0; s < FILA_FLASH_SETORES; s++) {
+        uint16_t d = (s + FILA_FLASH_SETORES - mais_antigo) % FILA_FLASH_SETORES;
+        uint16_t d_novo = (mais_novo + FILA_FLASH_SETORES - mais_antigo) % FILA_FLASH_SETORES;
+        if (estado[s] == SETOR_DADOS && d > d_novo) {
+            estado[s] = SETOR_SUJO;
+        }
+    }
+
+    // Continua a escrita na página seguinte à do último registro gravado
+    setor_escrita = mais_novo;
+    geracao = ger_max;
+    uint16_t ultimo = 0;
+    for (uint16_t p = POR_SETOR - 1; p > 0; p--) {
+        if (!vazio(endereco(mais_novo, p), REGISTRO_TAM)) {
+            ultimo = p;
+            break;
+        }
+    }
+    pos_escrita = (uint16_t)((ultimo / POR_PAGINA + 1) * POR_PAGINA);
+    pos_gravada = pos_escrita;
+
+    // Relê tudo desde o setor mais antigo: o que já foi entregue o servidor descarta
+    setor_leitura = mais_antigo;
+    pos_leitura = 1;
+    uint16_t s = setor_leitura, p = pos_leitura;
+    while (proximo_registro(&s, &p)) {
+        pendentes++;
+        p++;
+    }
+}
+
+bool fila_flash_gravar(const telemetria_amostra_t *a, uint32_t boot) {
+    if (pos_escrita >= POR_SETOR && !abrir_proximo_setor()) {
+        descartadas++;
+        return false;
+    }
+    registro_t r;
+    memset(&r, 0xFF, sizeof(r));
+    r.boot = boot;
+    r.seq = a->seq;
+    r.t_us = a->t_us;
+    r.valor = a->valor;
+    r.tipo = a->tipo;
+    r.verificacao = fnv1a(&r, offsetof(registro_t, verificacao));
+    memcpy(pagina + (pos_escrita % POR_PAGINA) * REGISTRO_TAM, &r, sizeof(r));
+    pos_escrita++;
+    pendentes++;
+
+    if (pos_escrita % POR_PAGINA == 0) {
+        programar_pagina(pos_escrita - POR_PAGINA);
+        pos_gravada = pos_escrita;
+        memset(pagina, 0xFF, sizeof(pagina));
+    }
+    return true;
+}
+
+uint16_t fila_flash_ler(telemetria_amostra_t *destino, uint16_t max, uint32_t *boot) {
+    if (pendentes == 0) {
+        return 0;
+    }
+    descarregar();                         // Os registros ainda na página em RAM também saem
+
+    uint16_t n = 0;
+    uint16_t s = setor_leitura, p = pos_leitura;
+    const registro_t *r;
+    while (n < max && (r = proximo_registro(&s, &p)) != NULL) {
+        if (n == 0) {
+            *boot = r->boot;
+        } else if (r->boot != *boot || r->seq != destino[n - 1].seq + 1) {
+            break;                         // Um lote só tem amostras consecutivas de um boot
+        }
+        destino[n].t_us = r->t_us;
+        destino[n].seq = r->seq;
+        destino[n].valor = r->valor;
+        destino[n].tipo = r->tipo;
+        n++;
+        p++;
+    }
+    return n;
+}
+
+void fila_flash_confirmar(uint16_t n) {
+    while (n > 0 && proximo_registro(&setor_leitura, &pos_leitura)) {
+        pos_leitura++;
+        pendentes--;
+        n--;
+    }
+    // Setores que a leitura deixou para trás podem ser apagados
+    for (uint16_t s = (setor_escrita + 1) % FILA_FLASH_SETORES; s != setor_leitura; s = (s + 1) % FILA_FLASH_SETORES) {
+        if (estado[s] == SETOR_DADOS) {
+            estado[s] = SETOR_SUJO;
+        }
+    }
+    if (pendentes == 0 && setor_leitura != setor_escrita) {
+        if (estado[setor_leitura] == SETOR_DADOS) {
+            estado[setor_leitura] = SETOR_SUJO;
+        }
+        setor_leitura = setor_escrita;
+        pos_leitura = pos_gravada;
+    }
+}
+
+bool fila_flash_manutencao(void) {
+    // Apaga primeiro o setor que a escrita vai precisar antes
+    for (uint16_t i = 1; i < FILA_FLASH_SETORES; i++) {
+        uint16_t s = (setor_escrita + i) % FILA_FLASH_SETORES;
+        if (estado[s] == SETOR_SUJO) {
+            apagar(s);
+            return true;
+        }
+    }
+    return false;
+}
+
+uint32_t fila_flash_pendentes(void) {
+    return pendentes;
+}
+
+uint32_t fila_flash_descartadas(void) {
+    return descartadas;
+}
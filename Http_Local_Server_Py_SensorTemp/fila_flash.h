@@ -0,0 +1,85 @@
+#ifndef FILA_FLASH_H
+#define FILA_FLASH_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "telemetria.h"
+
+/***************************************************************
+ * FILA PERSISTENTE DE AMOSTRAS NA FLASH (store-and-forward)
+ *
+ * Log circular nos últimos FILA_FLASH_SETORES setores de 4 KB da
+ * flash. Cada setor começa com um cabeçalho (marca + geração) e
+ * guarda registros de 32 bytes; os registros são acumulados em RAM
+ * e gravados uma página (256 bytes, 8 registros) por vez, sempre
+ * no fim do log. Os setores são usados em rodízio, então todos são
+ * apagados o mesmo número de vezes (nivelamento de desgaste); a
+ * geração diz, no boot, qual é o mais antigo.
+ *
+ * Um setor cujos registros já foram todos entregues fica "sujo" e
+ * só é apagado em fila_flash_manutencao(), chamada pelo laço
+ * principal quando está ocioso: gravar uma página leva ~1 ms, mas
+ * apagar um setor leva ~50 ms com as interrupções desligadas (a
+ * flash não pode ser lida durante o apagamento, e o código roda
+ * dela). Assim o apagamento não cai no caminho de gravação; só
+ * acontece ali se a manutenção não deu conta.
+ *
+ * A posição de leitura não é gravada na flash: após um reboot, os
+ * registros de setores ainda não apagados são reenviados e o
+ * servidor descarta os repetidos pelo número de sequência.
+ *
+ * Com a fila cheia, as amostras novas são descartadas e contadas.
+ * Só para o núcleo 0 (não coordena com o núcleo 1 ao gravar).
+ **************************************************************/
+#ifndef FILA_FLASH_SETORES
+#define FILA_FLASH_SETORES 32                 // 128 KB no fim da flash
+#endif
+
+/**
+ * Lê a região reservada e reconstrói a fila (chamar uma vez no boot)
+ */
+void fila_flash_iniciar(void);
+
+/**
+ * Acrescenta uma amostra no fim da fila
+ * @param a Amostra (com seq)
+ * @param boot Identificador do boot em que a amostra foi medida
+ * @return false se a fila está cheia e a amostra foi descartada
+ */
+bool fila_flash_gravar(const telemetria_amostra_t *a, uint32_t boot);
+
+/**
+ * Copia as amostras mais antigas ainda não confirmadas, sem removê-las.
+ * Para no fim da fila, na troca de boot ou num salto de sequência
+ * @param destino Recebe as amostras
+ * @param max Tamanho de destino
+ * @param boot Recebe o boot das amostras copiadas
+ * @return Quantidade copiada
+ */
+uint16_t fila_flash_ler(telemetria_amostra_t *destino, uint16_t max, uint32_t *boot);
+
+/**
+ * Remove da fila as n amostras mais antigas (o servidor as recebeu)
+ * @param n Quantidade, no máximo a retornada por fila_flash_ler
+ */
+void fila_flash_confirmar(uint16_t n);
+
+/**
+ * Apaga um setor já entregue, se houver. Chamar quando o laço está ocioso
+ * @return true se apagou um setor (~50 ms com interrupções desligadas)
+ */
+bool fila_flash_manutencao(void);
+
+/**
+ * Amostras na fila ainda não confirmadas
+ * @return Quantidade pendente
+ */
+uint32_t fila_flash_pendentes(void);
+
+/**
+ * Amostras descartadas com a fila cheia desde o boot
+ * @return Quantidade descartada
+ */
+uint32_t fila_flash_descartadas(void);
+
+#endif
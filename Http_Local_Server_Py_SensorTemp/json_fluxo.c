@@ -0,0 +1,347 @@
+#include <stdio.h>
+#include <string.h>
+#include "json_fluxo.h"
+
+/***************************************************************
+ * FASES DO PARSER (o que se espera no próximo byte)
+ **************************************************************/
+enum {
+    FASE_VALOR,                 // Um valor (raiz, depois de ':' ou de ',' num array)
+    FASE_VALOR_OU_FECHA,        // Logo depois de '[': um valor ou ']'
+    FASE_CHAVE_OU_FECHA,        // Logo depois de '{': uma chave ou '}'
+    FASE_CHAVE,                 // Depois de ',' num objeto
+    FASE_DOIS_PONTOS,
+    FASE_APOS_VALOR,            // ',' ou o fecho do contêiner
+    FASE_TEXTO,
+    FASE_ESCAPE,                // Depois de '\' num texto
+    FASE_UNICODE,               // Dígitos de \uXXXX
+    FASE_NUMERO,
+    FASE_LITERAL,               // true, false ou null
+    FASE_FIM                    // Só espaços até o fim
+};
+
+/***************************************************************
+ * FUNÇÕES INTERNAS
+ **************************************************************/
+static bool espaco(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+static void entregar(json_fluxo_t *j, json_tipo_t tipo) {
+    j->caminho[j->caminho_len] = '\0';
+    j->valor[j->valor_len] = '\0';
+    j->valor_fn(j->arg, j->caminho, tipo, j->valor);
+}
+
+/**
+ * Acrescenta um byte ao texto em leitura: à chave (no caminho) ou ao valor
+ * @return false se não cabe
+ */
+static bool acrescentar(json_fluxo_t *j, char c) {
+    if (j->chave) {
+        if (j->caminho_len + 1 >= JSON_FLUXO_CAMINHO_MAX) {
+            return false;
+        }
+        j->caminho[j->caminho_len++] = c;
+    } else {
+        if (j->valor_len + 1 >= JSON_FLUXO_VALOR_MAX) {
+            return false;
+        }
+        j->valor[j->valor_len++] = c;
+    }
+    return true;
+}
+
+/**
+ * Acrescenta um caractere do plano básico, codificado em UTF-8
+ */
+static bool acrescentar_utf8(json_fluxo_t *j, uint16_t codigo) {
+    if (codigo < 0x80) {
+        return acrescentar(j, (char)codigo);
+    }
+    if (codigo < 0x800) {
+        return acrescentar(j, (char)(0xC0 | codigo >> 6)) && acrescentar(j, (char)(0x80 | (codigo & 0x3F)));
+    }
+    return acrescentar(j, (char)(0xE0 | codigo >> 12)) && acrescentar(j, (char)(0x80 | (codigo >> 6 & 0x3F))) &&
+           acrescentar(j, (char)(0x80 | (codigo & 0x3F)));
+}
+
+/**
+ * Um valor terminou: o documento acabou (raiz) ou vem ',' ou o fecho
+ */
+static void valor_terminado(json_fluxo_t *j) {
+    if (j->profundidade == 0) {
+        j->fase = FASE_FIM;
+        j->estado = JSON_COMPLETO;
+    } else {
+        j->fase = FASE_APOS_VALOR;
+    }
+}
+
+/**
+ * Confere a gramática de número do JSON (RFC 8259):
+ * -? (0 | [1-9][0-9]*) (. [0-9]+)? ([eE] [+-]? [0-9]+)?
+ * @param s Número, terminado em zero
+ */
+static bool numero_valido(const char *s) {
+    if (*s == '-') s++;
+    if (*s == '0') {
+        s++;
+    } else if (*s >= '1' && *s <= '9') {
+        while (*s >= '0' && *s <= '9') s++;
+    } else {
+        return false;
+    }
+    if (*s == '.') {
+        s++;
+        if (!(*s >= '0' && *s <= '9')) return false;
+        while (*s >= '0' && *s <= '9') s++;
+    }
+    if (*s == 'e' || *s == 'E') {
+        s++;
+        if (*s == '+' || *s == '-') s++;
+        if (!(*s >= '0' && *s <= '9')) return false;
+        while (*s >= '0' && *s <= '9') s++;
+    }
+    return *s == '\0';
+}
+
+/**
+ * Entrega o número ou literal em leitura
+ * @return false se o número é inválido ou o literal não é true, false nem null
+ */
+static bool terminar_escalar(json_fluxo_t *j) {
+    j->valor[j->valor_len] = '\0';
+    if (j->fase == FASE_NUMERO) {
+        if (!numero_valido(j->valor)) {
+            return false;
+        }
+        entregar(j, JSON_NUMERO);
+    } else {
+        if (strcmp(j->valor, "true") == 0 || strcmp(j->valor, "false") == 0) {
+            entregar(j, JSON_BOOLEANO);
+        } else if (strcmp(j->valor, "null") == 0) {
+            entregar(j, JSON_NULO);
+        } else {
+            return false;
+        }
+    }
+    valor_terminado(j);
+    return true;
+}
+
+static bool abrir(json_fluxo_t *j, bool objeto) {
+    if (j->profundidade == JSON_FLUXO_PROFUNDIDADE) {
+        return false;
+    }
+    j->pilha[j->profundidade].objeto = objeto;
+    j->pilha[j->profundidade].base = j->caminho_len;
+    j->pilha[j->profundidade].indice = 0;
+    j->profundidade++;
+    j->fase = objeto ? FASE_CHAVE_OU_FECHA : FASE_VALOR_OU_FECHA;
+    return true;
+}
+
+static void fechar(json_fluxo_t *j) {
+    j->profundidade--;
+    j->caminho_len = j->pilha[j->profundidade].base;
+    if (j->pilha[j->profundidade].objeto) {
+        j->valor_len = 0;
+        entregar(j, JSON_FIM_OBJETO);
+    }
+    valor_terminado(j);
+}
+
+/**
+ * Início de uma chave: o caminho volta ao do objeto e ganha ".chave"
+ */
+static bool iniciar_chave(json_fluxo_t *j) {
+    j->caminho_len = j->pilha[j->profundidade - 1].base;
+    j->chave = true;
+    j->fase = FASE_TEXTO;
+    return j->caminho_len == 0 || acrescentar(j, '.');
+}
+
+static bool iniciar_valor(json_fluxo_t *j, char c) {
+    if (j->profundidade > 0 && !j->pilha[j->profundidade - 1].objeto) {
+        // Elemento de array: o caminho volta ao do array e ganha "[i]"
+        uint8_t base = j->pilha[j->profundidade - 1].base;
+        int n = snprintf(j->caminho + base, JSON_FLUXO_CAMINHO_MAX - base, "[%u]",
+                         j->pilha[j->profundidade - 1].indice);
+        if (n < 0 || base + n >= JSON_FLUXO_CAMINHO_MAX - 1) {
+            return false;
+        }
+        j->caminho_len = (uint8_t)(base + n);
+    }
+    j->valor_len = 0;
+    j->chave = false;
+    if (c == '{' || c == '[') {
+        return abrir(j, c == '{');
+    }
+    if (c == '"') {
+        j->fase = FASE_TEXTO;
+        return true;
+    }
+    if (c == '-' || (c >= '0' && c <= '9')) {
+        j->fase = FASE_NUMERO;
+    } else if (c == 't' || c == 'f' || c == 'n') {
+        j->fase = FASE_LITERAL;
+    } else {
+        return false;
+    }
+    return acrescentar(j, c);
+}
+
+static int valor_hex(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+/**
+ * Processa um byte
+ * @return false se o documento é inválido
+ */
+static bool processar(json_fluxo_t *j, char c) {
+    switch (j->fase) {
+    case FASE_TEXTO:
+        if (c == '"') {
+            if (j->chave) {
+                j->chave = false;
+                j->fase = FASE_DOIS_PONTOS;
+            } else {
+                entregar(j, JSON_TEXTO);
+                valor_terminado(j);
+            }
+            return true;
+        }
+        if (c == '\\') {
+            j->fase = FASE_ESCAPE;
+            return true;
+        }
+        return (uint8_t)c >= 0x20 && acrescentar(j, c);
+
+    case FASE_ESCAPE: {
+        static const char de[] = "\"\\/bfnrt";
+        static const char para[] = "\"\\/\b\f\n\r\t";
+        const char *e = c ? strchr(de, c) : NULL;
+        if (c == 'u') {
+            j->hex_faltam = 4;
+            j->codigo = 0;
+            j->fase = FASE_UNICODE;
+            return true;
+        }
+        j->fase = FASE_TEXTO;
+        return e && acrescentar(j, para[e - de]);
+    }
+
+    case FASE_UNICODE: {
+        int v = valor_hex(c);
+        if (v < 0) {
+            return false;
+        }
+        j->codigo = (uint16_t)(j->codigo << 4 | v);
+        if (--j->hex_faltam > 0) {
+            return true;
+        }
+        j->fase = FASE_TEXTO;
+        return j->codigo != 0 && acrescentar_utf8(j, j->codigo);
+    }
+
+    case FASE_NUMERO:
+        if ((c >= '0' && c <= '9') || c == '.' || c == 'e' || c == 'E' || c == '+' || c == '-') {
+            return acrescentar(j, c);
+        }
+        return terminar_escalar(j) && processar(j, c);    // O delimitador vale para a fase seguinte
+
+    case FASE_LITERAL:
+        if (c >= 'a' && c <= 'z') {
+            return acrescentar(j, c);
+        }
+        return terminar_escalar(j) && processar(j, c);
+
+    default:
+        break;
+    }
+
+    if (espaco(c)) {
+        return true;
+    }
+    switch (j->fase) {
+    case FASE_VALOR_OU_FECHA:
+        if (c == ']') {
+            fechar(j);
+            return true;
+        }
+        return iniciar_valor(j, c);
+    case FASE_VALOR:
+        return iniciar_valor(j, c);
+    case FASE_CHAVE_OU_FECHA:
+        if (c == '}') {
+            fechar(j);
+            return true;
+        }
+        // fall through
+    case FASE_CHAVE:
+        return c == '"' && iniciar_chave(j);
+    case FASE_DOIS_PONTOS:
+        if (c != ':') {
+            return false;
+        }
+        j->fase = FASE_VALOR;
+        return true;
+    case FASE_APOS_VALOR: {
+        bool objeto = j->pilha[j->profundidade - 1].objeto;
+        if (c == ',') {
+            if (objeto) {
+                j->fase = FASE_CHAVE;
+            } else {
+                j->pilha[j->profundidade - 1].indice++;
+                j->fase = FASE_VALOR;
+            }
+            return true;
+        }
+        if (c == (objeto ? '}' : ']')) {
+            fechar(j);
+            return true;
+        }
+        return false;
+    }
+    default:
+        return false;                      // FASE_FIM: texto depois do documento
+    }
+}
+
+/***************************************************************
+ * FUNÇÕES PÚBLICAS
+ **************************************************************/
+void json_fluxo_iniciar(json_fluxo_t *j, json_valor_fn valor_fn, void *arg) {
+    memset(j, 0, sizeof(*j));
+    j->valor_fn = valor_fn;
+    j->arg = arg;
+    j->estado = JSON_INCOMPLETO;
+    j->fase = FASE_VALOR;
+}
+
+json_estado_t json_fluxo_alimentar(json_fluxo_t *j, const uint8_t *dados, size_t n) {
+    for (size_t i = 0; i < n && j->estado != JSON_ERRO; i++) {
+        if (!processar(j, (char)dados[i])) {
+            j->estado = JSON_ERRO;
+            break;
+        }
+        j->posicao++;
+    }
+    return j->estado;
+}
+
+json_estado_t json_fluxo_terminar(json_fluxo_t *j) {
+    if (j->estado == JSON_INCOMPLETO && j->profundidade == 0 &&
+        (j->fase == FASE_NUMERO || j->fase == FASE_LITERAL) && !terminar_escalar(j)) {
+        j->estado = JSON_ERRO;
+    }
+    if (j->estado == JSON_INCOMPLETO) {
+        j->estado = JSON_ERRO;
+    }
+    return j->estado;
+}
@@ -0,0 +1,109 @@
+#ifndef JSON_FLUXO_H
+#define JSON_FLUXO_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/***************************************************************
+ * PARSER JSON INCREMENTAL
+ *
+ * Recebe o texto em pedaços de qualquer tamanho (por exemplo, as
+ * fatias dos pbufs de uma resposta HTTP, à medida que chegam) e
+ * chama uma função para cada valor, com o caminho dele no
+ * documento. A resposta não é guardada: a memória é fixa (caminho,
+ * valor em leitura e pilha de aninhamento).
+ *
+ *   {"comandos":[{"cmd":"led","valor":1}]}
+ *
+ *   comandos[0].cmd    JSON_TEXTO       led
+ *   comandos[0].valor  JSON_NUMERO      1
+ *   comandos[0]        JSON_FIM_OBJETO
+ *
+ * Escapes \uXXXX viram UTF-8 (só o plano básico). Um valor maior
+ * que JSON_FLUXO_VALOR_MAX, um caminho maior que
+ * JSON_FLUXO_CAMINHO_MAX ou um aninhamento maior que
+ * JSON_FLUXO_PROFUNDIDADE é erro, como o JSON malformado.
+ **************************************************************/
+#ifndef JSON_FLUXO_CAMINHO_MAX
+#define JSON_FLUXO_CAMINHO_MAX 48
+#endif
+#ifndef JSON_FLUXO_VALOR_MAX
+#define JSON_FLUXO_VALOR_MAX 48
+#endif
+#ifndef JSON_FLUXO_PROFUNDIDADE
+#define JSON_FLUXO_PROFUNDIDADE 6
+#endif
+
+typedef enum {
+    JSON_TEXTO,        // Texto sem as aspas, escapes já convertidos
+    JSON_NUMERO,       // Número como escrito, ex.: -12.5e3
+    JSON_BOOLEANO,     // "true" ou "false"
+    JSON_NULO,         // "null"
+    JSON_FIM_OBJETO    // Um objeto terminou (valor vazio); todos os seus campos já foram entregues
+} json_tipo_t;
+
+typedef enum {
+    JSON_INCOMPLETO,   // Falta texto
+    JSON_COMPLETO,     // O valor raiz terminou
+    JSON_ERRO          // Texto inválido ou grande demais; o resto é ignorado
+} json_estado_t;
+
+/**
+ * Função chamada para cada valor do documento
+ * @param arg Argumento dado em json_fluxo_iniciar
+ * @param caminho Caminho do valor, ex.: comandos[0].cmd ("" para a raiz)
+ * @param tipo Tipo do valor
+ * @param valor Valor como texto, terminado em zero
+ */
+typedef void (*json_valor_fn)(void *arg, const char *caminho, json_tipo_t tipo, const char *valor);
+
+typedef struct {
+    json_valor_fn valor_fn;
+    void *arg;
+    json_estado_t estado;
+    uint32_t posicao;               // Bytes consumidos (no erro, aponta o byte inválido)
+
+    // Estado interno
+    uint8_t fase;
+    uint8_t profundidade;
+    uint8_t caminho_len;
+    uint8_t valor_len;
+    bool chave;                     // O texto em leitura é uma chave
+    uint8_t hex_faltam;             // Dígitos de \uXXXX ainda por ler
+    uint16_t codigo;
+    struct {
+        bool objeto;
+        uint8_t base;               // Tamanho do caminho do contêiner
+        uint16_t indice;            // Elemento atual de um array
+    } pilha[JSON_FLUXO_PROFUNDIDADE];
+    char caminho[JSON_FLUXO_CAMINHO_MAX];
+    char valor[JSON_FLUXO_VALOR_MAX];
+} json_fluxo_t;
+
+/**
+ * Prepara o parser para um documento novo
+ * @param j Parser
+ * @param valor_fn Função chamada para cada valor
+ * @param arg Argumento para valor_fn
+ */
+void json_fluxo_iniciar(json_fluxo_t *j, json_valor_fn valor_fn, void *arg);
+
+/**
+ * Consome mais um pedaço do documento, chamando valor_fn para cada valor que termina nele
+ * @param j Parser
+ * @param dados Pedaço do texto
+ * @param n Tamanho do pedaço
+ * @return Estado depois do pedaço
+ */
+json_estado_t json_fluxo_alimentar(json_fluxo_t *j, const uint8_t *dados, size_t n);
+
+/**
+ * Indica o fim do texto: entrega um número na raiz que ainda esperava
+ * um delimitador e confere se o documento terminou
+ * @param j Parser
+ * @return JSON_COMPLETO, ou JSON_ERRO se o documento ficou incompleto ou é inválido
+ */
+json_estado_t json_fluxo_terminar(json_fluxo_t *j);
+
+#endif
@@ -18,6 +18,16 @@
 #define LWIP_ALTCP_TLS           1
 #define LWIP_ALTCP_TLS_MBEDTLS   1
 
+// The DNS cache in example_http_client_util.c publishes the addresses it holds in
+// lwIP's local host list, so httpc finds them without a query. One entry per
+// cached name (HTTP_CLIENT_DNS_ENTRIES)
+#define DNS_LOCAL_HOSTLIST              1
+#define DNS_LOCAL_HOSTLIST_IS_DYNAMIC   1
+#define MEMP_NUM_LOCALHOSTLIST          4
+
+// wifi.c follows link, interface and address changes of the station netif
+#define LWIP_NETIF_EXT_STATUS_CALLBACK  1
+
 // Note bug in lwip with LWIP_ALTCP and LWIP_DEBUG
 // https://savannah.nongnu.org/bugs/index.php?62159
 //#define LWIP_DEBUG 1
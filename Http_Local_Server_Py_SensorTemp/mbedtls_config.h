@@ -3,4 +3,10 @@
 
 #include "mbedtls_config_examples_common.h"
 
-#endif
\ No newline at end of file
+// Session tickets (RFC 5077) let a session be resumed even by servers that keep no session cache
+#define MBEDTLS_SSL_SESSION_TICKETS
+
+// Lets example_http_client_util.c count the heap used by mbedtls (http_client_tls_heap_in_use)
+#define MBEDTLS_PLATFORM_MEMORY
+
+#endif
@@ -1,25 +1,442 @@
 /**
  * Cliente HTTP para Raspberry Pi Pico W
- * Envia mensagens dinâmicas periodicamente para um servidor Flask
+ * Envia as mudanças do botão A para um servidor Flask assim que acontecem,
+ * com um heartbeat periódico quando nada muda (ou publica num broker MQTT)
  */
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include "pico/stdio.h"
 #include "pico/cyw43_arch.h"
 #include "pico/async_context.h"
+#include "pico/unique_id.h"
+#include "pico/rand.h"
+#include "hardware/sync.h"
 #include "lwip/altcp_tls.h"
+#include "lwip/stats.h"
 #include "example_http_client_util.h"
+#include "telemetria.h"
+#include "fila_flash.h"
+#include "botao.h"
+#include "comandos.h"
+#include "wifi.h"
+#include "mqtt_cliente.h"
 
 // ======= CONFIGURAÇÕES ======= //
 #define HOST "192.168.186.138"  // Substitua pelo IP do servidor
 #define PORT 5000
-#define INTERVALO_MS 1000    // Intervalo entre mensagens (3 segundos)
+#define HEARTBEAT_MS 30000   // Sem mudanças do botão, reenvia o estado nesse intervalo (o servidor pode mudar)
+#define HEARTBEAT_MIN_MS 1000 // Menor intervalo aceito no comando heartbeat_ms
 #define button_A 5
+#define USAR_KEEPALIVE 1     // 1: uma conexão mantida aberta; 0: fila de requisições, conexão nova por mensagem
+#define FILA_EM_VOO 2        // Sem keep-alive: requisições simultâneas da fila (cada uma usa um PCB TCP)
+#define RESUMO_A_CADA 10     // Mensagens entre cada resumo de latência/segmentos
+#define USAR_LOTE 1          // 1: amostras em lote num POST /lote; 0: um GET por mensagem
+#define ESPERA_MAX_MS 50     // Período máximo sem verificar os limites do lote
+#define LOTE_REPETIR_MS 2000 // Espera após um lote recusado antes de tentar de novo
+#define USAR_MQTT 0          // 1: botão e heartbeat publicados num broker MQTT (ignora USAR_KEEPALIVE e USAR_LOTE)
+#define MQTT_BROKER HOST     // IP do broker, ex.: mosquitto na máquina do servidor
+// Sem conexão, o lote guarda as amostras na flash (FILA_FLASH_SETORES no fim dela)
+// Limites do lote (tamanho/idade): TELEMETRIA_LOTE_MAX e TELEMETRIA_IDADE_MAX_MS
 // ============================= //
 
+#if USAR_LOTE && !USAR_KEEPALIVE
+#error "O modo lote envia POST pela conexão keep-alive (USAR_KEEPALIVE 1)"
+#endif
+
+// Estatísticas do resumo: segmentos TCP (tx + rx) por mensagem medem
+// o tempo de rádio gasto em handshakes e fechamentos
+static struct {
+    uint64_t soma_latencia_us;
+    uint32_t max_latencia_us;
+    int enviadas;
+    int falhas;
+    uint32_t seg_inicio;
+} resumo;
+
+static volatile uint32_t heartbeat_ms = HEARTBEAT_MS;
+
+#if USAR_KEEPALIVE || USAR_MQTT
+/**
+ * Executa um comando que veio na resposta de uma mensagem ou no tópico
+ * de comandos do MQTT (chamada no contexto do lwIP, durante a recepção)
+ *   led           valor 1/0 ou true/false: LED da placa (CYW43)
+ *   heartbeat_ms  valor em ms (>= HEARTBEAT_MIN_MS): intervalo do heartbeat
+ * @param cmd Nome do comando
+ * @param valor Valor como texto
+ * @param tipo Tipo JSON do valor
+ */
+static void executar_comando(const char *cmd, const char *valor, json_tipo_t tipo) {
+    if (strcmp(cmd, "led") == 0 && (tipo == JSON_NUMERO || tipo == JSON_BOOLEANO)) {
+        bool ligado = strcmp(valor, "true") == 0 || atoi(valor) != 0;
+        cyw43_arch_gpio_put(CYW43_WL_GPIO_LED_PIN, ligado);
+        printf("Comando: LED %s\n", ligado ? "ligado" : "desligado");
+    } else if (strcmp(cmd, "heartbeat_ms") == 0 && tipo == JSON_NUMERO && atol(valor) >= HEARTBEAT_MIN_MS) {
+        heartbeat_ms = (uint32_t)atol(valor);
+        printf("Comando: heartbeat a cada %lu ms\n", (unsigned long)heartbeat_ms);
+    } else {
+        printf("Comando ignorado: %s = %s\n", cmd, valor);
+    }
+}
+#endif
+
+/**
+ * O enlace subiu ou caiu (contexto do lwIP): acorda o laço principal,
+ * que pausa os envios sem enlace e os retoma quando ele volta. A
+ * conexão keep-alive é refeita sozinha na próxima requisição
+ */
+static void enlace_mudou(void *arg, bool conectado) {
+    printf("Enlace %s\n", conectado ? "de pé: retomando os envios" : "perdido: envios pausados");
+    __sev();
+}
+
+/**
+ * Contabiliza uma mensagem e imprime o resumo a cada RESUMO_A_CADA
+ * @param sucesso Se o servidor aceitou a mensagem
+ * @param latencia_us Tempo até a resposta completa
+ */
+static void resumo_registrar(bool sucesso, uint32_t latencia_us) {
+    if (sucesso) {
+        resumo.soma_latencia_us += latencia_us;
+        if (latencia_us > resumo.max_latencia_us) {
+            resumo.max_latencia_us = latencia_us;
+        }
+    } else {
+        resumo.falhas++;
+        wifi_verificar();                  // Não espera a vigia periódica para notar a queda
+    }
+
+    if (++resumo.enviadas == RESUMO_A_CADA) {
+        uint32_t segmentos = lwip_stats.tcp.xmit + lwip_stats.tcp.recv - resumo.seg_inicio;
+        int ok = resumo.enviadas - resumo.falhas;
+        printf("Resumo: %d mensagens, %d falhas, latência média %lu us (máx %lu us), "
+               "%lu.%01lu segmentos TCP/mensagem\n",
+               resumo.enviadas, resumo.falhas, (unsigned long)(ok ? resumo.soma_latencia_us / ok : 0),
+               (unsigned long)resumo.max_latencia_us, (unsigned long)(segmentos / resumo.enviadas),
+               (unsigned long)(segmentos * 10 / resumo.enviadas % 10));
+        resumo.soma_latencia_us = 0;
+        resumo.max_latencia_us = 0;
+        resumo.enviadas = 0;
+        resumo.falhas = 0;
+        resumo.seg_inicio = lwip_stats.tcp.xmit + lwip_stats.tcp.recv;
+    }
+}
+
+#if USAR_KEEPALIVE
+/**
+ * Envia uma mensagem pela conexão persistente (keep-alive)
+ * @param ka Estado da conexão, mantido entre as chamadas
+ * @param url Caminho com a mensagem
+ */
+static void enviar_keepalive(EXAMPLE_HTTP_KEEPALIVE_T *ka, const char *url) {
+    int result = http_client_keepalive_request_sync(cyw43_arch_async_context(), ka, url);
+    comandos_concluir();
+    printf("Status %lu em %lu us (conexões %lu, consultas DNS %lu)\n",
+           (unsigned long)ka->status, (unsigned long)ka->latency_us,
+           (unsigned long)ka->connections, (unsigned long)ka->lookups);
+    resumo_registrar(result == 0 && ka->status == 200, ka->latency_us);
+}
+#else
+/**
+ * Fim de uma mensagem da fila (chamada no contexto do lwIP)
+ * @param arg Número da mensagem
+ * @param result Resultado da requisição
+ * @param status Código HTTP da resposta
+ * @param latencia_us Tempo desde a entrada na fila até a resposta completa
+ */
+static void mensagem_concluida(void *arg, httpc_result_t result, uint32_t status, uint32_t latencia_us) {
+    bool sucesso = result == HTTPC_RESULT_OK && status == 200;
+    printf("[%lu] %s: resultado %d, status %lu em %lu us\n", (unsigned long)(uintptr_t)arg,
+           sucesso ? "Sucesso" : "Erro", result, (unsigned long)status, (unsigned long)latencia_us);
+    resumo_registrar(sucesso, latencia_us);
+}
+#endif
+
+#if USAR_LOTE
+static char corpo[TELEMETRIA_CORPO_MAX];    // Lote em envio; precisa durar até a resposta
+static telemetria_amostra_t reenvio[TELEMETRIA_LOTE_MAX];    // Amostras lidas da flash
+static uint16_t reenvio_no_lote;            // Amostras da flash no lote em envio (0: lote do anel)
+
+/**
+ * Começa a enviar um lote num único POST, sem esperar a resposta. Se
+ * há amostras guardadas na flash, elas saem primeiro (são mais antigas
+ * que as do anel)
+ * @param ka Conexão keep-alive
+ * @param telem Anel de amostras
+ * @return true se o POST foi iniciado
+ */
+static bool iniciar_lote(EXAMPLE_HTTP_KEEPALIVE_T *ka, telemetria_t *telem) {
+    size_t len;
+    reenvio_no_lote = 0;
+    uint32_t boot;
+    uint16_t n = fila_flash_ler(reenvio, TELEMETRIA_LOTE_MAX, &boot);
+    if (n > 0) {
+        len = telemetria_serializar_externas(telem, reenvio, n, boot, corpo, sizeof(corpo), &reenvio_no_lote);
+    } else {
+        len = telemetria_serializar(telem, corpo, sizeof(corpo));
+    }
+    if (len == 0) {
+        return false;
+    }
+    resumo.seg_inicio = lwip_stats.tcp.xmit + lwip_stats.tcp.recv;
+    if (http_client_keepalive_post_async(cyw43_arch_async_context(), ka, "/lote",
+                                         "application/json", corpo, (uint16_t)len) != 0) {
+        ka->status = 0;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Trata a resposta do lote: remove as amostras do anel (ou da flash) se o servidor aceitou
+ * @param ka Conexão keep-alive
+ * @param telem Anel de amostras
+ * @return true se o lote foi entregue
+ */
+static bool concluir_lote(EXAMPLE_HTTP_KEEPALIVE_T *ka, telemetria_t *telem) {
+    uint16_t amostras = reenvio_no_lote ? reenvio_no_lote : telem->em_envio;
+    comandos_concluir();
+    bool entregue = ka->result == HTTPC_RESULT_OK && ka->status == 200;
+    if (entregue) {
+        fila_flash_confirmar(reenvio_no_lote);
+        telemetria_confirmar(telem);
+    }
+    printf("Lote %s: %u amostras, status %lu em %lu us, %lu segmentos TCP (restam %u no anel, %lu na flash)\n",
+           reenvio_no_lote ? "da flash" : "do anel", amostras, (unsigned long)ka->status,
+           (unsigned long)ka->latency_us, (unsigned long)(lwip_stats.tcp.xmit + lwip_stats.tcp.recv - resumo.seg_inicio),
+           telem->quantidade, (unsigned long)fila_flash_pendentes());
+    return entregue;
+}
+
+/**
+ * Move todas as amostras do anel para o fim da fila na flash, mantendo a ordem
+ * @param telem Anel de amostras (sem lote em envio)
+ */
+static void guardar_na_flash(telemetria_t *telem) {
+    telemetria_amostra_t a;
+    while (telemetria_retirar(telem, &a)) {
+        if (!fila_flash_gravar(&a, telem->boot)) {
+            telemetria_contar_perdidas(telem, 1);             // Fila cheia
+        }
+    }
+}
+
+/**
+ * Registra as mudanças do botão no lote e o envia assim que há uma
+ * mudança nova, quando atinge o tamanho ou a idade configurados, ou
+ * com um heartbeat após HEARTBEAT_MS sem envios. O POST segue em
+ * segundo plano: o laço continua registrando eventos enquanto espera
+ * a resposta.
+ *
+ * Se um lote falha, as amostras passam a ir para a flash até um lote
+ * ser entregue; com a conexão de volta, a fila da flash é reenviada
+ * em ordem, em lotes, antes das amostras novas do anel
+ * @param ka Conexão keep-alive
+ */
+static void executar_lotes(EXAMPLE_HTTP_KEEPALIVE_T *ka) {
+    static telemetria_t telem;
+    telemetria_iniciar(&telem, TELEMETRIA_LOTE_MAX, TELEMETRIA_IDADE_MAX_MS);
+    fila_flash_iniciar();
+    printf("Modo lote: até %u amostras ou %lu ms por POST; boot %08lx, %lu amostras na flash\n",
+           telem.lote_max, (unsigned long)telem.idade_max_ms, (unsigned long)telem.boot,
+           (unsigned long)fila_flash_pendentes());
+
+    absolute_time_t proximo_heartbeat = get_absolute_time();    // Informa o estado inicial
+    absolute_time_t proximo_envio = proximo_heartbeat;
+    bool urgente = false;                                          // Há mudança ainda não entregue
+    bool enviando = false;
+    bool sem_conexao = false;                                      // O último lote falhou
+    bool enlace_antes = wifi_conectado();
+    while (1) {
+        botao_evento_t ev;
+        bool evento = false;
+        while (botao_obter_evento(&ev)) {
+            telemetria_registrar_em(&telem, ev.t_us, TELEM_BOTAO, ev.pressionado);
+            urgente = true;
+            evento = true;
+        }
+        if (time_reached(proximo_heartbeat)) {
+            telemetria_registrar(&telem, TELEM_HEARTBEAT, botao_pressionado());
+            proximo_heartbeat = make_timeout_time_ms(heartbeat_ms);
+            urgente = true;
+        }
+
+        // Enlace de volta: tenta já, sem esperar LOTE_REPETIR_MS
+        bool enlace = wifi_conectado();
+        if (enlace && !enlace_antes) {
+            proximo_envio = get_absolute_time();
+        }
+        enlace_antes = enlace;
+
+        if (enviando && ka->complete) {
+            enviando = false;
+            if (concluir_lote(ka, &telem)) {
+                sem_conexao = false;
+                urgente = telem.quantidade > 0;                    // Sobrou o que não coube no lote
+                proximo_heartbeat = make_timeout_time_ms(heartbeat_ms);
+            } else {
+                printf("Erro no lote - amostras vão para a flash, nova tentativa em %d ms\n", LOTE_REPETIR_MS);
+                sem_conexao = true;
+                proximo_envio = make_timeout_time_ms(LOTE_REPETIR_MS);
+            }
+        }
+
+        if (!enviando) {
+            // Sem conexão, ou com o anel quase cheio esperando a fila da flash
+            // esvaziar, as amostras vão para o fim da fila na flash
+            if (sem_conexao || (fila_flash_pendentes() > 0 &&
+                                telem.quantidade > TELEMETRIA_CAPACIDADE - TELEMETRIA_LOTE_MAX)) {
+                guardar_na_flash(&telem);
+            }
+            if ((urgente || telemetria_pronta(&telem) || fila_flash_pendentes() > 0) && time_reached(proximo_envio)) {
+                if (wifi_conectado()) {
+                    enviando = iniciar_lote(ka, &telem);
+                } else {
+                    sem_conexao = true;                            // Nem tenta: sem enlace
+                }
+                if (!enviando) {
+                    proximo_envio = make_timeout_time_ms(LOTE_REPETIR_MS);
+                }
+            }
+        }
+
+        // Apaga um setor já entregue da flash enquanto nada mais está acontecendo
+        if (!enviando && !evento && fila_flash_manutencao()) {
+            continue;
+        }
+
+        // Dorme até a próxima borda (a IRQ do botão acorda o WFE) ou até o próximo prazo
+        absolute_time_t prazo = make_timeout_time_ms(ESPERA_MAX_MS);
+        if (absolute_time_diff_us(proximo_heartbeat, prazo) > 0) {
+            prazo = proximo_heartbeat;
+        }
+        best_effort_wfe_or_timeout(prazo);
+    }
+}
+#endif
+
+#if USAR_MQTT
+static char mqtt_id[5 + 2 * PICO_UNIQUE_BOARD_ID_SIZE_BYTES + 1];    // "pico-" + ID da placa
+static char topico_botao[48];
+static char topico_heartbeat[48];
+static char topico_online[48];
+static char topico_cmd[48];
+
+/**
+ * Mensagem em pico/<ID>/cmd (contexto do lwIP), no mesmo JSON das
+ * respostas do servidor: {"comandos":[{"cmd":"led","valor":1}]}
+ */
+static bool mqtt_mensagem(__unused void *arg, __unused const char *topico, const uint8_t *dados, uint16_t len) {
+    comandos_processar(executar_comando, dados, len);
+    return true;
+}
+
+/**
+ * A sessão com o broker começou ou terminou (contexto do lwIP)
+ */
+static void mqtt_conexao(__unused void *arg, bool conectado) {
+    printf("MQTT %s\n", conectado ? "conectado" : "desconectado");
+    if (conectado) {
+        mqtt_publicar(topico_online, "1", 1, 1, true);
+    }
+    __sev();
+}
+
+/**
+ * Monta os tópicos pico/<ID>/... e liga o cliente MQTT. Chamar antes
+ * de wifi_iniciar: a conexão com o broker acompanha o enlace
+ */
+static void iniciar_mqtt(void) {
+    char id[2 * PICO_UNIQUE_BOARD_ID_SIZE_BYTES + 1];
+    pico_get_unique_board_id_string(id, sizeof(id));
+    snprintf(mqtt_id, sizeof(mqtt_id), "pico-%s", id);
+    snprintf(topico_botao, sizeof(topico_botao), "pico/%s/botao", id);
+    snprintf(topico_heartbeat, sizeof(topico_heartbeat), "pico/%s/heartbeat", id);
+    snprintf(topico_online, sizeof(topico_online), "pico/%s/online", id);
+    snprintf(topico_cmd, sizeof(topico_cmd), "pico/%s/cmd", id);
+
+    static const mqtt_config_t config = {
+        .id = mqtt_id,
+        .will_topico = topico_online,
+        .will_msg = "0",
+        .mensagem_fn = mqtt_mensagem,
+        .conexao_fn = mqtt_conexao,
+    };
+    mqtt_assinar(topico_cmd, 1);
+    if (!mqtt_iniciar(MQTT_BROKER, MQTT_PORTA, &config)) {
+        printf("IP do broker inválido: %s\n", MQTT_BROKER);
+    }
+}
+
+/**
+ * Imprime o resumo do MQTT: tempo até o PUBACK e segmentos TCP por mensagem
+ */
+static void resumo_mqtt(void) {
+    const mqtt_estatisticas_t *e = mqtt_estatisticas();
+    uint32_t segmentos = lwip_stats.tcp.xmit + lwip_stats.tcp.recv - resumo.seg_inicio;
+    uint32_t mensagens = e->publicadas ? e->publicadas : 1;
+    printf("Resumo MQTT: %lu publicadas, %lu confirmadas (PUBACK médio %lu us, máx %lu us), "
+           "%lu reenviadas, %lu descartadas, %lu.%01lu segmentos TCP/mensagem, %lu quedas\n",
+           (unsigned long)e->publicadas, (unsigned long)e->confirmadas,
+           (unsigned long)(e->confirmadas ? e->puback_soma_us / e->confirmadas : 0),
+           (unsigned long)e->puback_max_us, (unsigned long)e->reenviadas, (unsigned long)e->descartadas,
+           (unsigned long)(segmentos / mensagens), (unsigned long)(segmentos * 10 / mensagens % 10),
+           (unsigned long)e->quedas);
+}
+
+/**
+ * Publica cada mudança do botão em pico/<ID>/botao com QoS 1 (guardada
+ * até o PUBACK e reenviada depois de uma queda) e o heartbeat em
+ * pico/<ID>/heartbeat com QoS 0 (um heartbeat perdido é substituído
+ * pelo próximo). Sem conexão, as mudanças esperam na tabela do QoS 1;
+ * com ela cheia, o evento espera no laço e as bordas seguintes na fila
+ * do botão. Cada mensagem leva o boot (sorteado) e uma sequência, para
+ * o servidor descartar as repetidas por um reenvio
+ */
+static void executar_mqtt(void) {
+    uint32_t boot = get_rand_32();
+    uint32_t seq = 0;
+    printf("Modo MQTT: broker %s:%d, cliente %s\n", MQTT_BROKER, MQTT_PORTA, mqtt_id);
+
+    absolute_time_t proximo_heartbeat = get_absolute_time();    // Informa o estado inicial
+    botao_evento_t ev;
+    bool pendente = false;                                         // Evento que não coube na tabela
+    while (1) {
+        char msg[64];
+        if (!pendente && !botao_obter_evento(&ev)) {
+            if (!time_reached(proximo_heartbeat)) {
+                best_effort_wfe_or_timeout(proximo_heartbeat);   // A IRQ do botão acorda o WFE
+                continue;
+            }
+            snprintf(msg, sizeof(msg), "{\"boot\":%lu,\"seq\":%lu,\"valor\":%d}",
+                     (unsigned long)boot, (unsigned long)seq++, botao_pressionado());
+            if (mqtt_publicar(topico_heartbeat, msg, (uint16_t)strlen(msg), 0, false) != ERR_OK) {
+                printf("Heartbeat descartado (%s)\n", mqtt_conectado() ? "sem espaço" : "sem conexão");
+            }
+            proximo_heartbeat = make_timeout_time_ms(heartbeat_ms);
+            continue;
+        }
+
+        snprintf(msg, sizeof(msg), "{\"boot\":%lu,\"seq\":%lu,\"valor\":%d}",
+                 (unsigned long)boot, (unsigned long)seq, ev.pressionado);
+        pendente = mqtt_publicar(topico_botao, msg, (uint16_t)strlen(msg), 1, false) != ERR_OK;
+        if (pendente) {
+            // O PUBACK que libera a tabela não acorda o laço: tenta de novo depois
+            best_effort_wfe_or_timeout(make_timeout_time_ms(ESPERA_MAX_MS));
+            continue;
+        }
+        printf("[%lu] Botão %s publicado (%lu us desde a borda, %d sem PUBACK)\n", (unsigned long)seq,
+               ev.pressionado ? "on" : "off", (unsigned long)(time_us_64() - ev.t_us), mqtt_em_voo());
+        if (++seq % RESUMO_A_CADA == 0) {
+            resumo_mqtt();
+        }
+        proximo_heartbeat = make_timeout_time_ms(heartbeat_ms);
+    }
+}
+#endif
+
 int main() {
-    gpio_init(button_A);
-    gpio_set_dir(button_A, GPIO_IN);
-    gpio_pull_up(button_A);
+    botao_iniciar(button_A);
 
     // Inicializa hardware
     stdio_init_all();
@@ -32,54 +449,85 @@ int main() {
     }
     cyw43_arch_enable_sta_mode();
 
-    // Conecta à rede Wi-Fi
-    printf("Conectando a %s...\n", WIFI_SSID);
-    if (cyw43_arch_wifi_connect_timeout_ms(WIFI_SSID, WIFI_PASSWORD, 
-                                          CYW43_AUTH_WPA2_AES_PSK, 30000)) {
-        printf("Falha na conexão Wi-Fi\n");
-        return 1;
-    }
-    printf("Conectado! IP: %s\n", ip4addr_ntoa(netif_ip4_addr(netif_list)));
+    // Conecta à rede Wi-Fi em segundo plano: o botão já registra eventos
+    // enquanto o driver associa, e as falhas são repetidas com backoff
+    wifi_ouvir(enlace_mudou, NULL);
+#if USAR_MQTT
+    iniciar_mqtt();
+#endif
+    wifi_iniciar(WIFI_SSID, WIFI_PASSWORD, CYW43_AUTH_WPA2_AES_PSK);
 
     int counter = 0;
     char url[128];  // Buffer para URL dinâmica
+    resumo.seg_inicio = lwip_stats.tcp.xmit + lwip_stats.tcp.recv;
+
+#if USAR_MQTT
+    executar_mqtt();
+#endif
+#if USAR_KEEPALIVE
+    // Conexão persistente: o nome é resolvido uma vez e a conexão só é
+    // refeita se cair
+    static EXAMPLE_HTTP_KEEPALIVE_T ka = {0};
+    ka.hostname = HOST;
+    ka.port = PORT;
+    comandos_iniciar(&ka, executar_comando);    // Respostas lidas em fatias, com comandos do servidor
+    printf("Modo keep-alive\n");
+#if USAR_LOTE
+    executar_lotes(&ka);
+#endif
+#else
+    // Fila de requisições: o laço só enfileira e segue; até FILA_EM_VOO
+    // mensagens seguem em paralelo, cada uma com sua conexão
+    static EXAMPLE_HTTP_QUEUE_T fila = {0};
+    fila.hostname = HOST;
+    fila.port = PORT;
+    fila.max_in_flight = FILA_EM_VOO;
+    printf("Modo fila: %d requisições simultâneas, %d vagas\n", FILA_EM_VOO, HTTP_CLIENT_QUEUE_SLOTS);
+#endif
 
-    // Loop principal
+    // Loop principal: uma mensagem por mudança do botão, ou um heartbeat
+    // depois de HEARTBEAT_MS sem mudanças
+    absolute_time_t proximo_heartbeat = get_absolute_time();    // Informa o estado inicial
     while(1) {
-        if (gpio_get(button_A) == 0 )
-        {
-            sprintf(url, "/mensagem?msg=Button_on_%d", 
-                counter++);  
-        } else {
-            sprintf(url, "/mensagem?msg=Button_off_%d", 
-                counter++);  
-        }
-
-        // Configura requisição
-        EXAMPLE_HTTP_REQUEST_T req = {0};
-        req.hostname = HOST;
-        req.url = url;
-        req.port = PORT;
-        req.headers_fn = http_client_header_print_fn;
-        req.recv_fn = http_client_receive_print_fn;
+        // Sem enlace, os eventos esperam na fila do botão; enlace_mudou acorda o WFE
+        if (!wifi_conectado()) {
+            best_effort_wfe_or_timeout(at_the_end_of_time);
+            continue;
+        }
+#if !USAR_KEEPALIVE
+        // Contrapressão: com a fila cheia, os eventos esperam na fila do botão
+        if (http_client_queue_free_slots(&fila) == 0) {
+            best_effort_wfe_or_timeout(make_timeout_time_ms(ESPERA_MAX_MS));
+            continue;
+        }
+#endif
+        botao_evento_t ev;
+        bool heartbeat = false;
+        if (!botao_obter_evento(&ev)) {
+            if (!time_reached(proximo_heartbeat)) {
+                best_effort_wfe_or_timeout(proximo_heartbeat);   // A IRQ do botão acorda o WFE
+                continue;
+            }
+            heartbeat = true;
+            ev.pressionado = botao_pressionado();
+            ev.t_us = time_us_64();
+        }
+        sprintf(url, "/mensagem?msg=%sButton_%s_%d", heartbeat ? "Heartbeat_" : "",
+                ev.pressionado ? "on" : "off", counter++);
 
         // Envia requisição
-        printf("[%d] Enviando: %s\n", counter, url);
-        int result = http_client_request_sync(cyw43_arch_async_context(), &req);
-        
-        // Verifica resultado
-        if (result == 0) {
-            printf("Sucesso!\n");
-        } else {
-            printf("Erro %d - Verifique conexão\n", result);
-            
-            // Tenta reconectar se houver falha
-            cyw43_arch_wifi_connect_timeout_ms(WIFI_SSID, WIFI_PASSWORD, 
-                                             CYW43_AUTH_WPA2_AES_PSK, 10000);
-        }
-
-        // Aguarda antes de enviar novamente
-        sleep_ms(INTERVALO_MS);
+        printf("[%d] Enviando: %s (%lu us desde a borda)\n", counter, url,
+               (unsigned long)(time_us_64() - ev.t_us));
+#if USAR_KEEPALIVE
+        enviar_keepalive(&ka, url);
+#else
+        if (http_client_queue_submit(cyw43_arch_async_context(), &fila, url,
+                                     mensagem_concluida, (void *)(uintptr_t)counter) != 0) {
+            printf("Erro - mensagem descartada\n");
+        }
+#endif
+
+        proximo_heartbeat = make_timeout_time_ms(heartbeat_ms);
     }
 
     // Nunca chegará aqui devido ao while(1)
@@ -59,8 +59,19 @@ CCsGAQUFBwMBMAoGCCqGSM49BAMCA2gAMGUCMEHerJRT0WmG5tz4oVLSIxLbCizd\n\
 zVi56JFnA3cNTcDYfIzyzy5wUskPAykdrRrCS534ig==\n\
 -----END CERTIFICATE-----\n"
 
+// Requests made with the cached configuration: the first one negotiates a session, the
+// others should resume it
+#define TLS_REPEAT 3
+
+static void print_handshake(int n, int result, const EXAMPLE_HTTP_TLS_CONN_T *conn) {
+    printf("request %d: result %d, %s handshake %lu us, mbedtls heap peak %u bytes\n", n, result,
+           !conn->done ? "no" : conn->resumed ? "resumed" : "full",
+           (unsigned long)conn->handshake_us, (unsigned)conn->heap_peak);
+}
+
 int main() {
     stdio_init_all();
+    http_client_tls_init(); // Before any mbedtls allocation, plain tls_config included
     if (cyw43_arch_init()) {
         printf("failed to initialise\n");
         return 1;
@@ -70,22 +81,38 @@ int main() {
         printf("failed to connect\n");
         return 1;
     }
-    // This should work
+    // This should work. The root certificate is parsed once and the session is kept between requests
     static const uint8_t cert_ok[] = TLS_ROOT_CERT_OK;
+    static EXAMPLE_HTTP_TLS_CACHE_T tls_cache;
+    if (http_client_tls_cache_init(&tls_cache, cert_ok, sizeof(cert_ok)) != 0) {
+        panic("failed to create tls config");
+    }
+    printf("tls config: %u bytes of mbedtls heap\n", (unsigned)http_client_tls_heap_in_use());
     EXAMPLE_HTTP_REQUEST_T req = {0};
     req.hostname = HOST;
     req.url = URL_REQUEST;
     req.headers_fn = http_client_header_print_fn;
     req.recv_fn = http_client_receive_print_fn;
-    req.tls_config = altcp_tls_create_config_client(cert_ok, sizeof(cert_ok));
-    int pass = http_client_request_sync(cyw43_arch_async_context(), &req);
-    altcp_tls_free_config(req.tls_config);
+    req.tls_cache = &tls_cache;
+    int pass = 0;
+    for (int i = 0; i < TLS_REPEAT && pass == 0; i++) {
+        pass = http_client_request_sync(cyw43_arch_async_context(), &req);
+        print_handshake(i, pass, &req.tls_conn);
+    }
+    printf("full handshakes %lu (avg %lu us, heap peak %u), resumed %lu (avg %lu us, heap peak %u)\n",
+           (unsigned long)tls_cache.full_handshakes,
+           (unsigned long)(tls_cache.full_handshakes ? tls_cache.full_us / tls_cache.full_handshakes : 0),
+           (unsigned)tls_cache.full_heap_peak, (unsigned long)tls_cache.resumed_handshakes,
+           (unsigned long)(tls_cache.resumed_handshakes ? tls_cache.resumed_us / tls_cache.resumed_handshakes : 0),
+           (unsigned)tls_cache.resumed_heap_peak);
 
     // Repeat the test with the wrong certificate. It should fail
     static const uint8_t cert_bad[] = TLS_ROOT_CERT_BAD;
+    req.tls_cache = NULL;
     req.tls_config = altcp_tls_create_config_client(cert_bad, sizeof(cert_bad));
     int fail = http_client_request_sync(cyw43_arch_async_context(), &req);
     altcp_tls_free_config(req.tls_config);
+    http_client_tls_cache_deinit(&tls_cache);
 
     if (pass != 0 || fail == 0) {
         panic("test failed");
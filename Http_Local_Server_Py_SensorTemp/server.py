@@ -1,5 +1,6 @@
 from flask import Flask, request, render_template, jsonify
-from datetime import datetime
+from datetime import datetime, timedelta
+import json
 import os
 
 app = Flask(__name__)
@@ -8,6 +9,15 @@ app.config['TEMPLATES_AUTO_RELOAD'] = True
 # Lista para armazenar mensagens
 message_history = []
 
+# Comandos para a Pico: seguem na resposta da próxima mensagem (ver comandos.h)
+comandos_pendentes = []
+
+def resposta(status):
+    """Resposta às mensagens da Pico, com os comandos pendentes (que saem da fila)"""
+    comandos = comandos_pendentes[:]
+    comandos_pendentes.clear()
+    return jsonify(status=status, comandos=comandos)
+
 @app.route("/")
 def home():
     return render_template('index.html')
@@ -25,7 +35,125 @@ def receber_mensagem():
     if len(message_history) > 10:
         message_history.pop(0)
     
-    return "Mensagem recebida", 200
+    return resposta("Mensagem recebida"), 200
+
+# Nomes dos tipos de amostra do lote (telemetria_tipo_t em telemetria.h)
+TIPOS_AMOSTRA = {
+    0: lambda valor: "Button_on" if valor else "Button_off",
+    1: lambda valor: "Heartbeat (%s)" % ("Button_on" if valor else "Button_off"),
+}
+
+# Última sequência de amostra recebida de cada boot da Pico: lotes
+# reenviados (resposta perdida, fila da flash relida após um reboot)
+# trazem amostras já recebidas, que são descartadas
+ultima_seq = {}
+
+@app.route("/lote", methods=["POST"])
+def receber_lote():
+    """Recebe um lote de amostras da Pico (ver telemetria.h) e expande no histórico"""
+    lote = request.get_json(silent=True)
+    if not isinstance(lote, dict) or not isinstance(lote.get("amostras"), list):
+        return "Lote inválido", 400
+
+    # A Pico só conhece o próprio relógio (µs desde o boot): "agora_us" é esse
+    # relógio no envio, então cada amostra ocorreu (agora - t) µs antes de chegar.
+    # Amostras de um boot anterior (reenviadas da flash) vêm sem "agora_us" e
+    # ficam com a hora de chegada
+    chegada = datetime.now()
+    try:
+        boot = int(lote["boot"])
+        s0 = int(lote["s0"])
+        agora = int(lote["agora_us"]) if "agora_us" in lote else None
+        t0 = int(lote["t0_us"])
+        amostras = [(int(dt), int(tipo), int(valor)) for dt, tipo, valor in lote["amostras"]]
+    except (KeyError, TypeError, ValueError):
+        return "Lote inválido", 400
+
+    # As amostras são consecutivas a partir de s0 e chegam em ordem
+    ja_recebidas = max(0, min(len(amostras), ultima_seq.get(boot, -1) + 1 - s0))
+    for dt, tipo, valor in amostras[ja_recebidas:]:
+        nome = TIPOS_AMOSTRA.get(tipo, lambda v: f"tipo{tipo}={v}")(valor)
+        if agora is None:
+            message_history.append(f"[~{chegada.strftime('%H:%M:%S')}] {nome} (boot anterior)")
+        else:
+            instante = chegada - timedelta(microseconds=agora - (t0 + dt))
+            message_history.append(f"[{instante.strftime('%H:%M:%S.%f')[:-3]}] {nome}")
+    del message_history[:-10]
+    if amostras:
+        ultima_seq[boot] = max(ultima_seq.get(boot, -1), s0 + len(amostras) - 1)
+
+    perdidas = int(lote.get("perdidas", 0))
+    print(f"Lote {boot:08x}/{s0}: {len(amostras)} amostras"
+          + (f", {ja_recebidas} repetidas descartadas" if ja_recebidas else "")
+          + (f", {perdidas} perdidas na Pico" if perdidas else ""))
+    return resposta("Lote recebido"), 200
+
+# MQTT (USAR_MQTT na Pico): com a variável MQTT_BROKER definida, o servidor
+# assina os tópicos pico/<ID>/... no broker e publica os comandos direto no
+# tópico pico/<ID>/cmd, sem esperar a próxima mensagem da Pico
+mqtt_cli = None
+picos_online = set()
+
+def mqtt_conectado(cli, dados, flags, motivo, propriedades):
+    print(f"MQTT: conectado ao broker ({motivo})")
+    cli.subscribe([("pico/+/botao", 1), ("pico/+/heartbeat", 0), ("pico/+/online", 1)])
+
+def mqtt_mensagem(cli, dados, msg):
+    """Mensagem da Pico (thread do paho): entra no histórico como as do lote"""
+    _, pico, tipo = msg.topic.split("/", 2)
+    if tipo == "online":
+        if msg.payload == b"1":
+            picos_online.add(pico)
+        else:
+            picos_online.discard(pico)
+        print(f"MQTT: Pico {pico} {'online' if msg.payload == b'1' else 'offline'}")
+        return
+    try:
+        m = json.loads(msg.payload)
+        boot, seq, valor = int(m["boot"]), int(m["seq"]), int(m["valor"])
+    except (ValueError, KeyError, TypeError):
+        print(f"MQTT: mensagem inválida em {msg.topic}")
+        return
+    # Uma mudança do botão (QoS 1) sem PUBACK antes de uma queda é reenviada
+    # depois de reconectar e pode chegar repetida
+    if seq <= ultima_seq.get(boot, -1):
+        return
+    ultima_seq[boot] = seq
+    nome = TIPOS_AMOSTRA[0 if tipo == "botao" else 1](valor)
+    message_history.append(f"[{datetime.now().strftime('%H:%M:%S.%f')[:-3]}] {nome} (MQTT)")
+    del message_history[:-10]
+
+def iniciar_mqtt(broker):
+    global mqtt_cli
+    import paho.mqtt.client as mqtt    # pip install paho-mqtt (>= 2)
+    mqtt_cli = mqtt.Client(mqtt.CallbackAPIVersion.VERSION2)
+    mqtt_cli.on_connect = mqtt_conectado
+    mqtt_cli.on_message = mqtt_mensagem
+    mqtt_cli.connect_async(broker, 1883)    # Reconecta sozinho se o broker cair
+    mqtt_cli.loop_start()
+
+@app.route("/comando", methods=["GET"])
+def enfileirar_comando():
+    """Guarda um comando para a Pico, ex.: /comando?cmd=led&valor=1
+    (com MQTT, publica na hora para as Picos online)"""
+    cmd = request.args.get("cmd")
+    if not cmd:
+        return "Falta o parâmetro cmd", 400
+    valor = request.args.get("valor", "")
+    if valor in ("true", "false"):
+        valor = valor == "true"
+    else:
+        try:
+            valor = int(valor)
+        except ValueError:
+            pass
+    if mqtt_cli and picos_online:
+        corpo = json.dumps({"comandos": [{"cmd": cmd, "valor": valor}]})
+        for pico in list(picos_online):
+            mqtt_cli.publish(f"pico/{pico}/cmd", corpo, qos=1)
+        return f"Comando {cmd} publicado para {len(picos_online)} Pico(s)", 200
+    comandos_pendentes.append({"cmd": cmd, "valor": valor})
+    return f"Comando {cmd} na fila ({len(comandos_pendentes)} pendentes)", 200
 
 @app.route("/get_messages")
 def get_messages():
@@ -36,4 +164,17 @@ if __name__ == "__main__":
     if not os.path.exists('templates'):
         os.makedirs('templates')
     
-    app.run(host="0.0.0.0", port=5000, debug=True)
\ No newline at end of file
+    if os.environ.get("MQTT_BROKER"):
+        iniciar_mqtt(os.environ["MQTT_BROKER"])
+
+    try:
+        # waitress mantém a conexão da Pico aberta entre as mensagens
+        # (keep-alive HTTP/1.1). O servidor de desenvolvimento do Flask fecha
+        # a conexão depois de cada resposta: funciona, mas cada mensagem
+        # paga um novo handshake TCP
+        from waitress import serve
+        print("Servindo com waitress (keep-alive) na porta 5000")
+        serve(app, host="0.0.0.0", port=5000)
+    except ImportError:
+        print("waitress não instalado (pip install waitress): sem keep-alive")
+        app.run(host="0.0.0.0", port=5000, debug=True)
\ No newline at end of file
@@ -0,0 +1,158 @@
+#include <stdio.h>
+#include "pico/time.h"
+#include "pico/rand.h"
+#include "telemetria.h"
+
+/***************************************************************
+ * FUNÇÕES INTERNAS
+ **************************************************************/
+static uint64_t agora_us(void) {
+    return to_us_since_boot(get_absolute_time());
+}
+
+static const telemetria_amostra_t *amostra(const telemetria_t *t, uint16_t i) {
+    return &t->anel[(t->inicio + i) % TELEMETRIA_CAPACIDADE];
+}
+
+/**
+ * Monta o corpo com até n amostras consecutivas obtidas por obter()
+ * @param mesmo_boot Se falso, omite "agora_us" (relógio de outro boot)
+ * @return Tamanho do corpo (0 se nenhuma coube); *usadas recebe a quantidade incluída
+ */
+static size_t serializar(const telemetria_t *t, const telemetria_amostra_t *(*obter)(const void *, uint16_t),
+                         const void *origem, uint16_t n, uint32_t boot, bool mesmo_boot,
+                         char *buf, size_t tam, uint16_t *usadas) {
+    *usadas = 0;
+    if (n == 0) {
+        return 0;
+    }
+    const telemetria_amostra_t *a0 = obter(origem, 0);
+    int c;
+    if (mesmo_boot) {
+        c = snprintf(buf, tam, "{\"boot\":%lu,\"s0\":%lu,\"agora_us\":%llu,\"t0_us\":%llu,\"perdidas\":%lu,\"amostras\":[",
+                     (unsigned long)boot, (unsigned long)a0->seq, (unsigned long long)agora_us(),
+                     (unsigned long long)a0->t_us, (unsigned long)t->perdidas);
+    } else {
+        c = snprintf(buf, tam, "{\"boot\":%lu,\"s0\":%lu,\"t0_us\":%llu,\"perdidas\":%lu,\"amostras\":[",
+                     (unsigned long)boot, (unsigned long)a0->seq, (unsigned long long)a0->t_us,
+                     (unsigned long)t->perdidas);
+    }
+    if (c < 0 || (size_t)c >= tam) {
+        return 0;
+    }
+    size_t len = (size_t)c;
+
+    // Inclui amostras enquanto forem consecutivas e sobrar espaço para ela e para o "]}" final
+    uint16_t i;
+    for (i = 0; i < n; i++) {
+        const telemetria_amostra_t *a = obter(origem, i);
+        if (a->seq != a0->seq + i) {
+            break;
+        }
+        // dt em 64 bits: long tem 32 no RP2040 e estouraria com ~36 min de lote
+        c = snprintf(buf + len, tam - len, "%s[%lld,%u,%ld]", i ? "," : "",
+                     (long long)(int64_t)(a->t_us - a0->t_us), a->tipo, (long)a->valor);
+        if (c < 0 || len + (size_t)c + 2 >= tam) {
+            break;
+        }
+        len += (size_t)c;
+    }
+    if (i == 0) {
+        return 0;
+    }
+    buf[len++] = ']';
+    buf[len++] = '}';
+    buf[len] = '\0';
+    *usadas = i;
+    return len;
+}
+
+static const telemetria_amostra_t *obter_do_anel(const void *origem, uint16_t i) {
+    return amostra((const telemetria_t *)origem, i);
+}
+
+static const telemetria_amostra_t *obter_do_vetor(const void *origem, uint16_t i) {
+    return &((const telemetria_amostra_t *)origem)[i];
+}
+
+/***************************************************************
+ * API PÚBLICA
+ **************************************************************/
+void telemetria_iniciar(telemetria_t *t, uint16_t lote_max, uint32_t idade_max_ms) {
+    t->inicio = 0;
+    t->quantidade = 0;
+    t->lote_max = lote_max == 0 || lote_max > TELEMETRIA_CAPACIDADE ? TELEMETRIA_CAPACIDADE : lote_max;
+    t->idade_max_ms = idade_max_ms;
+    t->boot = get_rand_32();
+    t->proxima_seq = 0;
+    t->perdidas = 0;
+    t->em_envio = 0;
+    t->perdidas_em_envio = 0;
+}
+
+void telemetria_registrar(telemetria_t *t, uint8_t tipo, int32_t valor) {
+    telemetria_registrar_em(t, agora_us(), tipo, valor);
+}
+
+void telemetria_registrar_em(telemetria_t *t, uint64_t t_us, uint8_t tipo, int32_t valor) {
+    if (t->quantidade == TELEMETRIA_CAPACIDADE) {
+        // Anel cheio: descarta a mais antiga (inclusive se já estava num lote em envio)
+        t->inicio = (t->inicio + 1) % TELEMETRIA_CAPACIDADE;
+        t->quantidade--;
+        t->perdidas++;
+        if (t->em_envio) {
+            t->em_envio--;
+        }
+    }
+    telemetria_amostra_t *a = &t->anel[(t->inicio + t->quantidade) % TELEMETRIA_CAPACIDADE];
+    a->t_us = t_us;
+    a->seq = t->proxima_seq++;
+    a->tipo = tipo;
+    a->valor = valor;
+    t->quantidade++;
+}
+
+bool telemetria_retirar(telemetria_t *t, telemetria_amostra_t *a) {
+    if (t->quantidade == 0) {
+        return false;
+    }
+    *a = *amostra(t, 0);
+    t->inicio = (t->inicio + 1) % TELEMETRIA_CAPACIDADE;
+    t->quantidade--;
+    t->em_envio = 0;
+    return true;
+}
+
+bool telemetria_pronta(const telemetria_t *t) {
+    if (t->quantidade == 0) {
+        return false;
+    }
+    return t->quantidade >= t->lote_max || agora_us() - amostra(t, 0)->t_us >= (uint64_t)t->idade_max_ms * 1000;
+}
+
+size_t telemetria_serializar(telemetria_t *t, char *buf, size_t tam) {
+    uint16_t limite = t->quantidade < t->lote_max ? t->quantidade : t->lote_max;
+    size_t len = serializar(t, obter_do_anel, t, limite, t->boot, true, buf, tam, &t->em_envio);
+    t->perdidas_em_envio = t->perdidas;
+    return len;
+}
+
+size_t telemetria_serializar_externas(telemetria_t *t, const telemetria_amostra_t *amostras, uint16_t n,
+                                      uint32_t boot, char *buf, size_t tam, uint16_t *usadas) {
+    size_t len = serializar(t, obter_do_vetor, amostras, n, boot, boot == t->boot, buf, tam, usadas);
+    t->em_envio = 0;
+    t->perdidas_em_envio = t->perdidas;
+    return len;
+}
+
+void telemetria_contar_perdidas(telemetria_t *t, uint32_t n) {
+    t->perdidas += n;
+}
+
+void telemetria_confirmar(telemetria_t *t) {
+    t->inicio = (t->inicio + t->em_envio) % TELEMETRIA_CAPACIDADE;
+    t->quantidade -= t->em_envio;
+    t->perdidas -= t->perdidas_em_envio;
+    t->em_envio = 0;
+    t->perdidas_em_envio = 0;
+}
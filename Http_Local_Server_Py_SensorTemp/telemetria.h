@@ -0,0 +1,156 @@
+#ifndef TELEMETRIA_H
+#define TELEMETRIA_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/***************************************************************
+ * TELEMETRIA EM LOTES
+ *
+ * As amostras (tipo, valor e instante em µs desde o boot) vão para
+ * um anel de tamanho fixo e são enviadas juntas, num único POST,
+ * quando o lote atinge lote_max amostras ou quando a amostra mais
+ * antiga passa de idade_max_ms. Lotes maiores gastam menos
+ * cabeçalhos e menos tempo de rádio por amostra; lotes menores
+ * chegam ao servidor mais cedo.
+ *
+ * Corpo do POST (JSON compacto, tempos relativos à 1ª amostra):
+ *   {"boot":2841193520,"s0":350,"agora_us":123456789,"t0_us":118000000,
+ *    "perdidas":0,"amostras":[[0,0,1],[104211,0,0],...]}
+ * Cada amostra é [dt_us, tipo, valor]; dt_us pode ser negativo se
+ * uma amostra foi registrada com um instante anterior ao da 1ª.
+ * "boot" é sorteado a cada boot e cada amostra recebe um número de
+ * sequência crescente; as amostras de um lote são consecutivas a
+ * partir de "s0", e o servidor descarta as que já recebeu (lotes
+ * reenviados após uma resposta perdida ou reenviados da flash).
+ * "agora_us" é o relógio da Pico no envio: o servidor calcula a
+ * hora de cada amostra a partir dele. Ele é omitido quando as
+ * amostras são de um boot anterior (relógio sem referência).
+ * "perdidas" conta as amostras sobrescritas com o anel cheio (ou
+ * descartadas fora dele) desde o último lote entregue.
+ *
+ * As amostras só saem do anel depois que o servidor confirma o
+ * lote (telemetria_confirmar); se o envio falhar, o mesmo lote é
+ * reenviado na próxima tentativa. Sem trava: usar de um só contexto.
+ **************************************************************/
+#ifndef TELEMETRIA_CAPACIDADE
+#define TELEMETRIA_CAPACIDADE 128     // Amostras guardadas enquanto o servidor não responde
+#endif
+
+#ifndef TELEMETRIA_LOTE_MAX
+#define TELEMETRIA_LOTE_MAX 50        // Envia quando o lote tem essa quantidade de amostras
+#endif
+
+#ifndef TELEMETRIA_IDADE_MAX_MS
+#define TELEMETRIA_IDADE_MAX_MS 5000  // ...ou quando a amostra mais antiga tem essa idade
+#endif
+
+#ifndef TELEMETRIA_CORPO_MAX
+#define TELEMETRIA_CORPO_MAX 1400     // Tamanho máximo do corpo JSON (cabe num segmento TCP)
+#endif
+
+typedef enum {
+    TELEM_BOTAO = 0,                  // Mudança do botão A (1 = pressionado)
+    TELEM_HEARTBEAT = 1,              // Sem mudanças há um tempo; valor = estado do botão
+} telemetria_tipo_t;
+
+typedef struct {
+    uint64_t t_us;                    // Instante da amostra (µs desde o boot)
+    uint32_t seq;                     // Sequência da amostra neste boot
+    int32_t valor;
+    uint8_t tipo;                     // telemetria_tipo_t
+} telemetria_amostra_t;
+
+typedef struct {
+    telemetria_amostra_t anel[TELEMETRIA_CAPACIDADE];
+    uint16_t inicio;                  // Índice da amostra mais antiga
+    uint16_t quantidade;
+    uint16_t lote_max;
+    uint32_t idade_max_ms;
+    uint32_t boot;                    // Identificador deste boot
+    uint32_t proxima_seq;             // Sequência da próxima amostra registrada
+    uint32_t perdidas;                // Descartadas desde o último lote entregue
+    uint16_t em_envio;                // Amostras no corpo serializado por último
+    uint32_t perdidas_em_envio;
+} telemetria_t;
+
+/**
+ * Prepara o anel vazio e sorteia o identificador do boot
+ * @param t Estado da telemetria
+ * @param lote_max Amostras que disparam o envio (limitado a TELEMETRIA_CAPACIDADE)
+ * @param idade_max_ms Idade da amostra mais antiga que dispara o envio
+ */
+void telemetria_iniciar(telemetria_t *t, uint16_t lote_max, uint32_t idade_max_ms);
+
+/**
+ * Guarda uma amostra com o instante atual; com o anel cheio, a mais antiga é descartada
+ * @param t Estado da telemetria
+ * @param tipo Tipo da amostra (telemetria_tipo_t)
+ * @param valor Valor medido
+ */
+void telemetria_registrar(telemetria_t *t, uint8_t tipo, int32_t valor);
+
+/**
+ * Guarda uma amostra medida num instante anterior (ex.: borda registrada numa IRQ)
+ * @param t Estado da telemetria
+ * @param t_us Instante da amostra (µs desde o boot)
+ * @param tipo Tipo da amostra (telemetria_tipo_t)
+ * @param valor Valor medido
+ */
+void telemetria_registrar_em(telemetria_t *t, uint64_t t_us, uint8_t tipo, int32_t valor);
+
+/**
+ * Retira a amostra mais antiga do anel (ex.: para guardá-la na flash sem conexão).
+ * Não usar com um lote em envio
+ * @param t Estado da telemetria
+ * @param a Recebe a amostra
+ * @return false se o anel está vazio
+ */
+bool telemetria_retirar(telemetria_t *t, telemetria_amostra_t *a);
+
+/**
+ * Indica se algum limite de envio (tamanho ou idade) foi atingido
+ * @param t Estado da telemetria
+ * @return true se o lote deve ser enviado agora
+ */
+bool telemetria_pronta(const telemetria_t *t);
+
+/**
+ * Monta o corpo JSON com as amostras mais antigas que couberem (até lote_max)
+ * @param t Estado da telemetria
+ * @param buf Destino do corpo
+ * @param tam Tamanho de buf
+ * @return Tamanho do corpo, ou 0 se não há amostras ou nenhuma coube
+ */
+size_t telemetria_serializar(telemetria_t *t, char *buf, size_t tam);
+
+/**
+ * Monta o corpo JSON com amostras guardadas fora do anel (ex.: fila na flash).
+ * O anel não é alterado: telemetria_confirmar só zera "perdidas"
+ * @param t Estado da telemetria
+ * @param amostras Amostras consecutivas (seq crescente de 1 em 1)
+ * @param n Quantidade de amostras
+ * @param boot Boot em que as amostras foram medidas
+ * @param buf Destino do corpo
+ * @param tam Tamanho de buf
+ * @param usadas Recebe quantas amostras couberam no corpo
+ * @return Tamanho do corpo, ou 0 se nenhuma coube
+ */
+size_t telemetria_serializar_externas(telemetria_t *t, const telemetria_amostra_t *amostras, uint16_t n,
+                                      uint32_t boot, char *buf, size_t tam, uint16_t *usadas);
+
+/**
+ * Conta amostras descartadas fora do anel; saem no campo "perdidas" do próximo lote
+ * @param t Estado da telemetria
+ * @param n Quantidade descartada
+ */
+void telemetria_contar_perdidas(telemetria_t *t, uint32_t n);
+
+/**
+ * Remove do anel as amostras do último corpo serializado (o servidor recebeu o lote)
+ * @param t Estado da telemetria
+ */
+void telemetria_confirmar(telemetria_t *t);
+
+#endif
@@ -2,21 +2,41 @@
  * INCLUSÕES DE BIBLIOTECAS
  **************************************************************/
 #include "pico/stdlib.h"          // Biblioteca padrão do Pico
-#include "hardware/adc.h"         // Para leitura ADC (temperatura)
+#include "temperatura.h"          // Para leitura contínua da temperatura (ADC + DMA)
+#include "comandos.h"             // Para a fila de comandos (rede -> periféricos)
 #include "pico/cyw43_arch.h"      // Para controle Wi-Fi
 #include <stdio.h>                // Para funções de I/O
 #include <string.h>               // Para manipulação de strings
+#include <strings.h>              // Para strncasecmp (cabeçalhos HTTP)
 #include <stdlib.h>               // Para alocação de memória
 #include "lwip/pbuf.h"            // Para buffers de rede
-#include "lwip/tcp.h"             // Para protocolo TCP
+#include "lwip/tcp.h"             // Para protocolo TCP (prioridades dos PCBs)
+#include "lwip/altcp.h"           // Para a API altcp (TCP puro ou TLS)
+#include "lwip/altcp_tcp.h"       // Para altcp_tcp_new_ip_type (declarada aqui com LWIP_ALTCP)
 #include "lwip/netif.h"           // Para interface de rede
 #include "hardware/pio.h"         // Para controle PIO
 #include "hardware/clocks.h"      // Para controle de clocks
 #include "ws2818b.pio.h"          // Para LEDs NeoPixel
 #include "hardware/pwm.h"         // Para controle PWM (buzzer)
 #include "pico/binary_info.h"     // Para informações binárias
+#include "pico/multicore.h"       // Para o laço de renderização no núcleo 1
+#include "pico/async_context.h"   // Para os workers do núcleo 0
+#include "hardware/irq.h"         // Para a IRQ do FIFO entre núcleos
+#include "hardware/sync.h"        // Para __wfi
 #include "inc/ssd1306_i2c.h"      // Para display OLED
 #include "hardware/i2c.h"         // Para comunicação I2C
+#include "sse.h"                  // Para eventos em tempo real (/events)
+#include "websocket.h"            // Para controle em tempo real (/ws)
+#include "web_fs.h"               // Para os arquivos da interface (www/, gzip na flash)
+#include "metricas.h"             // Para os contadores exportados em /metrics
+#include "controle_udp.h"         // Para o protocolo binário de controle (UDP)
+#include "limitador.h"            // Para a taxa de comandos por cliente (429)
+#include "wifi.h"                 // Para a conexão Wi-Fi em segundo plano
+#include "mqtt_cliente.h"         // Para telemetria e comandos pelo broker MQTT
+#include "pico/unique_id.h"       // Para o ID da placa nos tópicos MQTT
+#if ROBO_HTTPS
+#include "https.h"                // Para o servidor HTTPS (altcp_tls + mbedTLS)
+#endif
 
 /***************************************************************
  * DEFINIÇÕES DE CONSTANTES E CONFIGURAÇÕES
@@ -36,18 +56,26 @@
 #define I2C_SDA 14                     // Pino SDA I2C (display)
 #define I2C_SCL 15                     // Pino SCL I2C (display)
 #define BUZZER_FREQUENCY 6000          // Frequência do buzzer (6kHz)
+#define SSE_INTERVALO_TEMP_MS 2000     // Intervalo entre eventos de temperatura
+#define RENDER_PERIODO_MS 5            // Espera máxima do núcleo 1 sem comandos
+#define RENDER_TICK_MS 20              // Cada atuador é acionado no máximo uma vez por tick (50 Hz)
+#define USO_JANELA_US 1000000          // Janela de medição da utilização dos núcleos
+#define ADC_PROCESSAR_MS 50            // Intervalo do worker que consome o buffer do ADC
 
 /***************************************************************
  * VARIÁVEIS GLOBAIS
  **************************************************************/
 // Controle do display OLED
 char mensagem_display[50] = "";    // Buffer para mensagem do display
-bool atualizar_display = false;    // Flag para atualização do display
+volatile bool atualizar_display = false;    // Flag para atualização do display (núcleo 1)
+static volatile uint32_t estado_seq = 0;    // Ímpar enquanto o núcleo 1 muda estado/mensagem (ver robo_ler_estado)
 
 // Controle do buzzer
 static absolute_time_t next_buzzer_toggle;  // Próximo momento para alternar buzzer
 static bool buzzer_state = false;           // Estado atual do buzzer
 static bool buzzer_active = false;          // Flag de ativação do buzzer
+static bool tom_ativo = false;              // Tom avulso em andamento (CMD_TOM)
+static absolute_time_t fim_tom;             // Fim do tom avulso
 
 // Estrutura e variáveis para LEDs NeoPixel
 typedef struct {
@@ -58,6 +86,122 @@ typedef pixel_t npLED_t;
 npLED_t leds[LED_COUNT];  // Buffer para cores dos LEDs
 PIO np_pio;               // Instância do PIO
 uint sm;                  // Máquina de estado do PIO
+uint32_t led_frame_id = 0; // Contador de quadros enviados à matriz
+
+// Estado do robô exposto pela API
+typedef enum {
+    ROBO_APAGADO = 0,  // LEDs apagados, display limpo
+    ROBO_ACORDADO,     // Olhos acesos e buzzer ativo
+    ROBO_DORMINDO      // Olhos apagados, buzzer desligado
+} robo_estado_t;
+
+static robo_estado_t robo_estado = ROBO_APAGADO;
+
+// Escritas pendentes do tick atual, uma por atuador: comandos que chegam
+// antes do tick substituem o pendente do mesmo atuador (o último vence).
+// Usado apenas pelo núcleo 1
+typedef struct {
+    bool leds;                    // cmd_leds aguardando (CMD_ESTADO ou CMD_QUADRO)
+    bool bip;                     // Ligar/desligar o bipe do estado
+    bool tom;                     // cmd_tom aguardando
+    bool display;                 // texto aguardando
+    bool estado;                  // novo_estado aguardando
+    bool bip_ligado;
+    robo_estado_t novo_estado;
+    comando_t cmd_leds;
+    comando_t cmd_tom;
+    char texto[CMD_TEXTO_TAM];
+} render_pendente_t;
+
+static render_pendente_t pendente;
+static absolute_time_t proximo_tick;      // Próxima aplicação permitida
+
+// Conexões HTTP (uma por PCB, sem malloc no callback)
+#define HTTP_MAX_CONEXOES 4               // Menor que MEMP_NUM_TCP_PCB: sobra PCB para o 503 imediato
+#define HTTP_RX_BUF 512                   // Cabeçalho + corpo de uma requisição
+#define HTTP_TX_BUF 512                   // Cabeçalhos e corpos dinâmicos aguardando envio
+#define HTTP_TX_SEGMENTOS 4               // Trechos pendentes por conexão
+#define HTTP_POLL_INTERVALO 2             // tcp_poll a cada 1 s (unidades de 500 ms)
+#define HTTP_TIMEOUT_OCIOSO_S 30          // Keep-alive sem requisições
+#define HTTP_TIMEOUT_ENVIO_S 10           // Resposta pendente sem a janela abrir
+#define HTTP_ESPERA_POLL 4                // Espera por vaga no pool antes do 503 (unidades de 500 ms)
+#define HTTP_SATURADO_POLL 4              // Prazo do 503 imediato antes de abortar (unidades de 500 ms)
+// Prioridades para o tcp_kill_prio do lwIP (pool de PCBs cheio, novo SYN): só
+// perdem o PCB o 503 já enviado e o keep-alive ocioso com a resposta confirmada
+// (o navegador reabre sem erro), o mais inativo primeiro. Requisições em
+// andamento, conexões em espera, SSE e WS ficam na prioridade do PCB de escuta
+// (TCP_PRIO_NORMAL) e o SYN excedente é descartado pelo lwIP
+#define HTTP_PRIO_SATURADO TCP_PRIO_MIN
+#define HTTP_PRIO_OCIOSO (TCP_PRIO_MIN + 1)
+
+// Trecho da resposta ainda não entregue ao lwIP
+typedef struct {
+    const char *dados;            // Próximo byte a enviar
+    u32_t restante;               // Bytes restantes do trecho
+    bool copiar;                  // true: dados em tx (copiados); false: flash (referenciados)
+} http_segmento_t;
+
+typedef struct {
+    struct altcp_pcb *pcb;          // PCB associado (NULL = livre)
+    uint64_t t_inicio;            // Chegada do segmento que completou a requisição
+    char rx[HTTP_RX_BUF + 1];     // Requisição acumulada entre segmentos
+    u16_t rx_len;                 // Bytes válidos em rx
+    char tx[HTTP_TX_BUF];         // Área dos trechos copiados
+    u16_t tx_len;                 // Bytes usados em tx
+    http_segmento_t seg[HTTP_TX_SEGMENTOS];  // Fila de envio (em ordem)
+    u8_t n_seg;                   // Trechos na fila
+    u8_t ocioso;                  // Segundos sem atividade (tcp_poll)
+    uint64_t t_atividade;         // Último recv/sent, para escolher a vítima LRU
+    u16_t requisicoes;            // Atendidas nesta conexão (0 = ainda não é keep-alive)
+    u8_t rota;                    // metrica_rota_t da requisição em andamento
+    bool fechar;                  // Fechar assim que a fila esvaziar
+} http_conn_t;
+
+static http_conn_t conexoes[HTTP_MAX_CONEXOES];
+
+// Texto de /metrics: grande demais para conn->tx, fica aqui até ser entregue ao lwIP
+#define METRICAS_BUF 8192
+static char metricas_texto[METRICAS_BUF];
+static http_conn_t *metricas_dono = NULL;  // Conexão que ainda envia metricas_texto
+
+// JSON de /api/temperatura/historico, pelo mesmo esquema: até 9 bytes por ponto
+// (",-1480.25" com o ADC saturado em 3,3 V), mais que cabe em conn->tx
+#define HISTORICO_BUF (TEMP_HIST_TAM * 9 + 40)
+static char historico_texto[HISTORICO_BUF];
+static http_conn_t *historico_dono = NULL;  // Conexão que ainda envia historico_texto
+
+// Latência entre a chegada da requisição e o primeiro byte da resposta
+static uint32_t lat_n = 0;          // Respostas medidas
+static uint32_t lat_ultima_us = 0;  // Última medição
+static uint32_t lat_max_us = 0;     // Pior caso
+static uint64_t lat_soma_us = 0;    // Soma para a média
+static uint32_t fila_max_us = 0;    // Maior espera de um comando na fila
+
+// Latência entre a interrupção do CYW43 e o callback de recepção TCP
+static volatile uint64_t t_irq_wifi = 0;  // Última borda do pino HOST_WAKE
+static uint32_t irq_n = 0;
+static uint32_t irq_ultima_us = 0;
+static uint32_t irq_max_us = 0;
+static uint64_t irq_soma_us = 0;
+
+// Utilização de cada núcleo (tempo ocupado / tempo total da janela)
+typedef struct {
+    uint32_t inicio_janela;         // Início da janela atual (time_us_32)
+    uint32_t ocupado_us;            // Tempo ocupado acumulado na janela
+    volatile uint32_t uso_pct;      // Utilização da última janela completa (0-100)
+} uso_nucleo_t;
+
+static uso_nucleo_t uso_nucleo[2];
+
+#if ROBO_MQTT
+// Tópicos MQTT do robô: robo/<ID da placa>/... (ver robo_mqtt_iniciar)
+static char mqtt_id[24];
+static char topico_temp[40];
+static char topico_estado[40];
+static char topico_cmd[40];
+static char topico_online[40];
+static bool mqtt_estado_pendente = false;   // Estado que não coube na tabela do QoS 1
+#endif
 
 /***************************************************************
  * PROTÓTIPOS DE FUNÇÕES
@@ -69,6 +213,7 @@ void npClear();
 void npWrite();
 int getIndex(int x, int y);
 void updateLEDs(int matriz[5][5][3]);
+void npWriteFrame(const uint8_t *rgb);
 
 // Funções para display
 void exibir_mensagem_centralizada(const char *mensagem);
@@ -77,11 +222,40 @@ void exibir_mensagem_centralizada(const char *mensagem);
 void pwm_init_buzzer(uint pin);
 void buzzer_on(uint pin);
 void buzzer_off(uint pin);
+void buzzer_tom(uint pin, uint16_t freq_hz, uint16_t duracao_ms);
 void update_buzzer();
 
+// Funções de estado do robô
+const char *robo_estado_nome(robo_estado_t estado);
+bool robo_estado_de_nome(const char *nome, robo_estado_t *estado);
+void robo_publicar_estado();
+bool robo_decodificar_comando(const uint8_t *dados, uint16_t len, comando_t *cmd);
+void robo_ws_mensagem(const uint8_t *dados, uint16_t len);
+bool robo_enfileirar_estado(robo_estado_t estado);
+void robo_acumular_comando(const comando_t *cmd);
+void robo_aplicar_pendentes();
+
+// Funções do núcleo 1
+void display_renderizar();
+void uso_registrar(uso_nucleo_t *uso, uint32_t ocupado_us);
+void core1_render();
+void notificar_estado_nucleo0();
+
+// Workers do núcleo 0 (rodam no async_context do cyw43, com o lwIP travado)
+static void trabalho_adc(async_context_t *ctx, async_at_time_worker_t *worker);
+static void trabalho_sse_temp(async_context_t *ctx, async_at_time_worker_t *worker);
+static void trabalho_estado(async_context_t *ctx, async_when_pending_worker_t *worker);
+static void robo_wifi_evento(void *arg, bool conectado);
+#if ROBO_MQTT
+static void robo_mqtt_iniciar(void);
+#endif
+static async_at_time_worker_t worker_adc = { .do_work = trabalho_adc };
+static async_at_time_worker_t worker_sse_temp = { .do_work = trabalho_sse_temp };
+static async_when_pending_worker_t worker_estado = { .do_work = trabalho_estado };  // Também acionado por /events
+
 // Funções para servidor web
-static err_t tcp_server_recv(void *arg, struct tcp_pcb *tpcb, struct pbuf *p, err_t err);
-static err_t tcp_server_accept(void *arg, struct tcp_pcb *newpcb, err_t err);
+static err_t tcp_server_recv(void *arg, struct altcp_pcb *tpcb, struct pbuf *p, err_t err);
+static err_t tcp_server_accept(void *arg, struct altcp_pcb *newpcb, err_t err);
 
 /***************************************************************
  * MATRIZES DE CORES PARA OS LEDs
@@ -121,7 +295,11 @@ int matriz_apagada[5][5][3] = {
  * @param mensagem Texto a ser exibido (máx 49 caracteres)
  */
 void exibir_mensagem_centralizada(const char *mensagem) {
+    estado_seq++;
+    __dmb();
     strncpy(mensagem_display, mensagem, sizeof(mensagem_display)-1);
+    __dmb();
+    estado_seq++;
     atualizar_display = true;  // Sinaliza para atualizar o display
 }
 
@@ -170,12 +348,15 @@ void npClear() {
  * Envia os dados do buffer para os LEDs
  */
 void npWrite() {
+    uint32_t t0 = time_us_32();
     for (uint i = 0; i < LED_COUNT; ++i) {
         pio_sm_put_blocking(np_pio, sm, leds[i].G);
         pio_sm_put_blocking(np_pio, sm, leds[i].R);
         pio_sm_put_blocking(np_pio, sm, leds[i].B);
     }
+    led_frame_id++;
     sleep_us(100);  // Aguarda o sinal de reset
+    histograma_registrar(&metricas.led, time_us_32() - t0);
 }
 
 /**
@@ -206,6 +387,20 @@ void updateLEDs(int matriz[5][5][3]) {
     npWrite();
 }
 
+/**
+ * Escreve um quadro completo recebido pela rede
+ * @param rgb 25 pixels RGB (75 bytes), linha a linha de cima para baixo
+ */
+void npWriteFrame(const uint8_t *rgb) {
+    for (int y = 0; y < 5; y++) {
+        for (int x = 0; x < 5; x++) {
+            const uint8_t *px = &rgb[(y * 5 + x) * 3];
+            npSetLED(getIndex(x, y), px[0], px[1], px[2]);
+        }
+    }
+    npWrite();
+}
+
 /***************************************************************
  * FUNÇÕES PARA CONTROLE DO BUZZER
  **************************************************************/
@@ -242,10 +437,33 @@ void buzzer_off(uint pin) {
     pwm_set_gpio_level(pin, 0);
 }
 
+/**
+ * Toca um tom avulso, suspendendo o bipe do estado acordado enquanto durar
+ * @param pin Pino do buzzer
+ * @param freq_hz Frequência do tom
+ * @param duracao_ms Duração do tom
+ */
+void buzzer_tom(uint pin, uint16_t freq_hz, uint16_t duracao_ms) {
+    uint slice_num = pwm_gpio_to_slice_num(pin);
+    pwm_set_clkdiv(slice_num, (float)clock_get_hz(clk_sys) / (freq_hz * 4096.0f));
+    pwm_set_gpio_level(pin, 1024);
+    tom_ativo = true;
+    fim_tom = make_timeout_time_ms(duracao_ms);
+}
+
 /**
  * Atualiza o estado do buzzer (chamada no loop principal)
  */
 void update_buzzer() {
+    if (tom_ativo) {
+        if (!time_reached(fim_tom)) {
+            return;
+        }
+        // Volta à frequência padrão e ao ponto em que o bipe estava
+        tom_ativo = false;
+        pwm_set_clkdiv(pwm_gpio_to_slice_num(BUZZER_PIN), clock_get_hz(clk_sys) / (BUZZER_FREQUENCY * 4096));
+        pwm_set_gpio_level(BUZZER_PIN, buzzer_active && buzzer_state ? 1024 : 0);
+    }
     if (buzzer_active && time_reached(next_buzzer_toggle)) {
         buzzer_state = !buzzer_state;
         pwm_set_gpio_level(BUZZER_PIN, buzzer_state ? 1024 : 0);
@@ -253,95 +471,1520 @@ void update_buzzer() {
     }
 }
 
+/***************************************************************
+ * FUNÇÕES DE ESTADO DO ROBÔ
+ **************************************************************/
+/**
+ * Converte o estado do robô para o nome usado na API JSON
+ * @param estado Estado do robô
+ * @return Nome do estado ("acordado", "dormindo" ou "apagado")
+ */
+const char *robo_estado_nome(robo_estado_t estado) {
+    switch (estado) {
+        case ROBO_ACORDADO: return "acordado";
+        case ROBO_DORMINDO: return "dormindo";
+        default:            return "apagado";
+    }
+}
+
+/**
+ * Converte o nome recebido pela API para o estado do robô
+ * @param nome Nome do estado
+ * @param estado Saída com o estado correspondente
+ * @return true se o nome for válido
+ */
+bool robo_estado_de_nome(const char *nome, robo_estado_t *estado) {
+    if (strcmp(nome, "acordado") == 0) {
+        *estado = ROBO_ACORDADO;
+    } else if (strcmp(nome, "dormindo") == 0) {
+        *estado = ROBO_DORMINDO;
+    } else if (strcmp(nome, "apagado") == 0) {
+        *estado = ROBO_APAGADO;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Lê o estado do robô e a mensagem do display numa cópia consistente
+ * (núcleo 0). O núcleo 1 escreve os dois sem trava: a sequência fica
+ * ímpar durante a escrita, e a leitura se repete se ela mudou no meio
+ * @param estado Estado do robô
+ * @param mensagem Cópia de mensagem_display (sizeof(mensagem_display) bytes)
+ */
+static void robo_ler_estado(robo_estado_t *estado, char *mensagem) {
+    uint32_t seq;
+    do {
+        while ((seq = estado_seq) & 1) {
+            tight_loop_contents();
+        }
+        __dmb();
+        *estado = robo_estado;
+        memcpy(mensagem, mensagem_display, sizeof(mensagem_display));
+        __dmb();
+    } while (estado_seq != seq);
+    mensagem[sizeof(mensagem_display) - 1] = '\0';
+}
+
+/**
+ * Envia o estado atual (robô, display e quadro dos LEDs) aos assinantes de /events
+ * e do tópico MQTT de estado.
+ * Pode ser chamada do loop principal ou de callbacks do lwIP (a trava é recursiva).
+ */
+void robo_publicar_estado() {
+    robo_estado_t estado;
+    char mensagem[sizeof(mensagem_display)];
+    robo_ler_estado(&estado, mensagem);
+    char json[112];                      // Mensagem de 49 caracteres e frame de 10 dígitos: 98 bytes
+    snprintf(json, sizeof(json), "{\"estado\":\"%s\",\"msg\":\"%s\",\"frame\":%lu}",
+             robo_estado_nome(estado), mensagem, (unsigned long)led_frame_id);
+    cyw43_arch_lwip_begin();
+    sse_publicar("estado", json);
+#if ROBO_MQTT
+    // QoS 1 e retido: quem assina depois recebe o estado atual. Sem sessão
+    // não guarda (a tabela do QoS 1 encheria de estados velhos): cada
+    // sessão nova publica o estado do momento (robo_mqtt_conexao). Com a
+    // tabela cheia, o worker de temperatura tenta de novo
+    if (mqtt_conectado()) {
+        mqtt_estado_pendente = mqtt_publicar(topico_estado, json, (uint16_t)strlen(json), 1, true) != ERR_OK;
+    }
+#endif
+    cyw43_arch_lwip_end();
+}
+
+/**
+ * Pede a troca de estado sem acionar periféricos (usada nos callbacks de rede)
+ * @param estado Estado desejado
+ * @return false se a fila de comandos estiver cheia
+ */
+bool robo_enfileirar_estado(robo_estado_t estado) {
+    comando_t cmd = { .tipo = CMD_ESTADO, .estado = (uint8_t)estado };
+    return comando_enviar(&cmd);
+}
+
+/**
+ * Marca a escrita pendente de um atuador, contando a substituição se já havia uma
+ * @param flag Flag do atuador em pendente
+ * @param atuador Atuador para as métricas
+ */
+static void pendente_marcar(bool *flag, metrica_atuador_t atuador) {
+    if (*flag) {
+        metricas.cmd_coalescidos[atuador]++;
+    }
+    *flag = true;
+}
+
+/**
+ * Registra um comando retirado da fila sem acionar periféricos (núcleo 1)
+ * Só o último comando de cada atuador até o próximo tick é aplicado.
+ * @param cmd Comando retirado da fila
+ */
+void robo_acumular_comando(const comando_t *cmd) {
+    uint32_t espera = time_us_32() - cmd->t_us;
+    if (espera > fila_max_us) {
+        fila_max_us = espera;
+    }
+
+    switch (cmd->tipo) {
+        case CMD_ESTADO: {
+            // Um estado aciona os três atuadores: olhos, bipe e mensagem
+            robo_estado_t estado = (robo_estado_t)cmd->estado;
+            pendente.estado = true;
+            pendente.novo_estado = estado;
+            pendente_marcar(&pendente.leds, ATUADOR_LEDS);
+            pendente.cmd_leds = *cmd;
+            pendente_marcar(&pendente.bip, ATUADOR_BUZZER);
+            pendente.bip_ligado = estado == ROBO_ACORDADO;
+            pendente_marcar(&pendente.display, ATUADOR_DISPLAY);
+            strcpy(pendente.texto, estado == ROBO_ACORDADO ? "Bip Bip Bip" :
+                                   estado == ROBO_DORMINDO ? "ZzZ ZzZ ZzZ" : "");
+            break;
+        }
+        case CMD_QUADRO:
+            pendente_marcar(&pendente.leds, ATUADOR_LEDS);
+            pendente.cmd_leds = *cmd;
+            break;
+        case CMD_TEXTO:
+            pendente_marcar(&pendente.display, ATUADOR_DISPLAY);
+            strcpy(pendente.texto, cmd->texto);
+            break;
+        case CMD_TOM:
+            pendente_marcar(&pendente.tom, ATUADOR_BUZZER);
+            pendente.cmd_tom = *cmd;
+            break;
+        default:
+            break;
+    }
+}
+
+/**
+ * Aplica as escritas pendentes: no máximo uma por atuador (núcleo 1)
+ */
+void robo_aplicar_pendentes() {
+    if (pendente.leds) {
+        if (pendente.cmd_leds.tipo == CMD_QUADRO) {
+            npWriteFrame(pendente.cmd_leds.quadro);
+        } else {
+            robo_estado_t estado = (robo_estado_t)pendente.cmd_leds.estado;
+            updateLEDs(estado == ROBO_ACORDADO ? matriz_olhos_acesos :
+                       estado == ROBO_DORMINDO ? matriz_olhos_apagados : matriz_apagada);
+        }
+        metricas.cmd_aplicados[ATUADOR_LEDS]++;
+    }
+    if (pendente.bip) {
+        if (pendente.bip_ligado) {
+            buzzer_on(BUZZER_PIN);
+        } else {
+            buzzer_off(BUZZER_PIN);
+        }
+        metricas.cmd_aplicados[ATUADOR_BUZZER]++;
+    }
+    if (pendente.tom) {
+        buzzer_tom(BUZZER_PIN, pendente.cmd_tom.tom.freq_hz, pendente.cmd_tom.tom.duracao_ms);
+        metricas.cmd_aplicados[ATUADOR_BUZZER]++;
+    }
+    if (pendente.display) {
+        exibir_mensagem_centralizada(pendente.texto);
+        metricas.cmd_aplicados[ATUADOR_DISPLAY]++;
+    }
+    if (pendente.estado) {
+        estado_seq++;
+        __dmb();
+        robo_estado = pendente.novo_estado;
+        __dmb();
+        estado_seq++;
+    }
+    // Um aviso por tick no máximo, também para o frame novo dos LEDs
+    if (pendente.estado || pendente.display || pendente.leds) {
+        notificar_estado_nucleo0();
+    }
+    pendente.leds = pendente.bip = pendente.tom = pendente.display = pendente.estado = false;
+}
+
+/**
+ * Converte um comando binário (WebSocket ou UDP) em comando_t
+ * @param dados Comando (primeiro byte = WS_CMD_*)
+ * @param len Tamanho do comando
+ * @param cmd Comando decodificado
+ * @return false se o comando for inválido
+ */
+bool robo_decodificar_comando(const uint8_t *dados, uint16_t len, comando_t *cmd) {
+    memset(cmd, 0, sizeof(*cmd));
+    switch (dados[0]) {
+        case WS_CMD_ESTADO:
+            if (len != 2 || dados[1] > ROBO_DORMINDO) return false;
+            cmd->tipo = CMD_ESTADO;
+            cmd->estado = dados[1];
+            return true;
+        case WS_CMD_QUADRO:
+            if (len != 1 + CMD_QUADRO_TAM) return false;
+            cmd->tipo = CMD_QUADRO;
+            memcpy(cmd->quadro, &dados[1], CMD_QUADRO_TAM);
+            return true;
+        case WS_CMD_TEXTO: {
+            uint16_t n = len - 1 < CMD_TEXTO_TAM - 1 ? len - 1 : CMD_TEXTO_TAM - 1;
+            // Só ASCII imprimível (a fonte do OLED), sem aspas nem barra
+            // invertida: o texto vai sem escape para o JSON de /api/status e
+            // para a linha data: do SSE
+            for (uint16_t i = 0; i < n; i++) {
+                uint8_t c = dados[1 + i];
+                if (c < ' ' || c > '~' || c == '"' || c == '\\') return false;
+            }
+            cmd->tipo = CMD_TEXTO;
+            memcpy(cmd->texto, &dados[1], n);
+            cmd->texto[n] = '\0';
+            return true;
+        }
+        case WS_CMD_TOM:
+            if (len != 5) return false;
+            cmd->tipo = CMD_TOM;
+            cmd->tom.freq_hz = dados[1] | (dados[2] << 8);
+            cmd->tom.duracao_ms = dados[3] | (dados[4] << 8);
+            // Limites do divisor do PWM (1 a 256) com wrap de 4096
+            return cmd->tom.freq_hz >= 200 && cmd->tom.freq_hz <= 20000 && cmd->tom.duracao_ms > 0;
+        default:
+            return false;
+    }
+}
+
+/**
+ * Trata as mensagens binárias recebidas pelo WebSocket
+ * Apenas converte para comando_t e enfileira; quem aciona os periféricos é o núcleo 1.
+ * @param dados Mensagem (primeiro byte = comando WS_CMD_*)
+ * @param len Tamanho da mensagem
+ */
+void robo_ws_mensagem(const uint8_t *dados, uint16_t len) {
+    comando_t cmd;
+    if (robo_decodificar_comando(dados, len, &cmd)) {
+        comando_enviar(&cmd);  // Fila cheia: descarta (contabilizado na fila)
+    }
+}
+
 /***************************************************************
  * FUNÇÕES DO SERVIDOR WEB
  **************************************************************/
+/**
+ * Reserva uma conexão livre do pool
+ * @param pcb PCB aceito pelo lwIP
+ * @return Conexão reservada ou NULL se o pool estiver cheio
+ */
+static http_conn_t *http_conn_alloc(struct altcp_pcb *pcb) {
+    for (int i = 0; i < HTTP_MAX_CONEXOES; i++) {
+        if (!conexoes[i].pcb) {
+            http_conn_t *conn = &conexoes[i];
+            conn->pcb = pcb;
+            conn->t_inicio = 0;
+            conn->rx_len = 0;
+            conn->tx_len = 0;
+            conn->n_seg = 0;
+            conn->ocioso = 0;
+            conn->t_atividade = time_us_64();
+            conn->requisicoes = 0;
+            conn->rota = ROTA_DESCONHECIDA;
+            conn->fechar = false;
+            return conn;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Desassocia os callbacks e devolve a conexão ao pool
+ */
+static void http_conn_free(http_conn_t *conn) {
+    if (conn->pcb) {
+        altcp_arg(conn->pcb, NULL);
+        altcp_recv(conn->pcb, NULL);
+        altcp_sent(conn->pcb, NULL);
+        altcp_err(conn->pcb, NULL);
+        altcp_poll(conn->pcb, NULL, 0);
+    }
+    if (metricas_dono == conn) {
+        metricas_dono = NULL;
+    }
+    if (historico_dono == conn) {
+        historico_dono = NULL;
+    }
+    conn->pcb = NULL;
+    conn->rx_len = 0;
+    conn->tx_len = 0;
+    conn->n_seg = 0;
+}
+
+/**
+ * Fecha a conexão de forma ordenada (aborta se o lwIP não tiver memória)
+ * @return ERR_ABRT se o PCB foi abortado (deve ser repassado ao lwIP pelo callback)
+ */
+static err_t http_conn_close(http_conn_t *conn) {
+    struct altcp_pcb *pcb = conn->pcb;
+    http_conn_free(conn);
+    if (altcp_close(pcb) != ERR_OK) {
+        altcp_abort(pcb);
+        return ERR_ABRT;
+    }
+    return ERR_OK;
+}
+
+/**
+ * Aborta a conexão imediatamente (erro ou tempo esgotado)
+ * @return ERR_ABRT
+ */
+static err_t http_conn_abort(http_conn_t *conn) {
+    struct altcp_pcb *pcb = conn->pcb;
+    http_conn_free(conn);
+    altcp_abort(pcb);
+    return ERR_ABRT;
+}
+
+/**
+ * Registra a latência da requisição em andamento (primeiro byte da resposta)
+ */
+static void http_registrar_latencia(http_conn_t *conn) {
+    if (!conn->t_inicio) {
+        return;
+    }
+    uint32_t dt = (uint32_t)(time_us_64() - conn->t_inicio);
+    conn->t_inicio = 0;
+    lat_ultima_us = dt;
+    lat_soma_us += dt;
+    lat_n++;
+    if (dt > lat_max_us) {
+        lat_max_us = dt;
+    }
+    histograma_registrar(&metricas.latencia_http, dt);
+}
+
+/**
+ * Coloca um trecho na fila de envio da conexão
+ * @param dados Início do trecho
+ * @param len Tamanho do trecho
+ * @param copiar true se os dados estão em conn->tx (o lwIP copia ao escrever);
+ *               false se estão na flash e podem ser referenciados até o ACK
+ * @return false se a fila de segmentos estiver cheia
+ */
+static bool http_enfileirar(http_conn_t *conn, const char *dados, u32_t len, bool copiar) {
+    if (conn->n_seg >= HTTP_TX_SEGMENTOS) {
+        return false;
+    }
+    http_segmento_t *seg = &conn->seg[conn->n_seg++];
+    seg->dados = dados;
+    seg->restante = len;
+    seg->copiar = copiar;
+    return true;
+}
+
+/**
+ * Entrega ao lwIP o máximo da fila que cabe na janela de envio
+ * Chamada ao responder, a cada tcp_sent e no tcp_poll (nova tentativa após ERR_MEM).
+ * @return ERR_OK, ou o erro fatal devolvido pelo tcp_write
+ */
+static err_t http_conn_enviar(http_conn_t *conn) {
+    struct altcp_pcb *pcb = conn->pcb;
+    bool escreveu = false;
+
+    while (conn->n_seg > 0) {
+        http_segmento_t *seg = &conn->seg[0];
+        u32_t n = seg->restante;
+        if (n > altcp_sndbuf(pcb)) {
+            n = altcp_sndbuf(pcb);
+        }
+        if (n == 0) {
+            break;  // Janela cheia: continua no próximo tcp_sent
+        }
+
+        u8_t flags = seg->copiar ? TCP_WRITE_FLAG_COPY : 0;
+        if (n < seg->restante || conn->n_seg > 1) {
+            flags |= TCP_WRITE_FLAG_MORE;
+        }
+
+        // ERR_MEM: tenta pedaços menores; se nem um MSS couber, tenta de novo depois
+        err_t err = altcp_write(pcb, seg->dados, (u16_t)n, flags);
+        while (err == ERR_MEM && n > TCP_MSS) {
+            n /= 2;
+            err = altcp_write(pcb, seg->dados, (u16_t)n, flags | TCP_WRITE_FLAG_MORE);
+        }
+        if (err == ERR_MEM) {
+            break;
+        }
+        if (err != ERR_OK) {
+            return err;
+        }
+
+        escreveu = true;
+        metricas.bytes[conn->rota] += n;
+        seg->dados += n;
+        seg->restante -= n;
+        if (seg->restante == 0) {
+            conn->n_seg--;
+            memmove(&conn->seg[0], &conn->seg[1], conn->n_seg * sizeof(http_segmento_t));
+        }
+    }
+
+    if (conn->n_seg == 0) {
+        conn->tx_len = 0;  // Tudo copiado/referenciado pelo lwIP
+        if (metricas_dono == conn) {
+            metricas_dono = NULL;
+        }
+        if (historico_dono == conn) {
+            historico_dono = NULL;
+        }
+    }
+    if (escreveu) {
+        altcp_output(pcb);
+        http_registrar_latencia(conn);
+    }
+    return ERR_OK;
+}
+
+/**
+ * Monta uma resposta HTTP e a põe na fila de envio, sem enviar
+ * Cabeçalho e corpos dinâmicos vão para o buffer da conexão; corpos estáticos
+ * são referenciados direto da flash, de modo que podem ter qualquer tamanho.
+ * @param conn Conexão de destino
+ * @param status Linha de status (ex.: "200 OK")
+ * @param tipo Content-Type do corpo (NULL se não houver corpo)
+ * @param corpo Corpo da resposta (NULL com len > 0: só o cabeçalho, quem chama enfileira o corpo)
+ * @param len Tamanho do corpo
+ * @param estatico true se o corpo estiver na flash (enviado sem cópia)
+ * @return false se a resposta não coube no buffer (a conexão será fechada)
+ */
+static bool http_montar(http_conn_t *conn, const char *status, const char *tipo,
+                        const char *corpo, u32_t len, bool estatico) {
+    char *cabecalho = conn->tx + conn->tx_len;
+    size_t livre = HTTP_TX_BUF - conn->tx_len;
+    int n;
+    if (tipo) {
+        n = snprintf(cabecalho, livre,
+                     "HTTP/1.1 %s\r\n"
+                     "Content-Type: %s\r\n"
+                     "Content-Length: %lu\r\n"
+                     "\r\n",
+                     status, tipo, (unsigned long)len);
+    } else {
+        n = snprintf(cabecalho, livre,
+                     "HTTP/1.1 %s\r\n"
+                     "Content-Length: 0\r\n"
+                     "\r\n",
+                     status);
+    }
+    if (n < 0 || (size_t)n >= livre || (!estatico && n + len > livre)) {
+        printf("HTTP: resposta '%s' maior que o buffer de envio\n", status);
+        conn->fechar = true;
+        return false;
+    }
+
+    // Corpo dinâmico fica contíguo ao cabeçalho: um único trecho copiado
+    if (len && !estatico) {
+        memcpy(cabecalho + n, corpo, len);
+        n += len;
+    }
+    conn->tx_len += n;
+    http_enfileirar(conn, cabecalho, n, true);
+    if (len && estatico && corpo) {
+        http_enfileirar(conn, corpo, len, false);
+    }
+    return true;
+}
+
+/**
+ * Envia uma resposta HTTP completa (ver http_montar)
+ */
+static void http_send(http_conn_t *conn, const char *status, const char *tipo,
+                      const char *corpo, u32_t len, bool estatico) {
+    http_montar(conn, status, tipo, corpo, len, estatico);
+    http_conn_enviar(conn);
+}
+
+/**
+ * Envia um arquivo do sistema de arquivos web (www/)
+ * Responde 304 sem corpo quando o ETag do navegador ainda é válido.
+ * Arquivos com hash no nome ficam em cache por um ano; as páginas
+ * são revalidadas a cada visita (o 304 custa só um cabeçalho).
+ * Só há a cópia gzip dos arquivos comprimidos: um cliente que recusa
+ * gzip recebe 406.
+ * @param arq Arquivo encontrado por web_fs_buscar
+ * @param if_none_match Valor do cabeçalho If-None-Match (NULL se ausente)
+ * @param aceita_gzip Se o cliente aceita Content-Encoding: gzip (http_aceita_gzip)
+ */
+static void http_enviar_arquivo(http_conn_t *conn, const web_arquivo_t *arq, const char *if_none_match,
+                                bool aceita_gzip) {
+    if (arq->gzip && !aceita_gzip) {
+        http_send(conn, "406 Not Acceptable", NULL, NULL, 0, false);
+        return;
+    }
+    bool valido = if_none_match &&
+                  (strstr(if_none_match, arq->etag) != NULL || strcmp(if_none_match, "*") == 0);
+    const char *cache = arq->imutavel ? "public, max-age=31536000, immutable" : "no-cache";
+
+    char *cabecalho = conn->tx + conn->tx_len;
+    size_t livre = HTTP_TX_BUF - conn->tx_len;
+    int n;
+    if (valido) {
+        n = snprintf(cabecalho, livre,
+                     "HTTP/1.1 304 Not Modified\r\n"
+                     "ETag: %s\r\n"
+                     "Cache-Control: %s\r\n"
+                     "\r\n",
+                     arq->etag, cache);
+    } else {
+        n = snprintf(cabecalho, livre,
+                     "HTTP/1.1 200 OK\r\n"
+                     "Content-Type: %s\r\n"
+                     "Content-Length: %lu\r\n"
+                     "%s"
+                     "Vary: Accept-Encoding\r\n"
+                     "ETag: %s\r\n"
+                     "Cache-Control: %s\r\n"
+                     "\r\n",
+                     arq->tipo, (unsigned long)arq->tamanho,
+                     arq->gzip ? "Content-Encoding: gzip\r\n" : "",
+                     arq->etag, cache);
+    }
+    if (n < 0 || (size_t)n >= livre) {
+        conn->fechar = true;
+        return;
+    }
+
+    conn->tx_len += n;
+    http_enfileirar(conn, cabecalho, n, true);
+    if (!valido) {
+        http_enfileirar(conn, (const char *)arq->dados, arq->tamanho, false);
+    }
+    http_conn_enviar(conn);
+}
+
+/**
+ * Extrai o valor de uma chave string de um objeto JSON simples
+ * Ex.: {"estado":"acordado"} -> "acordado"
+ * @return true se a chave foi encontrada
+ */
+static bool json_extrair_string(const char *json, const char *chave, char *saida, size_t tamanho) {
+    char padrao[24];
+    snprintf(padrao, sizeof(padrao), "\"%s\"", chave);
+    const char *p = strstr(json, padrao);
+    if (!p) return false;
+
+    p = strchr(p + strlen(padrao), ':');
+    if (!p) return false;
+    p = strchr(p, '"');
+    if (!p) return false;
+    p++;
+
+    size_t i = 0;
+    while (*p && *p != '"' && i < tamanho - 1) {
+        saida[i++] = *p++;
+    }
+    saida[i] = '\0';
+    return *p == '"';
+}
+
+/**
+ * Obtém o valor de um cabeçalho HTTP (nome sem diferenciar maiúsculas)
+ * @param cabecalhos Bloco de cabeçalhos terminado em '\0'
+ * @param nome Nome do cabeçalho, sem ':'
+ * @return true se o cabeçalho foi encontrado
+ */
+static bool http_obter_cabecalho(const char *cabecalhos, const char *nome, char *saida, size_t tamanho) {
+    size_t tam_nome = strlen(nome);
+    const char *linha = strstr(cabecalhos, "\r\n");
+    while (linha) {
+        linha += 2;
+        if (strncasecmp(linha, nome, tam_nome) == 0 && linha[tam_nome] == ':') {
+            const char *v = linha + tam_nome + 1;
+            while (*v == ' ') v++;
+            size_t i = 0;
+            while (v[i] && v[i] != '\r' && i < tamanho - 1) {
+                saida[i] = v[i];
+                i++;
+            }
+            saida[i] = '\0';
+            return true;
+        }
+        linha = strstr(linha, "\r\n");
+    }
+    return false;
+}
+
+/**
+ * Procura um token numa lista separada por vírgulas, sem diferenciar
+ * maiúsculas (ex.: Connection: keep-alive, Upgrade)
+ * @param valor Valor do cabeçalho
+ * @param token Token procurado
+ * @return true se o token está na lista
+ */
+static bool http_tem_token(const char *valor, const char *token) {
+    size_t tam = strlen(token);
+    const char *p = valor;
+    while (*p) {
+        while (*p == ' ' || *p == '\t' || *p == ',') p++;
+        const char *inicio = p;
+        while (*p && *p != ',') p++;
+        const char *fim = p;
+        while (fim > inicio && (fim[-1] == ' ' || fim[-1] == '\t')) fim--;
+        if ((size_t)(fim - inicio) == tam && strncasecmp(inicio, token, tam) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Negocia a codificação pelo Accept-Encoding (RFC 9110, 12.5.3): sem o
+ * cabeçalho, qualquer uma serve; "gzip" (ou "x-gzip") decide se está
+ * presente, senão "*"; q=0 recusa
+ * @param valor Valor do cabeçalho (NULL se ausente)
+ * @return true se o cliente aceita gzip
+ */
+static bool http_aceita_gzip(const char *valor) {
+    if (!valor) {
+        return true;
+    }
+    int gzip = -1, curinga = -1;       // -1: ausente; 0: recusado; 1: aceito
+    const char *p = valor;
+    while (*p) {
+        while (*p == ' ' || *p == ',') p++;
+        const char *nome = p;
+        while (*p && *p != ',' && *p != ';' && *p != ' ') p++;
+        size_t tam = (size_t)(p - nome);
+        int aceito = 1;
+        while (*p && *p != ',') {
+            if (*p == ';') {
+                p++;
+                while (*p == ' ') p++;
+                if ((p[0] == 'q' || p[0] == 'Q') && p[1] == '=') {
+                    aceito = strtod(p + 2, NULL) > 0;
+                }
+            } else {
+                p++;
+            }
+        }
+        if ((tam == 4 && strncasecmp(nome, "gzip", 4) == 0) || (tam == 6 && strncasecmp(nome, "x-gzip", 6) == 0)) {
+            gzip = aceito;
+        } else if (tam == 1 && *nome == '*') {
+            curinga = aceito;
+        }
+    }
+    return gzip >= 0 ? gzip : curinga == 1;
+}
+
+/**
+ * Lê o valor de Content-Length: só dígitos, sem estourar o u32
+ * @param valor Valor do cabeçalho
+ * @param tamanho Tamanho lido
+ * @return false se o valor é vazio, tem outros caracteres ou não cabe em 32 bits
+ */
+static bool http_ler_tamanho(const char *valor, u32_t *tamanho) {
+    u32_t n = 0;
+    const char *p = valor;
+    for (; *p >= '0' && *p <= '9'; p++) {
+        u32_t digito = (u32_t)(*p - '0');
+        if (n > (UINT32_MAX - digito) / 10) {
+            return false;
+        }
+        n = n * 10 + digito;
+    }
+    while (*p == ' ' || *p == '\t') p++;
+    if (p == valor || *p != '\0') {
+        return false;
+    }
+    *tamanho = n;
+    return true;
+}
+
+/**
+ * Marca a rota da requisição (contagem e bytes em /metrics)
+ */
+static void http_rota(http_conn_t *conn, metrica_rota_t rota) {
+    conn->rota = rota;
+    conn->requisicoes++;
+    metricas.requisicoes[rota]++;
+}
+
+/**
+ * Conta as conexões HTTP abertas no pool
+ */
+static int http_conexoes_ativas() {
+    int n = 0;
+    for (int i = 0; i < HTTP_MAX_CONEXOES; i++) {
+        if (conexoes[i].pcb) {
+            n++;
+        }
+    }
+    return n;
+}
+
+/**
+ * Aplica o limitador de taxa aos comandos do cliente da conexão
+ * @param conn Conexão de origem
+ * @return false se o cliente excedeu a taxa (o 429 já foi enfileirado)
+ */
+static bool http_limitar(http_conn_t *conn) {
+    if (limite_consumir(altcp_get_ip(conn->pcb, 0))) {
+        return true;
+    }
+    metricas.http_limitados++;
+    static const char resposta[] =
+        "HTTP/1.1 429 Too Many Requests\r\n"
+        "Retry-After: 1\r\n"
+        "Content-Length: 0\r\n"
+        "\r\n";
+    http_enfileirar(conn, resposta, sizeof(resposta) - 1, false);
+    http_conn_enviar(conn);
+    return false;
+}
+
+/**
+ * Trata uma requisição HTTP completa e envia a resposta
+ * @param conn Conexão de origem
+ * @param metodo Método HTTP ("GET", "POST", ...)
+ * @param caminho Caminho requisitado
+ * @param cabecalhos Linha de requisição e cabeçalhos
+ * @param corpo Corpo da requisição (string vazia se não houver)
+ * @return false se o PCB deixou de pertencer ao servidor HTTP (ex.: virou assinante SSE)
+ */
+static bool http_rotear(http_conn_t *conn, const char *metodo, const char *caminho,
+                        const char *cabecalhos, const char *corpo) {
+    bool get = strcmp(metodo, "GET") == 0;
+    bool post = strcmp(metodo, "POST") == 0;
+    const web_arquivo_t *arq;
+
+    if (get && (arq = web_fs_buscar(caminho)) != NULL) {
+        http_rota(conn, ROTA_ARQUIVO);
+        char etag[48];
+        char codificacoes[64];
+        bool tem_etag = http_obter_cabecalho(cabecalhos, "If-None-Match", etag, sizeof(etag));
+        bool tem_codificacoes = http_obter_cabecalho(cabecalhos, "Accept-Encoding", codificacoes, sizeof(codificacoes));
+        http_enviar_arquivo(conn, arq, tem_etag ? etag : NULL, http_aceita_gzip(tem_codificacoes ? codificacoes : NULL));
+    }
+    else if (get && strcmp(caminho, "/api/status") == 0) {
+        http_rota(conn, ROTA_STATUS);
+        float min, max, media;
+        temperatura_estatisticas(&min, &max, &media);
+        robo_estado_t estado;
+        char mensagem[sizeof(mensagem_display)];
+        robo_ler_estado(&estado, mensagem);
+        char json[160];
+        int n = snprintf(json, sizeof(json),
+                         "{\"estado\":\"%s\",\"temp\":%.2f,\"min\":%.2f,\"max\":%.2f,\"media\":%.2f,\"msg\":\"%s\"}",
+                         robo_estado_nome(estado), temperatura_atual(), min, max, media, mensagem);
+        http_send(conn, "200 OK", "application/json", json, n, false);
+    }
+    else if (get && strcmp(caminho, "/api/latencia") == 0) {
+        http_rota(conn, ROTA_LATENCIA);
+        char json[256];
+        int n = snprintf(json, sizeof(json),
+                         "{\"n\":%lu,\"ultima_us\":%lu,\"media_us\":%lu,\"max_us\":%lu,"
+                         "\"fila_max_us\":%lu,\"descartados\":%lu,"
+                         "\"irq_n\":%lu,\"irq_ultima_us\":%lu,\"irq_media_us\":%lu,\"irq_max_us\":%lu}",
+                         (unsigned long)lat_n, (unsigned long)lat_ultima_us,
+                         (unsigned long)(lat_n ? lat_soma_us / lat_n : 0), (unsigned long)lat_max_us,
+                         (unsigned long)fila_max_us, (unsigned long)comando_descartados(),
+                         (unsigned long)irq_n, (unsigned long)irq_ultima_us,
+                         (unsigned long)(irq_n ? irq_soma_us / irq_n : 0), (unsigned long)irq_max_us);
+        http_send(conn, "200 OK", "application/json", json, n, false);
+    }
+    else if (get && strcmp(caminho, "/api/nucleos") == 0) {
+        http_rota(conn, ROTA_NUCLEOS);
+        char json[48];
+        int n = snprintf(json, sizeof(json), "{\"core0_pct\":%lu,\"core1_pct\":%lu}",
+                         (unsigned long)uso_nucleo[0].uso_pct, (unsigned long)uso_nucleo[1].uso_pct);
+        http_send(conn, "200 OK", "application/json", json, n, false);
+    }
+    else if (get && strcmp(caminho, "/api/temperatura/historico") == 0) {
+        http_rota(conn, ROTA_HISTORICO);
+        if (historico_dono) {
+            http_send(conn, "503 Service Unavailable", NULL, NULL, 0, false);  // Outra leitura em andamento
+            return true;
+        }
+        float pontos[TEMP_HIST_TAM];
+        int total = temperatura_historico(pontos, TEMP_HIST_TAM);
+        size_t n = (size_t)snprintf(historico_texto, sizeof(historico_texto),
+                                    "{\"periodo_ms\":%d,\"temp\":[", TEMP_HIST_PERIODO_MS);
+        for (int i = 0; i < total && n < sizeof(historico_texto); i++) {
+            n += (size_t)snprintf(historico_texto + n, sizeof(historico_texto) - n,
+                                  i ? ",%.2f" : "%.2f", pontos[i]);
+        }
+        if (n < sizeof(historico_texto)) {
+            n += (size_t)snprintf(historico_texto + n, sizeof(historico_texto) - n, "]}");
+        }
+        if (n >= sizeof(historico_texto)) {
+            printf("HTTP: histórico maior que o buffer\n");
+            http_send(conn, "500 Internal Server Error", NULL, NULL, 0, false);
+            return true;
+        }
+        // Corpo fora de conn->tx, liberado como o de /metrics
+        if (http_montar(conn, "200 OK", "application/json", NULL, n, true)) {
+            historico_dono = conn;
+            http_enfileirar(conn, historico_texto, n, true);
+        }
+        http_conn_enviar(conn);
+    }
+    else if (get && strcmp(caminho, "/events") == 0) {
+        http_rota(conn, ROTA_EVENTOS);
+        if (!sse_assinar(conn->pcb)) {
+            http_send(conn, "503 Service Unavailable", NULL, NULL, 0, false);
+            return true;
+        }
+        // O PCB agora pertence ao módulo SSE; libera só a entrada do pool
+        conn->pcb = NULL;
+        http_conn_free(conn);
+        // Estado atual pelo worker: publicar aqui, dentro do recv deste PCB,
+        // poderia abortá-lo (sse_publicar) sem que o lwIP soubesse
+        async_context_set_work_pending(cyw43_arch_async_context(), &worker_estado);
+        return false;
+    }
+    else if (get && strcmp(caminho, "/ws") == 0) {
+        http_rota(conn, ROTA_WS);
+        char chave[40];
+        char valor[48];
+        if (!http_obter_cabecalho(cabecalhos, "Sec-WebSocket-Key", chave, sizeof(chave)) ||
+            !http_obter_cabecalho(cabecalhos, "Upgrade", valor, sizeof(valor)) || !http_tem_token(valor, "websocket") ||
+            !http_obter_cabecalho(cabecalhos, "Connection", valor, sizeof(valor)) || !http_tem_token(valor, "Upgrade")) {
+            http_send(conn, "400 Bad Request", NULL, NULL, 0, false);
+            return true;
+        }
+        if (!http_obter_cabecalho(cabecalhos, "Sec-WebSocket-Version", valor, sizeof(valor)) ||
+            strcmp(valor, "13") != 0) {
+            // RFC 6455, 4.4: informa a versão suportada
+            static const char versao[] =
+                "HTTP/1.1 426 Upgrade Required\r\n"
+                "Sec-WebSocket-Version: 13\r\n"
+                "Content-Length: 0\r\n"
+                "\r\n";
+            http_enfileirar(conn, versao, sizeof(versao) - 1, false);
+            http_conn_enviar(conn);
+            return true;
+        }
+        if (!ws_aceitar(conn->pcb, chave)) {
+            http_send(conn, "503 Service Unavailable", NULL, NULL, 0, false);
+            return true;
+        }
+        // O PCB agora pertence ao módulo WebSocket
+        conn->pcb = NULL;
+        http_conn_free(conn);
+        return false;
+    }
+    else if (post && strcmp(caminho, "/api/robot/state") == 0) {
+        http_rota(conn, ROTA_ESTADO);
+        if (!http_limitar(conn)) {
+            return true;
+        }
+        char nome[16];
+        robo_estado_t estado;
+        if (json_extrair_string(corpo, "estado", nome, sizeof(nome)) && robo_estado_de_nome(nome, &estado)) {
+            if (robo_enfileirar_estado(estado)) {
+                http_send(conn, "204 No Content", NULL, NULL, 0, false);
+            } else {
+                http_send(conn, "503 Service Unavailable", NULL, NULL, 0, false);
+            }
+        } else {
+            static const char erro[] = "{\"erro\":\"estado invalido\"}";
+            http_send(conn, "400 Bad Request", "application/json", erro, sizeof(erro) - 1, true);
+        }
+    }
+    // Rotas antigas mantidas para links salvos: aplicam o estado e voltam para a página
+    else if (get && (strcmp(caminho, "/robo_on") == 0 || strcmp(caminho, "/robo_off") == 0 ||
+                     strcmp(caminho, "/matriz_off") == 0)) {
+        http_rota(conn, ROTA_LEGADO);
+        if (!http_limitar(conn)) {
+            return true;
+        }
+        robo_enfileirar_estado(strcmp(caminho, "/robo_on") == 0 ? ROBO_ACORDADO :
+                               strcmp(caminho, "/robo_off") == 0 ? ROBO_DORMINDO : ROBO_APAGADO);
+        static const char redirect[] =
+            "HTTP/1.1 303 See Other\r\n"
+            "Location: /\r\n"
+            "Content-Length: 0\r\n"
+            "\r\n";
+        http_enfileirar(conn, redirect, sizeof(redirect) - 1, false);
+        http_conn_enviar(conn);
+    }
+    else if (get && strcmp(caminho, "/metrics") == 0) {
+        http_rota(conn, ROTA_METRICAS);
+        if (metricas_dono) {
+            http_send(conn, "503 Service Unavailable", NULL, NULL, 0, false);  // Outra coleta em andamento
+            return true;
+        }
+        // Cabeçalho e corpo entram juntos na fila: o dono só é liberado
+        // quando o último trecho de metricas_texto foi copiado pelo lwIP
+        int n = metricas_gerar(metricas_texto, sizeof(metricas_texto), http_conexoes_ativas());
+        if (http_montar(conn, "200 OK", "text/plain; version=0.0.4", NULL, n, true)) {
+            metricas_dono = conn;
+            http_enfileirar(conn, metricas_texto, n, true);
+        }
+        http_conn_enviar(conn);
+    }
+    else {
+        http_rota(conn, ROTA_DESCONHECIDA);
+        http_send(conn, "404 Not Found", NULL, NULL, 0, false);
+    }
+    return true;
+}
+
+/**
+ * Processa as requisições completas acumuladas no buffer da conexão
+ * Enquanto houver resposta na fila de envio, as próximas requisições aguardam.
+ * @param ret Código a devolver ao lwIP se a conexão foi fechada
+ * @return false se a conexão foi fechada ou entregue a outro módulo
+ */
+static bool http_processar(http_conn_t *conn, err_t *ret) {
+    while (conn->rx_len > 0 && conn->n_seg == 0 && !conn->fechar) {
+        conn->rx[conn->rx_len] = '\0';
+        char *fim_cabecalho = strstr(conn->rx, "\r\n\r\n");
+        if (!fim_cabecalho) {
+            if (conn->rx_len >= HTTP_RX_BUF) {
+                http_rota(conn, ROTA_DESCONHECIDA);
+                http_send(conn, "431 Request Header Fields Too Large", NULL, NULL, 0, false);
+                conn->fechar = true;
+                break;
+            }
+            return true;  // Aguarda o restante do cabeçalho
+        }
+
+        u16_t tam_cabecalho = (u16_t)(fim_cabecalho - conn->rx) + 4;
+        u32_t tam_corpo = 0;
+        char valor[16];
+
+        // Cabeçalhos procurados só dentro do bloco de cabeçalhos
+        *fim_cabecalho = '\0';
+        bool tem_tamanho = http_obter_cabecalho(conn->rx, "Content-Length", valor, sizeof(valor));
+        bool tamanho_valido = !tem_tamanho || http_ler_tamanho(valor, &tam_corpo);
+        if (http_obter_cabecalho(conn->rx, "Connection", valor, sizeof(valor)) && strcasecmp(valor, "close") == 0) {
+            conn->fechar = true;
+        }
+        *fim_cabecalho = '\r';
+
+        if (!tamanho_valido) {
+            http_rota(conn, ROTA_DESCONHECIDA);
+            http_send(conn, "400 Bad Request", NULL, NULL, 0, false);
+            conn->fechar = true;
+            break;
+        }
+        // Compara sem somar: um Content-Length enorme não pode dar a volta no u32
+        if (tam_corpo > HTTP_RX_BUF - tam_cabecalho) {
+            http_rota(conn, ROTA_DESCONHECIDA);
+            http_send(conn, "413 Payload Too Large", NULL, NULL, 0, false);
+            conn->fechar = true;
+            break;
+        }
+        if (conn->rx_len < tam_cabecalho + tam_corpo) {
+            return true;  // Aguarda o restante do corpo
+        }
+
+        // Linha de requisição: "<METODO> <CAMINHO> HTTP/1.1"
+        char metodo[8] = "";
+        char caminho[64] = "";
+        sscanf(conn->rx, "%7s %63s", metodo, caminho);
+        char *query = strchr(caminho, '?');
+        if (query) *query = '\0';
+
+        char *corpo = conn->rx + tam_cabecalho;
+        char fim = corpo[tam_corpo];
+        corpo[tam_corpo] = '\0';
+        *fim_cabecalho = '\0';
+
+        if (!http_rotear(conn, metodo, caminho, conn->rx, corpo)) {
+            return false;
+        }
+
+        // Mantém bytes de uma eventual próxima requisição (pipelining)
+        corpo[tam_corpo] = fim;
+        u16_t consumido = tam_cabecalho + tam_corpo;
+        conn->rx_len -= consumido;
+        memmove(conn->rx, conn->rx + consumido, conn->rx_len);
+    }
+
+    // Fecha só depois que toda a resposta foi entregue ao lwIP
+    if (conn->fechar && conn->n_seg == 0) {
+        *ret = http_conn_close(conn);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Callback de erro: o lwIP já liberou o PCB, só devolve a conexão ao pool
+ */
+static void tcp_server_err(void *arg, err_t err) {
+    http_conn_t *conn = (http_conn_t *)arg;
+    if (conn) {
+        if (err == ERR_ABRT) {
+            // Nossos aborts limpam o tcp_err antes; ERR_ABRT aqui é o lwIP sem PCB livre
+            metricas.despejos[DESPEJO_LWIP]++;
+        }
+        conn->pcb = NULL;
+        http_conn_free(conn);
+    }
+}
+
+/**
+ * Callback de confirmação de envio: a janela abriu, continua a fila
+ */
+static err_t tcp_server_sent(void *arg, struct altcp_pcb *tpcb, u16_t len) {
+    http_conn_t *conn = (http_conn_t *)arg;
+    conn->ocioso = 0;
+    conn->t_atividade = time_us_64();
+
+    err_t ret = http_conn_enviar(conn);
+    if (ret != ERR_OK) {
+        return http_conn_abort(conn);
+    }
+
+    // Fila vazia: fecha se pedido ou retoma requisições que chegaram durante o envio
+    if (conn->n_seg == 0) {
+        http_processar(conn, &ret);
+    }
+
+    // Resposta inteira confirmada e nada pendente: keep-alive ocioso, pode ceder o PCB
+    if (ret == ERR_OK && conn->pcb == tpcb && conn->n_seg == 0 && conn->rx_len == 0 &&
+        altcp_sndqueuelen(tpcb) == 0) {
+        altcp_setprio(tpcb, HTTP_PRIO_OCIOSO);
+    }
+    return ret;
+}
+
+/**
+ * Chamado pelo lwIP a cada HTTP_POLL_INTERVALO: nova tentativa após ERR_MEM
+ * e liberação de conexões ociosas ou com envio travado
+ */
+static err_t tcp_server_poll(void *arg, struct altcp_pcb *tpcb) {
+    http_conn_t *conn = (http_conn_t *)arg;
+    conn->ocioso++;
+
+    if (conn->n_seg > 0) {
+        if (conn->ocioso >= HTTP_TIMEOUT_ENVIO_S) {
+            printf("HTTP: envio travado, conexão abortada\n");
+            return http_conn_abort(conn);
+        }
+        if (http_conn_enviar(conn) != ERR_OK) {
+            return http_conn_abort(conn);
+        }
+        err_t ret = ERR_OK;
+        if (conn->n_seg == 0) {
+            http_processar(conn, &ret);
+        }
+        return ret;
+    }
+
+    if (conn->ocioso >= HTTP_TIMEOUT_OCIOSO_S) {
+        metricas.despejos[DESPEJO_OCIOSO]++;
+        return http_conn_close(conn);
+    }
+    return ERR_OK;
+}
+
 /**
  * Callback para recebimento de dados TCP
  */
-static err_t tcp_server_recv(void *arg, struct tcp_pcb *tpcb, struct pbuf *p, err_t err) {
+static err_t tcp_server_recv(void *arg, struct altcp_pcb *tpcb, struct pbuf *p, err_t err) {
+    http_conn_t *conn = (http_conn_t *)arg;
+    uint64_t t0 = time_us_64();
+    conn->t_inicio = t0;
+    conn->ocioso = 0;
+    conn->t_atividade = t0;
+    if (p && t_irq_wifi) {
+        uint32_t dt = (uint32_t)(t0 - t_irq_wifi);
+        t_irq_wifi = 0;
+        irq_ultima_us = dt;
+        irq_soma_us += dt;
+        irq_n++;
+        if (dt > irq_max_us) {
+            irq_max_us = dt;
+        }
+    }
     if (!p) {
-        tcp_close(tpcb);
-        tcp_recv(tpcb, NULL);
-        return ERR_OK;
+        // Cliente encerrou: termina de enviar o que falta e fecha
+        conn->fechar = true;
+        conn->rx_len = 0;
+        err_t ret = ERR_OK;
+        http_processar(conn, &ret);
+        return ret;
+    }
+
+    altcp_setprio(tpcb, TCP_PRIO_NORMAL);  // Requisição em andamento: fora do alcance do tcp_kill_prio
+
+    if (p->tot_len > HTTP_RX_BUF - conn->rx_len) {
+        if (conn->n_seg > 0) {
+            return ERR_MEM;  // Ocupado enviando: o lwIP guarda o pbuf e entrega de novo
+        }
+        altcp_recved(tpcb, p->tot_len);
+        pbuf_free(p);
+        http_rota(conn, ROTA_DESCONHECIDA);
+        http_send(conn, "413 Payload Too Large", NULL, NULL, 0, false);
+        conn->fechar = true;
+        err_t ret = ERR_OK;
+        http_processar(conn, &ret);
+        return ret;
     }
 
-    // Processa a requisição HTTP
-    char *request = (char *)malloc(p->len + 1);
-    memcpy(request, p->payload, p->len);
-    request[p->len] = '\0';
-
-    printf("Request: %s\n", request);
-
-    // Controle dos LEDs e display baseado na requisição
-    if (strstr(request, "GET /robo_on") != NULL) {
-        updateLEDs(matriz_olhos_acesos);
-        buzzer_on(BUZZER_PIN);
-        exibir_mensagem_centralizada("Bip Bip Bip");
-    }
-    else if (strstr(request, "GET /robo_off") != NULL) {
-        updateLEDs(matriz_olhos_apagados);
-        buzzer_off(BUZZER_PIN);
-        exibir_mensagem_centralizada("ZzZ ZzZ ZzZ");
-    }
-    else if (strstr(request, "GET /matriz_off") != NULL) {
-        updateLEDs(matriz_apagada);
-        buzzer_off(BUZZER_PIN);
-        exibir_mensagem_centralizada("");
-    }
-
-    // Leitura da temperatura interna
-    adc_select_input(4);
-    uint16_t raw_value = adc_read();
-    const float conversion_factor = 3.3f / (1 << 12);
-    float temperature = 27.0f - ((raw_value * conversion_factor) - 0.706f) / 0.001721f;
-
-    // Resposta HTTP
-    char html[1024];
-    snprintf(html, sizeof(html),
-             "HTTP/1.1 200 OK\r\n"
-             "Content-Type: text/html\r\n"
-             "\r\n"
-             "<!DOCTYPE html>\n"
-             "<html>\n"
-             "<head>\n"
-             "<title>Controlador do Robo</title>\n"
-             "<style>\n"
-             "body { font-family: Arial, sans-serif; text-align: center; margin-top: 50px; }\n"
-             "h1 { font-size: 64px; margin-bottom: 30px; }\n"
-             "h2 { font-size: 16px; margin-bottom: 8px; }\n"
-             "button { font-size: 36px; margin: 10px; padding: 20px 40px; border-radius: 10px; }\n"
-             ".temperature { font-size: 48px; margin-top: 30px; color: #333; }\n"
-             "</style>\n"
-             "</head>\n"
-             "<body>\n"
-             "<h1>Controlador do Robo</h1>\n"
-             "<form action=\"./robo_on\"><button>Robo Acordado</button></form>\n"
-             "<form action=\"./robo_off\"><button>Robo Dormindo</button></form>\n"
-             "<form action=\"./matriz_off\"><button>Apagar Leds</button></form>\n"
-             "<p class=\"temperature\">Temperatura Interna: %.2f &deg;C</p>\n"
-             "<h2>Davisson Tiago</h2>\n"
-             "</body>\n"
-             "</html>\n",
-             temperature);
-
-    tcp_write(tpcb, html, strlen(html), TCP_WRITE_FLAG_COPY);
-    tcp_output(tpcb);
-
-    free(request);
+    // Copia toda a cadeia de pbufs (não apenas o primeiro segmento)
+    pbuf_copy_partial(p, conn->rx + conn->rx_len, p->tot_len, 0);
+    conn->rx_len += p->tot_len;
+    altcp_recved(tpcb, p->tot_len);
     pbuf_free(p);
 
+    err_t ret = ERR_OK;
+    http_processar(conn, &ret);
+    uso_registrar(&uso_nucleo[0], (uint32_t)(time_us_64() - t0));
+    return ret;
+}
+
+/**
+ * Escolhe a conexão keep-alive ociosa há mais tempo (LRU)
+ * Só entre as que já atenderam alguma requisição e não têm requisição
+ * parcial nem resposta pendente: uma conexão recém-aceita ainda espera
+ * a primeira requisição e não pode perdê-la.
+ * @return Conexão a despejar ou NULL se todas estiverem trabalhando
+ */
+static http_conn_t *http_conn_lru() {
+    http_conn_t *vitima = NULL;
+    for (int i = 0; i < HTTP_MAX_CONEXOES; i++) {
+        http_conn_t *c = &conexoes[i];
+        if (c->pcb && c->requisicoes > 0 && c->rx_len == 0 && c->n_seg == 0 && !c->fechar &&
+            (!vitima || c->t_atividade < vitima->t_atividade)) {
+            vitima = c;
+        }
+    }
+    return vitima;
+}
+
+/**
+ * Prazo do 503 imediato esgotado sem o cliente fechar
+ */
+static err_t http_saturado_poll(void *arg, struct altcp_pcb *tpcb) {
+    altcp_abort(tpcb);
+    return ERR_ABRT;
+}
+
+/**
+ * Responde 503 sem ocupar uma entrada do pool (servidor saturado)
+ * Envia da flash, fecha só a transmissão e deixa o lwIP descartar o que
+ * o cliente mandar até o FIN dele (tcp_recv_null), evitando o RST que
+ * faria o navegador perder a resposta.
+ * @return ERR_ABRT se o PCB foi abortado
+ */
+static err_t http_saturado(struct altcp_pcb *pcb) {
+    static const char resposta[] =
+        "HTTP/1.1 503 Service Unavailable\r\n"
+        "Retry-After: 1\r\n"
+        "Content-Length: 0\r\n"
+        "Connection: close\r\n\r\n";
+
+    metricas.conexoes_recusadas++;
+    altcp_setprio(pcb, HTTP_PRIO_SATURADO);
+    altcp_arg(pcb, NULL);
+    altcp_recv(pcb, NULL);
+    altcp_poll(pcb, http_saturado_poll, HTTP_SATURADO_POLL);
+    if (altcp_write(pcb, resposta, sizeof(resposta) - 1, 0) != ERR_OK ||
+        altcp_shutdown(pcb, 0, 1) != ERR_OK) {
+        altcp_abort(pcb);
+        return ERR_ABRT;
+    }
     return ERR_OK;
 }
 
+/**
+ * Reserva uma entrada do pool para o PCB, despejando o keep-alive
+ * ocioso mais antigo se o pool estiver cheio
+ * @return Conexão com callbacks instalados ou NULL se todas estiverem trabalhando
+ */
+static http_conn_t *http_admitir(struct altcp_pcb *pcb) {
+    http_conn_t *conn = http_conn_alloc(pcb);
+    if (!conn) {
+        http_conn_t *vitima = http_conn_lru();
+        if (!vitima) {
+            return NULL;
+        }
+        metricas.despejos[DESPEJO_LRU]++;
+        http_conn_close(vitima);  // Outro PCB: um eventual abort não afeta o callback atual
+        conn = http_conn_alloc(pcb);
+    }
+    metricas.conexoes_aceitas++;
+
+    altcp_arg(pcb, conn);
+    altcp_recv(pcb, tcp_server_recv);
+    altcp_sent(pcb, tcp_server_sent);
+    altcp_err(pcb, tcp_server_err);
+    altcp_poll(pcb, tcp_server_poll, HTTP_POLL_INTERVALO);
+    return conn;
+}
+
+/**
+ * Recepção de uma conexão em espera por vaga no pool
+ * ERR_MEM faz o lwIP guardar o pbuf e reentregá-lo no próximo tcp_fasttmr
+ * (250 ms); nesse meio tempo as conexões recém-aceitas atendem a primeira
+ * requisição e viram candidatas ao despejo LRU.
+ */
+static err_t tcp_server_recv_espera(void *arg, struct altcp_pcb *tpcb, struct pbuf *p, err_t err) {
+    if (!p) {
+        altcp_recv(tpcb, NULL);
+        if (altcp_close(tpcb) != ERR_OK) {
+            altcp_abort(tpcb);
+            return ERR_ABRT;
+        }
+        return ERR_OK;
+    }
+    http_conn_t *conn = http_admitir(tpcb);
+    if (!conn) {
+        return ERR_MEM;
+    }
+    return tcp_server_recv(conn, tpcb, p, err);
+}
+
+/**
+ * Espera por vaga esgotada: o servidor está de fato saturado
+ */
+static err_t tcp_server_poll_espera(void *arg, struct altcp_pcb *tpcb) {
+    return http_saturado(tpcb);
+}
+
 /**
  * Callback para aceitação de novas conexões TCP
+ * Pool cheio sem keep-alive ocioso para despejar: a conexão espera até
+ * HTTP_ESPERA_POLL pela vaga (sem ocupar entrada do pool) e só então
+ * recebe o 503.
  */
-static err_t tcp_server_accept(void *arg, struct tcp_pcb *newpcb, err_t err) {
-    tcp_recv(newpcb, tcp_server_recv);
+static err_t tcp_server_accept(void *arg, struct altcp_pcb *newpcb, err_t err) {
+    if (err != ERR_OK || !newpcb) {
+        return ERR_VAL;
+    }
+
+    if (!http_admitir(newpcb)) {
+        metricas.conexoes_em_espera++;
+        altcp_arg(newpcb, NULL);
+        altcp_recv(newpcb, tcp_server_recv_espera);
+        altcp_poll(newpcb, tcp_server_poll_espera, HTTP_ESPERA_POLL);
+    }
     return ERR_OK;
 }
 
+/**
+ * Associa um PCB novo à porta e passa a aceitar conexões HTTP nele
+ * HTTP e HTTPS compartilham o mesmo pool e os mesmos callbacks: a camada
+ * TLS do altcp cifra e decifra por baixo deles.
+ * @param pcb PCB criado por altcp_tcp_new_ip_type ou https_novo_pcb (NULL é aceito)
+ * @param porta Porta de escuta
+ * @return PCB de escuta ou NULL em caso de falha
+ */
+static struct altcp_pcb *http_escutar(struct altcp_pcb *pcb, u16_t porta) {
+    if (!pcb) {
+        return NULL;
+    }
+    if (altcp_bind(pcb, IP_ADDR_ANY, porta) != ERR_OK) {
+        altcp_close(pcb);
+        return NULL;
+    }
+    struct altcp_pcb *escuta = altcp_listen(pcb);
+    if (!escuta) {
+        altcp_close(pcb);
+        return NULL;
+    }
+    altcp_accept(escuta, tcp_server_accept);
+    return escuta;
+}
+
+/***************************************************************
+ * NÚCLEO 1: RENDERIZAÇÃO E ATUADORES
+ **************************************************************/
+/**
+ * Desenha mensagem_display centralizada e envia o quadro ao OLED
+ */
+void display_renderizar() {
+    struct render_area frame_area = {
+        .start_column = 0,
+        .end_column = ssd1306_width - 1,
+        .start_page = 0,
+        .end_page = ssd1306_n_pages - 1
+    };
+    calculate_render_area_buffer_length(&frame_area);
+
+    uint8_t ssd[ssd1306_buffer_length];
+    memset(ssd, 0, ssd1306_buffer_length);
+
+    int pos_x = (ssd1306_width - strlen(mensagem_display)*8)/2;
+    int pos_y = (ssd1306_height - 8)/2;
+    ssd1306_draw_string(ssd, pos_x, pos_y, mensagem_display);
+
+    uint32_t t0 = time_us_32();
+    render_on_display(ssd, &frame_area);
+    histograma_registrar(&metricas.oled, time_us_32() - t0);
+}
+
+/**
+ * Acumula tempo ocupado e fecha a janela de utilização a cada USO_JANELA_US
+ * @param uso Contadores do núcleo
+ * @param ocupado_us Tempo ocupado desde a última chamada
+ */
+void uso_registrar(uso_nucleo_t *uso, uint32_t ocupado_us) {
+    uint32_t agora = time_us_32();
+    uso->ocupado_us += ocupado_us;
+    uint32_t janela = agora - uso->inicio_janela;
+    if (janela >= USO_JANELA_US) {
+        uso->uso_pct = (uint32_t)((uint64_t)uso->ocupado_us * 100 / janela);
+        uso->ocupado_us = 0;
+        uso->inicio_janela = agora;
+    }
+}
+
+/**
+ * Avisa o núcleo 0 (pelo FIFO entre núcleos) que o estado mudou
+ * Se o FIFO estiver cheio já existe aviso pendente, então nada se perde.
+ */
+void notificar_estado_nucleo0() {
+    if (multicore_fifo_wready()) {
+        multicore_fifo_push_blocking(0);
+    }
+}
+
+/**
+ * Laço do núcleo 1: consome a fila de comandos e aciona LEDs, buzzer e display
+ * Dorme em WFE entre iterações; comando_enviar() acorda o núcleo com SEV.
+ * A fila é esvaziada a cada despertar, mas os atuadores só são acionados
+ * a cada RENDER_TICK_MS: uma rajada de comandos custa uma escrita por
+ * atuador por tick, por mais rápido que os comandos cheguem.
+ */
+void core1_render() {
+    uso_nucleo[1].inicio_janela = time_us_32();
+    proximo_tick = get_absolute_time();
+    while (true) {
+        uint32_t t0 = time_us_32();
+
+        comando_t cmd;
+        while (comando_receber(&cmd)) {
+            robo_acumular_comando(&cmd);
+        }
+        if ((pendente.leds || pendente.bip || pendente.tom || pendente.display || pendente.estado) &&
+            time_reached(proximo_tick)) {
+            robo_aplicar_pendentes();
+            proximo_tick = make_timeout_time_ms(RENDER_TICK_MS);
+        }
+
+        update_buzzer();
+
+        if (atualizar_display) {
+            atualizar_display = false;
+            display_renderizar();
+        }
+
+        uso_registrar(&uso_nucleo[1], time_us_32() - t0);
+        best_effort_wfe_or_timeout(make_timeout_time_ms(RENDER_PERIODO_MS));
+    }
+}
+
+/***************************************************************
+ * NÚCLEO 0: WORKERS DO ASYNC_CONTEXT
+ **************************************************************/
+/**
+ * Consome as amostras do ADC copiadas pelo DMA
+ */
+static void trabalho_adc(async_context_t *ctx, async_at_time_worker_t *worker) {
+    uint32_t t0 = time_us_32();
+    temperatura_processar();
+    uso_registrar(&uso_nucleo[0], time_us_32() - t0);
+    async_context_add_at_time_worker_in_ms(ctx, worker, ADC_PROCESSAR_MS);
+}
+
+/**
+ * Publica a temperatura para os assinantes de /events
+ */
+static void trabalho_sse_temp(async_context_t *ctx, async_at_time_worker_t *worker) {
+    char json[24];
+    snprintf(json, sizeof(json), "{\"temp\":%.2f}", temperatura_atual());
+    sse_publicar("temp", json);
+#if ROBO_MQTT
+    mqtt_publicar(topico_temp, json, (uint16_t)strlen(json), 0, false);  // Sem sessão: descartada
+    if (mqtt_estado_pendente) {
+        robo_publicar_estado();
+    }
+#endif
+    async_context_add_at_time_worker_in_ms(ctx, worker, SSE_INTERVALO_TEMP_MS);
+}
+
+/**
+ * Publica as mudanças de estado feitas pelo núcleo 1 (e o estado inicial
+ * de um assinante novo de /events)
+ */
+static void trabalho_estado(async_context_t *ctx, async_when_pending_worker_t *worker) {
+    robo_publicar_estado();
+}
+
+/**
+ * O enlace Wi-Fi subiu ou caiu: mostra o IP (ou a falta dele) no display
+ * e pausa os eventos periódicos de temperatura enquanto não há rede.
+ * Os servidores continuam escutando em IP_ADDR_ANY e voltam a receber
+ * conexões sozinhos quando o enlace volta
+ */
+static void robo_wifi_evento(void *arg, bool conectado) {
+    async_context_t *ctx = cyw43_arch_async_context();
+    comando_t cmd = { .tipo = CMD_TEXTO, .t_us = time_us_32() };
+    cyw43_arch_gpio_put(LED_PIN, conectado);
+    if (conectado) {
+        snprintf(cmd.texto, sizeof(cmd.texto), "%s", netif_default ? ipaddr_ntoa(&netif_default->ip_addr) : "Wi-Fi");
+        async_context_add_at_time_worker_in_ms(ctx, &worker_sse_temp, SSE_INTERVALO_TEMP_MS);
+    } else {
+        snprintf(cmd.texto, sizeof(cmd.texto), "Sem Wi-Fi");
+        async_context_remove_at_time_worker(ctx, &worker_sse_temp);
+    }
+    comando_enviar(&cmd);
+}
+
+#if ROBO_MQTT
+/**
+ * Mensagem do tópico de comandos: o formato binário do WebSocket e do
+ * UDP ([WS_CMD_*][dados]) ou o nome de um estado em texto, para testes
+ * com mosquitto_pub (-t robo/<ID>/cmd -m acordado).
+ * Com a fila cheia recusa a mensagem: o cliente MQTT segura a recepção
+ * e entrega de novo depois, em vez de descartar o comando
+ */
+static bool robo_mqtt_mensagem(void *arg, const char *topico, const uint8_t *dados, uint16_t len) {
+    comando_t cmd;
+    bool valido = false;
+    if (comando_espaco() == 0) {
+        return false;
+    }
+    if (len > 0 && dados[0] < ' ') {
+        valido = robo_decodificar_comando(dados, len, &cmd);
+    } else if (len > 0 && len < 16) {
+        char nome[16];
+        robo_estado_t estado;
+        memcpy(nome, dados, len);
+        nome[len] = '\0';
+        valido = robo_estado_de_nome(nome, &estado);
+        cmd = (comando_t){ .tipo = CMD_ESTADO, .estado = (uint8_t)estado };
+    }
+    if (valido) {
+        comando_enviar(&cmd);            // Só o núcleo 0 produz: o espaço conferido continua livre
+        metricas.mqtt_comandos++;
+    } else {
+        metricas.mqtt_invalidos++;
+    }
+    return true;
+}
+
+/**
+ * Sessão nova com o broker: o robô está online e publica o estado atual
+ */
+static void robo_mqtt_conexao(void *arg, bool conectado) {
+    if (conectado) {
+        mqtt_publicar(topico_online, "1", 1, 1, true);
+        robo_publicar_estado();
+    }
+}
+
+/**
+ * Configura o cliente MQTT (antes de wifi_iniciar: ele conecta quando o enlace sobe)
+ *
+ *   robo/<ID>/temp    {"temp":25.31}, QoS 0 a cada SSE_INTERVALO_TEMP_MS
+ *   robo/<ID>/estado  mesmo JSON do evento "estado" de /events, QoS 1, retido
+ *   robo/<ID>/online  "1" ao conectar; "0" pelo broker (última vontade) se a conexão cair
+ *   robo/<ID>/cmd     assinado com QoS 1: comandos (robo_mqtt_mensagem)
+ */
+static void robo_mqtt_iniciar(void) {
+    static mqtt_config_t config = {
+        .id = mqtt_id,
+        .will_topico = topico_online,
+        .will_msg = "0",
+        .mensagem_fn = robo_mqtt_mensagem,
+        .conexao_fn = robo_mqtt_conexao,
+    };
+    char id[2 * PICO_UNIQUE_BOARD_ID_SIZE_BYTES + 1];
+    pico_get_unique_board_id_string(id, sizeof(id));
+    snprintf(mqtt_id, sizeof(mqtt_id), "robo-%s", id);
+    snprintf(topico_temp, sizeof(topico_temp), "robo/%s/temp", id);
+    snprintf(topico_estado, sizeof(topico_estado), "robo/%s/estado", id);
+    snprintf(topico_cmd, sizeof(topico_cmd), "robo/%s/cmd", id);
+    snprintf(topico_online, sizeof(topico_online), "robo/%s/online", id);
+
+    mqtt_assinar(topico_cmd, 1);
+    if (mqtt_iniciar(ROBO_MQTT_BROKER, MQTT_PORTA, &config)) {
+        printf("MQTT: broker %s:%d, tópicos robo/%s/*\n", ROBO_MQTT_BROKER, MQTT_PORTA, id);
+    }
+}
+#endif
+
+/**
+ * IRQ do FIFO entre núcleos: o núcleo 1 avisou mudança de estado
+ */
+static void fifo_nucleo0_irq() {
+    while (multicore_fifo_rvalid()) {
+        multicore_fifo_pop_blocking();
+    }
+    multicore_fifo_clear_irq();
+    async_context_set_work_pending(cyw43_arch_async_context(), &worker_estado);
+}
+
+/**
+ * Marca o instante em que o CYW43 sinalizou dados (roda antes do handler do driver)
+ */
+static void host_wake_irq() {
+#ifdef CYW43_PIN_WL_HOST_WAKE
+    if (gpio_get_irq_event_mask(CYW43_PIN_WL_HOST_WAKE) & GPIO_IRQ_LEVEL_HIGH) {
+        t_irq_wifi = time_us_64();
+    }
+#endif
+}
+
 /***************************************************************
  * FUNÇÃO PRINCIPAL
  **************************************************************/
@@ -377,79 +2020,81 @@ int main() {
     gpio_set_dir(LED_RED_PIN, GPIO_OUT);
     gpio_put(LED_RED_PIN, false);
 
-    // Conecta ao Wi-Fi
+    // Inicializa o chip Wi-Fi (sem ele não há async_context nem lwIP)
     while (cyw43_arch_init()) {
         printf("Falha ao inicializar Wi-Fi\n");
-        sleep_ms(100);
-        return -1;
+        sleep_ms(1000);
     }
 
     cyw43_arch_gpio_put(LED_PIN, 0);
     cyw43_arch_enable_sta_mode();
+    exibir_mensagem_centralizada("Sem Wi-Fi");
+    display_renderizar();
 
-    printf("Conectando ao Wi-Fi...\n");
-    while (cyw43_arch_wifi_connect_timeout_ms(WIFI_SSID, WIFI_PASSWORD, CYW43_AUTH_WPA2_AES_PSK, 20000)) {
-        printf("Falha ao conectar ao Wi-Fi\n");
-        sleep_ms(100);
-        return -1;
-    }
-
-    printf("Conectado ao Wi-Fi\n");
+    // A conexão segue em segundo plano; o LED onboard acende com o enlace
+    wifi_ouvir(robo_wifi_evento, NULL);
+#if ROBO_MQTT
+    robo_mqtt_iniciar();
+#endif
+    wifi_iniciar(WIFI_SSID, WIFI_PASSWORD, CYW43_AUTH_WPA2_AES_PSK);
 
-    if (netif_default) {
-        printf("IP do dispositivo: %s\n", ipaddr_ntoa(&netif_default->ip_addr));
-    }
-
-    // Configura servidor TCP na porta 80
-    struct tcp_pcb *server = tcp_new();
+    // Configura servidor TCP na porta 80 (e HTTPS na 443, se habilitado),
+    // já escutando antes de o enlace subir
+    cyw43_arch_lwip_begin();
+    struct altcp_pcb *server = http_escutar(altcp_tcp_new_ip_type(IPADDR_TYPE_ANY), 80);
     if (!server) {
-        printf("Falha ao criar servidor TCP\n");
+        cyw43_arch_lwip_end();
+        printf("Falha ao abrir o servidor TCP na porta 80\n");
         return -1;
     }
+#if ROBO_HTTPS
+    struct altcp_pcb *server_tls = http_escutar(https_novo_pcb(), HTTPS_PORTA);
+#endif
+    ws_definir_callback(robo_ws_mensagem);
+    bool udp_ok = controle_udp_iniciar(robo_decodificar_comando);
+    cyw43_arch_lwip_end();
 
-    if (tcp_bind(server, IP_ADDR_ANY, 80) != ERR_OK) {
-        printf("Falha ao associar servidor TCP à porta 80\n");
-        return -1;
+    printf("Servidor ouvindo na porta 80\n");
+#if ROBO_HTTPS
+    if (server_tls) {
+        printf("Servidor HTTPS ouvindo na porta %d\n", HTTPS_PORTA);
+    } else {
+        printf("Falha ao abrir o servidor HTTPS\n");
+    }
+#endif
+    if (udp_ok) {
+        printf("Controle UDP na porta %d\n", UDP_CONTROLE_PORTA);
+    } else {
+        printf("Falha ao abrir a porta de controle UDP\n");
     }
 
-    server = tcp_listen(server);
-    tcp_accept(server, tcp_server_accept);
+    // Inicia a amostragem contínua da temperatura (ADC + DMA)
+    temperatura_iniciar();
 
-    printf("Servidor ouvindo na porta 80\n");
+    // LEDs, buzzer e display passam a ser acionados apenas pelo núcleo 1
+    multicore_launch_core1(core1_render);
 
-    // Inicializa ADC para leitura de temperatura
-    adc_init();
-    adc_set_temp_sensor_enabled(true);
+    // Avisos do núcleo 1 chegam pelo FIFO (após o launch, que também usa o FIFO)
+    multicore_fifo_drain();
+    irq_set_exclusive_handler(SIO_IRQ_PROC0, fifo_nucleo0_irq);
+    irq_set_enabled(SIO_IRQ_PROC0, true);
 
-    // Loop principal
-    while (true) {
-        cyw43_arch_poll();  // Necessário para manter conexão Wi-Fi
-        
-        // Atualiza o estado do buzzer
-        update_buzzer();
+    // Mede a latência interrupção do CYW43 -> callback TCP
+#ifdef CYW43_PIN_WL_HOST_WAKE
+    gpio_add_raw_irq_handler_with_order_priority(CYW43_PIN_WL_HOST_WAKE, host_wake_irq,
+                                                 PICO_SHARED_IRQ_HANDLER_HIGHEST_ORDER_PRIORITY);
+#endif
 
-        // Atualiza display quando necessário
-        if (atualizar_display) {
-            struct render_area frame_area = {
-                .start_column = 0,
-                .end_column = ssd1306_width - 1,
-                .start_page = 0,
-                .end_page = ssd1306_n_pages - 1
-            };
-            calculate_render_area_buffer_length(&frame_area);
-            
-            uint8_t ssd[ssd1306_buffer_length];
-            memset(ssd, 0, ssd1306_buffer_length);
-            
-            int pos_x = (ssd1306_width - strlen(mensagem_display)*8)/2;
-            int pos_y = (ssd1306_height - 8)/2;
-            ssd1306_draw_string(ssd, pos_x, pos_y, mensagem_display);
-            
-            render_on_display(ssd, &frame_area);
-            atualizar_display = false;
-        }
-        
-        sleep_ms(10);  // Pequeno delay para reduzir carga da CPU
+    // Todo o trabalho do núcleo 0 roda em workers do async_context,
+    // disparados por interrupção (rede, FIFO) ou por tempo (ADC, SSE)
+    async_context_t *ctx = cyw43_arch_async_context();
+    uso_nucleo[0].inicio_janela = time_us_32();
+    async_context_add_when_pending_worker(ctx, &worker_estado);
+    async_context_add_at_time_worker_in_ms(ctx, &worker_adc, ADC_PROCESSAR_MS);
+    // worker_sse_temp só roda com o enlace de pé (robo_wifi_evento)
+
+    while (true) {
+        __wfi();  // Nada a fazer fora das interrupções
     }
 
     cyw43_arch_deinit();
@@ -0,0 +1,149 @@
+#!/usr/bin/env python3
+"""
+Mede o custo do handshake TLS do servidor HTTPS do robô (opção ROBO_HTTPS).
+
+Três modos, cada um com -n conexões em sequência:
+  completo  sem sessão guardada: ECDHE + assinatura ECDSA a cada conexão
+  id        retomada pelo session ID (cache do servidor; tickets desligados)
+  ticket    retomada por session ticket (estado guardado no cliente)
+
+O tempo medido vai do SYN ao fim do handshake; com --caminho, também é
+feita uma requisição GET e medido o tempo até a resposta completa.
+O servidor fala só TLS 1.2, então o cliente também fica em TLS 1.2
+(no TLS 1.3 a retomada funciona de outro jeito e o Python não expõe o
+session ID).
+
+Exemplos:
+  bench_https.py 192.168.0.50                       # os três modos, 20 conexões cada
+  bench_https.py 192.168.0.50 -m completo -m ticket -n 50
+  bench_https.py 192.168.0.50 --caminho /api/status
+  bench_https.py 192.168.0.50 --ca build/tls_certificado.pem   # valida o certificado
+"""
+import argparse
+import socket
+import ssl
+import time
+
+MODOS = ('completo', 'id', 'ticket')
+
+
+def contexto(modo, ca):
+    ctx = ssl.SSLContext(ssl.PROTOCOL_TLS_CLIENT)
+    ctx.minimum_version = ctx.maximum_version = ssl.TLSVersion.TLSv1_2
+    if ca:
+        ctx.load_verify_locations(ca)
+        ctx.check_hostname = False   # CN/SAN é o nome mDNS; aqui conectamos por IP
+    else:
+        ctx.check_hostname = False
+        ctx.verify_mode = ssl.CERT_NONE
+    if modo == 'id':
+        ctx.options |= ssl.OP_NO_TICKET
+    return ctx
+
+
+def conectar(args, ctx, sessao):
+    t0 = time.perf_counter()
+    tcp = socket.create_connection((args.host, args.porta), timeout=args.timeout)
+    tcp.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+    t_tcp = time.perf_counter()
+    tls = ctx.wrap_socket(tcp, server_hostname=args.nome, session=sessao)
+    t_tls = time.perf_counter()
+    t_resp = None
+    if args.caminho:
+        tls.sendall(('GET %s HTTP/1.1\r\nHost: %s\r\nConnection: close\r\n\r\n' % (
+            args.caminho, args.nome)).encode())
+        while tls.recv(4096):
+            pass
+        t_resp = time.perf_counter()
+    return tls, (t_tcp - t0, t_tls - t0, t_resp - t0 if t_resp else None)
+
+
+def fechar(tls):
+    try:
+        tls.unwrap()
+    except (OSError, ssl.SSLError):
+        pass
+    tls.close()
+
+
+def percentil(ordenados, p):
+    return ordenados[min(len(ordenados) - 1, int(len(ordenados) * p / 100))]
+
+
+def medir(args, modo):
+    ctx = contexto(modo, args.ca)
+    sessao = None
+    tempos, reusos, erros = [], 0, 0
+    suite = None
+    for i in range(args.n + (0 if modo == 'completo' else 1)):
+        try:
+            tls, t = conectar(args, ctx, sessao)
+        except (OSError, ssl.SSLError) as e:
+            erros += 1
+            print('  %s: %s' % (modo, e))
+            continue
+        suite = tls.cipher()[0]
+        if modo != 'completo':
+            if sessao is None:
+                # Primeira conexão só obtém a sessão; não entra na conta
+                sessao = tls.session
+                fechar(tls)
+                continue
+            reusos += tls.session_reused
+            sessao = tls.session   # Ticket pode ter sido renovado
+        tempos.append(t)
+        fechar(tls)
+        if args.pausa:
+            time.sleep(args.pausa / 1000)
+    return tempos, reusos, erros, suite
+
+
+def relatorio(modo, tempos, reusos, erros, suite):
+    if not tempos:
+        print('%-9s sem conexões (%d erros)' % (modo, erros))
+        return None
+    hs = sorted(t[1] - t[0] for t in tempos)
+    tcp = sorted(t[0] for t in tempos)
+    linha = '%-9s n=%d  handshake ms p50 %.1f  p90 %.1f  max %.1f  | tcp p50 %.1f' % (
+        modo, len(tempos), percentil(hs, 50) * 1000, percentil(hs, 90) * 1000,
+        hs[-1] * 1000, percentil(tcp, 50) * 1000)
+    if tempos[0][2] is not None:
+        resp = sorted(t[2] for t in tempos)
+        linha += '  | resposta p50 %.1f' % (percentil(resp, 50) * 1000)
+    if modo != 'completo':
+        linha += '  | retomadas %d/%d' % (reusos, len(tempos))
+    if erros:
+        linha += '  | erros %d' % erros
+    print(linha)
+    return percentil(hs, 50)
+
+
+def main():
+    ap = argparse.ArgumentParser(description='Benchmark do handshake TLS do servidor do robô')
+    ap.add_argument('host')
+    ap.add_argument('--porta', type=int, default=443)
+    ap.add_argument('-n', type=int, default=20, help='conexões medidas por modo')
+    ap.add_argument('-m', '--modo', action='append', choices=MODOS, help='repetível (padrão: todos)')
+    ap.add_argument('--caminho', help='faz um GET após o handshake (ex.: /api/status)')
+    ap.add_argument('--nome', default='robo.local', help='SNI e Host')
+    ap.add_argument('--ca', help='certificado PEM para validar o servidor')
+    ap.add_argument('--pausa', type=float, default=0, help='ms entre conexões')
+    ap.add_argument('--timeout', type=float, default=10)
+    args = ap.parse_args()
+
+    p50 = {}
+    suite = None
+    for modo in args.modo or MODOS:
+        tempos, reusos, erros, s = medir(args, modo)
+        suite = s or suite
+        p50[modo] = relatorio(modo, tempos, reusos, erros, s)
+    if suite:
+        print('suíte: %s' % suite)
+    if p50.get('completo'):
+        for modo in ('id', 'ticket'):
+            if p50.get(modo):
+                print('%s: %.1fx mais rápido que o handshake completo' % (modo, p50['completo'] / p50[modo]))
+
+
+if __name__ == '__main__':
+    main()
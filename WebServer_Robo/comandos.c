@@ -0,0 +1,52 @@
+#include "pico/stdlib.h"
+#include "hardware/sync.h"
+#include "comandos.h"
+
+#if (CMD_FILA_TAM & (CMD_FILA_TAM - 1)) != 0
+#error "CMD_FILA_TAM deve ser potência de 2"
+#endif
+
+/***************************************************************
+ * VARIÁVEIS INTERNAS
+ **************************************************************/
+static comando_t fila[CMD_FILA_TAM];
+static volatile uint32_t cabeca = 0;       // Escrito apenas pelo produtor
+static volatile uint32_t cauda = 0;        // Escrito apenas pelo consumidor
+static volatile uint32_t descartados = 0;
+
+/***************************************************************
+ * API PÚBLICA
+ **************************************************************/
+bool comando_enviar(comando_t *cmd) {
+    uint32_t c = cabeca;
+    if (c - cauda == CMD_FILA_TAM) {
+        descartados++;
+        return false;
+    }
+    cmd->t_us = time_us_32();
+    fila[c & (CMD_FILA_TAM - 1)] = *cmd;
+    __dmb();  // O conteúdo precisa estar visível antes do novo índice
+    cabeca = c + 1;
+    __sev();  // Acorda o consumidor se estiver em WFE no outro núcleo
+    return true;
+}
+
+bool comando_receber(comando_t *cmd) {
+    uint32_t t = cauda;
+    if (t == cabeca) {
+        return false;
+    }
+    __dmb();
+    *cmd = fila[t & (CMD_FILA_TAM - 1)];
+    __dmb();  // Termina a leitura antes de liberar a entrada
+    cauda = t + 1;
+    return true;
+}
+
+uint32_t comando_espaco() {
+    return CMD_FILA_TAM - (cabeca - cauda);
+}
+
+uint32_t comando_descartados() {
+    return descartados;
+}
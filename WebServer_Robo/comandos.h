@@ -0,0 +1,66 @@
+#ifndef COMANDOS_H
+#define COMANDOS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/***************************************************************
+ * FILA DE COMANDOS DO ROBÔ
+ *
+ * Fila circular sem trava, um produtor (callbacks do lwIP, núcleo 0)
+ * e um consumidor (laço de renderização, núcleo 1). Os callbacks
+ * de rede apenas enfileiram e respondem; nenhum periférico é
+ * acionado dentro deles.
+ **************************************************************/
+#ifndef CMD_FILA_TAM
+#define CMD_FILA_TAM 16               // Entradas na fila (potência de 2)
+#endif
+
+#define CMD_QUADRO_TAM 75             // 25 pixels RGB
+#define CMD_TEXTO_TAM 50              // Mesmo tamanho de mensagem_display
+
+typedef enum {
+    CMD_ESTADO = 1,                   // Aplica um estado do robô
+    CMD_QUADRO,                       // Escreve um quadro na matriz de LEDs
+    CMD_TEXTO,                        // Mostra um texto no display
+    CMD_TOM                           // Toca um tom no buzzer
+} cmd_tipo_t;
+
+typedef struct {
+    uint8_t tipo;                     // cmd_tipo_t
+    uint8_t estado;                   // Usado por CMD_ESTADO
+    uint32_t t_us;                    // Momento do enfileiramento (time_us_32)
+    union {
+        uint8_t quadro[CMD_QUADRO_TAM];
+        char texto[CMD_TEXTO_TAM];
+        struct {
+            uint16_t freq_hz;
+            uint16_t duracao_ms;
+        } tom;
+    };
+} comando_t;
+
+/**
+ * Enfileira um comando (somente o produtor)
+ * @return false se a fila estiver cheia (comando descartado)
+ */
+bool comando_enviar(comando_t *cmd);
+
+/**
+ * Entradas livres na fila (somente o produtor; o valor só pode aumentar
+ * até a próxima chamada de comando_enviar)
+ */
+uint32_t comando_espaco();
+
+/**
+ * Retira o comando mais antigo (somente o consumidor)
+ * @return false se a fila estiver vazia
+ */
+bool comando_receber(comando_t *cmd);
+
+/**
+ * Número de comandos descartados por fila cheia
+ */
+uint32_t comando_descartados();
+
+#endif
@@ -0,0 +1,204 @@
+#include <string.h>
+
+#include "pico/stdlib.h"
+#include "lwip/udp.h"
+#include "controle_udp.h"
+#include "metricas.h"
+
+/***************************************************************
+ * VARIÁVEIS INTERNAS
+ **************************************************************/
+// Janela de seq de um remetente (como a janela anti-replay do IPsec):
+// bit i de 'vistos' indica que ultimo_seq - i já foi aplicado
+typedef struct {
+    ip_addr_t ip;
+    u16_t porta;
+    bool ativo;
+    uint32_t ultimo_seq;
+    uint32_t vistos;
+    uint32_t t_uso;                // Para substituir o remetente menos recente
+} udp_remetente_t;
+
+static struct udp_pcb *pcb_controle = NULL;
+static udp_decodificar_fn decodificar_cb = NULL;
+static udp_remetente_t remetentes[UDP_REMETENTES];
+
+// Fora da pilha: o callback roda no contexto do lwIP e nunca é reentrante
+static uint8_t rx_buf[UDP_CABECALHO + 1 + UDP_LOTE_MAX * (2 + CMD_QUADRO_TAM)];
+static comando_t rx_cmds[UDP_LOTE_MAX];
+
+/***************************************************************
+ * FUNÇÕES INTERNAS
+ **************************************************************/
+#define UDP_SEQ_REINICIO 1024       // Atraso de seq tratado como reinício do remetente
+
+static uint32_t ler_u32(const uint8_t *p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+/**
+ * Encontra o remetente ou reaproveita a entrada usada há mais tempo
+ */
+static udp_remetente_t *remetente_obter(const ip_addr_t *ip, u16_t porta) {
+    udp_remetente_t *livre = &remetentes[0];
+    for (int i = 0; i < UDP_REMETENTES; i++) {
+        udp_remetente_t *r = &remetentes[i];
+        if (r->ativo && r->porta == porta && ip_addr_cmp(&r->ip, ip)) {
+            return r;
+        }
+        if (!r->ativo || (livre->ativo && r->t_uso < livre->t_uso)) {
+            livre = r;
+        }
+    }
+    ip_addr_copy(livre->ip, *ip);
+    livre->porta = porta;
+    livre->ativo = true;
+    livre->ultimo_seq = 0;
+    livre->vistos = 0;
+    return livre;
+}
+
+/**
+ * @return true se o seq já foi aplicado (ou é antigo demais para a janela)
+ */
+static bool seq_repetido(const udp_remetente_t *r, uint32_t seq) {
+    if (!r->vistos || (int32_t)(seq - r->ultimo_seq) > 0) {
+        return false;
+    }
+    uint32_t atraso = r->ultimo_seq - seq;
+    if (atraso >= UDP_SEQ_REINICIO) {
+        return false;  // Muito para trás: o remetente reiniciou a numeração
+    }
+    return atraso >= 32 || (r->vistos & (1u << atraso));
+}
+
+static void seq_marcar(udp_remetente_t *r, uint32_t seq) {
+    if (!r->vistos) {
+        r->ultimo_seq = seq;
+        r->vistos = 1;
+    } else if ((int32_t)(seq - r->ultimo_seq) > 0) {
+        uint32_t avanco = seq - r->ultimo_seq;
+        r->vistos = avanco >= 32 ? 1 : (r->vistos << avanco) | 1;
+        r->ultimo_seq = seq;
+    } else if (r->ultimo_seq - seq >= 32) {
+        r->ultimo_seq = seq;  // Reinício da numeração: nova janela
+        r->vistos = 1;
+    } else {
+        r->vistos |= 1u << (r->ultimo_seq - seq);
+    }
+}
+
+/**
+ * Decodifica o comando ou o lote do datagrama
+ * @return Número de comandos em cmds, ou -1 se algum for inválido
+ */
+static int decodificar(const uint8_t *dados, uint16_t len, uint8_t tipo, comando_t *cmds) {
+    if (tipo == UDP_TIPO_COMANDO) {
+        return len > 0 && decodificar_cb(dados, len, &cmds[0]) ? 1 : -1;
+    }
+    if (tipo != UDP_TIPO_LOTE || len < 1 || dados[0] == 0 || dados[0] > UDP_LOTE_MAX) {
+        return -1;
+    }
+    int n = dados[0];
+    uint16_t pos = 1;
+    for (int i = 0; i < n; i++) {
+        if (pos >= len) {
+            return -1;
+        }
+        uint8_t tam = dados[pos++];
+        if (tam == 0 || pos + tam > len || !decodificar_cb(&dados[pos], tam, &cmds[i])) {
+            return -1;
+        }
+        pos += tam;
+    }
+    return pos == len ? n : -1;
+}
+
+static void enviar_ack(const ip_addr_t *ip, u16_t porta, uint32_t seq, udp_status_t status, uint8_t aplicados) {
+    struct pbuf *p = pbuf_alloc(PBUF_TRANSPORT, UDP_CABECALHO + 2, PBUF_RAM);
+    if (!p) {
+        return;
+    }
+    uint8_t *b = (uint8_t *)p->payload;
+    b[0] = UDP_MAGIC;
+    b[1] = UDP_TIPO_ACK;
+    b[2] = 0;
+    b[3] = 0;
+    b[4] = seq;
+    b[5] = seq >> 8;
+    b[6] = seq >> 16;
+    b[7] = seq >> 24;
+    b[8] = status;
+    b[9] = aplicados;
+    udp_sendto(pcb_controle, p, ip, porta);
+    pbuf_free(p);
+}
+
+/**
+ * Callback de recepção: valida, descarta repetidos e enfileira
+ */
+static void controle_udp_recv(void *arg, struct udp_pcb *pcb, struct pbuf *p,
+                              const ip_addr_t *ip, u16_t porta) {
+    uint8_t *buf = rx_buf;
+    uint16_t len = pbuf_copy_partial(p, buf, sizeof(rx_buf), 0);
+    bool completo = len == p->tot_len;
+    pbuf_free(p);
+    metricas.udp_datagramas++;
+
+    if (len < UDP_CABECALHO || buf[0] != UDP_MAGIC) {
+        metricas.udp_invalidos++;
+        return;  // Nem dá para responder: não é o nosso protocolo
+    }
+    uint8_t tipo = buf[1];
+    bool pede_ack = buf[2] & UDP_FLAG_ACK;
+    uint32_t seq = ler_u32(&buf[4]);
+
+    comando_t *cmds = rx_cmds;
+    int n = completo ? decodificar(&buf[UDP_CABECALHO], len - UDP_CABECALHO, tipo, cmds) : -1;
+    udp_status_t status;
+    uint8_t aplicados = 0;
+
+    if (n < 0) {
+        metricas.udp_invalidos++;
+        status = UDP_STATUS_INVALIDO;
+    } else {
+        udp_remetente_t *r = remetente_obter(ip, porta);
+        r->t_uso = time_us_32();
+        if (seq_repetido(r, seq)) {
+            metricas.udp_duplicados++;
+            status = UDP_STATUS_DUPLICADO;
+        } else if (comando_espaco() < (uint32_t)n) {
+            status = UDP_STATUS_FILA_CHEIA;  // Seq não é marcado: a retransmissão será aplicada
+        } else {
+            for (int i = 0; i < n; i++) {
+                comando_enviar(&cmds[i]);  // Há espaço: o consumidor só libera entradas
+            }
+            seq_marcar(r, seq);
+            metricas.udp_comandos += n;
+            aplicados = n;
+            status = UDP_STATUS_OK;
+        }
+    }
+
+    if (pede_ack) {
+        enviar_ack(ip, porta, seq, status, aplicados);
+    }
+}
+
+/***************************************************************
+ * API PÚBLICA
+ **************************************************************/
+bool controle_udp_iniciar(udp_decodificar_fn decodificar) {
+    decodificar_cb = decodificar;
+    pcb_controle = udp_new();
+    if (!pcb_controle) {
+        return false;
+    }
+    if (udp_bind(pcb_controle, IP_ADDR_ANY, UDP_CONTROLE_PORTA) != ERR_OK) {
+        udp_remove(pcb_controle);
+        pcb_controle = NULL;
+        return false;
+    }
+    udp_recv(pcb_controle, controle_udp_recv, NULL);
+    return true;
+}
@@ -0,0 +1,66 @@
+#ifndef CONTROLE_UDP_H
+#define CONTROLE_UDP_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "comandos.h"
+
+/***************************************************************
+ * PROTOCOLO BINÁRIO DE CONTROLE SOBRE UDP
+ *
+ * Um datagrama = um cabeçalho de 8 bytes + um comando ou um lote.
+ * Sem conexão e sem parsing de texto: o comando vai direto para a
+ * fila do núcleo 1. Cada comando usa o mesmo formato das mensagens
+ * binárias do WebSocket ([tipo][dados], ver WS_CMD_* em websocket.h).
+ *
+ *   0  magic 'R' (0x52)
+ *   1  tipo: UDP_TIPO_COMANDO, UDP_TIPO_LOTE ou UDP_TIPO_ACK
+ *   2  flags: UDP_FLAG_ACK pede confirmação
+ *   3  reservado (0)
+ *   4  seq (uint32, little-endian), crescente por remetente
+ *   8  COMANDO: [tipo][dados...]
+ *      LOTE:    [n] seguido de n entradas [tam][tipo][dados...]
+ *
+ * A confirmação (UDP_TIPO_ACK) repete o seq e traz [status][aplicados].
+ * Um lote é aplicado por inteiro ou não é aplicado. Um seq repetido
+ * (retransmissão) não é aplicado de novo: só a confirmação é reenviada.
+ **************************************************************/
+#ifndef UDP_CONTROLE_PORTA
+#define UDP_CONTROLE_PORTA 5005
+#endif
+
+#ifndef UDP_REMETENTES
+#define UDP_REMETENTES 4           // Remetentes com janela de seq própria
+#endif
+
+#define UDP_LOTE_MAX 8             // Comandos por lote
+#define UDP_CABECALHO 8
+#define UDP_MAGIC 0x52
+
+#define UDP_TIPO_COMANDO 0x01
+#define UDP_TIPO_LOTE    0x02
+#define UDP_TIPO_ACK     0x80
+
+#define UDP_FLAG_ACK 0x01
+
+typedef enum {
+    UDP_STATUS_OK = 0,             // Enfileirado para o núcleo 1
+    UDP_STATUS_DUPLICADO,          // Seq já aplicado anteriormente
+    UDP_STATUS_FILA_CHEIA,         // Nada aplicado; pode retransmitir
+    UDP_STATUS_INVALIDO            // Datagrama ou comando malformado
+} udp_status_t;
+
+/**
+ * Converte um comando binário em comando_t
+ * @return false se o comando for inválido
+ */
+typedef bool (*udp_decodificar_fn)(const uint8_t *dados, uint16_t len, comando_t *cmd);
+
+/**
+ * Abre a porta UDP de controle (chamar com o lwIP travado)
+ * @param decodificar Conversor de comandos binários
+ * @return false se não foi possível abrir a porta
+ */
+bool controle_udp_iniciar(udp_decodificar_fn decodificar);
+
+#endif
@@ -0,0 +1,81 @@
+#!/usr/bin/env python3
+"""
+Gera tls_credenciais.c com o certificado e a chave do servidor HTTPS.
+
+Sem --cert/--chave, cria uma única vez (ao lado da saída) um par
+autoassinado EC P-256 com o openssl e passa a reutilizá-lo: o firmware
+não muda de certificado a cada build e o navegador só precisa aceitar
+a exceção uma vez. Com --cert/--chave, embute os arquivos informados
+(a chave deve ser EC P-256, ver mbedtls_config.h).
+
+Os PEM são gravados como strings C; os tamanhos incluem o '\\0' final,
+como exige o parser PEM do mbedTLS.
+
+Uso: gerar_credenciais_tls.py [--cert cert.pem --chave chave.pem] [--nome robo.local] <saida.c>
+"""
+import argparse
+import os
+import subprocess
+import sys
+
+
+def gerar_autoassinado(cert, chave, nome):
+    subprocess.run([
+        'openssl', 'req', '-x509', '-newkey', 'ec',
+        '-pkeyopt', 'ec_paramgen_curve:prime256v1',
+        '-nodes', '-days', '3650', '-subj', '/CN=%s' % nome,
+        '-addext', 'subjectAltName=DNS:%s' % nome,
+        '-keyout', chave, '-out', cert,
+    ], check=True, stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL)
+    print('tls: certificado autoassinado gerado para %s (%s)' % (nome, cert))
+
+
+def string_c(nome, texto):
+    linhas = ['    "%s\\n"' % linha.replace('\\', '\\\\').replace('"', '\\"')
+              for linha in texto.strip().splitlines()]
+    return ('const uint8_t %s[] =\n%s;\n'
+            'const size_t %s_tam = sizeof(%s);\n' % (nome, '\n'.join(linhas), nome, nome))
+
+
+def gerar(saida, cert, chave, nome):
+    if not cert and not chave:
+        base = os.path.dirname(os.path.abspath(saida))
+        cert = os.path.join(base, 'tls_certificado.pem')
+        chave = os.path.join(base, 'tls_chave.pem')
+        if not (os.path.exists(cert) and os.path.exists(chave)):
+            gerar_autoassinado(cert, chave, nome)
+    elif not (cert and chave):
+        sys.exit('tls: informe --cert e --chave juntos')
+
+    with open(cert, encoding='ascii') as f:
+        pem_cert = f.read()
+    with open(chave, encoding='ascii') as f:
+        pem_chave = f.read()
+    if 'BEGIN CERTIFICATE' not in pem_cert:
+        sys.exit('tls: %s não é um certificado PEM' % cert)
+    if 'PRIVATE KEY' not in pem_chave:
+        sys.exit('tls: %s não é uma chave privada PEM' % chave)
+
+    conteudo = ('// Gerado por gerar_credenciais_tls.py; não editar\n'
+                '#include <stddef.h>\n#include <stdint.h>\n\n'
+                '// %s\n%s\n// %s\n%s' % (
+                    os.path.basename(cert), string_c('tls_certificado', pem_cert),
+                    os.path.basename(chave), string_c('tls_chave', pem_chave)))
+
+    # Só reescreve se mudou, para não forçar recompilação
+    if os.path.exists(saida):
+        with open(saida, encoding='utf-8') as f:
+            if f.read() == conteudo:
+                return
+    with open(saida, 'w', encoding='utf-8') as f:
+        f.write(conteudo)
+
+
+if __name__ == '__main__':
+    ap = argparse.ArgumentParser(description='Embute certificado e chave TLS no firmware')
+    ap.add_argument('saida')
+    ap.add_argument('--cert', default='')
+    ap.add_argument('--chave', default='')
+    ap.add_argument('--nome', default='robo.local', help='CN/SAN do certificado autoassinado')
+    a = ap.parse_args()
+    gerar(a.saida, a.cert, a.chave, a.nome)
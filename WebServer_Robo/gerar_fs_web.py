@@ -0,0 +1,123 @@
+#!/usr/bin/env python3
+"""
+Gera web_fs_dados.c a partir dos arquivos de www/ (no espírito do makefsdata do lwIP).
+
+Para cada arquivo:
+  - comprime com gzip (nível 9, mtime=0 para a saída ser reprodutível) e
+    mantém a versão comprimida só quando ela for menor;
+  - calcula um hash SHA-256 do conteúdo, usado como ETag;
+  - arquivos que não são HTML são publicados com o hash no nome
+    (/app.js -> /app.1a2b3c4d.js) e podem ter cache de longa duração.
+    As referências nos HTML são reescritas para os nomes com hash, de modo
+    que qualquer mudança em um recurso também muda o ETag da página.
+
+Uso: gerar_fs_web.py <diretorio www> <saida.c>
+"""
+import gzip
+import hashlib
+import os
+import sys
+
+TIPOS = {
+    '.html': 'text/html; charset=utf-8',
+    '.css': 'text/css',
+    '.js': 'application/javascript',
+    '.json': 'application/json',
+    '.svg': 'image/svg+xml',
+    '.png': 'image/png',
+    '.ico': 'image/x-icon',
+}
+
+TAM_HASH_NOME = 8    # Dígitos hex no nome do arquivo
+TAM_HASH_ETAG = 16   # Dígitos hex no ETag
+
+
+def hash_hex(dados):
+    return hashlib.sha256(dados).hexdigest()
+
+
+def nome_com_hash(nome, dados):
+    base, ext = os.path.splitext(nome)
+    return '%s.%s%s' % (base, hash_hex(dados)[:TAM_HASH_NOME], ext)
+
+
+def ler_arquivos(diretorio):
+    arquivos = {}
+    for raiz, _, nomes in os.walk(diretorio):
+        for nome in sorted(nomes):
+            caminho = os.path.join(raiz, nome)
+            rel = '/' + os.path.relpath(caminho, diretorio).replace(os.sep, '/')
+            with open(caminho, 'rb') as f:
+                arquivos[rel] = f.read()
+    return dict(sorted(arquivos.items()))
+
+
+def publicar(arquivos):
+    """Retorna a lista (caminho publicado, conteúdo, imutável)."""
+    renomeados = {}
+    for rel, dados in arquivos.items():
+        if not rel.endswith('.html'):
+            renomeados[rel] = nome_com_hash(rel, dados)
+
+    publicados = []
+    for rel, dados in arquivos.items():
+        if rel in renomeados:
+            publicados.append((renomeados[rel], dados, True))
+            continue
+        for antigo, novo in renomeados.items():
+            dados = dados.replace(('"%s"' % antigo).encode(), ('"%s"' % novo).encode())
+        publicados.append((rel, dados, False))
+    return publicados
+
+
+def array_c(nome, dados):
+    linhas = []
+    for i in range(0, len(dados), 16):
+        linhas.append('    ' + ', '.join('0x%02x' % b for b in dados[i:i + 16]) + ',')
+    return 'static const uint8_t %s[%d] = {\n%s\n};\n' % (nome, len(dados), '\n'.join(linhas))
+
+
+def gerar(diretorio, saida):
+    publicados = publicar(ler_arquivos(diretorio))
+    partes = [
+        '// Gerado por gerar_fs_web.py a partir de www/ - NÃO EDITE\n',
+        '#include "web_fs.h"\n\n',
+    ]
+    entradas = []
+    total_original = total_flash = 0
+
+    for i, (caminho, dados, imutavel) in enumerate(publicados):
+        comprimido = gzip.compress(dados, compresslevel=9, mtime=0)
+        usa_gzip = len(comprimido) < len(dados)
+        conteudo = comprimido if usa_gzip else dados
+        ext = os.path.splitext(caminho)[1]
+        tipo = TIPOS.get(ext, 'application/octet-stream')
+        etag = hash_hex(dados)[:TAM_HASH_ETAG]
+
+        nome = 'arquivo_%d' % i
+        partes.append('// %s (%d -> %d bytes)\n' % (caminho, len(dados), len(conteudo)))
+        partes.append(array_c(nome, conteudo) + '\n')
+        entradas.append('    {"%s", "%s", %s, %d, "\\"%s\\"", %s, %s},' % (
+            caminho, tipo, nome, len(conteudo), etag,
+            'true' if usa_gzip else 'false', 'true' if imutavel else 'false'))
+        total_original += len(dados)
+        total_flash += len(conteudo)
+
+    partes.append('const web_arquivo_t web_fs_arquivos[] = {\n%s\n};\n\n' % '\n'.join(entradas))
+    partes.append('const int web_fs_total = %d;\n' % len(entradas))
+
+    conteudo = ''.join(partes)
+    # Só reescreve se mudou, para não forçar recompilação
+    if os.path.exists(saida):
+        with open(saida, encoding='utf-8') as f:
+            if f.read() == conteudo:
+                return
+    with open(saida, 'w', encoding='utf-8') as f:
+        f.write(conteudo)
+    print('web_fs: %d arquivos, %d -> %d bytes' % (len(entradas), total_original, total_flash))
+
+
+if __name__ == '__main__':
+    if len(sys.argv) != 3:
+        sys.exit('uso: %s <diretorio www> <saida.c>' % sys.argv[0])
+    gerar(sys.argv[1], sys.argv[2])
@@ -0,0 +1,150 @@
+#!/usr/bin/env python3
+"""
+Teste de carga HTTP para o build nativo do servidor (robo_host).
+
+Cada cliente faz requisições em sequência, reaproveitando a conexão
+(--keep-alive on) ou abrindo uma por requisição (--keep-alive off), e o
+relatório traz requisições/s e percentis de latência.
+
+Exemplos:
+  carga_http.py -c 4 -d 10                          # 4 clientes, keep-alive
+  carga_http.py -c 8 -d 10 --keep-alive off         # conexão nova por requisição
+  carga_http.py -c 4 -p /api/status -p /metrics     # alterna entre caminhos
+  carga_http.py -c 20 -d 10 --pausa 200             # 20 abas consultando a cada 200 ms
+  carga_http.py --host 192.168.0.50 --porta 80      # contra a placa
+"""
+import argparse
+import asyncio
+import collections
+import time
+
+
+class Resultado:
+    def __init__(self):
+        self.latencias = []
+        self.status = collections.Counter()
+        self.erros = collections.Counter()
+        self.bytes = 0
+        self.conexoes = 0
+        self.reconexoes = 0
+        self.por_cliente = collections.Counter()
+
+
+async def ler_resposta(leitor):
+    """Lê uma resposta com Content-Length; devolve (status, bytes, fechar)."""
+    linha = await leitor.readline()
+    if not linha:
+        raise ConnectionError('conexão encerrada')
+    status = int(linha.split()[1])
+    tamanho, fechar = 0, False
+    while True:
+        linha = await leitor.readline()
+        if linha in (b'\r\n', b'\n', b''):
+            break
+        nome, _, valor = linha.decode('latin-1').partition(':')
+        nome = nome.strip().lower()
+        if nome == 'content-length':
+            tamanho = int(valor)
+        elif nome == 'connection' and valor.strip().lower() == 'close':
+            fechar = True
+    if tamanho:
+        await leitor.readexactly(tamanho)
+    return status, tamanho, fechar
+
+
+async def requisitar(args, res, conexao, pedido):
+    if conexao is None:
+        conexao = await asyncio.wait_for(asyncio.open_connection(args.host, args.porta), args.timeout)
+        res.conexoes += 1
+    leitor, escritor = conexao
+    escritor.write(pedido)
+    return conexao, await asyncio.wait_for(ler_resposta(leitor), args.timeout)
+
+
+async def cliente(args, res, fim, indice):
+    conexao = None
+    i = indice
+    while time.perf_counter() < fim:
+        caminho = args.caminho[i % len(args.caminho)]
+        i += 1
+        pedido = ('GET %s HTTP/1.1\r\nHost: %s\r\nAccept-Encoding: gzip\r\n%s\r\n' % (
+            caminho, args.host, '' if args.keep_alive == 'on' else 'Connection: close\r\n')).encode()
+        t0 = time.perf_counter()
+        try:
+            try:
+                reusada = conexao is not None
+                conexao, (status, n, fechar) = await requisitar(args, res, conexao, pedido)
+            except (ConnectionError, asyncio.IncompleteReadError):
+                if not reusada:
+                    raise
+                # Keep-alive fechado pelo servidor (ocioso ou despejado): como um
+                # navegador, repete uma vez em uma conexão nova
+                conexao[1].close()
+                conexao = None
+                res.reconexoes += 1
+                conexao, (status, n, fechar) = await requisitar(args, res, None, pedido)
+        except (OSError, asyncio.TimeoutError, asyncio.IncompleteReadError, ValueError, IndexError) as e:
+            res.erros[type(e).__name__] += 1
+            if conexao:
+                conexao[1].close()
+            conexao = None
+            await asyncio.sleep(0.01)
+            continue
+        res.latencias.append(time.perf_counter() - t0)
+        res.status[status] += 1
+        res.bytes += n
+        if status < 500:
+            res.por_cliente[indice] += 1
+        if fechar or args.keep_alive == 'off':
+            conexao[1].close()
+            conexao = None
+        if args.pausa:
+            await asyncio.sleep(args.pausa / 1000)
+    if conexao:
+        conexao[1].close()
+
+
+def percentil(ordenados, p):
+    return ordenados[min(len(ordenados) - 1, int(len(ordenados) * p / 100))]
+
+
+async def executar(args):
+    res = Resultado()
+    inicio = time.perf_counter()
+    fim = inicio + args.duracao
+    await asyncio.gather(*(cliente(args, res, fim, i) for i in range(args.clientes)))
+    decorrido = time.perf_counter() - inicio
+
+    lat = sorted(res.latencias)
+    print('%d clientes, keep-alive %s, %.1f s, caminhos %s' % (
+        args.clientes, args.keep_alive, decorrido, ' '.join(args.caminho)))
+    print('requisições : %d (%.0f req/s), %d conexões, %.1f KiB' % (
+        len(lat), len(lat) / decorrido, res.conexoes, res.bytes / 1024))
+    print('status      : %s' % ' '.join('%d=%d' % kv for kv in sorted(res.status.items())))
+    servidas = [res.por_cliente[i] for i in range(args.clientes)]
+    print('por cliente : min %d  max %d respostas < 500, %d reconexões após keep-alive fechado' % (
+        min(servidas), max(servidas), res.reconexoes))
+    if res.erros:
+        print('erros       : %s' % ' '.join('%s=%d' % kv for kv in sorted(res.erros.items())))
+    if lat:
+        print('latência ms : p50 %.2f  p90 %.2f  p99 %.2f  max %.2f' % tuple(
+            x * 1000 for x in (percentil(lat, 50), percentil(lat, 90), percentil(lat, 99), lat[-1])))
+
+
+def main():
+    ap = argparse.ArgumentParser(description='Teste de carga HTTP do servidor do robô')
+    ap.add_argument('--host', default='127.0.0.1')
+    ap.add_argument('--porta', type=int, default=8080)
+    ap.add_argument('-c', '--clientes', type=int, default=4)
+    ap.add_argument('-d', '--duracao', type=float, default=10, help='segundos')
+    ap.add_argument('-p', '--caminho', action='append', help='repetível (padrão: /api/status)')
+    ap.add_argument('--keep-alive', choices=['on', 'off'], default='on')
+    ap.add_argument('--pausa', type=float, default=0, help='ms entre requisições de um cliente (navegador)')
+    ap.add_argument('--timeout', type=float, default=5)
+    args = ap.parse_args()
+    args.caminho = args.caminho or ['/api/status']
+    asyncio.run(executar(args))
+
+
+if __name__ == '__main__':
+    main()
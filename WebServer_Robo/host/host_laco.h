@@ -0,0 +1,46 @@
+#ifndef HOST_LACO_H
+#define HOST_LACO_H
+
+#include <stdint.h>
+
+/***************************************************************
+ * LAÇO DE EVENTOS DO BUILD NATIVO
+ *
+ * No firmware o lwIP e os workers rodam em interrupções do núcleo 0
+ * e o laço principal só faz __wfi(). No host, cada __wfi() executa
+ * um ciclo: espera eventos de socket (lwip_host.c) até o próximo
+ * worker vencer, depois roda workers e "interrupções" pendentes.
+ **************************************************************/
+typedef void (*host_evento_fn)(void *arg);
+
+/**
+ * Observa um descritor extra no epoll (ex.: eventfd do FIFO entre núcleos)
+ */
+void host_laco_observar(int fd, host_evento_fn fn, void *arg);
+
+/**
+ * Processa eventos de rede por até timeout_ms (0 = sem esperar)
+ */
+void host_lwip_processar(int timeout_ms);
+
+/**
+ * Tempo até o próximo worker com horário (ms, -1 se não houver)
+ */
+int host_async_proximo_ms(void);
+
+/**
+ * Executa os workers vencidos e os marcados como pendentes
+ */
+void host_async_executar(void);
+
+/**
+ * Chama os callbacks estendidos da netif (Wi-Fi simulado em pico_host.c)
+ */
+void host_netif_avisar(uint16_t motivo);
+
+/**
+ * Avança a simulação do ADC + DMA até o instante atual
+ */
+void host_dma_avancar(void);
+
+#endif
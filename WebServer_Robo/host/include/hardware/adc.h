@@ -0,0 +1,21 @@
+#pragma once
+#include "pico_host.h"
+
+typedef struct {
+    volatile uint32_t cs;
+    volatile uint32_t result;
+    volatile uint32_t fcs;
+    volatile uint32_t fifo;
+    volatile uint32_t div;
+} adc_hw_t;
+
+extern adc_hw_t *adc_hw;
+
+void adc_init(void);
+void adc_set_temp_sensor_enabled(bool habilitar);
+void adc_select_input(uint entrada);
+uint16_t adc_read(void);
+void adc_set_round_robin(uint mascara);
+void adc_fifo_setup(bool en, bool dreq_en, uint16_t dreq_limiar, bool err_no_fifo, bool byte_shift);
+void adc_set_clkdiv(float div);
+void adc_run(bool rodar);
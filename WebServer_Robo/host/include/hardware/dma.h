@@ -0,0 +1,46 @@
+#pragma once
+#include "pico_host.h"
+
+/**
+ * Canais de DMA simulados: só o padrão usado pelo firmware (periférico ->
+ * buffer em anel), alimentado pelo laço de eventos do host.
+ * write_addr guarda o ponteiro completo (64 bits no host).
+ */
+#define NUM_DMA_CHANNELS 12
+
+enum dma_channel_transfer_size { DMA_SIZE_8 = 0, DMA_SIZE_16 = 1, DMA_SIZE_32 = 2 };
+enum { DREQ_ADC = 36 };
+
+typedef struct {
+    enum dma_channel_transfer_size tamanho;
+    bool incr_leitura;
+    bool incr_escrita;
+    bool anel_escrita;
+    uint bits_anel;
+    uint dreq;
+} dma_channel_config;
+
+typedef struct {
+    volatile uintptr_t read_addr;
+    volatile uintptr_t write_addr;
+    volatile uint32_t transfer_count;
+    volatile uint32_t ctrl_trig;
+} dma_channel_hw_t;
+
+typedef struct {
+    dma_channel_hw_t ch[NUM_DMA_CHANNELS];
+} dma_hw_t;
+
+extern dma_hw_t *dma_hw;
+
+int dma_claim_unused_channel(bool obrigatorio);
+dma_channel_config dma_channel_get_default_config(uint canal);
+void channel_config_set_transfer_data_size(dma_channel_config *c, enum dma_channel_transfer_size tamanho);
+void channel_config_set_read_increment(dma_channel_config *c, bool incr);
+void channel_config_set_write_increment(dma_channel_config *c, bool incr);
+void channel_config_set_ring(dma_channel_config *c, bool escrita, uint bits);
+void channel_config_set_dreq(dma_channel_config *c, uint dreq);
+void dma_channel_configure(uint canal, const dma_channel_config *c, volatile void *destino,
+                           const volatile void *origem, uint transferencias, bool iniciar);
+void dma_channel_set_trans_count(uint canal, uint32_t transferencias, bool iniciar);
+bool dma_channel_is_busy(uint canal);
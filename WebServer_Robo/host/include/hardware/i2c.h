@@ -0,0 +1,10 @@
+#pragma once
+#include "pico_host.h"
+
+typedef struct i2c_inst i2c_inst_t;
+extern i2c_inst_t *i2c0;
+extern i2c_inst_t *i2c1;
+
+uint i2c_init(i2c_inst_t *i2c, uint baudrate);
+int i2c_write_blocking(i2c_inst_t *i2c, uint8_t endereco, const uint8_t *dados, size_t len, bool sem_stop);
+int i2c_read_blocking(i2c_inst_t *i2c, uint8_t endereco, uint8_t *dados, size_t len, bool sem_stop);
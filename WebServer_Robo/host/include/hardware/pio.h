@@ -0,0 +1,20 @@
+#pragma once
+#include "pico_host.h"
+
+typedef struct pio_host *PIO;
+extern PIO pio0;
+extern PIO pio1;
+
+typedef struct {
+    const uint16_t *instructions;
+    uint8_t length;
+    int8_t origin;
+} pio_program_t;
+
+typedef struct {
+    uint32_t clkdiv;
+} pio_sm_config;
+
+uint pio_add_program(PIO pio, const pio_program_t *programa);
+int pio_claim_unused_sm(PIO pio, bool obrigatorio);
+void pio_sm_put_blocking(PIO pio, uint sm, uint32_t dado);
@@ -0,0 +1,17 @@
+#pragma once
+#include "pico_host.h"
+
+typedef struct {
+    float clkdiv;
+    uint16_t top;
+} pwm_config;
+
+uint pwm_gpio_to_slice_num(uint gpio);
+pwm_config pwm_get_default_config(void);
+void pwm_config_set_clkdiv(pwm_config *c, float div);
+void pwm_config_set_wrap(pwm_config *c, uint16_t wrap);
+void pwm_init(uint slice, pwm_config *c, bool iniciar);
+void pwm_set_clkdiv(uint slice, float div);
+void pwm_set_wrap(uint slice, uint16_t wrap);
+void pwm_set_gpio_level(uint gpio, uint16_t nivel);
+void pwm_set_enabled(uint slice, bool habilitar);
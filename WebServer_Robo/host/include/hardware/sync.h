@@ -0,0 +1,10 @@
+#pragma once
+#include "pico_host.h"
+
+static inline void __dmb(void) { __sync_synchronize(); }
+static inline void __dsb(void) { __sync_synchronize(); }
+void __sev(void);
+void __wfe(void);
+void __wfi(void);   // No host: executa um ciclo do laço de eventos (rede + workers)
+uint32_t save_and_disable_interrupts(void);
+void restore_interrupts(uint32_t estado);
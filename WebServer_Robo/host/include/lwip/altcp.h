@@ -0,0 +1,39 @@
+#pragma once
+/**
+ * Como no lwIP com LWIP_ALTCP == 0: a API altcp vira a API raw TCP
+ * (o build nativo não tem TLS).
+ */
+#include "lwip/tcp.h"
+
+#define altcp_accept_fn tcp_accept_fn
+#define altcp_recv_fn tcp_recv_fn
+#define altcp_sent_fn tcp_sent_fn
+#define altcp_poll_fn tcp_poll_fn
+#define altcp_err_fn tcp_err_fn
+#define altcp_connected_fn tcp_connected_fn
+#define altcp_pcb tcp_pcb
+#define altcp_tcp_new_ip_type tcp_new_ip_type
+#define altcp_tcp_new tcp_new
+#define altcp_new(allocator) tcp_new()
+#define altcp_new_ip_type(allocator, ip_type) tcp_new_ip_type(ip_type)
+#define altcp_arg tcp_arg
+#define altcp_accept tcp_accept
+#define altcp_recv tcp_recv
+#define altcp_sent tcp_sent
+#define altcp_poll tcp_poll
+#define altcp_err tcp_err
+#define altcp_recved tcp_recved
+#define altcp_bind tcp_bind
+#define altcp_listen_with_backlog tcp_listen_with_backlog
+#define altcp_listen tcp_listen
+#define altcp_connect tcp_connect
+#define altcp_abort tcp_abort
+#define altcp_close tcp_close
+#define altcp_shutdown tcp_shutdown
+#define altcp_write tcp_write
+#define altcp_output tcp_output
+#define altcp_sndbuf tcp_sndbuf
+#define altcp_sndqueuelen tcp_sndqueuelen
+#define altcp_nagle_disable tcp_nagle_disable
+#define altcp_setprio tcp_setprio
+#define altcp_get_ip(pcb, local) ((local) ? (&(pcb)->local_ip) : (&(pcb)->remote_ip))
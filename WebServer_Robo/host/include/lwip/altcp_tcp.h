@@ -0,0 +1,3 @@
+#pragma once
+// Sem LWIP_ALTCP, altcp_tcp_new_ip_type já é a macro de altcp.h
+#include "lwip/altcp.h"
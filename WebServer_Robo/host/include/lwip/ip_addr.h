@@ -0,0 +1,24 @@
+#pragma once
+#include "lwip/arch.h"
+
+// Só IPv4; addr em ordem de rede, como no lwIP
+typedef struct {
+    u32_t addr;
+} ip_addr_t;
+typedef ip_addr_t ip4_addr_t;
+
+extern const ip_addr_t ip_addr_any;
+#define IP_ADDR_ANY (&ip_addr_any)
+#define IP_ANY_TYPE (&ip_addr_any)
+#define IPADDR_TYPE_V4 0U
+#define IPADDR_TYPE_ANY 46U
+
+#define ip_addr_cmp(a, b) ((a)->addr == (b)->addr)
+#define ip_addr_copy(dest, src) ((dest).addr = (src).addr)
+#define ip_addr_set_zero(a) ((a)->addr = 0)
+#define ip4_addr_get_u32(a) ((a)->addr)
+#define ip_2_ip4(a) (a)
+
+char *ipaddr_ntoa(const ip_addr_t *addr);
+char *ip4addr_ntoa(const ip4_addr_t *addr);
+int ipaddr_aton(const char *texto, ip_addr_t *addr);
@@ -0,0 +1,10 @@
+#pragma once
+#include "lwip/opt.h"
+
+typedef enum {
+    MEMP_TCP_PCB,
+    MEMP_TCP_SEG,
+    MEMP_UDP_PCB,
+    MEMP_PBUF_POOL,
+    MEMP_MAX
+} memp_t;
@@ -0,0 +1,42 @@
+#pragma once
+#include "lwip/opt.h"
+#include "lwip/ip_addr.h"
+
+struct netif {
+    ip_addr_t ip_addr;
+    ip_addr_t netmask;
+    ip_addr_t gw;
+};
+
+extern struct netif *netif_default;
+extern struct netif *netif_list;
+
+#define netif_ip4_addr(n) (&(n)->ip_addr)
+
+// Callback estendido (LWIP_NETIF_EXT_STATUS_CALLBACK); os argumentos não são emulados
+typedef uint16_t netif_nsc_reason_t;
+#define LWIP_NSC_NONE                     0x0000
+#define LWIP_NSC_NETIF_ADDED              0x0001
+#define LWIP_NSC_NETIF_REMOVED            0x0002
+#define LWIP_NSC_LINK_CHANGED             0x0004
+#define LWIP_NSC_STATUS_CHANGED           0x0008
+#define LWIP_NSC_IPV4_ADDRESS_CHANGED     0x0010
+#define LWIP_NSC_IPV4_GATEWAY_CHANGED     0x0020
+#define LWIP_NSC_IPV4_NETMASK_CHANGED     0x0040
+#define LWIP_NSC_IPV4_SETTINGS_CHANGED    0x0080
+
+typedef union {
+    int nao_emulado;
+} netif_ext_callback_args_t;
+
+typedef void (*netif_ext_callback_fn)(struct netif *netif, netif_nsc_reason_t reason,
+                                      const netif_ext_callback_args_t *args);
+
+typedef struct netif_ext_callback {
+    netif_ext_callback_fn callback_fn;
+    struct netif_ext_callback *next;
+} netif_ext_callback_t;
+
+#define NETIF_DECLARE_EXT_CALLBACK(name) static netif_ext_callback_t name;
+
+void netif_add_ext_callback(netif_ext_callback_t *callback, netif_ext_callback_fn fn);
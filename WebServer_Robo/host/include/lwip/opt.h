@@ -0,0 +1,36 @@
+#pragma once
+/**
+ * Configuração do lwIP emulado: usa o lwipopts.h do firmware e os
+ * mesmos valores padrão do lwIP 2.1 para o que ele não define.
+ */
+#include "lwipopts.h"
+
+#ifndef TCP_MSS
+#define TCP_MSS 536
+#endif
+#ifndef TCP_WND
+#define TCP_WND (4 * TCP_MSS)
+#endif
+#ifndef TCP_SND_BUF
+#define TCP_SND_BUF (2 * TCP_MSS)
+#endif
+#ifndef TCP_SND_QUEUELEN
+#define TCP_SND_QUEUELEN ((4 * (TCP_SND_BUF) + (TCP_MSS - 1)) / (TCP_MSS))
+#endif
+#ifndef MEMP_NUM_TCP_PCB
+#define MEMP_NUM_TCP_PCB 5
+#endif
+#ifndef MEMP_NUM_UDP_PCB
+#define MEMP_NUM_UDP_PCB 4
+#endif
+#ifndef LWIP_STATS
+#define LWIP_STATS 0
+#endif
+#if !LWIP_STATS
+#undef MEM_STATS
+#undef MEMP_STATS
+#undef TCP_STATS
+#define MEM_STATS 0
+#define MEMP_STATS 0
+#define TCP_STATS 0
+#endif
@@ -0,0 +1,24 @@
+#pragma once
+#include "lwip/opt.h"
+#include "lwip/err.h"
+
+typedef enum { PBUF_TRANSPORT, PBUF_IP, PBUF_LINK, PBUF_RAW_TX, PBUF_RAW } pbuf_layer;
+typedef enum { PBUF_RAM, PBUF_ROM, PBUF_REF, PBUF_POOL } pbuf_type;
+
+// Sempre um único bloco contíguo no host (next == NULL)
+struct pbuf {
+    struct pbuf *next;
+    void *payload;
+    u16_t tot_len;
+    u16_t len;
+    u8_t type_internal;
+    u8_t flags;
+    u16_t ref;
+};
+
+struct pbuf *pbuf_alloc(pbuf_layer camada, u16_t len, pbuf_type tipo);
+u8_t pbuf_free(struct pbuf *p);
+void pbuf_ref(struct pbuf *p);
+u16_t pbuf_copy_partial(const struct pbuf *p, void *destino, u16_t len, u16_t deslocamento);
+err_t pbuf_take(struct pbuf *p, const void *dados, u16_t len);
+u8_t pbuf_get_at(const struct pbuf *p, u16_t deslocamento);
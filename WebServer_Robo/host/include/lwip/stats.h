@@ -0,0 +1,38 @@
+#pragma once
+#include "lwip/opt.h"
+#include "lwip/memp.h"
+
+/**
+ * Estatísticas aproximadas: o host conta PCBs, escritas pendentes e
+ * pbufs de recepção vivos, não a memória real de uma pilha lwIP.
+ */
+struct stats_mem {
+    u32_t err;
+    u32_t avail;
+    u32_t used;
+    u32_t max;
+    u32_t illegal;
+};
+
+struct stats_proto {
+    u32_t xmit;
+    u32_t recv;
+    u32_t fw;
+    u32_t drop;
+    u32_t chkerr;
+    u32_t lenerr;
+    u32_t memerr;
+    u32_t rterr;
+    u32_t proterr;
+    u32_t opterr;
+    u32_t err;
+    u32_t cachehit;
+};
+
+struct stats_ {
+    struct stats_proto tcp;
+    struct stats_mem mem;
+    struct stats_mem *memp[MEMP_MAX];
+};
+
+extern struct stats_ lwip_stats;
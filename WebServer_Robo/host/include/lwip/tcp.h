@@ -0,0 +1,93 @@
+#pragma once
+#include "lwip/opt.h"
+#include "lwip/err.h"
+#include "lwip/ip_addr.h"
+#include "lwip/pbuf.h"
+
+/**
+ * API raw TCP do lwIP emulada sobre sockets do Linux (lwip_host.c).
+ * Mesmas regras do lwIP: callbacks só na thread do laço de eventos,
+ * ERR_ABRT obrigatório depois de tcp_abort dentro de um callback,
+ * tcp_write limitado por tcp_sndbuf e janela de recepção reaberta
+ * com tcp_recved.
+ */
+struct tcp_pcb;
+
+typedef err_t (*tcp_accept_fn)(void *arg, struct tcp_pcb *novo, err_t err);
+typedef err_t (*tcp_recv_fn)(void *arg, struct tcp_pcb *pcb, struct pbuf *p, err_t err);
+typedef err_t (*tcp_sent_fn)(void *arg, struct tcp_pcb *pcb, u16_t len);
+typedef err_t (*tcp_poll_fn)(void *arg, struct tcp_pcb *pcb);
+typedef void (*tcp_err_fn)(void *arg, err_t err);
+typedef err_t (*tcp_connected_fn)(void *arg, struct tcp_pcb *pcb, err_t err);
+
+enum tcp_state { CLOSED = 0, LISTEN, SYN_SENT, SYN_RCVD, ESTABLISHED, FIN_WAIT_1, FIN_WAIT_2,
+                 CLOSE_WAIT, CLOSING, LAST_ACK, TIME_WAIT };
+
+struct tcp_pcb {
+    // Campos que a aplicação pode ler (mesmos nomes do lwIP)
+    enum tcp_state state;
+    ip_addr_t local_ip;
+    ip_addr_t remote_ip;
+    u16_t local_port;
+    u16_t remote_port;
+    u8_t prio;
+    u16_t snd_buf;                  // Espaço livre em tx
+    u16_t snd_queuelen;             // Escritas ainda não confirmadas
+    u16_t rcv_wnd;                  // Janela de recepção disponível
+
+    // Emulação
+    int fd;
+    void *callback_arg;
+    tcp_accept_fn accept;
+    tcp_recv_fn recv;
+    tcp_sent_fn sent;
+    tcp_poll_fn poll;
+    tcp_err_fn errf;
+    tcp_connected_fn connected;
+    u8_t pollinterval;
+    uint64_t prox_poll_us;
+    u8_t tx[TCP_SND_BUF];
+    u16_t tx_len;
+    u32_t confirmados;              // Bytes aceitos pelo kernel ainda não informados em tcp_sent
+    struct pbuf *refused_data;      // Recusado pela aplicação (ERR_MEM), reentregue depois
+    uint64_t prox_reentrega_us;     // Próxima reentrega de refused_data (tcp_fasttmr)
+    bool fin_recebido;
+    bool fin_entregue;
+    bool fechando;                  // tcp_close com dados pendentes
+    bool fechar_envio;              // tcp_shutdown(tx) com dados pendentes
+    uint64_t ultimo_us;             // Última atividade (pcb->tmr do lwIP, usado por tcp_kill_prio)
+    bool morto;                     // Liberado no fim do ciclo
+    err_t erro_pendente;            // Erro do socket a informar fora do callback atual
+    struct tcp_pcb *prox;
+};
+
+#define TCP_WRITE_FLAG_COPY 0x01
+#define TCP_WRITE_FLAG_MORE 0x02
+
+#define TCP_PRIO_MIN 1
+#define TCP_PRIO_NORMAL 64
+#define TCP_PRIO_MAX 127
+
+#define tcp_sndbuf(pcb) ((pcb)->snd_buf)
+#define tcp_sndqueuelen(pcb) ((pcb)->snd_queuelen)
+#define tcp_listen(pcb) tcp_listen_with_backlog(pcb, 16)
+
+struct tcp_pcb *tcp_new(void);
+struct tcp_pcb *tcp_new_ip_type(u8_t tipo);
+err_t tcp_bind(struct tcp_pcb *pcb, const ip_addr_t *ip, u16_t porta);
+struct tcp_pcb *tcp_listen_with_backlog(struct tcp_pcb *pcb, u8_t backlog);
+err_t tcp_connect(struct tcp_pcb *pcb, const ip_addr_t *ip, u16_t porta, tcp_connected_fn connected);
+void tcp_arg(struct tcp_pcb *pcb, void *arg);
+void tcp_accept(struct tcp_pcb *pcb, tcp_accept_fn accept);
+void tcp_recv(struct tcp_pcb *pcb, tcp_recv_fn recv);
+void tcp_sent(struct tcp_pcb *pcb, tcp_sent_fn sent);
+void tcp_poll(struct tcp_pcb *pcb, tcp_poll_fn poll, u8_t intervalo);
+void tcp_err(struct tcp_pcb *pcb, tcp_err_fn err);
+err_t tcp_write(struct tcp_pcb *pcb, const void *dados, u16_t len, u8_t flags);
+err_t tcp_output(struct tcp_pcb *pcb);
+void tcp_recved(struct tcp_pcb *pcb, u16_t len);
+err_t tcp_close(struct tcp_pcb *pcb);
+err_t tcp_shutdown(struct tcp_pcb *pcb, int shut_rx, int shut_tx);
+void tcp_abort(struct tcp_pcb *pcb);
+void tcp_setprio(struct tcp_pcb *pcb, u8_t prio);
+void tcp_nagle_disable(struct tcp_pcb *pcb);
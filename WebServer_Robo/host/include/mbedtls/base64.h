@@ -0,0 +1,7 @@
+#pragma once
+#include <stddef.h>
+
+#define MBEDTLS_ERR_BASE64_BUFFER_TOO_SMALL -0x002A
+
+int mbedtls_base64_encode(unsigned char *destino, size_t tamanho, size_t *escritos,
+                          const unsigned char *origem, size_t len);
@@ -0,0 +1,5 @@
+#pragma once
+#include <stddef.h>
+#include "mbedtls/version.h"
+
+int mbedtls_sha1_ret(const unsigned char *entrada, size_t len, unsigned char saida[20]);
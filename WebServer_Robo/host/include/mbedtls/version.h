@@ -0,0 +1,3 @@
+#pragma once
+// Implementação mínima no host (mbedtls_host.c) com a API do Mbed TLS 2.28
+#define MBEDTLS_VERSION_NUMBER 0x021C0000
@@ -0,0 +1,27 @@
+#pragma once
+#include "pico_host.h"
+
+typedef struct async_context async_context_t;
+
+typedef struct async_work_on_timeout {
+    struct async_work_on_timeout *next;
+    void (*do_work)(async_context_t *contexto, struct async_work_on_timeout *worker);
+    absolute_time_t next_time;
+    void *user_data;
+} async_at_time_worker_t;
+
+typedef struct async_when_pending_worker {
+    struct async_when_pending_worker *next;
+    void (*do_work)(async_context_t *contexto, struct async_when_pending_worker *worker);
+    volatile bool work_pending;
+    void *user_data;
+} async_when_pending_worker_t;
+
+bool async_context_add_at_time_worker_at(async_context_t *contexto, async_at_time_worker_t *worker, absolute_time_t t);
+bool async_context_add_at_time_worker_in_ms(async_context_t *contexto, async_at_time_worker_t *worker, uint32_t ms);
+bool async_context_remove_at_time_worker(async_context_t *contexto, async_at_time_worker_t *worker);
+bool async_context_add_when_pending_worker(async_context_t *contexto, async_when_pending_worker_t *worker);
+bool async_context_remove_when_pending_worker(async_context_t *contexto, async_when_pending_worker_t *worker);
+void async_context_set_work_pending(async_context_t *contexto, async_when_pending_worker_t *worker);
+void async_context_acquire_lock_blocking(async_context_t *contexto);
+void async_context_release_lock(async_context_t *contexto);
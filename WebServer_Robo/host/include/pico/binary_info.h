@@ -0,0 +1,6 @@
+#pragma once
+#include "pico_host.h"
+
+#define bi_decl(...)
+#define bi_2pins_with_func(...)
+#define bi_program_description(...)
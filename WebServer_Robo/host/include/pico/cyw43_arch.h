@@ -0,0 +1,41 @@
+#pragma once
+#include "pico_host.h"
+#include "pico/async_context.h"
+
+/**
+ * Sem rádio: a "conexão Wi-Fi" sempre funciona e a rede é a interface
+ * de loopback do Linux (ver lwip_host.c). O contexto assíncrono roda
+ * na thread principal, dentro de __wfi().
+ */
+#define CYW43_WL_GPIO_LED_PIN 0
+#define CYW43_PIN_WL_HOST_WAKE 24
+#define CYW43_AUTH_OPEN 0
+#define CYW43_AUTH_WPA2_AES_PSK 0x00400004
+#define CYW43_LINK_DOWN 0
+#define CYW43_LINK_JOIN 1
+#define CYW43_LINK_NOIP 2
+#define CYW43_LINK_UP 3
+#define CYW43_LINK_FAIL (-1)
+#define CYW43_LINK_NONET (-2)
+#define CYW43_LINK_BADAUTH (-3)
+#define CYW43_ITF_STA 0
+
+typedef struct cyw43_t {
+    int itf_state;
+} cyw43_t;
+
+extern cyw43_t cyw43_state;
+
+int cyw43_arch_init(void);
+void cyw43_arch_deinit(void);
+void cyw43_arch_enable_sta_mode(void);
+int cyw43_arch_wifi_connect_timeout_ms(const char *ssid, const char *senha, uint32_t auth, uint32_t timeout_ms);
+int cyw43_arch_wifi_connect_async(const char *ssid, const char *senha, uint32_t auth);
+void cyw43_arch_gpio_put(uint pino, bool valor);
+int cyw43_tcpip_link_status(cyw43_t *self, int itf);
+int cyw43_wifi_leave(cyw43_t *self, int itf);
+async_context_t *cyw43_arch_async_context(void);
+
+// Só a thread principal usa o lwIP no host
+static inline void cyw43_arch_lwip_begin(void) {}
+static inline void cyw43_arch_lwip_end(void) {}
@@ -0,0 +1,11 @@
+#pragma once
+#include "pico_host.h"
+
+// O núcleo 1 é uma thread; o FIFO entre núcleos tem 8 posições, como no RP2040
+void multicore_launch_core1(void (*entrada)(void));
+bool multicore_fifo_wready(void);
+bool multicore_fifo_rvalid(void);
+void multicore_fifo_push_blocking(uint32_t dado);
+uint32_t multicore_fifo_pop_blocking(void);
+void multicore_fifo_drain(void);
+void multicore_fifo_clear_irq(void);
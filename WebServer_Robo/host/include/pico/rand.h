@@ -0,0 +1,4 @@
+#pragma once
+#include "pico_host.h"
+
+uint32_t get_rand_32(void);
@@ -0,0 +1,80 @@
+#ifndef PICO_HOST_H
+#define PICO_HOST_H
+
+/***************************************************************
+ * SUBCONJUNTO DO PICO SDK PARA O BUILD NATIVO (LINUX)
+ *
+ * Só o que o firmware usa, com a mesma assinatura do SDK 1.5.1.
+ * Os periféricos não existem: as funções guardam a configuração
+ * e, quando faz sentido, simulam o tempo gasto (I2C, PIO).
+ **************************************************************/
+#include <assert.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+typedef unsigned int uint;
+typedef uint64_t absolute_time_t;
+
+#define __unused __attribute__((unused))
+#define count_of(a) (sizeof(a) / sizeof((a)[0]))
+#define _u(x) x##u
+
+// Tempo (relógio monotônico do Linux)
+uint64_t time_us_64(void);
+uint32_t time_us_32(void);
+absolute_time_t get_absolute_time(void);
+absolute_time_t make_timeout_time_ms(uint32_t ms);
+absolute_time_t make_timeout_time_us(uint64_t us);
+bool time_reached(absolute_time_t t);
+int64_t absolute_time_diff_us(absolute_time_t de, absolute_time_t ate);
+uint32_t to_ms_since_boot(absolute_time_t t);
+void sleep_ms(uint32_t ms);
+void sleep_us(uint64_t us);
+bool best_effort_wfe_or_timeout(absolute_time_t t);
+
+bool stdio_init_all(void);
+static inline void tight_loop_contents(void) {}
+
+// GPIO
+#define GPIO_OUT 1
+#define GPIO_IN 0
+
+enum gpio_function {
+    GPIO_FUNC_SPI = 1,
+    GPIO_FUNC_UART = 2,
+    GPIO_FUNC_I2C = 3,
+    GPIO_FUNC_PWM = 4,
+    GPIO_FUNC_SIO = 5,
+    GPIO_FUNC_PIO0 = 6,
+};
+
+#define GPIO_IRQ_LEVEL_LOW 0x1u
+#define GPIO_IRQ_LEVEL_HIGH 0x2u
+#define GPIO_IRQ_EDGE_FALL 0x4u
+#define GPIO_IRQ_EDGE_RISE 0x8u
+#define PICO_SHARED_IRQ_HANDLER_HIGHEST_ORDER_PRIORITY 0xff
+#define PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY 0x80
+
+typedef void (*irq_handler_t)(void);
+typedef void (*gpio_irq_callback_t)(uint gpio, uint32_t event_mask);
+
+void gpio_init(uint gpio);
+void gpio_set_dir(uint gpio, bool out);
+void gpio_put(uint gpio, bool valor);
+bool gpio_get(uint gpio);
+void gpio_set_function(uint gpio, enum gpio_function fn);
+void gpio_pull_up(uint gpio);
+void gpio_set_irq_enabled_with_callback(uint gpio, uint32_t eventos, bool habilitar, gpio_irq_callback_t cb);
+void gpio_set_irq_enabled(uint gpio, uint32_t eventos, bool habilitar);
+uint32_t gpio_get_irq_event_mask(uint gpio);
+void gpio_acknowledge_irq(uint gpio, uint32_t eventos);
+void gpio_add_raw_irq_handler_with_order_priority(uint gpio, irq_handler_t handler, uint8_t prioridade);
+
+// Interrupções
+enum { SIO_IRQ_PROC0 = 15, SIO_IRQ_PROC1 = 16, IO_IRQ_BANK0 = 13 };
+void irq_set_exclusive_handler(uint num, irq_handler_t handler);
+void irq_set_enabled(uint num, bool habilitar);
+
+#endif
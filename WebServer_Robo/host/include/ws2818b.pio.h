@@ -0,0 +1,15 @@
+#pragma once
+// Substitui o cabeçalho gerado pelo pioasm no build do firmware
+#include "hardware/pio.h"
+
+static const uint16_t ws2818b_program_instructions[] = { 0 };
+
+static const pio_program_t ws2818b_program = {
+    .instructions = ws2818b_program_instructions,
+    .length = 1,
+    .origin = -1,
+};
+
+static inline void ws2818b_program_init(PIO pio, uint sm, uint offset, uint pino, float freq) {
+    (void)pio; (void)sm; (void)offset; (void)pino; (void)freq;
+}
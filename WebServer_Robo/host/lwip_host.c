@@ -0,0 +1,875 @@
+/**
+ * API raw do lwIP (TCP/UDP) emulada sobre sockets não bloqueantes do Linux
+ *
+ * Preserva o que importa para o código do servidor: callbacks só na
+ * thread do laço, janela de envio de TCP_SND_BUF (tcp_write devolve
+ * ERR_MEM), janela de recepção reaberta por tcp_recved, pbuf recusado
+ * (ERR_MEM) reentregue depois, tcp_poll a cada intervalo*500 ms e no
+ * máximo MEMP_NUM_TCP_PCB conexões (as excedentes esperam no backlog
+ * do kernel, como um SYN ignorado pelo lwIP sem PCB livre). Com o pool
+ * cheio, uma conexão de prioridade menor que a do PCB de escuta é
+ * abortada para dar lugar à nova, como o tcp_kill_prio do lwIP.
+ *
+ * tcp_sent é chamado quando o kernel aceita os bytes; no loopback isso
+ * equivale ao ACK. As portas recebem um deslocamento (ROBO_HOST_PORTA_OFFSET,
+ * padrão 8000) para não exigir root: HTTP 80 -> 8080, UDP 5005 -> 13005.
+ * Conexões de saída (tcp_connect) vão à porta real: o broker MQTT local
+ * escuta na 1883.
+ */
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#undef TCP_MSS  // Opção de socket em netinet/tcp.h; aqui vale o valor do lwipopts.h
+
+#include "pico/stdlib.h"
+#include "lwip/tcp.h"
+#include "lwip/udp.h"
+#include "lwip/netif.h"
+#include "lwip/stats.h"
+#include "host_laco.h"
+
+#define EVENTOS_MAX 32
+#define TCP_TMR_US 250000  // tcp_fasttmr: reentrega de dados recusados
+#define OBSERVADOS_MAX 4
+
+/***************************************************************
+ * ESTADO GLOBAL
+ **************************************************************/
+const ip_addr_t ip_addr_any = { 0 };
+
+static struct netif netif_host;
+struct netif *netif_default = NULL;
+struct netif *netif_list = NULL;
+
+struct stats_ lwip_stats;
+static struct stats_mem memp_stats[MEMP_MAX];
+
+struct udp_pcb {
+    int fd;
+    u16_t porta;
+    udp_recv_fn recv;
+    void *arg;
+};
+
+// Tipos de descritor no epoll
+typedef enum { FD_TCP, FD_UDP, FD_EXTRA } tipo_fd_t;
+
+typedef struct {
+    tipo_fd_t tipo;
+    void *obj;
+    host_evento_fn fn;
+} registro_fd_t;
+
+static int epfd = -1;
+static struct tcp_pcb *pcbs = NULL;         // Todos os PCBs TCP (inclusive o de escuta)
+static int conexoes_ativas = 0;
+static registro_fd_t observados[OBSERVADOS_MAX];
+static int n_observados = 0;
+
+/***************************************************************
+ * FUNÇÕES INTERNAS
+ **************************************************************/
+static void iniciar(void) {
+    if (epfd >= 0) {
+        return;
+    }
+    epfd = epoll_create1(EPOLL_CLOEXEC);
+    for (int i = 0; i < MEMP_MAX; i++) {
+        lwip_stats.memp[i] = &memp_stats[i];
+    }
+    memp_stats[MEMP_TCP_PCB].avail = MEMP_NUM_TCP_PCB;
+    memp_stats[MEMP_UDP_PCB].avail = MEMP_NUM_UDP_PCB;
+#ifdef MEMP_NUM_TCP_SEG
+    memp_stats[MEMP_TCP_SEG].avail = MEMP_NUM_TCP_SEG;
+#endif
+#ifdef PBUF_POOL_SIZE
+    memp_stats[MEMP_PBUF_POOL].avail = PBUF_POOL_SIZE;
+#endif
+#ifdef MEM_SIZE
+    lwip_stats.mem.avail = MEM_SIZE;
+#endif
+
+    netif_host.ip_addr.addr = htonl(INADDR_LOOPBACK);
+    netif_host.netmask.addr = htonl(0xff000000u);
+    netif_default = netif_list = &netif_host;
+}
+
+static void contar(struct stats_mem *m, int delta) {
+    m->used += delta;
+    if (m->used > m->max) {
+        m->max = m->used;
+    }
+}
+
+static u16_t porta_host(u16_t porta) {
+    const char *offset = getenv("ROBO_HOST_PORTA_OFFSET");
+    return (u16_t)(porta + (offset ? atoi(offset) : 8000));
+}
+
+static in_addr_t endereco_host(const ip_addr_t *ip) {
+    const char *env = getenv("ROBO_HOST_ENDERECO");
+    if (env) {
+        return inet_addr(env);
+    }
+    return ip && ip->addr ? ip->addr : htonl(INADDR_LOOPBACK);
+}
+
+static void nao_bloqueante(int fd) {
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+}
+
+/**
+ * Conexão que o lwIP abortaria para alocar um PCB de prioridade prio
+ * (tcp_kill_prio): a de menor prioridade abaixo de prio e, entre essas,
+ * a mais inativa
+ */
+static struct tcp_pcb *tcp_vitima(u8_t prio) {
+    struct tcp_pcb *vitima = NULL;
+    for (struct tcp_pcb *p = pcbs; p; p = p->prox) {
+        if (p->morto || p->state == LISTEN || p->prio >= prio) {
+            continue;
+        }
+        if (!vitima || p->prio < vitima->prio ||
+            (p->prio == vitima->prio && p->ultimo_us < vitima->ultimo_us)) {
+            vitima = p;
+        }
+    }
+    return vitima;
+}
+
+/**
+ * Atualiza o interesse do PCB no epoll conforme o estado
+ */
+static void tcp_interesse(struct tcp_pcb *pcb) {
+    if (pcb->fd < 0) {
+        return;
+    }
+    struct epoll_event ev = { .data.ptr = pcb };
+    if (pcb->state == LISTEN) {
+        if (conexoes_ativas < MEMP_NUM_TCP_PCB || tcp_vitima(pcb->prio)) {
+            ev.events = EPOLLIN;  // Sem PCB livre o SYN fica no backlog do kernel
+        }
+    } else if (pcb->state == SYN_SENT) {
+        ev.events = EPOLLOUT;     // connect não bloqueante: gravável quando termina
+    } else {
+        if (!pcb->fin_recebido && !pcb->refused_data && pcb->rcv_wnd > 0) {
+            ev.events |= EPOLLIN;
+        }
+        if (pcb->tx_len > 0) {
+            ev.events |= EPOLLOUT;
+        }
+    }
+    epoll_ctl(epfd, EPOLL_CTL_MOD, pcb->fd, &ev);
+}
+
+static void tcp_interesse_escuta(void) {
+    for (struct tcp_pcb *p = pcbs; p; p = p->prox) {
+        if (p->state == LISTEN && !p->morto) {
+            tcp_interesse(p);
+        }
+    }
+}
+
+/**
+ * Encerra o socket e marca o PCB para liberação no fim do ciclo
+ */
+static void tcp_descartar(struct tcp_pcb *pcb, bool reset) {
+    if (pcb->morto) {
+        return;
+    }
+    if (pcb->fd >= 0) {
+        if (reset) {
+            struct linger l = { .l_onoff = 1, .l_linger = 0 };
+            setsockopt(pcb->fd, SOL_SOCKET, SO_LINGER, &l, sizeof(l));
+        }
+        epoll_ctl(epfd, EPOLL_CTL_DEL, pcb->fd, NULL);
+        close(pcb->fd);
+        pcb->fd = -1;
+    }
+    if (pcb->state != LISTEN && pcb->state != CLOSED) {
+        conexoes_ativas--;
+        contar(&memp_stats[MEMP_TCP_PCB], -1);
+        contar(&memp_stats[MEMP_TCP_SEG], -(int)pcb->snd_queuelen);
+        lwip_stats.mem.used -= pcb->tx_len;
+        tcp_interesse_escuta();
+    }
+    if (pcb->refused_data) {
+        pbuf_free(pcb->refused_data);
+        pcb->refused_data = NULL;
+    }
+    pcb->state = CLOSED;
+    pcb->morto = true;
+}
+
+/**
+ * Envia ao kernel o que estiver em tx (sem chamar callbacks)
+ */
+static void tcp_descarregar(struct tcp_pcb *pcb) {
+    while (pcb->tx_len > 0 && pcb->fd >= 0) {
+        ssize_t n = send(pcb->fd, pcb->tx, pcb->tx_len, MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (n < 0) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR && !pcb->erro_pendente) {
+                pcb->erro_pendente = ERR_RST;
+            }
+            break;
+        }
+        memmove(pcb->tx, pcb->tx + n, pcb->tx_len - n);
+        pcb->tx_len -= n;
+        pcb->snd_buf += n;
+        pcb->confirmados += n;
+        pcb->ultimo_us = time_us_64();
+        lwip_stats.mem.used -= n;
+        lwip_stats.tcp.xmit++;
+    }
+    if (pcb->tx_len == 0) {
+        contar(&memp_stats[MEMP_TCP_SEG], -(int)pcb->snd_queuelen);
+        pcb->snd_queuelen = 0;
+        if (pcb->fechar_envio) {
+            shutdown(pcb->fd, SHUT_WR);
+            pcb->fechar_envio = false;
+        }
+        if (pcb->fechando) {
+            shutdown(pcb->fd, SHUT_WR);
+            tcp_descartar(pcb, false);
+            return;
+        }
+    }
+    tcp_interesse(pcb);
+}
+
+static void tcp_aceitar(struct tcp_pcb *escuta) {
+    if (conexoes_ativas >= MEMP_NUM_TCP_PCB) {
+        struct tcp_pcb *vitima = tcp_vitima(escuta->prio);
+        if (!vitima) {
+            tcp_interesse(escuta);
+            return;
+        }
+        tcp_abort(vitima);
+    }
+
+    struct sockaddr_in origem;
+    socklen_t tam = sizeof(origem);
+    int fd = accept4(escuta->fd, (struct sockaddr *)&origem, &tam, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (fd < 0) {
+        return;
+    }
+
+    int buf = TCP_SND_BUF;
+    setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &buf, sizeof(buf));
+
+    struct tcp_pcb *pcb = tcp_new();
+    pcb->fd = fd;
+    pcb->state = ESTABLISHED;
+    pcb->local_ip = escuta->local_ip;
+    pcb->local_port = escuta->local_port;
+    pcb->remote_ip.addr = origem.sin_addr.s_addr;
+    pcb->remote_port = ntohs(origem.sin_port);
+    pcb->callback_arg = escuta->callback_arg;
+    pcb->prio = escuta->prio;
+    pcb->ultimo_us = time_us_64();
+    conexoes_ativas++;
+    contar(&memp_stats[MEMP_TCP_PCB], 1);
+
+    struct epoll_event ev = { .events = EPOLLIN, .data.ptr = pcb };
+    epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev);
+    tcp_interesse_escuta();
+
+    err_t ret = escuta->accept ? escuta->accept(escuta->callback_arg, pcb, ERR_OK) : ERR_VAL;
+    if (ret != ERR_OK && ret != ERR_ABRT) {
+        tcp_abort(pcb);
+    }
+}
+
+/**
+ * O connect não bloqueante terminou: conexão estabelecida ou erro
+ * (informado em tcp_err, como a falha do SYN no lwIP)
+ */
+static void tcp_conectado(struct tcp_pcb *pcb) {
+    int erro = 0;
+    socklen_t tam = sizeof(erro);
+    getsockopt(pcb->fd, SOL_SOCKET, SO_ERROR, &erro, &tam);
+    if (erro) {
+        pcb->erro_pendente = ERR_RST;
+        return;
+    }
+    struct sockaddr_in local;
+    tam = sizeof(local);
+    getsockname(pcb->fd, (struct sockaddr *)&local, &tam);
+    pcb->local_ip.addr = local.sin_addr.s_addr;
+    pcb->local_port = ntohs(local.sin_port);
+    pcb->state = ESTABLISHED;
+    pcb->ultimo_us = time_us_64();
+    tcp_interesse(pcb);
+    if (pcb->connected && pcb->connected(pcb->callback_arg, pcb, ERR_OK) != ERR_OK && !pcb->morto) {
+        tcp_abort(pcb);
+    }
+}
+
+/**
+ * Entrega dados (ou o FIN, com p == NULL) ao callback de recepção
+ * @return false se o PCB deixou de existir
+ */
+static bool tcp_entregar(struct tcp_pcb *pcb, struct pbuf *p) {
+    err_t ret;
+    if (pcb->recv) {
+        ret = pcb->recv(pcb->callback_arg, pcb, p, ERR_OK);
+    } else if (p) {
+        tcp_recved(pcb, p->tot_len);  // Igual ao tcp_recv_null do lwIP
+        pbuf_free(p);
+        ret = ERR_OK;
+    } else {
+        ret = tcp_close(pcb);
+    }
+
+    if (ret == ERR_ABRT || pcb->morto) {
+        return false;
+    }
+    if (ret == ERR_MEM && p) {
+        pcb->refused_data = p;  // A aplicação está ocupada: tenta de novo no tcp_fasttmr
+        pcb->prox_reentrega_us = time_us_64() + TCP_TMR_US;
+    } else if (!p) {
+        pcb->fin_entregue = true;
+    }
+    tcp_interesse(pcb);
+    return true;
+}
+
+static void tcp_ler(struct tcp_pcb *pcb) {
+    u16_t max = pcb->rcv_wnd < TCP_MSS ? pcb->rcv_wnd : TCP_MSS;
+    if (max == 0 || pcb->refused_data) {
+        return;
+    }
+    struct pbuf *p = pbuf_alloc(PBUF_RAW, max, PBUF_POOL);
+    ssize_t n = recv(pcb->fd, p->payload, max, MSG_DONTWAIT);
+    if (n < 0) {
+        pbuf_free(p);
+        if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+            pcb->erro_pendente = ERR_RST;
+        }
+        return;
+    }
+    if (n == 0) {
+        pbuf_free(p);
+        pcb->fin_recebido = true;
+        tcp_interesse(pcb);
+        tcp_entregar(pcb, NULL);
+        return;
+    }
+    p->len = p->tot_len = (u16_t)n;
+    pcb->rcv_wnd -= n;
+    pcb->ultimo_us = time_us_64();
+    lwip_stats.tcp.recv++;
+    tcp_entregar(pcb, p);
+}
+
+/**
+ * Erros do socket, confirmações, pbufs recusados e tcp_poll
+ */
+static void tcp_manutencao(struct tcp_pcb *pcb) {
+    if (pcb->morto || pcb->state == LISTEN) {
+        return;
+    }
+    if (pcb->erro_pendente) {
+        tcp_err_fn errf = pcb->errf;
+        void *arg = pcb->callback_arg;
+        err_t err = pcb->erro_pendente;
+        tcp_descartar(pcb, true);
+        if (errf) {
+            errf(arg, err);
+        }
+        return;
+    }
+    if (pcb->confirmados > 0) {
+        u32_t n = pcb->confirmados;
+        pcb->confirmados = 0;
+        while (n > 0 && !pcb->morto) {
+            u16_t parte = n > 0xffff ? 0xffff : (u16_t)n;
+            n -= parte;
+            if (pcb->sent && pcb->sent(pcb->callback_arg, pcb, parte) == ERR_ABRT) {
+                return;
+            }
+        }
+        if (pcb->morto) {
+            return;
+        }
+    }
+    if (pcb->refused_data && time_us_64() >= pcb->prox_reentrega_us) {
+        struct pbuf *p = pcb->refused_data;
+        pcb->refused_data = NULL;
+        if (!tcp_entregar(pcb, p)) {
+            return;
+        }
+    }
+    if (pcb->poll && time_us_64() >= pcb->prox_poll_us) {
+        pcb->prox_poll_us = time_us_64() + pcb->pollinterval * 500000ull;
+        pcb->poll(pcb->callback_arg, pcb);
+    }
+}
+
+static int tcp_proximo_ms(void) {
+    int64_t menor = -1;
+    uint64_t agora = time_us_64();
+    for (struct tcp_pcb *p = pcbs; p; p = p->prox) {
+        if (p->morto || p->state == LISTEN) {
+            continue;
+        }
+        if (p->confirmados || p->erro_pendente) {
+            return 0;
+        }
+        uint64_t prazos[2] = { p->poll ? p->prox_poll_us : 0, p->refused_data ? p->prox_reentrega_us : 0 };
+        for (int i = 0; i < 2; i++) {
+            if (prazos[i]) {
+                int64_t falta = prazos[i] > agora ? (int64_t)(prazos[i] - agora) : 0;
+                if (menor < 0 || falta < menor) {
+                    menor = falta;
+                }
+            }
+        }
+    }
+    return menor < 0 ? -1 : (int)((menor + 999) / 1000);
+}
+
+static void liberar_mortos(void) {
+    for (struct tcp_pcb **p = &pcbs; *p;) {
+        if ((*p)->morto) {
+            struct tcp_pcb *m = *p;
+            *p = m->prox;
+            free(m);
+        } else {
+            p = &(*p)->prox;
+        }
+    }
+}
+
+static void udp_ler(struct udp_pcb *pcb) {
+    uint8_t buf[1500];
+    struct sockaddr_in origem;
+    socklen_t tam = sizeof(origem);
+    ssize_t n = recvfrom(pcb->fd, buf, sizeof(buf), MSG_DONTWAIT, (struct sockaddr *)&origem, &tam);
+    if (n < 0) {
+        return;
+    }
+    if (!pcb->recv) {
+        return;
+    }
+    struct pbuf *p = pbuf_alloc(PBUF_TRANSPORT, (u16_t)n, PBUF_POOL);
+    memcpy(p->payload, buf, n);
+    ip_addr_t ip = { .addr = origem.sin_addr.s_addr };
+    pcb->recv(pcb->arg, pcb, p, &ip, ntohs(origem.sin_port));
+}
+
+/***************************************************************
+ * LAÇO DE EVENTOS
+ **************************************************************/
+void host_laco_observar(int fd, host_evento_fn fn, void *arg) {
+    iniciar();
+    registro_fd_t *r = &observados[n_observados++];
+    r->tipo = FD_EXTRA;
+    r->obj = arg;
+    r->fn = fn;
+    struct epoll_event ev = { .events = EPOLLIN, .data.ptr = r };
+    epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev);
+}
+
+static bool eh_observado(void *ptr) {
+    return ptr >= (void *)observados && ptr < (void *)(observados + OBSERVADOS_MAX);
+}
+
+// UDP usa o endereço do próprio pcb como tag; TCP, o tcp_pcb
+static struct udp_pcb *udp_pcbs[MEMP_NUM_UDP_PCB];
+
+static struct udp_pcb *eh_udp(void *ptr) {
+    for (int i = 0; i < MEMP_NUM_UDP_PCB; i++) {
+        if (udp_pcbs[i] && (void *)udp_pcbs[i] == ptr) {
+            return udp_pcbs[i];
+        }
+    }
+    return NULL;
+}
+
+void host_lwip_processar(int timeout_ms) {
+    iniciar();
+    int t_tcp = tcp_proximo_ms();
+    if (t_tcp >= 0 && (timeout_ms < 0 || t_tcp < timeout_ms)) {
+        timeout_ms = t_tcp;
+    }
+
+    struct epoll_event eventos[EVENTOS_MAX];
+    int n = epoll_wait(epfd, eventos, EVENTOS_MAX, timeout_ms);
+    for (int i = 0; i < n; i++) {
+        void *ptr = eventos[i].data.ptr;
+        if (eh_observado(ptr)) {
+            registro_fd_t *r = ptr;
+            r->fn(r->obj);
+            continue;
+        }
+        struct udp_pcb *udp = eh_udp(ptr);
+        if (udp) {
+            udp_ler(udp);
+            continue;
+        }
+        struct tcp_pcb *pcb = ptr;
+        if (pcb->morto) {
+            continue;
+        }
+        if (pcb->state == LISTEN) {
+            tcp_aceitar(pcb);
+            continue;
+        }
+        if (pcb->state == SYN_SENT) {
+            tcp_conectado(pcb);
+            continue;
+        }
+        if (eventos[i].events & EPOLLOUT) {
+            tcp_descarregar(pcb);
+        }
+        if (!pcb->morto && (eventos[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR))) {
+            if (eventos[i].events & EPOLLIN) {
+                tcp_ler(pcb);
+            } else if (!pcb->fin_recebido) {
+                pcb->erro_pendente = ERR_RST;
+            }
+        }
+    }
+
+    for (struct tcp_pcb *p = pcbs; p; p = p->prox) {
+        tcp_manutencao(p);
+    }
+    liberar_mortos();
+}
+
+/***************************************************************
+ * API TCP
+ **************************************************************/
+struct tcp_pcb *tcp_new(void) {
+    iniciar();
+    struct tcp_pcb *pcb = calloc(1, sizeof(struct tcp_pcb));
+    pcb->fd = -1;
+    pcb->prio = TCP_PRIO_NORMAL;
+    pcb->snd_buf = TCP_SND_BUF;
+    pcb->rcv_wnd = TCP_WND;
+    pcb->prox = pcbs;
+    pcbs = pcb;
+    return pcb;
+}
+
+struct tcp_pcb *tcp_new_ip_type(u8_t tipo) {
+    (void)tipo;
+    return tcp_new();
+}
+
+err_t tcp_bind(struct tcp_pcb *pcb, const ip_addr_t *ip, u16_t porta) {
+    pcb->local_ip.addr = endereco_host(ip);
+    pcb->local_port = porta;
+    return ERR_OK;
+}
+
+struct tcp_pcb *tcp_listen_with_backlog(struct tcp_pcb *pcb, u8_t backlog) {
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    int um = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &um, sizeof(um));
+    struct sockaddr_in end = {
+        .sin_family = AF_INET,
+        .sin_port = htons(porta_host(pcb->local_port)),
+        .sin_addr.s_addr = pcb->local_ip.addr,
+    };
+    if (bind(fd, (struct sockaddr *)&end, sizeof(end)) < 0 || listen(fd, backlog) < 0) {
+        perror("[host] tcp_listen");
+        close(fd);
+        return NULL;
+    }
+    nao_bloqueante(fd);
+    printf("[host] TCP %u -> %s:%u\n", pcb->local_port, inet_ntoa(end.sin_addr), ntohs(end.sin_port));
+
+    pcb->fd = fd;
+    pcb->state = LISTEN;
+    struct epoll_event ev = { .events = EPOLLIN, .data.ptr = pcb };
+    epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev);
+    return pcb;
+}
+
+err_t tcp_connect(struct tcp_pcb *pcb, const ip_addr_t *ip, u16_t porta, tcp_connected_fn connected) {
+    if (pcb->state != CLOSED) {
+        return ERR_ISCONN;
+    }
+    if (conexoes_ativas >= MEMP_NUM_TCP_PCB) {
+        memp_stats[MEMP_TCP_PCB].err++;
+        return ERR_MEM;
+    }
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+    int buf = TCP_SND_BUF;
+    setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &buf, sizeof(buf));
+    struct sockaddr_in end = { .sin_family = AF_INET, .sin_port = htons(porta), .sin_addr.s_addr = ip->addr };
+    if (connect(fd, (struct sockaddr *)&end, sizeof(end)) < 0 && errno != EINPROGRESS) {
+        close(fd);
+        return ERR_RTE;
+    }
+
+    pcb->fd = fd;
+    pcb->state = SYN_SENT;
+    pcb->remote_ip = *ip;
+    pcb->remote_port = porta;
+    pcb->connected = connected;
+    pcb->ultimo_us = time_us_64();
+    conexoes_ativas++;
+    contar(&memp_stats[MEMP_TCP_PCB], 1);
+    struct epoll_event ev = { .events = EPOLLOUT, .data.ptr = pcb };
+    epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev);
+    tcp_interesse_escuta();
+    return ERR_OK;
+}
+
+void tcp_arg(struct tcp_pcb *pcb, void *arg) { pcb->callback_arg = arg; }
+void tcp_accept(struct tcp_pcb *pcb, tcp_accept_fn accept) { pcb->accept = accept; }
+void tcp_recv(struct tcp_pcb *pcb, tcp_recv_fn recv) { pcb->recv = recv; }
+void tcp_sent(struct tcp_pcb *pcb, tcp_sent_fn sent) { pcb->sent = sent; }
+void tcp_err(struct tcp_pcb *pcb, tcp_err_fn err) { pcb->errf = err; }
+
+void tcp_setprio(struct tcp_pcb *pcb, u8_t prio) {
+    pcb->prio = prio;
+    tcp_interesse_escuta();
+}
+
+void tcp_poll(struct tcp_pcb *pcb, tcp_poll_fn poll, u8_t intervalo) {
+    pcb->poll = poll;
+    pcb->pollinterval = intervalo;
+    pcb->prox_poll_us = time_us_64() + intervalo * 500000ull;
+}
+
+void tcp_nagle_disable(struct tcp_pcb *pcb) {
+    int um = 1;
+    setsockopt(pcb->fd, IPPROTO_TCP, TCP_NODELAY, &um, sizeof(um));
+}
+
+err_t tcp_write(struct tcp_pcb *pcb, const void *dados, u16_t len, u8_t flags) {
+    (void)flags;  // Os dados são sempre copiados no host
+    if (pcb->state != ESTABLISHED || pcb->fechando) {
+        return ERR_CONN;
+    }
+    if (len > pcb->snd_buf || pcb->snd_queuelen >= TCP_SND_QUEUELEN) {
+        memp_stats[MEMP_TCP_SEG].err++;
+        lwip_stats.tcp.memerr++;
+        return ERR_MEM;
+    }
+    memcpy(pcb->tx + pcb->tx_len, dados, len);
+    pcb->tx_len += len;
+    pcb->snd_buf -= len;
+    pcb->snd_queuelen++;
+    contar(&memp_stats[MEMP_TCP_SEG], 1);
+    contar(&lwip_stats.mem, len);
+    return ERR_OK;
+}
+
+err_t tcp_output(struct tcp_pcb *pcb) {
+    if (!pcb->morto) {
+        tcp_descarregar(pcb);
+    }
+    return ERR_OK;
+}
+
+void tcp_recved(struct tcp_pcb *pcb, u16_t len) {
+    u32_t wnd = pcb->rcv_wnd + len;
+    pcb->rcv_wnd = wnd > TCP_WND ? TCP_WND : (u16_t)wnd;
+    tcp_interesse(pcb);
+}
+
+err_t tcp_close(struct tcp_pcb *pcb) {
+    if (pcb->state == LISTEN || pcb->tx_len == 0) {
+        if (pcb->fd >= 0 && pcb->state != LISTEN) {
+            shutdown(pcb->fd, SHUT_WR);
+        }
+        tcp_descartar(pcb, false);
+    } else {
+        pcb->fechando = true;  // Termina de enviar e então fecha
+        pcb->recv = NULL;
+        pcb->sent = NULL;
+        pcb->poll = NULL;
+        pcb->errf = NULL;
+    }
+    return ERR_OK;
+}
+
+err_t tcp_shutdown(struct tcp_pcb *pcb, int shut_rx, int shut_tx) {
+    if (shut_rx && shut_tx) {
+        return tcp_close(pcb);
+    }
+    if (shut_tx && pcb->state == ESTABLISHED) {
+        pcb->state = FIN_WAIT_1;
+        if (pcb->tx_len == 0) {
+            shutdown(pcb->fd, SHUT_WR);
+        } else {
+            pcb->fechar_envio = true;  // FIN depois dos dados pendentes
+        }
+    }
+    if (shut_rx) {
+        pcb->recv = NULL;  // Dados posteriores são descartados
+    }
+    return ERR_OK;
+}
+
+void tcp_abort(struct tcp_pcb *pcb) {
+    tcp_err_fn errf = pcb->errf;
+    void *arg = pcb->callback_arg;
+    tcp_descartar(pcb, true);
+    if (errf) {
+        errf(arg, ERR_ABRT);  // Como no lwIP (tcp_abandon)
+    }
+}
+
+/***************************************************************
+ * API UDP
+ **************************************************************/
+struct udp_pcb *udp_new(void) {
+    iniciar();
+    for (int i = 0; i < MEMP_NUM_UDP_PCB; i++) {
+        if (!udp_pcbs[i]) {
+            udp_pcbs[i] = calloc(1, sizeof(struct udp_pcb));
+            udp_pcbs[i]->fd = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+            contar(&memp_stats[MEMP_UDP_PCB], 1);
+            return udp_pcbs[i];
+        }
+    }
+    memp_stats[MEMP_UDP_PCB].err++;
+    return NULL;
+}
+
+err_t udp_bind(struct udp_pcb *pcb, const ip_addr_t *ip, u16_t porta) {
+    struct sockaddr_in end = {
+        .sin_family = AF_INET,
+        .sin_port = htons(porta_host(porta)),
+        .sin_addr.s_addr = endereco_host(ip),
+    };
+    if (bind(pcb->fd, (struct sockaddr *)&end, sizeof(end)) < 0) {
+        perror("[host] udp_bind");
+        return ERR_USE;
+    }
+    printf("[host] UDP %u -> %s:%u\n", porta, inet_ntoa(end.sin_addr), ntohs(end.sin_port));
+    pcb->porta = porta;
+    struct epoll_event ev = { .events = EPOLLIN, .data.ptr = pcb };
+    epoll_ctl(epfd, EPOLL_CTL_ADD, pcb->fd, &ev);
+    return ERR_OK;
+}
+
+void udp_recv(struct udp_pcb *pcb, udp_recv_fn recv, void *arg) {
+    pcb->recv = recv;
+    pcb->arg = arg;
+}
+
+err_t udp_sendto(struct udp_pcb *pcb, struct pbuf *p, const ip_addr_t *ip, u16_t porta) {
+    struct sockaddr_in end = { .sin_family = AF_INET, .sin_port = htons(porta), .sin_addr.s_addr = ip->addr };
+    uint8_t buf[1500];
+    u16_t n = pbuf_copy_partial(p, buf, sizeof(buf), 0);
+    return sendto(pcb->fd, buf, n, MSG_DONTWAIT, (struct sockaddr *)&end, sizeof(end)) < 0 ? ERR_BUF : ERR_OK;
+}
+
+void udp_remove(struct udp_pcb *pcb) {
+    for (int i = 0; i < MEMP_NUM_UDP_PCB; i++) {
+        if (udp_pcbs[i] == pcb) {
+            udp_pcbs[i] = NULL;
+        }
+    }
+    close(pcb->fd);
+    contar(&memp_stats[MEMP_UDP_PCB], -1);
+    free(pcb);
+}
+
+/***************************************************************
+ * NETIF
+ **************************************************************/
+static netif_ext_callback_t *netif_callbacks = NULL;
+
+void netif_add_ext_callback(netif_ext_callback_t *callback, netif_ext_callback_fn fn) {
+    callback->callback_fn = fn;
+    callback->next = netif_callbacks;
+    netif_callbacks = callback;
+}
+
+void host_netif_avisar(uint16_t motivo) {
+    iniciar();
+    for (netif_ext_callback_t *c = netif_callbacks; c; c = c->next) {
+        c->callback_fn(&netif_host, motivo, NULL);
+    }
+}
+
+/***************************************************************
+ * PBUF E ENDEREÇOS
+ **************************************************************/
+struct pbuf *pbuf_alloc(pbuf_layer camada, u16_t len, pbuf_type tipo) {
+    (void)camada;
+    struct pbuf *p = malloc(sizeof(struct pbuf) + len);
+    if (!p) {
+        return NULL;
+    }
+    p->next = NULL;
+    p->payload = (u8_t *)(p + 1);
+    p->tot_len = p->len = len;
+    p->type_internal = (u8_t)tipo;
+    p->flags = 0;
+    p->ref = 1;
+    if (tipo == PBUF_POOL) {
+        contar(&memp_stats[MEMP_PBUF_POOL], 1);
+    }
+    return p;
+}
+
+void pbuf_ref(struct pbuf *p) {
+    p->ref++;
+}
+
+u8_t pbuf_free(struct pbuf *p) {
+    if (!p || --p->ref > 0) {
+        return 0;
+    }
+    if (p->type_internal == PBUF_POOL) {
+        contar(&memp_stats[MEMP_PBUF_POOL], -1);
+    }
+    free(p);
+    return 1;
+}
+
+u16_t pbuf_copy_partial(const struct pbuf *p, void *destino, u16_t len, u16_t deslocamento) {
+    if (deslocamento >= p->tot_len) {
+        return 0;
+    }
+    u16_t n = p->tot_len - deslocamento < len ? p->tot_len - deslocamento : len;
+    memcpy(destino, (const u8_t *)p->payload + deslocamento, n);
+    return n;
+}
+
+err_t pbuf_take(struct pbuf *p, const void *dados, u16_t len) {
+    if (len > p->tot_len) {
+        return ERR_ARG;
+    }
+    memcpy(p->payload, dados, len);
+    return ERR_OK;
+}
+
+u8_t pbuf_get_at(const struct pbuf *p, u16_t deslocamento) {
+    return deslocamento < p->tot_len ? ((const u8_t *)p->payload)[deslocamento] : 0;
+}
+
+char *ipaddr_ntoa(const ip_addr_t *addr) {
+    struct in_addr a = { .s_addr = addr->addr };
+    return inet_ntoa(a);
+}
+
+char *ip4addr_ntoa(const ip4_addr_t *addr) {
+    return ipaddr_ntoa(addr);
+}
+
+int ipaddr_aton(const char *texto, ip_addr_t *addr) {
+    struct in_addr a;
+    if (!inet_aton(texto, &a)) {
+        return 0;
+    }
+    addr->addr = a.s_addr;
+    return 1;
+}
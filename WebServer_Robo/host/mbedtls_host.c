@@ -0,0 +1,83 @@
+/**
+ * SHA-1 e Base64 para o handshake do WebSocket no build nativo
+ * (mesma API do Mbed TLS 2.28; o firmware usa o pico_mbedtls)
+ */
+#include <stdint.h>
+#include <string.h>
+
+#include "mbedtls/sha1.h"
+#include "mbedtls/base64.h"
+
+#define ROTL(x, n) (((x) << (n)) | ((x) >> (32 - (n))))
+
+static void sha1_bloco(uint32_t h[5], const unsigned char *b) {
+    uint32_t w[80];
+    for (int i = 0; i < 16; i++) {
+        w[i] = (uint32_t)b[4 * i] << 24 | (uint32_t)b[4 * i + 1] << 16 | (uint32_t)b[4 * i + 2] << 8 | b[4 * i + 3];
+    }
+    for (int i = 16; i < 80; i++) {
+        w[i] = ROTL(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+    }
+    uint32_t a = h[0], bb = h[1], c = h[2], d = h[3], e = h[4];
+    for (int i = 0; i < 80; i++) {
+        uint32_t f, k;
+        if (i < 20) { f = (bb & c) | (~bb & d); k = 0x5A827999; }
+        else if (i < 40) { f = bb ^ c ^ d; k = 0x6ED9EBA1; }
+        else if (i < 60) { f = (bb & c) | (bb & d) | (c & d); k = 0x8F1BBCDC; }
+        else { f = bb ^ c ^ d; k = 0xCA62C1D6; }
+        uint32_t t = ROTL(a, 5) + f + e + k + w[i];
+        e = d; d = c; c = ROTL(bb, 30); bb = a; a = t;
+    }
+    h[0] += a; h[1] += bb; h[2] += c; h[3] += d; h[4] += e;
+}
+
+int mbedtls_sha1_ret(const unsigned char *entrada, size_t len, unsigned char saida[20]) {
+    uint32_t h[5] = { 0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0 };
+    size_t i = 0;
+    for (; i + 64 <= len; i += 64) {
+        sha1_bloco(h, entrada + i);
+    }
+    unsigned char final[128] = { 0 };
+    size_t resto = len - i;
+    memcpy(final, entrada + i, resto);
+    final[resto] = 0x80;
+    size_t tam_final = resto + 9 <= 64 ? 64 : 128;
+    uint64_t bits = (uint64_t)len * 8;
+    for (int j = 0; j < 8; j++) {
+        final[tam_final - 1 - j] = (unsigned char)(bits >> (8 * j));
+    }
+    sha1_bloco(h, final);
+    if (tam_final == 128) {
+        sha1_bloco(h, final + 64);
+    }
+    for (int j = 0; j < 5; j++) {
+        saida[4 * j] = h[j] >> 24;
+        saida[4 * j + 1] = h[j] >> 16;
+        saida[4 * j + 2] = h[j] >> 8;
+        saida[4 * j + 3] = h[j];
+    }
+    return 0;
+}
+
+int mbedtls_base64_encode(unsigned char *destino, size_t tamanho, size_t *escritos,
+                          const unsigned char *origem, size_t len) {
+    static const char tabela[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    size_t necessario = 4 * ((len + 2) / 3) + 1;
+    if (tamanho < necessario) {
+        *escritos = necessario;
+        return MBEDTLS_ERR_BASE64_BUFFER_TOO_SMALL;
+    }
+    size_t o = 0;
+    for (size_t i = 0; i < len; i += 3) {
+        uint32_t v = (uint32_t)origem[i] << 16;
+        if (i + 1 < len) v |= (uint32_t)origem[i + 1] << 8;
+        if (i + 2 < len) v |= origem[i + 2];
+        destino[o++] = tabela[(v >> 18) & 63];
+        destino[o++] = tabela[(v >> 12) & 63];
+        destino[o++] = i + 1 < len ? tabela[(v >> 6) & 63] : '=';
+        destino[o++] = i + 2 < len ? tabela[v & 63] : '=';
+    }
+    destino[o] = '\0';
+    *escritos = o;
+    return 0;
+}
@@ -0,0 +1,625 @@
+/**
+ * Implementação host (Linux) do subconjunto do Pico SDK usado pelo firmware
+ */
+#include <errno.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "pico/stdlib.h"
+#include "pico/multicore.h"
+#include "pico/cyw43_arch.h"
+#include "pico/rand.h"
+#include "pico/unique_id.h"
+#include "lwip/netif.h"
+#include "hardware/sync.h"
+#include "hardware/clocks.h"
+#include "hardware/pwm.h"
+#include "hardware/i2c.h"
+#include "hardware/pio.h"
+#include "hardware/adc.h"
+#include "hardware/dma.h"
+#include "host_laco.h"
+
+/***************************************************************
+ * TEMPO
+ **************************************************************/
+static uint64_t t_boot_us = 0;
+
+static uint64_t relogio_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000u + ts.tv_nsec / 1000;
+}
+
+uint64_t time_us_64(void) {
+    if (!t_boot_us) {
+        t_boot_us = relogio_us() - 1;  // Nunca 0, como após o boot
+    }
+    return relogio_us() - t_boot_us;
+}
+
+uint32_t time_us_32(void) {
+    return (uint32_t)time_us_64();
+}
+
+absolute_time_t get_absolute_time(void) {
+    return time_us_64();
+}
+
+absolute_time_t make_timeout_time_us(uint64_t us) {
+    return time_us_64() + us;
+}
+
+absolute_time_t make_timeout_time_ms(uint32_t ms) {
+    return make_timeout_time_us((uint64_t)ms * 1000u);
+}
+
+bool time_reached(absolute_time_t t) {
+    return time_us_64() >= t;
+}
+
+int64_t absolute_time_diff_us(absolute_time_t de, absolute_time_t ate) {
+    return (int64_t)(ate - de);
+}
+
+uint32_t to_ms_since_boot(absolute_time_t t) {
+    return (uint32_t)(t / 1000u);
+}
+
+void sleep_us(uint64_t us) {
+    struct timespec ts = { .tv_sec = us / 1000000u, .tv_nsec = (us % 1000000u) * 1000 };
+    while (nanosleep(&ts, &ts) == -1 && errno == EINTR) {
+    }
+}
+
+void sleep_ms(uint32_t ms) {
+    sleep_us((uint64_t)ms * 1000u);
+}
+
+bool stdio_init_all(void) {
+    setvbuf(stdout, NULL, _IOLBF, 0);
+    return true;
+}
+
+/***************************************************************
+ * WFE/SEV ENTRE AS THREADS DOS "NÚCLEOS"
+ **************************************************************/
+static pthread_mutex_t evento_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t evento_cond = PTHREAD_COND_INITIALIZER;
+static bool evento_sev = false;
+
+void __sev(void) {
+    pthread_mutex_lock(&evento_mutex);
+    evento_sev = true;
+    pthread_cond_broadcast(&evento_cond);
+    pthread_mutex_unlock(&evento_mutex);
+}
+
+bool best_effort_wfe_or_timeout(absolute_time_t t) {
+    pthread_mutex_lock(&evento_mutex);
+    while (!evento_sev && !time_reached(t)) {
+        uint64_t alvo = t_boot_us + t;
+        struct timespec ts = { .tv_sec = alvo / 1000000u, .tv_nsec = (alvo % 1000000u) * 1000 };
+        pthread_cond_timedwait(&evento_cond, &evento_mutex, &ts);  // CLOCK_MONOTONIC (ver condvar_monotonica)
+    }
+    evento_sev = false;
+    pthread_mutex_unlock(&evento_mutex);
+    return time_reached(t);
+}
+
+void __wfe(void) {
+    best_effort_wfe_or_timeout(make_timeout_time_ms(1));
+}
+
+__attribute__((constructor)) static void condvar_monotonica(void) {
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&evento_cond, &attr);
+    time_us_64();
+}
+
+void __wfi(void) {
+    host_lwip_processar(host_async_proximo_ms());
+    host_dma_avancar();
+    host_async_executar();
+}
+
+uint32_t save_and_disable_interrupts(void) {
+    return 0;
+}
+
+void restore_interrupts(uint32_t estado) {
+    (void)estado;
+}
+
+/***************************************************************
+ * NÚCLEO 1 E FIFO ENTRE NÚCLEOS
+ **************************************************************/
+#define FIFO_TAM 8
+
+static uint32_t fifo[FIFO_TAM];
+static int fifo_n = 0;
+static int fifo_ini = 0;
+static pthread_mutex_t fifo_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t fifo_cond = PTHREAD_COND_INITIALIZER;
+static int fifo_evento = -1;               // eventfd: "IRQ" SIO_IRQ_PROC0
+static irq_handler_t irq_handlers[32];
+static bool irq_habilitada[32];
+
+static void *core1_thread(void *arg) {
+    ((void (*)(void))arg)();
+    return NULL;
+}
+
+void multicore_launch_core1(void (*entrada)(void)) {
+    pthread_t t;
+    pthread_create(&t, NULL, core1_thread, (void *)entrada);
+    pthread_detach(t);
+}
+
+bool multicore_fifo_wready(void) {
+    pthread_mutex_lock(&fifo_mutex);
+    bool ok = fifo_n < FIFO_TAM;
+    pthread_mutex_unlock(&fifo_mutex);
+    return ok;
+}
+
+bool multicore_fifo_rvalid(void) {
+    pthread_mutex_lock(&fifo_mutex);
+    bool ok = fifo_n > 0;
+    pthread_mutex_unlock(&fifo_mutex);
+    return ok;
+}
+
+void multicore_fifo_push_blocking(uint32_t dado) {
+    pthread_mutex_lock(&fifo_mutex);
+    while (fifo_n == FIFO_TAM) {
+        pthread_cond_wait(&fifo_cond, &fifo_mutex);
+    }
+    fifo[(fifo_ini + fifo_n++) % FIFO_TAM] = dado;
+    pthread_cond_broadcast(&fifo_cond);
+    pthread_mutex_unlock(&fifo_mutex);
+    if (fifo_evento >= 0) {
+        uint64_t um = 1;
+        (void)!write(fifo_evento, &um, sizeof(um));
+    }
+}
+
+uint32_t multicore_fifo_pop_blocking(void) {
+    pthread_mutex_lock(&fifo_mutex);
+    while (fifo_n == 0) {
+        pthread_cond_wait(&fifo_cond, &fifo_mutex);
+    }
+    uint32_t dado = fifo[fifo_ini];
+    fifo_ini = (fifo_ini + 1) % FIFO_TAM;
+    fifo_n--;
+    pthread_cond_broadcast(&fifo_cond);
+    pthread_mutex_unlock(&fifo_mutex);
+    return dado;
+}
+
+void multicore_fifo_drain(void) {
+    pthread_mutex_lock(&fifo_mutex);
+    fifo_n = 0;
+    pthread_cond_broadcast(&fifo_cond);
+    pthread_mutex_unlock(&fifo_mutex);
+}
+
+void multicore_fifo_clear_irq(void) {
+}
+
+static void fifo_irq(void *arg) {
+    (void)arg;
+    uint64_t n;
+    (void)!read(fifo_evento, &n, sizeof(n));
+    if (irq_habilitada[SIO_IRQ_PROC0] && irq_handlers[SIO_IRQ_PROC0]) {
+        irq_handlers[SIO_IRQ_PROC0]();
+    }
+}
+
+void irq_set_exclusive_handler(uint num, irq_handler_t handler) {
+    irq_handlers[num] = handler;
+}
+
+void irq_set_enabled(uint num, bool habilitar) {
+    irq_habilitada[num] = habilitar;
+    if (num == SIO_IRQ_PROC0 && habilitar && fifo_evento < 0) {
+        fifo_evento = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        host_laco_observar(fifo_evento, fifo_irq, NULL);
+    }
+}
+
+/***************************************************************
+ * CONTEXTO ASSÍNCRONO (WORKERS DO NÚCLEO 0)
+ **************************************************************/
+struct async_context {
+    async_at_time_worker_t *com_horario;
+    async_when_pending_worker_t *pendentes;
+};
+
+static async_context_t contexto;
+
+async_context_t *cyw43_arch_async_context(void) {
+    return &contexto;
+}
+
+bool async_context_remove_at_time_worker(async_context_t *ctx, async_at_time_worker_t *worker) {
+    for (async_at_time_worker_t **p = &ctx->com_horario; *p; p = &(*p)->next) {
+        if (*p == worker) {
+            *p = worker->next;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool async_context_add_at_time_worker_at(async_context_t *ctx, async_at_time_worker_t *worker, absolute_time_t t) {
+    async_context_remove_at_time_worker(ctx, worker);
+    worker->next_time = t;
+    worker->next = ctx->com_horario;
+    ctx->com_horario = worker;
+    return true;
+}
+
+bool async_context_add_at_time_worker_in_ms(async_context_t *ctx, async_at_time_worker_t *worker, uint32_t ms) {
+    return async_context_add_at_time_worker_at(ctx, worker, make_timeout_time_ms(ms));
+}
+
+bool async_context_add_when_pending_worker(async_context_t *ctx, async_when_pending_worker_t *worker) {
+    worker->next = ctx->pendentes;
+    ctx->pendentes = worker;
+    return true;
+}
+
+bool async_context_remove_when_pending_worker(async_context_t *ctx, async_when_pending_worker_t *worker) {
+    for (async_when_pending_worker_t **p = &ctx->pendentes; *p; p = &(*p)->next) {
+        if (*p == worker) {
+            *p = worker->next;
+            return true;
+        }
+    }
+    return false;
+}
+
+void async_context_set_work_pending(async_context_t *ctx, async_when_pending_worker_t *worker) {
+    (void)ctx;
+    worker->work_pending = true;
+}
+
+void async_context_acquire_lock_blocking(async_context_t *ctx) {
+    (void)ctx;
+}
+
+void async_context_release_lock(async_context_t *ctx) {
+    (void)ctx;
+}
+
+int host_async_proximo_ms(void) {
+    for (async_when_pending_worker_t *w = contexto.pendentes; w; w = w->next) {
+        if (w->work_pending) {
+            return 0;
+        }
+    }
+    int64_t menor = -1;
+    for (async_at_time_worker_t *w = contexto.com_horario; w; w = w->next) {
+        int64_t falta = absolute_time_diff_us(get_absolute_time(), w->next_time);
+        if (falta < 0) {
+            falta = 0;
+        }
+        if (menor < 0 || falta < menor) {
+            menor = falta;
+        }
+    }
+    return menor < 0 ? -1 : (int)((menor + 999) / 1000);
+}
+
+void host_async_executar(void) {
+    // Um worker com horário sai da lista antes de rodar (pode se reagendar)
+    bool rodou = true;
+    while (rodou) {
+        rodou = false;
+        for (async_at_time_worker_t *w = contexto.com_horario; w; w = w->next) {
+            if (time_reached(w->next_time)) {
+                async_context_remove_at_time_worker(&contexto, w);
+                w->do_work(&contexto, w);
+                rodou = true;
+                break;
+            }
+        }
+    }
+    for (async_when_pending_worker_t *w = contexto.pendentes; w; w = w->next) {
+        if (w->work_pending) {
+            w->work_pending = false;
+            w->do_work(&contexto, w);
+        }
+    }
+}
+
+/***************************************************************
+ * CYW43 (SEM RÁDIO)
+ *
+ * HOST_WIFI_FALHAS=n faz as n primeiras associações falharem (sem
+ * rede), para exercitar o backoff do gerenciador do Wi-Fi.
+ **************************************************************/
+cyw43_t cyw43_state;
+static int wifi_status = CYW43_LINK_DOWN;
+static int wifi_falhas = -1;
+
+int cyw43_arch_init(void) {
+    return 0;
+}
+
+void cyw43_arch_deinit(void) {
+}
+
+void cyw43_arch_enable_sta_mode(void) {
+}
+
+int cyw43_arch_wifi_connect_async(const char *ssid, const char *senha, uint32_t auth) {
+    (void)senha; (void)auth;
+    if (wifi_falhas < 0) {
+        const char *falhas = getenv("HOST_WIFI_FALHAS");
+        wifi_falhas = falhas ? atoi(falhas) : 0;
+    }
+    if (wifi_falhas > 0) {
+        wifi_falhas--;
+        wifi_status = CYW43_LINK_NONET;
+        printf("[host] Wi-Fi simulado: \"%s\" não encontrada\n", ssid);
+        return 0;
+    }
+    wifi_status = CYW43_LINK_UP;
+    printf("[host] Wi-Fi simulado: \"%s\" conectado (loopback)\n", ssid);
+    host_netif_avisar(LWIP_NSC_LINK_CHANGED | LWIP_NSC_STATUS_CHANGED);
+    return 0;
+}
+
+int cyw43_arch_wifi_connect_timeout_ms(const char *ssid, const char *senha, uint32_t auth, uint32_t timeout_ms) {
+    (void)timeout_ms;
+    cyw43_arch_wifi_connect_async(ssid, senha, auth);
+    return wifi_status == CYW43_LINK_UP ? 0 : wifi_status;
+}
+
+int cyw43_tcpip_link_status(cyw43_t *self, int itf) {
+    (void)self; (void)itf;
+    return wifi_status;
+}
+
+int cyw43_wifi_leave(cyw43_t *self, int itf) {
+    (void)self; (void)itf;
+    bool estava_up = wifi_status == CYW43_LINK_UP;
+    wifi_status = CYW43_LINK_DOWN;
+    if (estava_up) {
+        host_netif_avisar(LWIP_NSC_LINK_CHANGED);
+    }
+    return 0;
+}
+
+uint32_t get_rand_32(void) {
+    return (uint32_t)random() ^ ((uint32_t)random() << 16);
+}
+
+/**
+ * ID da placa: ROBO_HOST_ID, ou "HOSTROBO" em hexadecimal. Vários
+ * robo_host no mesmo broker precisam de IDs diferentes
+ */
+void pico_get_unique_board_id_string(char *id_out, uint len) {
+    const char *id = getenv("ROBO_HOST_ID");
+    snprintf(id_out, len, "%s", id ? id : "484F5354524F424F");
+}
+
+void cyw43_arch_gpio_put(uint pino, bool valor) {
+    (void)pino; (void)valor;
+}
+
+/***************************************************************
+ * GPIO
+ **************************************************************/
+static bool gpio_nivel[32];
+
+void gpio_init(uint gpio) { gpio_nivel[gpio % 32] = false; }
+void gpio_set_dir(uint gpio, bool out) { (void)gpio; (void)out; }
+void gpio_put(uint gpio, bool valor) { gpio_nivel[gpio % 32] = valor; }
+bool gpio_get(uint gpio) { return gpio_nivel[gpio % 32]; }
+void gpio_set_function(uint gpio, enum gpio_function fn) { (void)gpio; (void)fn; }
+void gpio_pull_up(uint gpio) { gpio_nivel[gpio % 32] = true; }
+void gpio_set_irq_enabled_with_callback(uint gpio, uint32_t eventos, bool habilitar, gpio_irq_callback_t cb) {
+    (void)gpio; (void)eventos; (void)habilitar; (void)cb;
+}
+void gpio_set_irq_enabled(uint gpio, uint32_t eventos, bool habilitar) {
+    (void)gpio; (void)eventos; (void)habilitar;
+}
+uint32_t gpio_get_irq_event_mask(uint gpio) { (void)gpio; return 0; }
+void gpio_acknowledge_irq(uint gpio, uint32_t eventos) { (void)gpio; (void)eventos; }
+void gpio_add_raw_irq_handler_with_order_priority(uint gpio, irq_handler_t handler, uint8_t prioridade) {
+    (void)gpio; (void)handler; (void)prioridade;
+}
+
+/***************************************************************
+ * CLOCKS, PWM, I2C E PIO
+ **************************************************************/
+uint32_t clock_get_hz(enum clock_index clk) {
+    return clk == clk_adc || clk == clk_usb ? 48000000u : 125000000u;
+}
+
+uint pwm_gpio_to_slice_num(uint gpio) { return (gpio >> 1) & 7; }
+pwm_config pwm_get_default_config(void) { return (pwm_config){ .clkdiv = 1.0f, .top = 0xffff }; }
+void pwm_config_set_clkdiv(pwm_config *c, float div) { c->clkdiv = div; }
+void pwm_config_set_wrap(pwm_config *c, uint16_t wrap) { c->top = wrap; }
+void pwm_init(uint slice, pwm_config *c, bool iniciar) { (void)slice; (void)c; (void)iniciar; }
+void pwm_set_clkdiv(uint slice, float div) { (void)slice; (void)div; }
+void pwm_set_wrap(uint slice, uint16_t wrap) { (void)slice; (void)wrap; }
+void pwm_set_gpio_level(uint gpio, uint16_t nivel) { (void)gpio; (void)nivel; }
+void pwm_set_enabled(uint slice, bool habilitar) { (void)slice; (void)habilitar; }
+
+struct i2c_inst {
+    uint baudrate;
+};
+static struct i2c_inst i2c_inst[2];
+i2c_inst_t *i2c0 = &i2c_inst[0];
+i2c_inst_t *i2c1 = &i2c_inst[1];
+
+uint i2c_init(i2c_inst_t *i2c, uint baudrate) {
+    i2c->baudrate = baudrate;
+    return baudrate;
+}
+
+// Simula a duração do barramento: 9 bits por byte (dados + ACK)
+int i2c_write_blocking(i2c_inst_t *i2c, uint8_t endereco, const uint8_t *dados, size_t len, bool sem_stop) {
+    (void)endereco; (void)dados; (void)sem_stop;
+    if (i2c->baudrate) {
+        sleep_us((uint64_t)(len + 1) * 9 * 1000000u / i2c->baudrate);
+    }
+    return (int)len;
+}
+
+int i2c_read_blocking(i2c_inst_t *i2c, uint8_t endereco, uint8_t *dados, size_t len, bool sem_stop) {
+    memset(dados, 0, len);
+    return i2c_write_blocking(i2c, endereco, dados, len, sem_stop);
+}
+
+struct pio_host {
+    int sm_livre;
+};
+static struct pio_host pio_inst[2];
+PIO pio0 = &pio_inst[0];
+PIO pio1 = &pio_inst[1];
+
+uint pio_add_program(PIO pio, const pio_program_t *programa) {
+    (void)pio; (void)programa;
+    return 0;
+}
+
+int pio_claim_unused_sm(PIO pio, bool obrigatorio) {
+    (void)obrigatorio;
+    return pio->sm_livre < 4 ? pio->sm_livre++ : -1;
+}
+
+// 24 bits a 800 kHz por LED WS2812
+void pio_sm_put_blocking(PIO pio, uint sm, uint32_t dado) {
+    (void)pio; (void)sm; (void)dado;
+    uint64_t fim = time_us_64() + 10;  // Um canal de cor: 8 bits a 800 kHz
+    while (time_us_64() < fim) {
+    }
+}
+
+/***************************************************************
+ * ADC + DMA (SENSOR DE TEMPERATURA SIMULADO)
+ **************************************************************/
+static adc_hw_t adc_regs;
+adc_hw_t *adc_hw = &adc_regs;
+static dma_hw_t dma_regs;
+dma_hw_t *dma_hw = &dma_regs;
+
+static float adc_div = 0.0f;
+static bool adc_rodando = false;
+
+static struct {
+    bool em_uso;
+    dma_channel_config cfg;
+    uintptr_t base;                 // Início do anel de escrita
+    uint64_t t_ultimo_us;           // Última amostra gerada
+} dma_canais[NUM_DMA_CHANNELS];
+
+void adc_init(void) {}
+void adc_set_temp_sensor_enabled(bool habilitar) { (void)habilitar; }
+void adc_select_input(uint entrada) { (void)entrada; }
+void adc_set_round_robin(uint mascara) { (void)mascara; }
+void adc_fifo_setup(bool en, bool dreq_en, uint16_t dreq_limiar, bool err_no_fifo, bool byte_shift) {
+    (void)en; (void)dreq_en; (void)dreq_limiar; (void)err_no_fifo; (void)byte_shift;
+}
+void adc_set_clkdiv(float div) { adc_div = div; }
+void adc_run(bool rodar) { adc_rodando = rodar; }
+
+// Sensor interno a ~27 °C com um pouco de ruído (V = 0,706 V, 3,3 V / 4096)
+uint16_t adc_read(void) {
+    return (uint16_t)(876 + (rand() % 5) - 2);
+}
+
+int dma_claim_unused_channel(bool obrigatorio) {
+    for (int i = 0; i < NUM_DMA_CHANNELS; i++) {
+        if (!dma_canais[i].em_uso) {
+            dma_canais[i].em_uso = true;
+            return i;
+        }
+    }
+    if (obrigatorio) {
+        fprintf(stderr, "[host] sem canais de DMA\n");
+        abort();
+    }
+    return -1;
+}
+
+dma_channel_config dma_channel_get_default_config(uint canal) {
+    (void)canal;
+    return (dma_channel_config){ .tamanho = DMA_SIZE_32, .incr_leitura = true, .incr_escrita = false };
+}
+
+void channel_config_set_transfer_data_size(dma_channel_config *c, enum dma_channel_transfer_size t) { c->tamanho = t; }
+void channel_config_set_read_increment(dma_channel_config *c, bool incr) { c->incr_leitura = incr; }
+void channel_config_set_write_increment(dma_channel_config *c, bool incr) { c->incr_escrita = incr; }
+void channel_config_set_ring(dma_channel_config *c, bool escrita, uint bits) {
+    c->anel_escrita = escrita;
+    c->bits_anel = bits;
+}
+void channel_config_set_dreq(dma_channel_config *c, uint dreq) { c->dreq = dreq; }
+
+void dma_channel_configure(uint canal, const dma_channel_config *c, volatile void *destino,
+                           const volatile void *origem, uint transferencias, bool iniciar) {
+    dma_canais[canal].cfg = *c;
+    dma_canais[canal].base = (uintptr_t)destino;
+    dma_canais[canal].t_ultimo_us = time_us_64();
+    dma_hw->ch[canal].read_addr = (uintptr_t)origem;
+    dma_hw->ch[canal].write_addr = (uintptr_t)destino;
+    dma_hw->ch[canal].transfer_count = iniciar ? transferencias : 0;
+}
+
+void dma_channel_set_trans_count(uint canal, uint32_t transferencias, bool iniciar) {
+    dma_hw->ch[canal].transfer_count = transferencias;
+    if (iniciar) {
+        dma_canais[canal].t_ultimo_us = time_us_64();
+    }
+}
+
+bool dma_channel_is_busy(uint canal) {
+    return dma_hw->ch[canal].transfer_count > 0;
+}
+
+void host_dma_avancar(void) {
+    if (!adc_rodando) {
+        return;
+    }
+    uint64_t periodo_us = (uint64_t)((1.0f + adc_div) * 1000000.0f / 48000000.0f);
+    if (periodo_us == 0) {
+        periodo_us = 1;
+    }
+    for (int i = 0; i < NUM_DMA_CHANNELS; i++) {
+        dma_channel_hw_t *ch = &dma_hw->ch[i];
+        if (!dma_canais[i].em_uso || dma_canais[i].cfg.dreq != DREQ_ADC || !ch->transfer_count) {
+            continue;
+        }
+        uint64_t agora = time_us_64();
+        uint32_t n = (uint32_t)((agora - dma_canais[i].t_ultimo_us) / periodo_us);
+        if (n == 0) {
+            continue;
+        }
+        dma_canais[i].t_ultimo_us += (uint64_t)n * periodo_us;
+        uintptr_t tam = 1u << dma_canais[i].cfg.tamanho;
+        uintptr_t anel = dma_canais[i].cfg.anel_escrita ? (uintptr_t)1 << dma_canais[i].cfg.bits_anel : 0;
+        while (n-- && ch->transfer_count) {
+            uint16_t amostra = adc_read();
+            memcpy((void *)ch->write_addr, &amostra, tam < sizeof(amostra) ? tam : sizeof(amostra));
+            uintptr_t prox = ch->write_addr + tam;
+            if (anel && prox - dma_canais[i].base >= anel) {
+                prox = dma_canais[i].base;
+            }
+            ch->write_addr = prox;
+            ch->transfer_count--;
+        }
+    }
+}
@@ -0,0 +1,31 @@
+#include <stdio.h>
+
+#include "lwip/altcp_tls.h"
+#include "https.h"
+
+/***************************************************************
+ * VARIÁVEIS INTERNAS
+ **************************************************************/
+// Uma configuração para todas as conexões: guarda o certificado já
+// decodificado, o cache de sessões e a chave dos tickets
+static struct altcp_tls_config *config_tls = NULL;
+
+/***************************************************************
+ * API
+ **************************************************************/
+/**
+ * Cria um PCB TLS do servidor (a configuração é criada na primeira chamada)
+ * @return PCB pronto para bind/listen ou NULL se as credenciais forem inválidas
+ */
+struct altcp_pcb *https_novo_pcb(void) {
+    if (!config_tls) {
+        config_tls = altcp_tls_create_config_server_privkey_cert(
+            tls_chave, tls_chave_tam, NULL, 0,
+            tls_certificado, tls_certificado_tam);
+        if (!config_tls) {
+            printf("HTTPS: certificado ou chave inválidos\n");
+            return NULL;
+        }
+    }
+    return altcp_tls_new(config_tls, IPADDR_TYPE_ANY);
+}
@@ -0,0 +1,41 @@
+#ifndef HTTPS_H
+#define HTTPS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "lwip/altcp.h"
+
+/***************************************************************
+ * SERVIDOR HTTPS (altcp_tls + mbedTLS)
+ *
+ * Só é compilado com a opção ROBO_HTTPS do CMake. O listener TLS usa
+ * os mesmos callbacks e o mesmo pool do HTTP: a camada altcp_tls faz
+ * o handshake e cifra/decifra por baixo deles.
+ *
+ * Custos do handshake completo no RP2040 (ECDHE + assinatura ECDSA
+ * P-256) ficam na casa das centenas de ms; por isso a configuração
+ * habilita a retomada de sessão (cache por session ID no servidor e
+ * session tickets), que evita as operações de chave pública nas
+ * reconexões. Ver lwipopts.h e mbedtls_config.h.
+ *
+ * Certificado e chave (PEM) são embutidos no firmware por
+ * gerar_credenciais_tls.py (gera tls_credenciais.c).
+ **************************************************************/
+#ifndef HTTPS_PORTA
+#define HTTPS_PORTA 443
+#endif
+
+// Gerados em tls_credenciais.c; os tamanhos incluem o '\0' final exigido pelo mbedTLS
+extern const uint8_t tls_certificado[];
+extern const size_t tls_certificado_tam;
+extern const uint8_t tls_chave[];
+extern const size_t tls_chave_tam;
+
+/**
+ * Cria um PCB TLS do servidor (a configuração é criada na primeira chamada)
+ * Deve ser chamada com o lwIP travado (cyw43_arch_lwip_begin).
+ * @return PCB pronto para bind/listen ou NULL se as credenciais forem inválidas
+ */
+struct altcp_pcb *https_novo_pcb(void);
+
+#endif
@@ -0,0 +1,63 @@
+#include "pico/stdlib.h"
+#include "limitador.h"
+
+// Fichas em milionésimos: a cada µs o balde ganha exatamente LIMITE_TAXA
+#define FICHA 1000000u
+
+#if LIMITE_RAJADA > 4000
+#error "LIMITE_RAJADA * FICHA precisa caber em 32 bits"
+#endif
+
+/***************************************************************
+ * VARIÁVEIS INTERNAS
+ **************************************************************/
+typedef struct {
+    ip_addr_t ip;
+    bool ativo;
+    uint32_t fichas;               // Milionésimos de ficha (até LIMITE_RAJADA * FICHA)
+    uint32_t t_recarga;            // Última recarga (time_us_32)
+} limite_cliente_t;
+
+static limite_cliente_t clientes[LIMITE_CLIENTES];
+
+/***************************************************************
+ * FUNÇÕES INTERNAS
+ **************************************************************/
+/**
+ * Encontra o cliente ou reaproveita a entrada recarregada há mais tempo
+ */
+static limite_cliente_t *cliente_obter(const ip_addr_t *ip, uint32_t agora) {
+    limite_cliente_t *livre = &clientes[0];
+    for (int i = 0; i < LIMITE_CLIENTES; i++) {
+        limite_cliente_t *c = &clientes[i];
+        if (c->ativo && ip_addr_cmp(&c->ip, ip)) {
+            return c;
+        }
+        if (!c->ativo || (livre->ativo && agora - c->t_recarga > agora - livre->t_recarga)) {
+            livre = c;
+        }
+    }
+    ip_addr_copy(livre->ip, *ip);
+    livre->ativo = true;
+    livre->fichas = LIMITE_RAJADA * FICHA;
+    livre->t_recarga = agora;
+    return livre;
+}
+
+/***************************************************************
+ * API PÚBLICA
+ **************************************************************/
+bool limite_consumir(const ip_addr_t *ip) {
+    uint32_t agora = time_us_32();
+    limite_cliente_t *c = cliente_obter(ip, agora);
+
+    uint64_t recarga = (uint64_t)(agora - c->t_recarga) * LIMITE_TAXA;
+    c->t_recarga = agora;
+    c->fichas = recarga >= LIMITE_RAJADA * FICHA - c->fichas ? LIMITE_RAJADA * FICHA
+                                                              : c->fichas + (uint32_t)recarga;
+    if (c->fichas < FICHA) {
+        return false;
+    }
+    c->fichas -= FICHA;
+    return true;
+}
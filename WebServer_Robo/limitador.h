@@ -0,0 +1,38 @@
+#ifndef LIMITADOR_H
+#define LIMITADOR_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "lwip/ip_addr.h"
+
+/***************************************************************
+ * LIMITADOR DE TAXA POR CLIENTE (token bucket)
+ *
+ * Cada IP tem um balde de LIMITE_RAJADA fichas que se recarrega a
+ * LIMITE_TAXA fichas por segundo; cada comando gasta uma ficha e,
+ * com o balde vazio, é recusado (HTTP 429). A tabela guarda os
+ * LIMITE_CLIENTES IPs mais recentes: um IP novo ocupa a entrada
+ * usada há mais tempo e começa com o balde cheio.
+ *
+ * Usado apenas no contexto do lwIP (núcleo 0), sem trava.
+ **************************************************************/
+#ifndef LIMITE_TAXA
+#define LIMITE_TAXA 10                // Comandos por segundo por cliente, em regime
+#endif
+
+#ifndef LIMITE_RAJADA
+#define LIMITE_RAJADA 20              // Comandos seguidos aceitos com o balde cheio
+#endif
+
+#ifndef LIMITE_CLIENTES
+#define LIMITE_CLIENTES 8             // IPs acompanhados ao mesmo tempo
+#endif
+
+/**
+ * Gasta uma ficha do balde do cliente
+ * @param ip Endereço do cliente
+ * @return false se o cliente excedeu a taxa (comando deve ser recusado)
+ */
+bool limite_consumir(const ip_addr_t *ip);
+
+#endif
@@ -12,8 +12,11 @@
 #define MEMP_NUM_PBUF 16
 #define PBUF_POOL_SIZE 16               // Ajuste conforme necessário
 #define MEMP_NUM_UDP_PCB 4
-#define MEMP_NUM_TCP_PCB 4
+#define MEMP_NUM_TCP_PCB 11             // HTTP 4 + SSE 2 + WS 2 + MQTT 1 + folga para o 503 imediato e TIME_WAIT
 #define MEMP_NUM_TCP_SEG 16
+#define TCP_MSS 1460
+#define TCP_SND_BUF (2 * TCP_MSS)     // Comporta a página da interface em uma única escrita
+#define TCP_SND_QUEUELEN ((4 * (TCP_SND_BUF) + (TCP_MSS - 1)) / (TCP_MSS))
 #define LWIP_IPV4 1
 #define LWIP_ICMP 1
 #define LWIP_RAW 1
@@ -27,6 +30,36 @@
 #define HTTPD_USE_CUSTOM_FSDATA 0
 #define LWIP_HTTPD_CGI 0           // Desative CGI para economizar memória
 #define LWIP_NETIF_HOSTNAME 1
+#define LWIP_NETIF_EXT_STATUS_CALLBACK 1  // Avisos de enlace/endereço para o gerenciador do Wi-Fi (wifi.c)
 
+// Estatísticas exportadas em /metrics (heap, pools e segmentos TCP)
+#define LWIP_STATS 1
+#define LWIP_STATS_DISPLAY 0
+#define MEM_STATS 1
+#define MEMP_STATS 1
+#define TCP_STATS 1
+#define LINK_STATS 0
+#define ETHARP_STATS 0
+#define IP_STATS 0
+#define ICMP_STATS 0
+#define UDP_STATS 0
+#define SYS_STATS 0
+
+// HTTPS (opção ROBO_HTTPS do CMake): API altcp com a camada TLS do mbedTLS
+#if ROBO_HTTPS
+#define LWIP_ALTCP 1
+#define LWIP_ALTCP_TLS 1
+#define LWIP_ALTCP_TLS_MBEDTLS 1
+#define MEMP_NUM_ALTCP_PCB (2 * MEMP_NUM_TCP_PCB)   // Conexão TLS = camada TLS + camada TCP
+// Retomada de sessão: evita ECDHE + ECDSA (a parte cara do handshake)
+// quando o navegador reconecta. O cache do servidor atende clientes que
+// só conhecem session ID; os tickets não ocupam RAM no servidor.
+#define ALTCP_MBEDTLS_USE_SESSION_CACHE 1
+#define ALTCP_MBEDTLS_SESSION_CACHE_SIZE 8
+#define ALTCP_MBEDTLS_SESSION_CACHE_TIMEOUT_SECONDS (60 * 60)
+#define ALTCP_MBEDTLS_USE_SESSION_TICKETS 1
+#define ALTCP_MBEDTLS_SESSION_TICKET_CIPHER MBEDTLS_CIPHER_AES_128_GCM
+#define ALTCP_MBEDTLS_SESSION_TICKET_TIMEOUT_SECONDS (60 * 60 * 24)
+#endif
 
 #endif /* LWIPOPTS_H */
@@ -0,0 +1,90 @@
+#ifndef MBEDTLS_CONFIG_ROBO_H
+#define MBEDTLS_CONFIG_ROBO_H
+
+// Apenas o necessário para o handshake do WebSocket (SHA-1 + base64)
+#define MBEDTLS_SHA1_C
+#define MBEDTLS_BASE64_C
+
+/***************************************************************
+ * TLS DO SERVIDOR HTTPS (opção ROBO_HTTPS do CMake)
+ *
+ * Só TLS 1.2 com ECDHE-ECDSA: certificado P-256 e troca de chaves em
+ * X25519 (oferecida primeiro pelos navegadores) ou P-256. Sem RSA: uma
+ * assinatura RSA-2048 custaria segundos no Cortex-M0+.
+ **************************************************************/
+#if ROBO_HTTPS
+#include <limits.h>
+
+// Entropia do ROSC via pico_mbedtls (mbedtls_hardware_poll)
+#define MBEDTLS_NO_PLATFORM_ENTROPY
+#define MBEDTLS_ENTROPY_HARDWARE_ALT
+#define MBEDTLS_ENTROPY_C
+#define MBEDTLS_CTR_DRBG_C
+#define MBEDTLS_PLATFORM_C
+#define MBEDTLS_HAVE_TIME            // Validade das sessões em cache e dos tickets
+
+// Protocolo
+#define MBEDTLS_SSL_TLS_C
+#define MBEDTLS_SSL_SRV_C
+#define MBEDTLS_SSL_PROTO_TLS1_2
+#define MBEDTLS_SSL_SERVER_NAME_INDICATION
+#define MBEDTLS_KEY_EXCHANGE_ECDHE_ECDSA_ENABLED
+
+// Retomada de sessão (ALTCP_MBEDTLS_USE_SESSION_* em lwipopts.h)
+#define MBEDTLS_SSL_CACHE_C
+#define MBEDTLS_SSL_TICKET_C
+#define MBEDTLS_SSL_SESSION_TICKETS
+
+// Registros: a entrada precisa caber um registro inteiro do cliente; a
+// saída limita o que o altcp_tls aceita por escrita (altcp_sndbuf), de
+// modo que uma resposta nunca é gravada pela metade
+#define MBEDTLS_SSL_MAX_FRAGMENT_LENGTH
+#define MBEDTLS_SSL_IN_CONTENT_LEN 4096
+#define MBEDTLS_SSL_OUT_CONTENT_LEN 2048
+
+// Suítes em ordem de preferência. ChaCha20-Poly1305 é mais rápida que
+// AES-GCM em software no M0+ (sem instruções de AES nem multiplicação
+// carry-less); AES-128-GCM fica para clientes sem ChaCha. Outra lista
+// pode ser passada em ROBO_TLS_SUITES pelo CMake.
+#ifndef ROBO_TLS_SUITES
+#define ROBO_TLS_SUITES \
+    MBEDTLS_TLS_ECDHE_ECDSA_WITH_CHACHA20_POLY1305_SHA256, \
+    MBEDTLS_TLS_ECDHE_ECDSA_WITH_AES_128_GCM_SHA256
+#endif
+#define MBEDTLS_SSL_CIPHERSUITES ROBO_TLS_SUITES
+
+// Cifras e hashes
+#define MBEDTLS_CIPHER_C
+#define MBEDTLS_AES_C
+#define MBEDTLS_AES_FEWER_TABLES     // Tabelas de 2 KB em vez de 8 KB
+#define MBEDTLS_GCM_C
+#define MBEDTLS_CHACHA20_C
+#define MBEDTLS_POLY1305_C
+#define MBEDTLS_CHACHAPOLY_C
+#define MBEDTLS_MD_C
+#define MBEDTLS_SHA256_C
+#define MBEDTLS_SHA256_SMALLER
+
+// Curvas elípticas
+#define MBEDTLS_BIGNUM_C
+#define MBEDTLS_ECP_C
+#define MBEDTLS_ECDH_C
+#define MBEDTLS_ECDSA_C
+#define MBEDTLS_ECP_DP_SECP256R1_ENABLED
+#define MBEDTLS_ECP_DP_CURVE25519_ENABLED
+#define MBEDTLS_ECP_NIST_OPTIM       // Redução modular específica de P-256
+#define MBEDTLS_ECP_WINDOW_SIZE 4    // Janela da multiplicação: RAM x velocidade
+#define MBEDTLS_ECP_FIXED_POINT_OPTIM 1  // Pré-cálculo do gerador (assinatura mais rápida)
+
+// Certificado e chave em PEM
+#define MBEDTLS_ASN1_PARSE_C
+#define MBEDTLS_ASN1_WRITE_C
+#define MBEDTLS_OID_C
+#define MBEDTLS_PK_C
+#define MBEDTLS_PK_PARSE_C
+#define MBEDTLS_PEM_PARSE_C
+#define MBEDTLS_X509_USE_C
+#define MBEDTLS_X509_CRT_PARSE_C
+#endif
+
+#endif
@@ -0,0 +1,222 @@
+#include <stdarg.h>
+#include <stdio.h>
+
+#include "metricas.h"
+#include "sse.h"
+#include "websocket.h"
+#include "wifi.h"
+#include "mqtt_cliente.h"
+#include "lwip/stats.h"
+#include "lwip/memp.h"
+
+metricas_t metricas;
+
+// Limites superiores dos baldes em microssegundos (o último é +Inf)
+static const uint32_t limites_us[METRICAS_BALDES - 1] = {
+    100, 250, 500, 1000, 2500, 5000, 10000, 25000, 50000, 100000
+};
+
+static const char *const nomes_rota[ROTA_TOTAL] = {
+    "arquivo", "status", "latencia", "nucleos", "historico",
+    "events", "ws", "estado", "legado", "metrics", "desconhecida"
+};
+
+static const char *const nomes_atuador[ATUADOR_TOTAL] = {
+    "leds", "buzzer", "display"
+};
+
+void histograma_registrar(histograma_t *h, uint32_t us) {
+    int i = 0;
+    while (i < METRICAS_BALDES - 1 && us > limites_us[i]) {
+        i++;
+    }
+    h->baldes[i]++;
+    h->soma_us += us;
+    h->n++;
+}
+
+// Acrescenta texto formatado ao buffer de saída, sem ultrapassá-lo
+typedef struct {
+    char *buf;
+    size_t tamanho;
+    size_t n;
+} texto_t;
+
+static void escrever(texto_t *t, const char *fmt, ...) {
+    if (t->n >= t->tamanho) {
+        return;
+    }
+    va_list args;
+    va_start(args, fmt);
+    int n = vsnprintf(t->buf + t->n, t->tamanho - t->n, fmt, args);
+    va_end(args);
+    if (n > 0) {
+        t->n += n;
+        if (t->n >= t->tamanho) {
+            t->n = t->tamanho - 1;  // Truncado
+        }
+    }
+}
+
+static void escrever_histograma(texto_t *t, const char *nome, const char *ajuda, const histograma_t *h) {
+    escrever(t, "# HELP %s %s\n# TYPE %s histogram\n", nome, ajuda, nome);
+    uint32_t acumulado = 0;
+    for (int i = 0; i < METRICAS_BALDES - 1; i++) {
+        acumulado += h->baldes[i];
+        escrever(t, "%s_bucket{le=\"%lu.%06lu\"} %lu\n", nome,
+                 (unsigned long)(limites_us[i] / 1000000), (unsigned long)(limites_us[i] % 1000000),
+                 (unsigned long)acumulado);
+    }
+    acumulado += h->baldes[METRICAS_BALDES - 1];
+    escrever(t, "%s_bucket{le=\"+Inf\"} %lu\n", nome, (unsigned long)acumulado);
+    escrever(t, "%s_sum %lu.%06lu\n%s_count %lu\n", nome,
+             (unsigned long)(h->soma_us / 1000000), (unsigned long)(h->soma_us % 1000000),
+             nome, (unsigned long)acumulado);
+}
+
+#if MEMP_STATS
+static void escrever_pool(texto_t *t, const char *pool, const struct stats_mem *m) {
+    escrever(t, "robo_lwip_pool{pool=\"%s\",medida=\"usado\"} %lu\n"
+                "robo_lwip_pool{pool=\"%s\",medida=\"maximo\"} %lu\n"
+                "robo_lwip_pool{pool=\"%s\",medida=\"total\"} %lu\n"
+                "robo_lwip_pool{pool=\"%s\",medida=\"falhas\"} %lu\n",
+             pool, (unsigned long)m->used, pool, (unsigned long)m->max,
+             pool, (unsigned long)m->avail, pool, (unsigned long)m->err);
+}
+#endif
+
+int metricas_gerar(char *saida, size_t tamanho, int http_ativas) {
+    texto_t t = { saida, tamanho, 0 };
+
+    escrever(&t, "# HELP robo_http_requisicoes_total Requisicoes HTTP por rota\n"
+                 "# TYPE robo_http_requisicoes_total counter\n");
+    for (int i = 0; i < ROTA_TOTAL; i++) {
+        escrever(&t, "robo_http_requisicoes_total{rota=\"%s\"} %lu\n", nomes_rota[i],
+                 (unsigned long)metricas.requisicoes[i]);
+    }
+    escrever(&t, "# HELP robo_http_resposta_bytes_total Bytes de resposta por rota\n"
+                 "# TYPE robo_http_resposta_bytes_total counter\n");
+    for (int i = 0; i < ROTA_TOTAL; i++) {
+        escrever(&t, "robo_http_resposta_bytes_total{rota=\"%s\"} %lu\n", nomes_rota[i],
+                 (unsigned long)metricas.bytes[i]);
+    }
+    escrever_histograma(&t, "robo_http_latencia_segundos",
+                        "Requisicao completa ate o primeiro byte da resposta", &metricas.latencia_http);
+
+    escrever(&t, "# TYPE robo_conexoes_ativas gauge\n"
+                 "robo_conexoes_ativas{tipo=\"http\"} %d\n"
+                 "robo_conexoes_ativas{tipo=\"sse\"} %d\n"
+                 "robo_conexoes_ativas{tipo=\"ws\"} %d\n",
+             http_ativas, sse_assinantes(), ws_conexoes());
+    escrever(&t, "# TYPE robo_conexoes_aceitas_total counter\nrobo_conexoes_aceitas_total %lu\n",
+             (unsigned long)metricas.conexoes_aceitas);
+    escrever(&t, "# TYPE robo_conexoes_em_espera_total counter\nrobo_conexoes_em_espera_total %lu\n",
+             (unsigned long)metricas.conexoes_em_espera);
+    escrever(&t, "# TYPE robo_conexoes_recusadas_total counter\nrobo_conexoes_recusadas_total %lu\n",
+             (unsigned long)metricas.conexoes_recusadas);
+    escrever(&t, "# HELP robo_conexoes_despejadas_total Conexoes HTTP encerradas pelo servidor\n"
+                 "# TYPE robo_conexoes_despejadas_total counter\n"
+                 "robo_conexoes_despejadas_total{motivo=\"lru\"} %lu\n"
+                 "robo_conexoes_despejadas_total{motivo=\"ocioso\"} %lu\n"
+                 "robo_conexoes_despejadas_total{motivo=\"lwip\"} %lu\n",
+             (unsigned long)metricas.despejos[DESPEJO_LRU], (unsigned long)metricas.despejos[DESPEJO_OCIOSO],
+             (unsigned long)metricas.despejos[DESPEJO_LWIP]);
+
+    escrever(&t, "# HELP robo_http_limitados_total Comandos HTTP recusados com 429 (taxa por cliente)\n"
+                 "# TYPE robo_http_limitados_total counter\n"
+                 "robo_http_limitados_total %lu\n",
+             (unsigned long)metricas.http_limitados);
+
+    escrever(&t, "# HELP robo_udp_total Protocolo de controle UDP\n"
+                 "# TYPE robo_udp_total counter\n"
+                 "robo_udp_total{evento=\"datagrama\"} %lu\n"
+                 "robo_udp_total{evento=\"comando\"} %lu\n"
+                 "robo_udp_total{evento=\"duplicado\"} %lu\n"
+                 "robo_udp_total{evento=\"invalido\"} %lu\n",
+             (unsigned long)metricas.udp_datagramas, (unsigned long)metricas.udp_comandos,
+             (unsigned long)metricas.udp_duplicados, (unsigned long)metricas.udp_invalidos);
+
+    const wifi_estatisticas_t *wifi = wifi_estatisticas();
+    escrever(&t, "# HELP robo_wifi_conectado Enlace Wi-Fi de pe, com IP\n"
+                 "# TYPE robo_wifi_conectado gauge\n"
+                 "robo_wifi_conectado %d\n"
+                 "# HELP robo_wifi_total Gerenciador da conexao Wi-Fi\n"
+                 "# TYPE robo_wifi_total counter\n"
+                 "robo_wifi_total{evento=\"tentativa\"} %lu\n"
+                 "robo_wifi_total{evento=\"falha\"} %lu\n"
+                 "robo_wifi_total{evento=\"queda\"} %lu\n",
+             wifi_conectado() ? 1 : 0, (unsigned long)wifi->tentativas,
+             (unsigned long)wifi->falhas, (unsigned long)wifi->quedas);
+
+    const mqtt_estatisticas_t *mqtt = mqtt_estatisticas();
+    escrever(&t, "# HELP robo_mqtt_conectado Sessao com o broker MQTT de pe\n"
+                 "# TYPE robo_mqtt_conectado gauge\n"
+                 "robo_mqtt_conectado %d\n"
+                 "# HELP robo_mqtt_em_voo Publicacoes QoS 1 aguardando PUBACK\n"
+                 "# TYPE robo_mqtt_em_voo gauge\n"
+                 "robo_mqtt_em_voo %d\n",
+             mqtt_conectado() ? 1 : 0, mqtt_em_voo());
+    escrever(&t, "# HELP robo_mqtt_total Cliente MQTT\n"
+                 "# TYPE robo_mqtt_total counter\n"
+                 "robo_mqtt_total{evento=\"conexao\"} %lu\n"
+                 "robo_mqtt_total{evento=\"falha\"} %lu\n"
+                 "robo_mqtt_total{evento=\"queda\"} %lu\n"
+                 "robo_mqtt_total{evento=\"publicada\"} %lu\n"
+                 "robo_mqtt_total{evento=\"reenviada\"} %lu\n"
+                 "robo_mqtt_total{evento=\"confirmada\"} %lu\n"
+                 "robo_mqtt_total{evento=\"descartada\"} %lu\n"
+                 "robo_mqtt_total{evento=\"recebida\"} %lu\n"
+                 "robo_mqtt_total{evento=\"comando\"} %lu\n"
+                 "robo_mqtt_total{evento=\"invalido\"} %lu\n",
+             (unsigned long)mqtt->conexoes, (unsigned long)mqtt->falhas, (unsigned long)mqtt->quedas,
+             (unsigned long)mqtt->publicadas, (unsigned long)mqtt->reenviadas,
+             (unsigned long)mqtt->confirmadas, (unsigned long)mqtt->descartadas,
+             (unsigned long)mqtt->recebidas, (unsigned long)metricas.mqtt_comandos,
+             (unsigned long)metricas.mqtt_invalidos);
+    escrever(&t, "# HELP robo_mqtt_puback_segundos Publicacao QoS 1 ate o PUBACK do broker\n"
+                 "# TYPE robo_mqtt_puback_segundos summary\n"
+                 "robo_mqtt_puback_segundos_sum %lu.%06lu\n"
+                 "robo_mqtt_puback_segundos_count %lu\n"
+                 "# TYPE robo_mqtt_puback_max_segundos gauge\n"
+                 "robo_mqtt_puback_max_segundos %lu.%06lu\n",
+             (unsigned long)(mqtt->puback_soma_us / 1000000), (unsigned long)(mqtt->puback_soma_us % 1000000),
+             (unsigned long)mqtt->confirmadas,
+             (unsigned long)(mqtt->puback_max_us / 1000000), (unsigned long)(mqtt->puback_max_us % 1000000));
+
+#if MEM_STATS
+    escrever(&t, "# HELP robo_lwip_heap_bytes Heap do lwIP (MEM_SIZE)\n"
+                 "# TYPE robo_lwip_heap_bytes gauge\n"
+                 "robo_lwip_heap_bytes{medida=\"usado\"} %lu\n"
+                 "robo_lwip_heap_bytes{medida=\"maximo\"} %lu\n"
+                 "robo_lwip_heap_bytes{medida=\"total\"} %lu\n",
+             (unsigned long)lwip_stats.mem.used, (unsigned long)lwip_stats.mem.max,
+             (unsigned long)lwip_stats.mem.avail);
+#endif
+#if MEMP_STATS
+    escrever(&t, "# HELP robo_lwip_pool Pools do lwIP (PBUF_POOL_SIZE, MEMP_NUM_TCP_SEG, MEMP_NUM_TCP_PCB)\n"
+                 "# TYPE robo_lwip_pool gauge\n");
+    escrever_pool(&t, "pbuf_pool", lwip_stats.memp[MEMP_PBUF_POOL]);
+    escrever_pool(&t, "tcp_seg", lwip_stats.memp[MEMP_TCP_SEG]);
+    escrever_pool(&t, "tcp_pcb", lwip_stats.memp[MEMP_TCP_PCB]);
+#endif
+#if TCP_STATS
+    escrever(&t, "# TYPE robo_tcp_segmentos_total counter\n"
+                 "robo_tcp_segmentos_total{sentido=\"enviado\"} %lu\n"
+                 "robo_tcp_segmentos_total{sentido=\"recebido\"} %lu\n"
+                 "robo_tcp_segmentos_total{sentido=\"descartado\"} %lu\n",
+             (unsigned long)lwip_stats.tcp.xmit, (unsigned long)lwip_stats.tcp.recv,
+             (unsigned long)lwip_stats.tcp.drop);
+#endif
+
+    escrever(&t, "# HELP robo_atuador_comandos_total Comandos por atuador: aplicados ou coalescidos (substituidos no mesmo tick)\n"
+                 "# TYPE robo_atuador_comandos_total counter\n");
+    for (int i = 0; i < ATUADOR_TOTAL; i++) {
+        escrever(&t, "robo_atuador_comandos_total{atuador=\"%s\",resultado=\"aplicado\"} %lu\n"
+                     "robo_atuador_comandos_total{atuador=\"%s\",resultado=\"coalescido\"} %lu\n",
+                 nomes_atuador[i], (unsigned long)metricas.cmd_aplicados[i],
+                 nomes_atuador[i], (unsigned long)metricas.cmd_coalescidos[i]);
+    }
+    escrever_histograma(&t, "robo_oled_envio_segundos", "Envio do quadro ao OLED (I2C)", &metricas.oled);
+    escrever_histograma(&t, "robo_led_escrita_segundos", "Escrita da matriz de LEDs (PIO)", &metricas.led);
+    return (int)t.n;
+}
@@ -0,0 +1,94 @@
+#ifndef METRICAS_H
+#define METRICAS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/***************************************************************
+ * MÉTRICAS (/metrics, formato de exposição do Prometheus)
+ *
+ * Cada contador tem um único escritor: os callbacks do lwIP no
+ * núcleo 0 ou o laço de renderização no núcleo 1. Registrar é só
+ * um incremento em memória, sem trava nem seção crítica; a leitura
+ * em /metrics pode ver um histograma no meio de uma atualização,
+ * o que é aceitável para monitoramento.
+ **************************************************************/
+typedef enum {
+    ROTA_ARQUIVO = 0,                 // Arquivos de www/
+    ROTA_STATUS,
+    ROTA_LATENCIA,
+    ROTA_NUCLEOS,
+    ROTA_HISTORICO,
+    ROTA_EVENTOS,
+    ROTA_WS,
+    ROTA_ESTADO,
+    ROTA_LEGADO,                      // /robo_on, /robo_off, /matriz_off
+    ROTA_METRICAS,
+    ROTA_DESCONHECIDA,                // 404 e requisições inválidas
+    ROTA_TOTAL
+} metrica_rota_t;
+
+// Motivo do encerramento de uma conexão HTTP pelo servidor
+typedef enum {
+    DESPEJO_LRU = 0,                  // Pool cheio: keep-alive ocioso mais antigo cedeu a vaga
+    DESPEJO_OCIOSO,                   // HTTP_TIMEOUT_OCIOSO_S sem requisições
+    DESPEJO_LWIP,                     // Pool de PCBs do lwIP cheio: tcp_kill_prio escolheu esta
+    DESPEJO_TOTAL
+} metrica_despejo_t;
+
+// Atuador acionado pelo núcleo 1
+typedef enum {
+    ATUADOR_LEDS = 0,                 // Matriz de LEDs (estado ou quadro)
+    ATUADOR_BUZZER,                   // Bipe do estado e tons avulsos
+    ATUADOR_DISPLAY,                  // Mensagem do OLED
+    ATUADOR_TOTAL
+} metrica_atuador_t;
+
+#define METRICAS_BALDES 11            // 10 limites + "+Inf"
+
+typedef struct {
+    volatile uint32_t baldes[METRICAS_BALDES];  // Não cumulativos (acumulados na exportação)
+    volatile uint32_t n;
+    volatile uint32_t soma_us;        // Volta a zero após ~71 min acumulados (tratado como reset)
+} histograma_t;
+
+typedef struct {
+    // Núcleo 0 (callbacks do lwIP)
+    volatile uint32_t requisicoes[ROTA_TOTAL];
+    volatile uint32_t bytes[ROTA_TOTAL];        // Bytes de resposta entregues ao lwIP
+    histograma_t latencia_http;                 // Requisição completa -> primeiro byte da resposta
+    volatile uint32_t conexoes_aceitas;
+    volatile uint32_t conexoes_em_espera;       // Aceitas sem vaga no pool, aguardando uma liberar
+    volatile uint32_t conexoes_recusadas;       // 503: espera por vaga esgotada
+    volatile uint32_t despejos[DESPEJO_TOTAL];  // Conexões encerradas para liberar recursos
+    volatile uint32_t http_limitados;           // 429: cliente acima da taxa de comandos
+    volatile uint32_t udp_datagramas;           // Controle UDP: datagramas recebidos
+    volatile uint32_t udp_comandos;             // Comandos enfileirados
+    volatile uint32_t udp_duplicados;           // Seq repetido (não reaplicado)
+    volatile uint32_t udp_invalidos;
+    volatile uint32_t mqtt_comandos;            // MQTT: comandos do tópico cmd enfileirados
+    volatile uint32_t mqtt_invalidos;           // Mensagens do tópico cmd que não são comando
+    // Núcleo 1 (laço de renderização)
+    histograma_t oled;                          // Envio do quadro ao display por I2C
+    histograma_t led;                           // Escrita da matriz de LEDs pelo PIO
+    volatile uint32_t cmd_aplicados[ATUADOR_TOTAL];    // Escritas feitas no atuador
+    volatile uint32_t cmd_coalescidos[ATUADOR_TOTAL];  // Substituídos por outro comando no mesmo tick
+} metricas_t;
+
+extern metricas_t metricas;
+
+/**
+ * Registra uma duração em um histograma (somente o escritor do histograma)
+ * @param us Duração em microssegundos
+ */
+void histograma_registrar(histograma_t *h, uint32_t us);
+
+/**
+ * Gera o texto de exposição com todas as métricas
+ * Lê as estatísticas do lwIP: chamar dentro do contexto do lwIP.
+ * @param http_ativas Conexões HTTP abertas no momento
+ * @return Bytes escritos em saida
+ */
+int metricas_gerar(char *saida, size_t tamanho, int http_ativas);
+
+#endif
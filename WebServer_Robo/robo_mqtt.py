@@ -0,0 +1,168 @@
+#!/usr/bin/env python3
+"""
+Controle e bench do robô pelo broker MQTT (ver robo_mqtt_iniciar em
+RoboWebServer.c). Requer paho-mqtt >= 2 (pip install paho-mqtt) e um
+broker, ex.: mosquitto -v (porta 1883).
+
+Tópicos: robo/<ID>/temp, robo/<ID>/estado, robo/<ID>/online e
+robo/<ID>/cmd (comandos no formato binário do WebSocket e do UDP).
+Sem --id, o ID é o do primeiro robô online no broker.
+
+Exemplos:
+  robo_mqtt.py ouvir                     # telemetria de todos os robôs
+  robo_mqtt.py estado acordado
+  robo_mqtt.py texto "Ola"
+  robo_mqtt.py tom 880 200
+  robo_mqtt.py bench -n 200              # latência e vazão, QoS 0 x QoS 1
+  robo_mqtt.py --broker 192.168.0.10 bench
+"""
+import argparse
+import queue
+import sys
+import time
+
+import paho.mqtt.client as mqtt
+
+from robo_udp import ESTADOS, cmd_estado, cmd_quadro, cmd_texto, cmd_tom, percentis
+
+
+class Robo:
+    def __init__(self, broker, porta, robo_id=None):
+        self.cli = mqtt.Client(mqtt.CallbackAPIVersion.VERSION2)
+        self.estados = queue.Queue()
+        self.online = queue.Queue()
+        self.cli.on_message = self._mensagem
+        self.cli.connect(broker, porta)
+        self.cli.loop_start()
+        self.cli.subscribe('robo/+/online', qos=1)
+        self.id = robo_id or self._descobrir()
+        self.cli.subscribe('robo/%s/estado' % self.id, qos=1)
+
+    def _mensagem(self, cli, dados, msg):
+        partes = msg.topic.split('/')
+        if partes[-1] == 'online' and msg.payload == b'1':
+            self.online.put(partes[1])
+        elif partes[-1] == 'estado':
+            self.estados.put((time.perf_counter(), msg.payload))
+
+    def _descobrir(self):
+        try:
+            return self.online.get(timeout=3)  # "online" é retido: chega logo na assinatura
+        except queue.Empty:
+            sys.exit('nenhum robô online no broker (use --id)')
+
+    def comando(self, cmd, qos=1):
+        return self.cli.publish('robo/%s/cmd' % self.id, cmd, qos=qos)
+
+    def esperar_estado(self, nome, timeout=2.0):
+        """Espera um evento de estado com o estado dado; retorna o instante de chegada"""
+        fim = time.perf_counter() + timeout
+        alvo = ('"estado":"%s"' % nome).encode()
+        while True:
+            try:
+                t, payload = self.estados.get(timeout=max(0.0, fim - time.perf_counter()))
+            except queue.Empty:
+                return None
+            if alvo in payload:
+                return t
+
+    def drenar(self):
+        while not self.estados.empty():
+            self.estados.get_nowait()
+
+    def fechar(self):
+        self.cli.loop_stop()
+        self.cli.disconnect()
+
+
+def bench(robo, n):
+    estados = ['acordado', 'dormindo']
+
+    # Ida e volta: comando no tópico cmd -> estado publicado pelo robô.
+    # Inclui o tick do núcleo 1 (RENDER_TICK_MS), como o bench do UDP com ack
+    for qos in (0, 1):
+        robo.comando(cmd_estado('apagado'), qos=1).wait_for_publish()
+        robo.esperar_estado('apagado')
+        robo.drenar()
+        rtts = []
+        for i in range(n):
+            nome = estados[i % 2]
+            t0 = time.perf_counter()
+            robo.comando(cmd_estado(nome), qos=qos)
+            t = robo.esperar_estado(nome)
+            if t is not None:
+                rtts.append(t - t0)
+        print('cmd -> estado, QoS %d  :' % qos, percentis(rtts) if rtts else 'sem respostas')
+
+    # Vazão: n comandos seguidos e um estado no fim como marcador. Os
+    # comandos chegam em ordem pela mesma conexão, então o marcador
+    # aplicado indica que todos os anteriores foram recebidos
+    for qos in (0, 1):
+        robo.comando(cmd_estado('apagado'), qos=1).wait_for_publish()
+        robo.esperar_estado('apagado')
+        robo.drenar()
+        t0 = time.perf_counter()
+        for i in range(n):
+            robo.comando(cmd_texto('msg %d' % i), qos=qos)
+        robo.comando(cmd_estado('acordado'), qos=qos)
+        t = robo.esperar_estado('acordado', timeout=10)
+        if t is None:
+            print('vazão, QoS %d          : marcador não chegou (comandos perdidos?)' % qos)
+        else:
+            print('vazão, QoS %d          : %d comandos em %.1f ms (%.0f cmd/s)' % (
+                qos, n + 1, (t - t0) * 1000, (n + 1) / (t - t0)))
+
+
+def ouvir(broker, porta):
+    cli = mqtt.Client(mqtt.CallbackAPIVersion.VERSION2)
+    cli.on_message = lambda c, d, msg: print(time.strftime('%H:%M:%S'), msg.topic,
+                                             msg.payload.decode(errors='replace'))
+    cli.connect(broker, porta)
+    cli.subscribe('robo/#', qos=1)
+    try:
+        cli.loop_forever()
+    except KeyboardInterrupt:
+        pass
+
+
+def main():
+    ap = argparse.ArgumentParser(description='Controle do robô por MQTT')
+    ap.add_argument('--broker', default='127.0.0.1')
+    ap.add_argument('--porta', type=int, default=1883)
+    ap.add_argument('--id', help='ID da placa (padrão: primeiro robô online)')
+    ap.add_argument('--qos', type=int, choices=(0, 1), default=1)
+    sub = ap.add_subparsers(dest='acao', required=True)
+    sub.add_parser('ouvir')
+    sub.add_parser('estado').add_argument('nome', choices=ESTADOS)
+    sub.add_parser('texto').add_argument('texto')
+    p = sub.add_parser('tom')
+    p.add_argument('freq', type=int)
+    p.add_argument('ms', type=int)
+    p = sub.add_parser('quadro', help='preenche a matriz com uma cor')
+    for c in 'rgb':
+        p.add_argument(c, type=int)
+    sub.add_parser('bench').add_argument('-n', type=int, default=200)
+    args = ap.parse_args()
+
+    if args.acao == 'ouvir':
+        ouvir(args.broker, args.porta)
+        return
+
+    robo = Robo(args.broker, args.porta, args.id)
+    if args.acao == 'bench':
+        print('robô %s' % robo.id)
+        bench(robo, args.n)
+    else:
+        cmd = {
+            'estado': lambda: cmd_estado(args.nome),
+            'texto': lambda: cmd_texto(args.texto),
+            'tom': lambda: cmd_tom(args.freq, args.ms),
+            'quadro': lambda: cmd_quadro(args.r, args.g, args.b),
+        }[args.acao]()
+        robo.comando(cmd, qos=args.qos).wait_for_publish()
+        print('publicado em robo/%s/cmd' % robo.id)
+    robo.fechar()
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,172 @@
+#!/usr/bin/env python3
+"""
+Cliente do protocolo binário de controle UDP do robô (ver controle_udp.h).
+
+Exemplos:
+  robo_udp.py 192.168.0.50 estado acordado
+  robo_udp.py 192.168.0.50 texto "Ola"
+  robo_udp.py 192.168.0.50 tom 880 200
+  robo_udp.py 192.168.0.50 quadro 0 0 64
+  robo_udp.py 192.168.0.50 lote            # estado + texto + tom em um datagrama
+  robo_udp.py 192.168.0.50 bench -n 500    # ida e volta: UDP com ack x HTTP
+  robo_udp.py --porta 13005 --porta-http 8080 127.0.0.1 bench   # build nativo (host/)
+"""
+import argparse
+import http.client
+import json
+import random
+import socket
+import statistics
+import struct
+import sys
+import time
+
+PORTA = 5005
+MAGIC = 0x52
+TIPO_COMANDO, TIPO_LOTE, TIPO_ACK = 0x01, 0x02, 0x80
+FLAG_ACK = 0x01
+CMD_ESTADO, CMD_QUADRO, CMD_TEXTO, CMD_TOM = 0x01, 0x02, 0x03, 0x04
+ESTADOS = {'apagado': 0, 'acordado': 1, 'dormindo': 2}
+STATUS = ['ok', 'duplicado', 'fila_cheia', 'invalido']
+
+
+def cmd_estado(nome):
+    return bytes([CMD_ESTADO, ESTADOS[nome]])
+
+
+def cmd_quadro(r, g, b):
+    return bytes([CMD_QUADRO]) + bytes([r, g, b]) * 25
+
+
+def cmd_texto(texto):
+    return bytes([CMD_TEXTO]) + texto.encode('latin-1')[:49]
+
+
+def cmd_tom(freq, ms):
+    return struct.pack('<BHH', CMD_TOM, freq, ms)
+
+
+class Cliente:
+    def __init__(self, host, porta=PORTA, timeout=0.2, tentativas=3):
+        self.destino = (host, porta)
+        self.sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+        self.sock.settimeout(timeout)
+        self.tentativas = tentativas
+        self.seq = random.getrandbits(31)
+
+    def _datagrama(self, tipo, corpo, ack):
+        self.seq = (self.seq + 1) & 0xffffffff
+        return self.seq, struct.pack('<BBBBI', MAGIC, tipo, FLAG_ACK if ack else 0, 0, self.seq) + corpo
+
+    def enviar(self, comandos, ack=True):
+        """Envia um comando (ou um lote) e retorna (status, aplicados, rtt_s)."""
+        if len(comandos) == 1:
+            seq, dg = self._datagrama(TIPO_COMANDO, comandos[0], ack)
+        else:
+            corpo = bytes([len(comandos)]) + b''.join(bytes([len(c)]) + c for c in comandos)
+            seq, dg = self._datagrama(TIPO_LOTE, corpo, ack)
+        if not ack:
+            self.sock.sendto(dg, self.destino)
+            return None, None, None
+
+        # Retransmite com o mesmo seq: o robô não aplica o comando duas vezes
+        for _ in range(self.tentativas):
+            t0 = time.perf_counter()
+            self.sock.sendto(dg, self.destino)
+            try:
+                while True:
+                    resp, _ = self.sock.recvfrom(64)
+                    if len(resp) >= 10 and resp[1] == TIPO_ACK and struct.unpack_from('<I', resp, 4)[0] == seq:
+                        return STATUS[resp[8]], resp[9], time.perf_counter() - t0
+            except socket.timeout:
+                continue
+        return 'sem_resposta', 0, None
+
+
+def percentis(amostras):
+    amostras = sorted(amostras)
+    p = lambda q: amostras[min(len(amostras) - 1, int(q * len(amostras)))] * 1000
+    return 'mediana %.2f ms  p90 %.2f ms  p99 %.2f ms  max %.2f ms  (n=%d)' % (
+        statistics.median(amostras) * 1000, p(0.9), p(0.99), amostras[-1] * 1000, len(amostras))
+
+
+def bench(host, n, porta, porta_http):
+    cli = Cliente(host, porta)
+    estados = ['acordado', 'dormindo']
+
+    udp = []
+    for i in range(n):
+        status, _, rtt = cli.enviar([cmd_estado(estados[i % 2])])
+        if rtt is not None and status in ('ok', 'duplicado'):
+            udp.append(rtt)
+    print('UDP + ack             :', percentis(udp) if udp else 'sem respostas')
+
+    corpo = lambda i: json.dumps({'estado': estados[i % 2]})
+    cab = {'Content-Type': 'application/json'}
+
+    # HTTP com keep-alive: paga só o parsing
+    http_ka = []
+    conn = http.client.HTTPConnection(host, porta_http, timeout=2)
+    for i in range(n):
+        t0 = time.perf_counter()
+        conn.request('POST', '/api/robot/state', corpo(i), cab)
+        conn.getresponse().read()
+        http_ka.append(time.perf_counter() - t0)
+    conn.close()
+    print('HTTP keep-alive       :', percentis(http_ka))
+
+    # HTTP com conexão nova por comando: handshake TCP + parsing
+    http_novo = []
+    for i in range(n):
+        t0 = time.perf_counter()
+        conn = http.client.HTTPConnection(host, porta_http, timeout=2)
+        conn.request('POST', '/api/robot/state', corpo(i), cab)
+        conn.getresponse().read()
+        conn.close()
+        http_novo.append(time.perf_counter() - t0)
+    print('HTTP conexão por cmd  :', percentis(http_novo))
+
+
+def main():
+    ap = argparse.ArgumentParser(description='Controle do robô por UDP')
+    ap.add_argument('host')
+    ap.add_argument('--porta', type=int, default=PORTA)
+    ap.add_argument('--porta-http', type=int, default=80, help='porta HTTP do bench')
+    ap.add_argument('--sem-ack', action='store_true', help='não pede confirmação')
+    sub = ap.add_subparsers(dest='acao', required=True)
+    sub.add_parser('estado').add_argument('nome', choices=ESTADOS)
+    sub.add_parser('texto').add_argument('texto')
+    p = sub.add_parser('tom')
+    p.add_argument('freq', type=int)
+    p.add_argument('ms', type=int)
+    p = sub.add_parser('quadro', help='preenche a matriz com uma cor')
+    for c in 'rgb':
+        p.add_argument(c, type=int)
+    sub.add_parser('lote')
+    sub.add_parser('bench').add_argument('-n', type=int, default=200)
+    args = ap.parse_args()
+
+    if args.acao == 'bench':
+        bench(args.host, args.n, args.porta, args.porta_http)
+        return
+
+    cmds = {
+        'estado': lambda: [cmd_estado(args.nome)],
+        'texto': lambda: [cmd_texto(args.texto)],
+        'tom': lambda: [cmd_tom(args.freq, args.ms)],
+        'quadro': lambda: [cmd_quadro(args.r, args.g, args.b)],
+        'lote': lambda: [cmd_estado('acordado'), cmd_texto('Lote UDP'), cmd_tom(1000, 150)],
+    }[args.acao]()
+
+    status, aplicados, rtt = Cliente(args.host, args.porta).enviar(cmds, ack=not args.sem_ack)
+    if status is None:
+        print('enviado (sem ack)')
+    elif rtt is None:
+        print(status)
+        sys.exit(1)
+    else:
+        print('%s: %d comando(s), %.2f ms' % (status, aplicados, rtt * 1000))
+
+
+if __name__ == '__main__':
+    main()
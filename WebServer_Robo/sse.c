@@ -0,0 +1,221 @@
+#include <stdio.h>
+#include <string.h>
+#include "sse.h"
+
+/***************************************************************
+ * ESTRUTURAS INTERNAS
+ **************************************************************/
+// Slot do buffer de difusão compartilhado por todos os assinantes
+typedef struct {
+    char dados[SSE_SLOT_TAM];
+    u16_t len;
+} sse_slot_t;
+
+// Estado de cada assinante: quanto do fluxo ele já confirmou
+typedef struct {
+    struct altcp_pcb *pcb;   // NULL = livre
+    u32_t seq_ack;         // Evento mais antigo ainda não confirmado
+    u16_t ack_off;         // Bytes já confirmados desse evento
+    u16_t cabecalho;       // Bytes do cabeçalho ainda não confirmados
+    u32_t pulados;         // Bit (seq % SSE_SLOTS): evento não enviado a este assinante
+} sse_assinante_t;
+
+#if SSE_SLOTS > 32
+#error "SSE_SLOTS maior que os bits de sse_assinante_t.pulados"
+#endif
+
+static sse_slot_t slots[SSE_SLOTS];
+static u32_t seq_prox = 0;    // Sequência do próximo evento publicado
+static sse_assinante_t assinantes[SSE_MAX_ASSINANTES];
+static int n_assinantes = 0;
+
+// Cabeçalho da resposta; fica na flash e é enviado sem cópia
+static const char sse_cabecalho[] =
+    "HTTP/1.1 200 OK\r\n"
+    "Content-Type: text/event-stream\r\n"
+    "Cache-Control: no-cache\r\n"
+    "Connection: keep-alive\r\n"
+    "\r\n"
+    "retry: 2000\n\n";
+
+/***************************************************************
+ * FUNÇÕES AUXILIARES
+ **************************************************************/
+/**
+ * Libera o assinante (o PCB já foi liberado ou abortado)
+ */
+static void sse_liberar(sse_assinante_t *s) {
+    s->pcb = NULL;
+    n_assinantes--;
+}
+
+/**
+ * Aborta a conexão do assinante
+ * Usa tcp_abort em vez de tcp_close: segmentos pendentes apontam para
+ * os slots compartilhados e não podem sobreviver à saída do assinante.
+ */
+static void sse_abortar(sse_assinante_t *s) {
+    struct altcp_pcb *pcb = s->pcb;
+    altcp_arg(pcb, NULL);
+    altcp_recv(pcb, NULL);
+    altcp_sent(pcb, NULL);
+    altcp_err(pcb, NULL);
+    sse_liberar(s);
+    altcp_abort(pcb);
+}
+
+/**
+ * Contabiliza bytes confirmados pelo assinante, na ordem do fluxo
+ * Eventos pulados (não enviados a ele) são liberados sem consumir bytes.
+ * @param s Assinante
+ * @param len Bytes confirmados (0 só libera os pulados à frente)
+ */
+static void sse_confirmar(sse_assinante_t *s, u16_t len) {
+    if (s->cabecalho) {
+        u16_t c = len < s->cabecalho ? len : s->cabecalho;
+        s->cabecalho -= c;
+        len -= c;
+    }
+
+    while (s->seq_ack != seq_prox) {
+        u32_t bit = 1u << (s->seq_ack % SSE_SLOTS);
+        if (s->pulados & bit) {
+            s->pulados &= ~bit;
+            s->seq_ack++;
+            continue;
+        }
+        if (len == 0) {
+            break;
+        }
+        const sse_slot_t *slot = &slots[s->seq_ack % SSE_SLOTS];
+        u16_t resta = slot->len - s->ack_off;
+        if (len < resta) {
+            s->ack_off += len;
+            len = 0;
+        } else {
+            len -= resta;
+            s->seq_ack++;
+            s->ack_off = 0;
+        }
+    }
+}
+
+/***************************************************************
+ * CALLBACKS TCP
+ **************************************************************/
+/**
+ * Contabiliza os bytes confirmados e libera os slots correspondentes
+ */
+static err_t sse_sent(void *arg, struct altcp_pcb *tpcb, u16_t len) {
+    sse_confirmar((sse_assinante_t *)arg, len);
+    return ERR_OK;
+}
+
+/**
+ * O cliente não envia nada útil; apenas detecta o fechamento
+ */
+static err_t sse_recv(void *arg, struct altcp_pcb *tpcb, struct pbuf *p, err_t err) {
+    sse_assinante_t *s = (sse_assinante_t *)arg;
+    if (!p) {
+        sse_abortar(s);
+        return ERR_ABRT;
+    }
+    altcp_recved(tpcb, p->tot_len);
+    pbuf_free(p);
+    return ERR_OK;
+}
+
+/**
+ * Callback de erro: o lwIP já liberou o PCB
+ */
+static void sse_err(void *arg, err_t err) {
+    sse_assinante_t *s = (sse_assinante_t *)arg;
+    if (s) {
+        sse_liberar(s);
+    }
+}
+
+/***************************************************************
+ * API PÚBLICA
+ **************************************************************/
+bool sse_assinar(struct altcp_pcb *pcb) {
+    sse_assinante_t *s = NULL;
+    for (int i = 0; i < SSE_MAX_ASSINANTES; i++) {
+        if (!assinantes[i].pcb) {
+            s = &assinantes[i];
+            break;
+        }
+    }
+    if (!s) {
+        return false;
+    }
+
+    if (altcp_write(pcb, sse_cabecalho, sizeof(sse_cabecalho) - 1, 0) != ERR_OK) {
+        return false;
+    }
+
+    s->pcb = pcb;
+    s->seq_ack = seq_prox;  // Recebe apenas eventos futuros
+    s->ack_off = 0;
+    s->cabecalho = sizeof(sse_cabecalho) - 1;
+    s->pulados = 0;
+    n_assinantes++;
+
+    altcp_arg(pcb, s);
+    altcp_recv(pcb, sse_recv);
+    altcp_sent(pcb, sse_sent);
+    altcp_err(pcb, sse_err);
+    altcp_poll(pcb, NULL, 0);  // Remove o poll herdado do servidor HTTP
+    altcp_setprio(pcb, TCP_PRIO_NORMAL);  // Fora do alcance do despejo das conexões HTTP
+    altcp_output(pcb);
+    return true;
+}
+
+void sse_publicar(const char *evento, const char *dados) {
+    if (n_assinantes == 0) {
+        return;
+    }
+
+    // O slot a ser reutilizado ainda está pendente em algum assinante lento?
+    for (int i = 0; i < SSE_MAX_ASSINANTES; i++) {
+        sse_assinante_t *s = &assinantes[i];
+        if (s->pcb && seq_prox - s->seq_ack >= SSE_SLOTS) {
+            printf("SSE: assinante lento desconectado\n");
+            sse_abortar(s);
+        }
+    }
+
+    sse_slot_t *slot = &slots[seq_prox % SSE_SLOTS];
+    int n = snprintf(slot->dados, SSE_SLOT_TAM, "event: %s\ndata: %s\n\n", evento, dados);
+    if (n < 0 || n >= SSE_SLOT_TAM) {
+        printf("SSE: evento '%s' maior que o slot\n", evento);
+        return;
+    }
+    slot->len = (u16_t)n;
+    seq_prox++;
+
+    // Mesmo buffer para todos: o lwIP apenas referencia o slot
+    for (int i = 0; i < SSE_MAX_ASSINANTES; i++) {
+        sse_assinante_t *s = &assinantes[i];
+        if (!s->pcb) {
+            continue;
+        }
+        err_t err = altcp_write(s->pcb, slot->dados, slot->len, 0);
+        if (err == ERR_MEM) {
+            // Fila de envio cheia agora: este evento fica de fora para ele.
+            // Quem não sai disso é pego pela contagem de slots acima
+            s->pulados |= 1u << ((seq_prox - 1) % SSE_SLOTS);
+            sse_confirmar(s, 0);
+            continue;
+        }
+        if (err != ERR_OK) {
+            sse_abortar(s);
+            continue;
+        }
+        altcp_output(s->pcb);
+    }
+}
+
+int sse_assinantes() {
+    return n_assinantes;
+}
@@ -0,0 +1,53 @@
+#ifndef SSE_H
+#define SSE_H
+
+#include <stdbool.h>
+#include "lwip/tcp.h"
+#include "lwip/altcp.h"
+
+/***************************************************************
+ * SERVER-SENT EVENTS (/events)
+ *
+ * Cada evento é formatado uma única vez em um slot do buffer de
+ * difusão e enviado a todos os assinantes sem cópia (PBUF_ROM).
+ * O slot só é reutilizado depois que todos os assinantes
+ * confirmaram (ACK) seus bytes; assinantes lentos demais são
+ * desconectados e o EventSource do navegador reconecta sozinho.
+ * Um evento que não cabe na fila de envio de um assinante (ERR_MEM)
+ * é pulado só para ele.
+ **************************************************************/
+#ifndef SSE_MAX_ASSINANTES
+#define SSE_MAX_ASSINANTES 2     // Conexões /events simultâneas
+#endif
+
+#ifndef SSE_SLOTS
+#define SSE_SLOTS 8              // Eventos em trânsito no buffer de difusão
+#endif
+
+#ifndef SSE_SLOT_TAM
+#define SSE_SLOT_TAM 128         // Tamanho máximo de um evento formatado
+#endif
+
+/**
+ * Assume a conexão como assinante do fluxo de eventos
+ * Envia o cabeçalho text/event-stream e troca os callbacks do PCB.
+ * @param pcb Conexão TCP já aceita
+ * @return false se o limite de assinantes foi atingido ou não houver
+ *         memória; nesse caso a conexão continua com quem chamou
+ */
+bool sse_assinar(struct altcp_pcb *pcb);
+
+/**
+ * Publica um evento para todos os assinantes
+ * Deve ser chamada com o lwIP travado (callback ou cyw43_arch_lwip_begin).
+ * @param evento Nome do evento (campo "event:")
+ * @param dados Dados do evento em uma única linha (campo "data:")
+ */
+void sse_publicar(const char *evento, const char *dados);
+
+/**
+ * Retorna o número de assinantes conectados
+ */
+int sse_assinantes();
+
+#endif
@@ -0,0 +1,157 @@
+#include <stdio.h>
+#include "pico/stdlib.h"
+#include "hardware/adc.h"
+#include "hardware/dma.h"
+#include "temperatura.h"
+
+#define ADC_ENTRADA_TEMP 4      // Canal do sensor interno
+#define ADC_CLOCK_HZ 48000000   // Clock do ADC (clk_adc)
+
+// Buffer circular do DMA: potência de 2 e alinhado ao próprio tamanho
+#define ADC_RING_BITS 10                          // 1024 bytes
+#define ADC_RING_AMOSTRAS ((1u << ADC_RING_BITS) / sizeof(uint16_t))
+
+// Suavização exponencial aplicada sobre cada bloco sobreamostrado
+#define TEMP_ALFA 0.25f
+
+/***************************************************************
+ * VARIÁVEIS INTERNAS
+ **************************************************************/
+static uint16_t adc_ring[ADC_RING_AMOSTRAS] __attribute__((aligned(1u << ADC_RING_BITS)));
+static int dma_chan;
+static uint32_t ring_lido = 0;           // Próxima amostra ainda não processada
+
+static uint32_t bloco_soma = 0;          // Soma das amostras do bloco atual
+static uint32_t bloco_n = 0;             // Amostras no bloco atual
+
+static volatile float temp_filtrada = 0.0f;
+static bool temp_valida = false;
+
+static float historico[TEMP_HIST_TAM];
+static int hist_inicio = 0;
+static int hist_n = 0;
+static absolute_time_t proximo_ponto;
+
+static volatile float estat_min = 0.0f;
+static volatile float estat_max = 0.0f;
+static volatile float estat_media = 0.0f;
+
+/***************************************************************
+ * FUNÇÕES AUXILIARES
+ **************************************************************/
+/**
+ * Converte a média de leituras de 12 bits em graus Celsius
+ */
+static float converter(float bruto) {
+    const float conversion_factor = 3.3f / (1 << 12);
+    return 27.0f - ((bruto * conversion_factor) - 0.706f) / 0.001721f;
+}
+
+/**
+ * (Re)inicia a transferência DMA do FIFO do ADC para o buffer circular
+ */
+static void dma_disparar() {
+    dma_channel_set_trans_count(dma_chan, 0xFFFFFFFFu, true);
+}
+
+/**
+ * Insere um ponto no histórico e recalcula min/max/média da janela
+ */
+static void historico_inserir(float valor) {
+    int pos = (hist_inicio + hist_n) % TEMP_HIST_TAM;
+    historico[pos] = valor;
+    if (hist_n < TEMP_HIST_TAM) {
+        hist_n++;
+    } else {
+        hist_inicio = (hist_inicio + 1) % TEMP_HIST_TAM;
+    }
+
+    float min = historico[hist_inicio];
+    float max = min;
+    float soma = 0.0f;
+    for (int i = 0; i < hist_n; i++) {
+        float v = historico[(hist_inicio + i) % TEMP_HIST_TAM];
+        if (v < min) min = v;
+        if (v > max) max = v;
+        soma += v;
+    }
+    estat_min = min;
+    estat_max = max;
+    estat_media = soma / hist_n;
+}
+
+/***************************************************************
+ * API PÚBLICA
+ **************************************************************/
+void temperatura_iniciar() {
+    adc_init();
+    adc_set_temp_sensor_enabled(true);
+    adc_select_input(ADC_ENTRADA_TEMP);
+    adc_set_round_robin(1u << ADC_ENTRADA_TEMP);
+    adc_fifo_setup(true,    // Resultados vão para o FIFO
+                   true,    // Gera DREQ para o DMA
+                   1,       // DREQ a cada amostra
+                   false,   // Sem bit de erro
+                   false);  // Mantém 12 bits
+    adc_set_clkdiv((float)ADC_CLOCK_HZ / ADC_TAXA_HZ - 1.0f);
+
+    dma_chan = dma_claim_unused_channel(true);
+    dma_channel_config c = dma_channel_get_default_config(dma_chan);
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_16);
+    channel_config_set_read_increment(&c, false);
+    channel_config_set_write_increment(&c, true);
+    channel_config_set_ring(&c, true, ADC_RING_BITS);  // Escrita dá a volta no buffer
+    channel_config_set_dreq(&c, DREQ_ADC);
+    dma_channel_configure(dma_chan, &c, adc_ring, &adc_hw->fifo, 0xFFFFFFFFu, false);
+
+    proximo_ponto = make_timeout_time_ms(TEMP_HIST_PERIODO_MS);
+    dma_disparar();
+    adc_run(true);
+}
+
+void temperatura_processar() {
+    // O contador de transferências esgota após ~49 dias a 1 kHz
+    if (!dma_channel_is_busy(dma_chan)) {
+        dma_disparar();
+    }
+
+    uint32_t escrita = (uint32_t)((uintptr_t)dma_hw->ch[dma_chan].write_addr - (uintptr_t)adc_ring) / sizeof(uint16_t);
+    escrita %= ADC_RING_AMOSTRAS;
+
+    while (ring_lido != escrita) {
+        bloco_soma += adc_ring[ring_lido];
+        ring_lido = (ring_lido + 1) % ADC_RING_AMOSTRAS;
+
+        if (++bloco_n == ADC_SOBREAMOSTRAS) {
+            float t = converter((float)bloco_soma / bloco_n);
+            temp_filtrada = temp_valida ? temp_filtrada + TEMP_ALFA * (t - temp_filtrada) : t;
+            temp_valida = true;
+            bloco_soma = 0;
+            bloco_n = 0;
+        }
+    }
+
+    if (temp_valida && time_reached(proximo_ponto)) {
+        proximo_ponto = make_timeout_time_ms(TEMP_HIST_PERIODO_MS);
+        historico_inserir(temp_filtrada);
+    }
+}
+
+float temperatura_atual() {
+    return temp_filtrada;
+}
+
+void temperatura_estatisticas(float *min, float *max, float *media) {
+    *min = estat_min;
+    *max = estat_max;
+    *media = estat_media;
+}
+
+int temperatura_historico(float *saida, int max) {
+    int n = hist_n < max ? hist_n : max;
+    int inicio = hist_inicio + (hist_n - n);
+    for (int i = 0; i < n; i++) {
+        saida[i] = historico[(inicio + i) % TEMP_HIST_TAM];
+    }
+    return n;
+}
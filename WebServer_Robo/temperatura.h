@@ -0,0 +1,60 @@
+#ifndef TEMPERATURA_H
+#define TEMPERATURA_H
+
+/***************************************************************
+ * AMOSTRAGEM CONTÍNUA DA TEMPERATURA INTERNA
+ *
+ * O ADC roda livre (round-robin no sensor interno) e o DMA copia
+ * o FIFO para um buffer circular, sem uso de CPU. Um worker do
+ * async_context no núcleo 0 chama temperatura_processar()
+ * periodicamente para sobreamostrar, filtrar e atualizar o
+ * histórico; os leitores só consultam valores prontos.
+ **************************************************************/
+#ifndef ADC_TAXA_HZ
+#define ADC_TAXA_HZ 1000              // Amostras por segundo do ADC
+#endif
+
+#ifndef ADC_SOBREAMOSTRAS
+#define ADC_SOBREAMOSTRAS 256         // Amostras brutas por leitura filtrada
+#endif
+
+#ifndef TEMP_HIST_PERIODO_MS
+#define TEMP_HIST_PERIODO_MS 1000     // Intervalo entre pontos do histórico
+#endif
+
+#ifndef TEMP_HIST_TAM
+#define TEMP_HIST_TAM 60              // Pontos no histórico (janela de estatísticas)
+#endif
+
+/**
+ * Configura ADC, FIFO e DMA e inicia a amostragem contínua
+ */
+void temperatura_iniciar();
+
+/**
+ * Consome as amostras já copiadas pelo DMA (chamada pelo worker do ADC, núcleo 0)
+ */
+void temperatura_processar();
+
+/**
+ * Última temperatura filtrada em graus Celsius (O(1))
+ */
+float temperatura_atual();
+
+/**
+ * Estatísticas da janela do histórico (O(1))
+ * @param min Menor valor da janela
+ * @param max Maior valor da janela
+ * @param media Média da janela
+ */
+void temperatura_estatisticas(float *min, float *max, float *media);
+
+/**
+ * Copia o histórico, do ponto mais antigo para o mais recente
+ * @param saida Vetor de destino
+ * @param max Capacidade de saida
+ * @return Número de pontos copiados
+ */
+int temperatura_historico(float *saida, int max);
+
+#endif
@@ -0,0 +1,15 @@
+#include <string.h>
+
+#include "web_fs.h"
+
+const web_arquivo_t *web_fs_buscar(const char *caminho) {
+    if (strcmp(caminho, "/") == 0) {
+        caminho = "/index.html";
+    }
+    for (int i = 0; i < web_fs_total; i++) {
+        if (strcmp(web_fs_arquivos[i].caminho, caminho) == 0) {
+            return &web_fs_arquivos[i];
+        }
+    }
+    return NULL;
+}
@@ -0,0 +1,32 @@
+#ifndef WEB_FS_H
+#define WEB_FS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/***************************************************************
+ * SISTEMA DE ARQUIVOS WEB NA FLASH
+ * Os arquivos de www/ são comprimidos e indexados em tempo de
+ * compilação por gerar_fs_web.py (gera web_fs_dados.c).
+ **************************************************************/
+typedef struct {
+    const char *caminho;      // Caminho publicado ("/index.html", "/app.1a2b3c4d.js")
+    const char *tipo;         // Content-Type
+    const uint8_t *dados;     // Conteúdo (gzip se 'gzip' for true)
+    uint32_t tamanho;         // Bytes em 'dados'
+    const char *etag;         // Hash do conteúdo, já entre aspas
+    bool gzip;                // Enviar com Content-Encoding: gzip
+    bool imutavel;            // Nome contém o hash: pode ficar em cache indefinidamente
+} web_arquivo_t;
+
+extern const web_arquivo_t web_fs_arquivos[];
+extern const int web_fs_total;
+
+/**
+ * Procura um arquivo pelo caminho publicado
+ * @param caminho Caminho da requisição ("/" equivale a "/index.html")
+ * @return Arquivo encontrado ou NULL
+ */
+const web_arquivo_t *web_fs_buscar(const char *caminho);
+
+#endif
@@ -0,0 +1,317 @@
+#include <stdio.h>
+#include <string.h>
+#include "mbedtls/version.h"
+#include "mbedtls/sha1.h"
+#include "mbedtls/base64.h"
+#include "websocket.h"
+
+// GUID fixo definido pela RFC 6455 para o cálculo do Sec-WebSocket-Accept
+#define WS_GUID "258EAFA5-E914-47DA-95CA-C5AB0DC85B11"
+
+// Opcodes de quadro
+#define WS_OP_CONTINUACAO 0x0
+#define WS_OP_TEXTO   0x1
+#define WS_OP_BINARIO 0x2
+#define WS_OP_FECHAR  0x8
+#define WS_OP_PING    0x9
+#define WS_OP_PONG    0xA
+
+// Códigos de fechamento
+#define WS_FECHA_NORMAL    1000
+#define WS_FECHA_PROTOCOLO 1002
+#define WS_FECHA_TIPO      1003
+#define WS_FECHA_GRANDE    1009
+
+/***************************************************************
+ * ESTRUTURAS INTERNAS
+ **************************************************************/
+typedef struct {
+    struct altcp_pcb *pcb;        // NULL = livre
+    uint8_t rx[WS_RX_BUF];      // Quadro parcialmente recebido
+    u16_t rx_len;               // Bytes válidos em rx
+    bool ping_pendente;         // Ping enviado e ainda sem resposta
+} ws_conn_t;
+
+static ws_conn_t conexoes_ws[WS_MAX_CONEXOES];
+static ws_mensagem_fn mensagem_fn = NULL;
+
+/***************************************************************
+ * FUNÇÕES AUXILIARES
+ **************************************************************/
+/**
+ * Envia um quadro do servidor (sem máscara, sempre FIN)
+ * @return Resultado do tcp_write
+ */
+static err_t ws_enviar(ws_conn_t *ws, uint8_t opcode, const uint8_t *dados, u16_t len) {
+    uint8_t cabecalho[4];
+    u16_t n = 2;
+    cabecalho[0] = 0x80 | opcode;
+    if (len < 126) {
+        cabecalho[1] = (uint8_t)len;
+    } else {
+        cabecalho[1] = 126;
+        cabecalho[2] = (uint8_t)(len >> 8);
+        cabecalho[3] = (uint8_t)len;
+        n = 4;
+    }
+
+    err_t err = altcp_write(ws->pcb, cabecalho, n, TCP_WRITE_FLAG_COPY | (len ? TCP_WRITE_FLAG_MORE : 0));
+    if (err == ERR_OK && len) {
+        err = altcp_write(ws->pcb, dados, len, TCP_WRITE_FLAG_COPY);
+    }
+    if (err == ERR_OK) {
+        altcp_output(ws->pcb);
+    }
+    return err;
+}
+
+/**
+ * Desassocia os callbacks e libera a entrada da tabela
+ */
+static void ws_liberar(ws_conn_t *ws) {
+    if (ws->pcb) {
+        altcp_arg(ws->pcb, NULL);
+        altcp_recv(ws->pcb, NULL);
+        altcp_err(ws->pcb, NULL);
+        altcp_poll(ws->pcb, NULL, 0);
+    }
+    ws->pcb = NULL;
+    ws->rx_len = 0;
+}
+
+/**
+ * Envia o quadro de fechamento e encerra a conexão TCP
+ * @return ERR_ABRT se foi necessário abortar o PCB
+ */
+static err_t ws_fechar(ws_conn_t *ws, u16_t codigo) {
+    uint8_t dados[2] = { (uint8_t)(codigo >> 8), (uint8_t)codigo };
+    struct altcp_pcb *pcb = ws->pcb;
+    ws_enviar(ws, WS_OP_FECHAR, dados, sizeof(dados));
+    ws_liberar(ws);
+    if (altcp_close(pcb) != ERR_OK) {
+        altcp_abort(pcb);
+        return ERR_ABRT;
+    }
+    return ERR_OK;
+}
+
+/**
+ * Trata um quadro completo (dados já desmascarados)
+ * @return false se a conexão foi fechada
+ */
+static bool ws_tratar_quadro(ws_conn_t *ws, uint8_t opcode, bool fin, uint8_t *dados, u16_t len, err_t *err) {
+    if ((opcode & 0x8) && !fin) {
+        *err = ws_fechar(ws, WS_FECHA_PROTOCOLO);  // Quadros de controle não podem ser fragmentados
+        return false;
+    }
+    switch (opcode) {
+        case WS_OP_BINARIO:
+            if (!fin) {
+                *err = ws_fechar(ws, WS_FECHA_TIPO);  // Fragmentação não suportada
+                return false;
+            }
+            if (mensagem_fn && len > 0) {
+                mensagem_fn(dados, len);
+            }
+            return true;
+        case WS_OP_PING:
+            ws_enviar(ws, WS_OP_PONG, dados, len);
+            return true;
+        case WS_OP_PONG:
+            return true;
+        case WS_OP_FECHAR:
+            *err = ws_fechar(ws, WS_FECHA_NORMAL);
+            return false;
+        case WS_OP_TEXTO:
+            *err = ws_fechar(ws, WS_FECHA_TIPO);  // Só mensagens binárias
+            return false;
+        case WS_OP_CONTINUACAO:
+            // Nenhuma mensagem fragmentada é aceita, então não há o que continuar
+        default:
+            *err = ws_fechar(ws, WS_FECHA_PROTOCOLO);  // Opcode reservado
+            return false;
+    }
+}
+
+/**
+ * Extrai e trata todos os quadros completos do buffer
+ * @return false se a conexão foi fechada
+ */
+static bool ws_processar(ws_conn_t *ws, err_t *err) {
+    while (ws->rx_len >= 2) {
+        bool fin = ws->rx[0] & 0x80;
+        uint8_t opcode = ws->rx[0] & 0x0F;
+        bool mascarado = ws->rx[1] & 0x80;
+        u16_t len = ws->rx[1] & 0x7F;
+        u16_t pos = 2;
+
+        if (!mascarado) {
+            *err = ws_fechar(ws, WS_FECHA_PROTOCOLO);  // Cliente deve sempre mascarar
+            return false;
+        }
+        if (len == 126) {
+            if (ws->rx_len < 4) return true;
+            len = (u16_t)((ws->rx[2] << 8) | ws->rx[3]);
+            pos = 4;
+        } else if (len == 127) {
+            *err = ws_fechar(ws, WS_FECHA_GRANDE);
+            return false;
+        }
+        if ((u32_t)pos + 4 + len > WS_RX_BUF) {
+            *err = ws_fechar(ws, WS_FECHA_GRANDE);
+            return false;
+        }
+        if (ws->rx_len < pos + 4 + len) {
+            return true;  // Aguarda o restante do quadro
+        }
+
+        const uint8_t *mascara = &ws->rx[pos];
+        uint8_t *dados = &ws->rx[pos + 4];
+        for (u16_t i = 0; i < len; i++) {
+            dados[i] ^= mascara[i & 3];
+        }
+
+        ws->ping_pendente = false;
+        if (!ws_tratar_quadro(ws, opcode, fin, dados, len, err)) {
+            return false;
+        }
+
+        u16_t consumido = pos + 4 + len;
+        ws->rx_len -= consumido;
+        memmove(ws->rx, ws->rx + consumido, ws->rx_len);
+    }
+    return true;
+}
+
+/***************************************************************
+ * CALLBACKS TCP
+ **************************************************************/
+static err_t ws_recv(void *arg, struct altcp_pcb *tpcb, struct pbuf *p, err_t err) {
+    ws_conn_t *ws = (ws_conn_t *)arg;
+    if (!p) {
+        ws_liberar(ws);
+        if (altcp_close(tpcb) != ERR_OK) {
+            altcp_abort(tpcb);
+            return ERR_ABRT;
+        }
+        return ERR_OK;
+    }
+
+    altcp_recved(tpcb, p->tot_len);
+
+    // Consome a cadeia aos pedaços: o buffer comporta um quadro por vez
+    err_t ret = ERR_OK;
+    u16_t off = 0;
+    while (off < p->tot_len) {
+        u16_t livre = WS_RX_BUF - ws->rx_len;
+        u16_t n = p->tot_len - off < livre ? p->tot_len - off : livre;
+        pbuf_copy_partial(p, ws->rx + ws->rx_len, n, off);
+        ws->rx_len += n;
+        off += n;
+        if (!ws_processar(ws, &ret)) {
+            break;
+        }
+    }
+    pbuf_free(p);
+    return ret;
+}
+
+/**
+ * Chamado pelo lwIP a cada WS_PING_INTERVALO: envia ping e derruba
+ * conexões que não responderam ao ping anterior
+ */
+static err_t ws_poll(void *arg, struct altcp_pcb *tpcb) {
+    ws_conn_t *ws = (ws_conn_t *)arg;
+    if (ws->ping_pendente) {
+        printf("WebSocket: sem resposta ao ping, conexão abortada\n");
+        ws_liberar(ws);
+        altcp_abort(tpcb);
+        return ERR_ABRT;
+    }
+    ws->ping_pendente = true;
+    ws_enviar(ws, WS_OP_PING, NULL, 0);
+    return ERR_OK;
+}
+
+static void ws_err(void *arg, err_t err) {
+    ws_conn_t *ws = (ws_conn_t *)arg;
+    if (ws) {
+        ws->pcb = NULL;  // O lwIP já liberou o PCB
+        ws_liberar(ws);
+    }
+}
+
+/***************************************************************
+ * API PÚBLICA
+ **************************************************************/
+void ws_definir_callback(ws_mensagem_fn fn) {
+    mensagem_fn = fn;
+}
+
+bool ws_aceitar(struct altcp_pcb *pcb, const char *chave) {
+    ws_conn_t *ws = NULL;
+    for (int i = 0; i < WS_MAX_CONEXOES; i++) {
+        if (!conexoes_ws[i].pcb) {
+            ws = &conexoes_ws[i];
+            break;
+        }
+    }
+    size_t tam_chave = strlen(chave);
+    if (!ws || tam_chave == 0 || tam_chave > 32) {
+        return false;
+    }
+
+    // Sec-WebSocket-Accept = base64(SHA-1(chave + GUID))
+    char concat[32 + sizeof(WS_GUID)];
+    memcpy(concat, chave, tam_chave);
+    memcpy(concat + tam_chave, WS_GUID, sizeof(WS_GUID) - 1);
+
+    unsigned char hash[20];
+#if MBEDTLS_VERSION_NUMBER < 0x03000000
+    mbedtls_sha1_ret((const unsigned char *)concat, tam_chave + sizeof(WS_GUID) - 1, hash);
+#else
+    mbedtls_sha1((const unsigned char *)concat, tam_chave + sizeof(WS_GUID) - 1, hash);
+#endif
+
+    unsigned char aceite[32];
+    size_t tam_aceite;
+    if (mbedtls_base64_encode(aceite, sizeof(aceite), &tam_aceite, hash, sizeof(hash)) != 0) {
+        return false;
+    }
+
+    char resposta[160];
+    int n = snprintf(resposta, sizeof(resposta),
+                     "HTTP/1.1 101 Switching Protocols\r\n"
+                     "Upgrade: websocket\r\n"
+                     "Connection: Upgrade\r\n"
+                     "Sec-WebSocket-Accept: %s\r\n"
+                     "\r\n",
+                     aceite);
+    if (altcp_write(pcb, resposta, n, TCP_WRITE_FLAG_COPY) != ERR_OK) {
+        return false;
+    }
+
+    ws->pcb = pcb;
+    ws->rx_len = 0;
+    ws->ping_pendente = false;
+
+    altcp_arg(pcb, ws);
+    altcp_recv(pcb, ws_recv);
+    altcp_sent(pcb, NULL);  // Remove o tcp_sent herdado do servidor HTTP
+    altcp_err(pcb, ws_err);
+    altcp_poll(pcb, ws_poll, WS_PING_INTERVALO);
+    altcp_setprio(pcb, TCP_PRIO_NORMAL);  // Fora do alcance do despejo das conexões HTTP
+    altcp_nagle_disable(pcb);  // Pong e respostas curtas saem imediatamente
+    altcp_output(pcb);
+    return true;
+}
+
+int ws_conexoes() {
+    int n = 0;
+    for (int i = 0; i < WS_MAX_CONEXOES; i++) {
+        if (conexoes_ws[i].pcb) {
+            n++;
+        }
+    }
+    return n;
+}
@@ -0,0 +1,60 @@
+#ifndef WEBSOCKET_H
+#define WEBSOCKET_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "lwip/tcp.h"
+#include "lwip/altcp.h"
+
+/***************************************************************
+ * WEBSOCKET (/ws) SOBRE O TCP RAW DO lwIP
+ *
+ * Suporta apenas o necessário para controle em tempo real:
+ * handshake RFC 6455, quadros binários não fragmentados vindos
+ * do navegador, ping/pong e fechamento.
+ **************************************************************/
+#ifndef WS_MAX_CONEXOES
+#define WS_MAX_CONEXOES 2        // Conexões WebSocket simultâneas
+#endif
+
+#ifndef WS_RX_BUF
+#define WS_RX_BUF 160            // Maior quadro aceito (cabeçalho + máscara + dados)
+#endif
+
+#ifndef WS_PING_INTERVALO
+#define WS_PING_INTERVALO 10     // Intervalo de ping em unidades de 500 ms (5 s)
+#endif
+
+// Comandos binários (primeiro byte da mensagem)
+#define WS_CMD_ESTADO 0x01       // [estado]: 0 apagado, 1 acordado, 2 dormindo
+#define WS_CMD_QUADRO 0x02       // [75 bytes]: 25 pixels RGB, linha a linha
+#define WS_CMD_TEXTO  0x03       // [texto]: mensagem para o display
+#define WS_CMD_TOM    0x04       // [freq u16][duração ms u16], little-endian
+
+/**
+ * Função chamada para cada mensagem binária recebida
+ * @param dados Mensagem já desmascarada
+ * @param len Tamanho da mensagem
+ */
+typedef void (*ws_mensagem_fn)(const uint8_t *dados, uint16_t len);
+
+/**
+ * Define quem trata as mensagens binárias recebidas
+ */
+void ws_definir_callback(ws_mensagem_fn fn);
+
+/**
+ * Conclui o upgrade HTTP -> WebSocket e assume o PCB
+ * @param pcb Conexão que enviou o pedido de upgrade
+ * @param chave Valor do cabeçalho Sec-WebSocket-Key
+ * @return false se não houver conexão livre ou a chave for inválida;
+ *         nesse caso a conexão continua com quem chamou
+ */
+bool ws_aceitar(struct altcp_pcb *pcb, const char *chave);
+
+/**
+ * Retorna o número de conexões WebSocket abertas
+ */
+int ws_conexoes();
+
+#endif
@@ -0,0 +1,38 @@
+function $(i) { return document.getElementById(i); }
+
+function show(s) {
+  if (s.estado) $('estado').textContent = 'Estado: ' + s.estado;
+  if (s.temp !== undefined) $('temp').textContent = s.temp.toFixed(2);
+}
+
+// Comandos via API JSON (sem recarregar a página)
+function cmd(e) {
+  fetch('/api/robot/state', {
+    method: 'POST',
+    headers: {'Content-Type': 'application/json'},
+    body: JSON.stringify({estado: e})
+  }).then(function (r) { if (r.status == 204) show({estado: e}); });
+}
+
+fetch('/api/status').then(function (r) { return r.json(); }).then(show);
+
+// Atualizações empurradas pelo robô
+var es = new EventSource('/events');
+es.addEventListener('estado', function (e) { show(JSON.parse(e.data)); });
+es.addEventListener('temp', function (e) { show(JSON.parse(e.data)); });
+
+// Matriz 5x5: cada clique envia o quadro completo pelo WebSocket
+// (wss:// quando a página veio pelo HTTPS, senão o navegador bloqueia)
+var ws = new WebSocket((location.protocol === 'https:' ? 'wss://' : 'ws://') + location.host + '/ws'), px = new Uint8Array(76);
+px[0] = 2;
+for (var y = 0; y < 5; y++) {
+  var tr = $('m').insertRow();
+  for (var x = 0; x < 5; x++) (function (c, o) {
+    c.onclick = function () {
+      var v = px[o] ? 0 : 64;
+      px[o] = px[o + 1] = px[o + 2] = v;
+      c.style.background = v ? '#fff' : '#222';
+      if (ws.readyState == 1) ws.send(px);
+    };
+  })(tr.insertCell(), 1 + (y * 5 + x) * 3);
+}
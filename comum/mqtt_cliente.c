@@ -0,0 +1,738 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "pico/cyw43_arch.h"
+#include "pico/rand.h"
+#include "lwip/tcp.h"
+#include "lwip/altcp.h"
+#include "lwip/altcp_tcp.h"
+#include "wifi.h"
+#include "mqtt_cliente.h"
+
+/***************************************************************
+ * PACOTES DO MQTT 3.1.1 (tipo nos 4 bits altos do primeiro byte)
+ **************************************************************/
+#define PKT_CONNECT     0x10
+#define PKT_CONNACK     0x20
+#define PKT_PUBLISH     0x30
+#define PKT_PUBACK      0x40
+#define PKT_SUBSCRIBE   0x82     // Bits reservados 0010
+#define PKT_SUBACK      0x90
+#define PKT_PINGREQ     0xC0
+#define PKT_PINGRESP    0xD0
+
+#define PUBLISH_DUP     0x08
+#define PUBLISH_RETAIN  0x01
+
+#define CONNECT_LIMPA   0x02
+#define CONNECT_WILL    0x04
+#define CONNECT_WILL_Q1 0x08
+#define CONNECT_WILL_RT 0x20
+#define CONNECT_SENHA   0x40
+#define CONNECT_USUARIO 0x80
+
+#define MQTT_POLL_INTERVALO 2    // altcp_poll a cada 1 s (unidades de 500 ms)
+#define CABECALHO_MAX 5          // Tipo + até 4 bytes de tamanho restante
+
+// Fases da leitura de um pacote
+enum { RX_TIPO, RX_TAMANHO, RX_CORPO, RX_DESCARTE };
+
+/***************************************************************
+ * VARIÁVEIS INTERNAS
+ **************************************************************/
+// Publicação QoS 1 aguardando PUBACK
+typedef struct {
+    bool usada;
+    bool enviada;                // Na conexão atual
+    bool dup;                    // Já saiu numa conexão anterior
+    bool reter;
+    uint16_t id;
+    uint16_t topico_len;
+    uint16_t len;
+    uint32_t ordem;              // Ordem de publicação, mantida nos reenvios
+    uint32_t t_us;               // Último envio
+    uint8_t dados[MQTT_MENSAGEM_MAX];   // Tópico seguido do conteúdo
+} em_voo_t;
+
+static ip_addr_t broker_ip;
+static u16_t broker_porta;
+static mqtt_config_t config;
+
+static mqtt_estado_t estado = MQTT_PARADO;
+static struct altcp_pcb *pcb = NULL;
+static uint8_t falhas_seguidas;          // Zerado no CONNACK
+static bool recusado;                    // CONNACK recusou credenciais ou ID: espera o máximo
+static mqtt_estatisticas_t estatisticas;
+
+static struct {
+    const char *filtro;
+    uint8_t qos;
+} assinaturas[MQTT_ASSINATURAS_MAX];
+static int n_assinaturas;
+
+static em_voo_t em_voo[MQTT_EM_VOO];
+static uint32_t ordem_prox;
+static uint16_t id_prox = 1;
+
+static uint32_t t_ultimo_envio;          // Para o PINGREQ
+static uint32_t t_ping;
+static bool ping_pendente;
+
+// Fora da pilha: o callback de recepção roda no contexto do lwIP e nunca é reentrante
+static uint8_t rx_buf[MQTT_RX_MAX];
+static uint8_t rx_fase = RX_TIPO;
+static uint8_t rx_tipo;
+static uint8_t rx_digitos;
+static uint32_t rx_tam;
+static uint32_t rx_lidos;
+static bool rx_ocupado;                  // A aplicação recusou o PUBLISH em rx_buf
+static uint16_t rx_pular;                // Bytes do pbuf recusado já consumidos
+static const char *rx_erro;              // Motivo para derrubar a conexão
+
+static void trabalho_relogio(async_context_t *ctx, async_at_time_worker_t *worker);
+static async_at_time_worker_t worker_relogio = { .do_work = trabalho_relogio };
+
+/***************************************************************
+ * FUNÇÕES INTERNAS: CODIFICAÇÃO
+ **************************************************************/
+static uint8_t *escrever_u16(uint8_t *p, uint16_t v) {
+    *p++ = (uint8_t)(v >> 8);
+    *p++ = (uint8_t)v;
+    return p;
+}
+
+static uint8_t *escrever_texto(uint8_t *p, const char *texto, uint16_t len) {
+    p = escrever_u16(p, len);
+    memcpy(p, texto, len);
+    return p + len;
+}
+
+/**
+ * Cabeçalho fixo: tipo e tamanho restante (1 a 4 bytes, 7 bits por byte)
+ */
+static uint8_t *escrever_cabecalho(uint8_t *p, uint8_t tipo, uint32_t restante) {
+    *p++ = tipo;
+    do {
+        uint8_t b = restante & 0x7F;
+        restante >>= 7;
+        *p++ = restante ? (b | 0x80) : b;
+    } while (restante);
+    return p;
+}
+
+static uint16_t ler_u16(const uint8_t *p) {
+    return (uint16_t)(p[0] << 8 | p[1]);
+}
+
+/***************************************************************
+ * FUNÇÕES INTERNAS: ENVIO
+ **************************************************************/
+/**
+ * Entrega um pacote inteiro ao TCP, ou nada dele
+ * @return ERR_CONN sem conexão, ERR_MEM sem espaço no envio
+ */
+static err_t enviar(const uint8_t *pacote, uint16_t len) {
+    if (!pcb) {
+        return ERR_CONN;
+    }
+    if (altcp_sndbuf(pcb) < len || altcp_sndqueuelen(pcb) >= TCP_SND_QUEUELEN) {
+        return ERR_MEM;
+    }
+    err_t err = altcp_write(pcb, pacote, len, TCP_WRITE_FLAG_COPY);
+    if (err != ERR_OK) {
+        return err;
+    }
+    altcp_output(pcb);
+    t_ultimo_envio = time_us_32();
+    return ERR_OK;
+}
+
+static err_t enviar_publish(const uint8_t *topico, uint16_t topico_len, const uint8_t *dados, uint16_t len,
+                            uint8_t qos, bool reter, bool dup, uint16_t id) {
+    uint8_t pacote[CABECALHO_MAX + 2 + 2 + MQTT_MENSAGEM_MAX];
+    uint8_t tipo = PKT_PUBLISH | (qos << 1) | (dup ? PUBLISH_DUP : 0) | (reter ? PUBLISH_RETAIN : 0);
+    uint8_t *p = escrever_cabecalho(pacote, tipo, 2u + topico_len + (qos ? 2 : 0) + len);
+    p = escrever_u16(p, topico_len);
+    memcpy(p, topico, topico_len);
+    p += topico_len;
+    if (qos) {
+        p = escrever_u16(p, id);
+    }
+    memcpy(p, dados, len);
+    p += len;
+    return enviar(pacote, (uint16_t)(p - pacote));
+}
+
+static err_t enviar_connect(void) {
+    uint8_t pacote[CABECALHO_MAX + 10 + 5 * (2 + MQTT_TOPICO_MAX)];
+    const char *textos[] = { config.id, config.will_topico, config.will_topico ? config.will_msg : NULL,
+                             config.usuario, config.usuario ? config.senha : NULL };
+    uint8_t flags = CONNECT_LIMPA;
+    uint32_t restante = 10;
+    for (int i = 0; i < 5; i++) {
+        if (textos[i] && strlen(textos[i]) > MQTT_TOPICO_MAX) {
+            return ERR_VAL;
+        }
+        restante += textos[i] ? 2 + strlen(textos[i]) : 0;
+    }
+    if (config.will_topico) {
+        flags |= CONNECT_WILL | CONNECT_WILL_Q1 | CONNECT_WILL_RT;
+    }
+    if (config.usuario) {
+        flags |= CONNECT_USUARIO | (config.senha ? CONNECT_SENHA : 0);
+    }
+
+    uint8_t *p = escrever_cabecalho(pacote, PKT_CONNECT, restante);
+    p = escrever_texto(p, "MQTT", 4);
+    *p++ = 4;                                  // Nível do protocolo: 3.1.1
+    *p++ = flags;
+    p = escrever_u16(p, MQTT_KEEPALIVE_S);
+    for (int i = 0; i < 5; i++) {
+        if (textos[i]) {
+            p = escrever_texto(p, textos[i], (uint16_t)strlen(textos[i]));
+        }
+    }
+    return enviar(pacote, (uint16_t)(p - pacote));
+}
+
+static uint16_t novo_id(void) {
+    for (;;) {
+        uint16_t id = id_prox++;
+        if (id == 0) {
+            continue;
+        }
+        bool em_uso = false;
+        for (int i = 0; i < MQTT_EM_VOO; i++) {
+            em_uso |= em_voo[i].usada && em_voo[i].id == id;
+        }
+        if (!em_uso) {
+            return id;
+        }
+    }
+}
+
+/**
+ * Envia as publicações QoS 1 ainda não enviadas nesta conexão, na ordem
+ * em que foram feitas, até faltar espaço no envio
+ */
+static void descarregar_em_voo(void) {
+    while (estado == MQTT_CONECTADO) {
+        em_voo_t *m = NULL;
+        for (int i = 0; i < MQTT_EM_VOO; i++) {
+            if (em_voo[i].usada && !em_voo[i].enviada && (!m || (int32_t)(em_voo[i].ordem - m->ordem) < 0)) {
+                m = &em_voo[i];
+            }
+        }
+        if (!m || enviar_publish(m->dados, m->topico_len, m->dados + m->topico_len, m->len,
+                                 1, m->reter, m->dup, m->id) != ERR_OK) {
+            return;
+        }
+        if (m->dup) {
+            estatisticas.reenviadas++;
+        } else {
+            estatisticas.publicadas++;
+        }
+        m->enviada = true;
+        m->dup = true;
+        m->t_us = time_us_32();
+    }
+}
+
+static void assinar_todas(void) {
+    for (int i = 0; i < n_assinaturas; i++) {
+        uint8_t pacote[CABECALHO_MAX + 2 + 2 + MQTT_TOPICO_MAX + 1];
+        uint16_t len = (uint16_t)strlen(assinaturas[i].filtro);
+        uint8_t *p = escrever_cabecalho(pacote, PKT_SUBSCRIBE, 2u + 2 + len + 1);
+        p = escrever_u16(p, novo_id());
+        p = escrever_texto(p, assinaturas[i].filtro, len);
+        *p++ = assinaturas[i].qos;
+        if (enviar(pacote, (uint16_t)(p - pacote)) != ERR_OK) {
+            printf("MQTT: falha ao assinar %s\n", assinaturas[i].filtro);
+        }
+    }
+}
+
+/***************************************************************
+ * FUNÇÕES INTERNAS: CONEXÃO
+ **************************************************************/
+/**
+ * (Re)agenda o relógio: prazo do CONNACK ou fim do backoff
+ */
+static void agendar(uint32_t ms) {
+    async_context_t *ctx = cyw43_arch_async_context();
+    async_context_remove_at_time_worker(ctx, &worker_relogio);
+    async_context_add_at_time_worker_in_ms(ctx, &worker_relogio, ms);
+}
+
+/**
+ * Sorteia a espera até a próxima tentativa, como no Wi-Fi: o teto
+ * dobra a cada falha seguida e a espera fica entre metade e o teto
+ */
+static uint32_t sortear_espera(void) {
+    uint32_t teto = MQTT_BACKOFF_MAX_MS;
+    if (!recusado && falhas_seguidas < 16 && ((uint32_t)MQTT_BACKOFF_MIN_MS << falhas_seguidas) < MQTT_BACKOFF_MAX_MS) {
+        teto = (uint32_t)MQTT_BACKOFF_MIN_MS << falhas_seguidas;
+    }
+    return teto / 2 + get_rand_32() % (teto / 2 + 1);
+}
+
+/**
+ * Solta o PCB sem callbacks e prepara o reenvio do QoS 1 pendente
+ */
+static void soltar_pcb(void) {
+    if (pcb) {
+        altcp_arg(pcb, NULL);
+        altcp_recv(pcb, NULL);
+        altcp_sent(pcb, NULL);
+        altcp_err(pcb, NULL);
+        altcp_poll(pcb, NULL, 0);
+        altcp_abort(pcb);
+        pcb = NULL;
+    }
+    rx_fase = RX_TIPO;
+    rx_ocupado = false;
+    rx_pular = 0;
+    ping_pendente = false;
+    for (int i = 0; i < MQTT_EM_VOO; i++) {
+        em_voo[i].enviada = false;
+    }
+}
+
+/**
+ * A tentativa falhou ou a sessão caiu: espera o backoff, ou o Wi-Fi
+ * se o enlace também caiu
+ */
+static void encerrar(const char *motivo) {
+    bool sessao = estado == MQTT_CONECTADO;
+    soltar_pcb();
+    if (sessao) {
+        estatisticas.quedas++;
+    } else {
+        estatisticas.falhas++;
+    }
+
+    if (!wifi_conectado()) {
+        estado = MQTT_SEM_REDE;
+        async_context_remove_at_time_worker(cyw43_arch_async_context(), &worker_relogio);
+        printf("MQTT: %s\n", motivo);
+    } else {
+        uint32_t espera = sortear_espera();
+        if (falhas_seguidas < UINT8_MAX) {
+            falhas_seguidas++;
+        }
+        estado = MQTT_ESPERA;
+        printf("MQTT: %s, nova tentativa em %lu ms\n", motivo, (unsigned long)espera);
+        agendar(espera);
+    }
+    if (sessao && config.conexao_fn) {
+        config.conexao_fn(config.arg, false);
+    }
+}
+
+/**
+ * Para usar dentro dos callbacks do PCB: encerra e devolve ERR_ABRT ao lwIP
+ */
+static err_t derrubar(const char *motivo) {
+    encerrar(motivo);
+    return ERR_ABRT;
+}
+
+static void sessao_iniciada(void) {
+    estado = MQTT_CONECTADO;
+    falhas_seguidas = 0;
+    recusado = false;
+    estatisticas.conexoes++;
+    async_context_remove_at_time_worker(cyw43_arch_async_context(), &worker_relogio);
+    printf("MQTT: conectado a %s:%u\n", ipaddr_ntoa(&broker_ip), broker_porta);
+    assinar_todas();
+    descarregar_em_voo();
+    if (config.conexao_fn) {
+        config.conexao_fn(config.arg, true);
+    }
+}
+
+/**
+ * Trata um pacote completo do broker. Um PUBLISH recusado pela aplicação
+ * fica em rx_buf com rx_ocupado, sem PUBACK, para ser tratado de novo
+ * @return false se o pacote é inválido ou encerra a sessão (motivo em rx_erro)
+ */
+static bool tratar_pacote(uint8_t tipo, const uint8_t *corpo, uint32_t len) {
+    switch (tipo & 0xF0) {
+    case PKT_CONNACK:
+        if (estado != MQTT_CONECTANDO || len < 2) {
+            rx_erro = "CONNACK inesperado";
+            return false;
+        }
+        if (corpo[1] != 0) {
+            // 2: ID rejeitado; 4 e 5: credenciais. Insistir não adianta: espera o máximo
+            recusado = corpo[1] == 2 || corpo[1] == 4 || corpo[1] == 5;
+            rx_erro = "conexão recusada pelo broker";
+            printf("MQTT: CONNACK com código %u\n", corpo[1]);
+            return false;
+        }
+        sessao_iniciada();
+        return true;
+
+    case PKT_PUBLISH: {
+        uint8_t qos = (tipo >> 1) & 0x03;
+        uint16_t topico_len = len >= 2 ? ler_u16(corpo) : 0;
+        uint32_t inicio = 2u + topico_len + (qos ? 2 : 0);
+        if (estado != MQTT_CONECTADO || len < 2 || inicio > len || qos > 1) {
+            rx_erro = "PUBLISH inválido";
+            return false;
+        }
+        if (topico_len < MQTT_TOPICO_MAX) {
+            char topico[MQTT_TOPICO_MAX];
+            memcpy(topico, corpo + 2, topico_len);
+            topico[topico_len] = '\0';
+            if (config.mensagem_fn &&
+                !config.mensagem_fn(config.arg, topico, corpo + inicio, (uint16_t)(len - inicio))) {
+                rx_ocupado = true;
+                return true;
+            }
+            estatisticas.recebidas++;
+        } else {
+            printf("MQTT: tópico recebido grande demais (%u bytes)\n", topico_len);
+        }
+        if (qos == 1 && pcb) {
+            uint8_t puback[4] = { PKT_PUBACK, 2 };
+            memcpy(&puback[2], corpo + 2 + topico_len, 2);
+            enviar(puback, sizeof(puback));
+        }
+        return pcb != NULL;
+    }
+
+    case PKT_PUBACK:
+        if (len >= 2) {
+            uint16_t id = ler_u16(corpo);
+            for (int i = 0; i < MQTT_EM_VOO; i++) {
+                em_voo_t *m = &em_voo[i];
+                if (m->usada && m->enviada && m->id == id) {
+                    uint32_t rtt = time_us_32() - m->t_us;
+                    estatisticas.confirmadas++;
+                    estatisticas.puback_ultimo_us = rtt;
+                    estatisticas.puback_soma_us += rtt;
+                    if (rtt > estatisticas.puback_max_us) {
+                        estatisticas.puback_max_us = rtt;
+                    }
+                    m->usada = false;
+                    break;
+                }
+            }
+        }
+        return true;
+
+    case PKT_SUBACK:
+        if (len >= 3 && corpo[2] == 0x80) {
+            printf("MQTT: assinatura recusada pelo broker\n");
+        }
+        return true;
+
+    case PKT_PINGRESP:
+        ping_pendente = false;
+        return true;
+
+    default:
+        return true;                // PUBREC e afins não ocorrem com QoS <= 1
+    }
+}
+
+/**
+ * Consome bytes da conexão, remontando os pacotes em rx_buf. Para logo
+ * depois de um PUBLISH recusado pela aplicação (rx_ocupado)
+ * @param usados Bytes consumidos
+ * @return false se a conexão deve ser derrubada
+ */
+static bool consumir(const uint8_t *dados, uint16_t len, uint16_t *usados) {
+    uint16_t i = 0;
+    *usados = 0;
+    while (i < len && !rx_ocupado) {
+        switch (rx_fase) {
+        case RX_TIPO:
+            rx_tipo = dados[i++];
+            rx_tam = 0;
+            rx_digitos = 0;
+            rx_fase = RX_TAMANHO;
+            break;
+
+        case RX_TAMANHO: {
+            uint8_t b = dados[i++];
+            rx_tam |= (uint32_t)(b & 0x7F) << (7 * rx_digitos++);
+            if (b & 0x80) {
+                if (rx_digitos == 4) {
+                    rx_erro = "tamanho de pacote inválido";
+                    return false;
+                }
+                break;
+            }
+            rx_lidos = 0;
+            if (rx_tam == 0) {
+                rx_fase = RX_TIPO;
+                if (!tratar_pacote(rx_tipo, rx_buf, 0)) {
+                    return false;
+                }
+            } else if (rx_tam > MQTT_RX_MAX) {
+                printf("MQTT: pacote de %lu bytes descartado\n", (unsigned long)rx_tam);
+                rx_fase = RX_DESCARTE;
+            } else {
+                rx_fase = RX_CORPO;
+            }
+            break;
+        }
+
+        default: {
+            uint32_t n = rx_tam - rx_lidos < (uint32_t)(len - i) ? rx_tam - rx_lidos : (uint32_t)(len - i);
+            if (rx_fase == RX_CORPO) {
+                memcpy(rx_buf + rx_lidos, dados + i, n);
+            }
+            rx_lidos += n;
+            i += n;
+            if (rx_lidos == rx_tam) {
+                bool corpo = rx_fase == RX_CORPO;
+                rx_fase = RX_TIPO;
+                if (corpo && !tratar_pacote(rx_tipo, rx_buf, rx_tam)) {
+                    return false;
+                }
+            }
+            break;
+        }
+        }
+        *usados = i;
+    }
+    return true;
+}
+
+/***************************************************************
+ * CALLBACKS DO PCB
+ **************************************************************/
+static err_t mqtt_recv(void *arg, struct altcp_pcb *tpcb, struct pbuf *p, err_t err) {
+    if (!p) {
+        return derrubar("o broker fechou a conexão");
+    }
+    rx_erro = NULL;
+    if (rx_ocupado) {
+        // Reentrega de um pbuf recusado: primeiro a mensagem que ficou em rx_buf
+        rx_ocupado = false;
+        if (!tratar_pacote(rx_tipo, rx_buf, rx_tam)) {
+            pbuf_free(p);
+            return pcb ? derrubar(rx_erro ? rx_erro : "protocolo") : ERR_ABRT;
+        }
+        if (rx_ocupado) {
+            return ERR_MEM;
+        }
+    }
+
+    u16_t inicio = 0;                          // Posição de q na cadeia
+    for (struct pbuf *q = p; q; inicio += q->len, q = q->next) {
+        if (inicio + q->len <= rx_pular) {
+            continue;                          // Consumido antes da recusa
+        }
+        u16_t desde = rx_pular > inicio ? rx_pular - inicio : 0;
+        uint16_t usados;
+        if (!consumir((const uint8_t *)q->payload + desde, q->len - desde, &usados)) {
+            pbuf_free(p);
+            // Sessão já encerrada dentro do pacote (pcb solto) ou pacote inválido
+            return pcb ? derrubar(rx_erro ? rx_erro : "protocolo") : ERR_ABRT;
+        }
+        if (rx_ocupado) {
+            // O lwIP guarda o pbuf e entrega de novo; a janela não reabre até lá
+            rx_pular = inicio + desde + usados;
+            return ERR_MEM;
+        }
+    }
+    rx_pular = 0;
+    altcp_recved(tpcb, p->tot_len);
+    pbuf_free(p);
+    return ERR_OK;
+}
+
+static err_t mqtt_sent(void *arg, struct altcp_pcb *tpcb, u16_t len) {
+    descarregar_em_voo();
+    return ERR_OK;
+}
+
+/**
+ * A cada segundo: keep-alive (PINGREQ e resposta) e prazo dos PUBACK
+ */
+static err_t mqtt_poll(void *arg, struct altcp_pcb *tpcb) {
+    if (estado != MQTT_CONECTADO) {
+        return ERR_OK;
+    }
+    uint32_t agora = time_us_32();
+    if (ping_pendente && agora - t_ping > MQTT_KEEPALIVE_S * 1000000u) {
+        return derrubar("sem resposta ao PINGREQ");
+    }
+    for (int i = 0; i < MQTT_EM_VOO; i++) {
+        if (em_voo[i].usada && em_voo[i].enviada && agora - em_voo[i].t_us > MQTT_PUBACK_MAX_MS * 1000u) {
+            return derrubar("PUBACK atrasado");
+        }
+    }
+    if (!ping_pendente && agora - t_ultimo_envio >= MQTT_KEEPALIVE_S * 500000u) {
+        static const uint8_t pingreq[2] = { PKT_PINGREQ, 0 };
+        if (enviar(pingreq, sizeof(pingreq)) == ERR_OK) {
+            ping_pendente = true;
+            t_ping = agora;
+        }
+    }
+    descarregar_em_voo();
+    return ERR_OK;
+}
+
+/**
+ * O lwIP já liberou o PCB (RST, falha na conexão ou tcp_abort)
+ */
+static void mqtt_err(void *arg, err_t err) {
+    pcb = NULL;
+    char motivo[40];
+    snprintf(motivo, sizeof(motivo), "conexão perdida (erro %d)", err);
+    encerrar(motivo);
+}
+
+static err_t mqtt_conectado_tcp(void *arg, struct altcp_pcb *tpcb, err_t err) {
+    altcp_nagle_disable(tpcb);   // Pacotes pequenos e sensíveis à latência
+    rx_fase = RX_TIPO;
+    if (enviar_connect() != ERR_OK) {
+        return derrubar("falha ao enviar CONNECT");
+    }
+    return ERR_OK;
+}
+
+static void conectar(void) {
+    estado = MQTT_CONECTANDO;
+    agendar(MQTT_CONNACK_MAX_MS);
+    pcb = altcp_tcp_new_ip_type(IPADDR_TYPE_V4);
+    if (!pcb) {
+        encerrar("sem PCB livre");
+        return;
+    }
+    altcp_arg(pcb, NULL);
+    altcp_recv(pcb, mqtt_recv);
+    altcp_sent(pcb, mqtt_sent);
+    altcp_err(pcb, mqtt_err);
+    altcp_poll(pcb, mqtt_poll, MQTT_POLL_INTERVALO);
+    err_t err = altcp_connect(pcb, &broker_ip, broker_porta, mqtt_conectado_tcp);
+    if (err != ERR_OK) {
+        char motivo[40];
+        snprintf(motivo, sizeof(motivo), "falha ao conectar (erro %d)", err);
+        encerrar(motivo);
+    }
+}
+
+static void trabalho_relogio(async_context_t *ctx, async_at_time_worker_t *worker) {
+    if (estado == MQTT_CONECTANDO) {
+        encerrar("broker não respondeu");
+    } else if (estado == MQTT_ESPERA) {
+        conectar();
+    }
+}
+
+static void mqtt_wifi_evento(void *arg, bool conectado) {
+    if (conectado && estado == MQTT_SEM_REDE) {
+        falhas_seguidas = 0;
+        conectar();
+    } else if (!conectado && (estado == MQTT_CONECTANDO || estado == MQTT_CONECTADO)) {
+        encerrar("Wi-Fi caiu");
+    } else if (!conectado && estado == MQTT_ESPERA) {
+        async_context_remove_at_time_worker(cyw43_arch_async_context(), &worker_relogio);
+        estado = MQTT_SEM_REDE;
+    }
+}
+
+/***************************************************************
+ * FUNÇÕES PÚBLICAS
+ **************************************************************/
+bool mqtt_iniciar(const char *broker, uint16_t porta, const mqtt_config_t *cfg) {
+    if (!ipaddr_aton(broker, &broker_ip)) {
+        printf("MQTT: endereço do broker inválido: %s\n", broker);
+        return false;
+    }
+    broker_porta = porta;
+    config = *cfg;
+
+    cyw43_arch_lwip_begin();
+    if (estado == MQTT_PARADO) {
+        estado = MQTT_SEM_REDE;
+        wifi_ouvir(mqtt_wifi_evento, NULL);
+        if (wifi_conectado()) {
+            conectar();
+        }
+    }
+    cyw43_arch_lwip_end();
+    return true;
+}
+
+bool mqtt_assinar(const char *filtro, uint8_t qos) {
+    bool ok = false;
+    cyw43_arch_lwip_begin();
+    if (n_assinaturas < MQTT_ASSINATURAS_MAX && strlen(filtro) <= MQTT_TOPICO_MAX) {
+        assinaturas[n_assinaturas].filtro = filtro;
+        assinaturas[n_assinaturas].qos = qos > 1 ? 1 : qos;
+        n_assinaturas++;
+        ok = true;
+    }
+    cyw43_arch_lwip_end();
+    return ok;
+}
+
+err_t mqtt_publicar(const char *topico, const void *dados, uint16_t len, uint8_t qos, bool reter) {
+    size_t topico_len = strlen(topico);
+    if (topico_len + len > MQTT_MENSAGEM_MAX) {
+        return ERR_VAL;
+    }
+
+    err_t ret = ERR_MEM;
+    cyw43_arch_lwip_begin();
+    if (qos == 0) {
+        ret = estado == MQTT_CONECTADO ? enviar_publish((const uint8_t *)topico, (uint16_t)topico_len, dados, len,
+                                                        0, reter, false, 0)
+                                       : ERR_CONN;
+        if (ret == ERR_OK) {
+            estatisticas.publicadas++;
+        } else {
+            estatisticas.descartadas++;
+        }
+    } else {
+        for (int i = 0; i < MQTT_EM_VOO; i++) {
+            em_voo_t *m = &em_voo[i];
+            if (!m->usada) {
+                m->usada = true;
+                m->enviada = false;
+                m->dup = false;
+                m->reter = reter;
+                m->id = novo_id();
+                m->ordem = ordem_prox++;
+                m->topico_len = (uint16_t)topico_len;
+                m->len = len;
+                memcpy(m->dados, topico, topico_len);
+                memcpy(m->dados + topico_len, dados, len);
+                descarregar_em_voo();
+                ret = ERR_OK;
+                break;
+            }
+        }
+        // Tabela cheia (ERR_MEM): nada é descartado aqui, a mensagem fica com
+        // quem chamou, que pode tentar de novo a cada prazo sem inflar a contagem
+    }
+    cyw43_arch_lwip_end();
+    return ret;
+}
+
+bool mqtt_conectado(void) {
+    return estado == MQTT_CONECTADO;
+}
+
+mqtt_estado_t mqtt_estado(void) {
+    return estado;
+}
+
+int mqtt_em_voo(void) {
+    int n = 0;
+    for (int i = 0; i < MQTT_EM_VOO; i++) {
+        n += em_voo[i].usada;
+    }
+    return n;
+}
+
+const mqtt_estatisticas_t *mqtt_estatisticas(void) {
+    return &estatisticas;
+}
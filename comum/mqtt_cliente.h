@@ -0,0 +1,170 @@
+#ifndef MQTT_CLIENTE_H
+#define MQTT_CLIENTE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "lwip/err.h"
+
+/***************************************************************
+ * CLIENTE MQTT 3.1.1 (API raw/altcp do lwIP)
+ *
+ * Uma única conexão TCP persistente com o broker leva a telemetria
+ * (PUBLISH) e traz os comandos (SUBSCRIBE), sem o handshake e os
+ * cabeçalhos de uma requisição HTTP por mensagem e sem consulta
+ * periódica: o broker entrega o comando assim que ele é publicado.
+ *
+ *   CONECTANDO --(CONNACK)--> CONECTADO --(queda)--> ESPERA
+ *        ^                                              |
+ *        +-------------(backoff com jitter)-------------+
+ *
+ * A conexão acompanha o Wi-Fi (wifi_ouvir): abre quando o enlace
+ * sobe, cai junto com ele e, depois de uma falha, tenta de novo com
+ * espera crescente. Sessão limpa a cada conexão: as assinaturas são
+ * refeitas depois do CONNACK.
+ *
+ * QoS 0 sai na hora ou é descartada (sem conexão ou sem espaço no
+ * envio). QoS 1 fica guardada até o PUBACK, numa tabela de
+ * MQTT_EM_VOO mensagens: sem conexão ela espera, e o que estava sem
+ * confirmação numa queda é reenviado (DUP) depois de reconectar, na
+ * ordem original. O tempo até o PUBACK é medido. Mensagens recebidas
+ * valem QoS 0 ou 1 (as assinaturas pedem no máximo 1).
+ *
+ * Se a aplicação não pode receber (fila cheia), a mensagem fica
+ * guardada e o pbuf volta ao lwIP (ERR_MEM): a janela TCP fecha, o
+ * broker segura o resto e o lwIP entrega de novo no próximo tcp_fasttmr
+ * (250 ms). Nada é descartado e o PUBACK só sai depois da entrega.
+ *
+ * Tudo roda no contexto do lwIP; as funções públicas travam o lwIP
+ * (trava recursiva) e podem ser chamadas de qualquer ponto do
+ * núcleo 0.
+ **************************************************************/
+#ifndef MQTT_PORTA
+#define MQTT_PORTA 1883
+#endif
+#ifndef MQTT_KEEPALIVE_S
+#define MQTT_KEEPALIVE_S 30               // PINGREQ depois de metade disso sem enviar nada
+#endif
+#ifndef MQTT_CONNACK_MAX_MS
+#define MQTT_CONNACK_MAX_MS 5000          // Conexão TCP + CONNACK; depois disso é falha
+#endif
+#ifndef MQTT_PUBACK_MAX_MS
+#define MQTT_PUBACK_MAX_MS 10000          // QoS 1 sem PUBACK: a conexão é dada como perdida
+#endif
+#ifndef MQTT_BACKOFF_MIN_MS
+#define MQTT_BACKOFF_MIN_MS 1000
+#endif
+#ifndef MQTT_BACKOFF_MAX_MS
+#define MQTT_BACKOFF_MAX_MS 30000
+#endif
+#ifndef MQTT_EM_VOO
+#define MQTT_EM_VOO 8                     // Mensagens QoS 1 aguardando PUBACK
+#endif
+#ifndef MQTT_MENSAGEM_MAX
+#define MQTT_MENSAGEM_MAX 128             // Tópico + dados de uma publicação (QoS 1: cópia guardada até o PUBACK)
+#endif
+#ifndef MQTT_RX_MAX
+#define MQTT_RX_MAX 256                   // Maior pacote recebido; os maiores são descartados
+#endif
+#ifndef MQTT_TOPICO_MAX
+#define MQTT_TOPICO_MAX 64                // Tópico de uma mensagem recebida ou filtro de assinatura
+#endif
+#ifndef MQTT_ASSINATURAS_MAX
+#define MQTT_ASSINATURAS_MAX 4
+#endif
+
+typedef enum {
+    MQTT_PARADO,                      // mqtt_iniciar ainda não foi chamada
+    MQTT_SEM_REDE,                    // Aguardando o enlace Wi-Fi
+    MQTT_CONECTANDO,                  // TCP ou CONNACK em andamento
+    MQTT_CONECTADO,
+    MQTT_ESPERA                       // Aguardando o backoff para tentar de novo
+} mqtt_estado_t;
+
+typedef struct {
+    uint32_t conexoes;                // CONNACK aceitos
+    uint32_t falhas;                  // Tentativas que não chegaram ao CONNACK
+    uint32_t quedas;                  // Conexões perdidas depois do CONNACK
+    uint32_t publicadas;              // PUBLISH enviados (QoS 0 e primeira vez do QoS 1)
+    uint32_t reenviadas;              // QoS 1 reenviadas (DUP) após reconectar
+    uint32_t confirmadas;             // PUBACK recebidos
+    uint32_t descartadas;             // QoS 0 sem conexão ou sem espaço (QoS 1 recusada fica com quem chamou)
+    uint32_t recebidas;               // PUBLISH entregues à aplicação
+    uint32_t puback_ultimo_us;        // PUBLISH -> PUBACK da última confirmação
+    uint32_t puback_max_us;
+    uint64_t puback_soma_us;
+} mqtt_estatisticas_t;
+
+/**
+ * Mensagem recebida numa assinatura (contexto do lwIP; não pode bloquear)
+ * @param arg Argumento dado em mqtt_config_t
+ * @param topico Tópico, terminado em zero
+ * @param dados Conteúdo (não é terminado em zero)
+ * @param len Tamanho do conteúdo
+ * @return false se não pode receber agora: a mesma mensagem é entregue de novo mais tarde
+ */
+typedef bool (*mqtt_mensagem_fn)(void *arg, const char *topico, const uint8_t *dados, uint16_t len);
+
+/**
+ * A sessão com o broker começou (depois do CONNACK) ou terminou
+ */
+typedef void (*mqtt_conexao_fn)(void *arg, bool conectado);
+
+typedef struct {
+    const char *id;                   // Client ID, único por dispositivo
+    const char *usuario;              // NULL: sem autenticação
+    const char *senha;
+    const char *will_topico;          // NULL: sem última vontade
+    const char *will_msg;             // Publicada (retida, QoS 1) pelo broker se a conexão cair
+    mqtt_mensagem_fn mensagem_fn;
+    mqtt_conexao_fn conexao_fn;       // Opcional
+    void *arg;
+} mqtt_config_t;
+
+/**
+ * Configura o cliente e conecta ao broker sempre que o enlace Wi-Fi
+ * estiver de pé. Chamar antes de wifi_iniciar, ou a primeira subida
+ * do enlace se perde (wifi_ouvir só avisa mudanças)
+ * @param broker IP do broker, ex.: "192.168.0.10"
+ * @param porta Porta TCP (MQTT_PORTA)
+ * @param config Configuração (as strings precisam durar enquanto o firmware roda)
+ * @return false se o IP é inválido
+ */
+bool mqtt_iniciar(const char *broker, uint16_t porta, const mqtt_config_t *config);
+
+/**
+ * Acrescenta uma assinatura, feita a cada conexão
+ * @param filtro Filtro de tópicos (+ e # valem); precisa durar
+ * @param qos QoS máximo das mensagens entregues (0 ou 1)
+ * @return false se já há MQTT_ASSINATURAS_MAX assinaturas
+ */
+bool mqtt_assinar(const char *filtro, uint8_t qos);
+
+/**
+ * Publica uma mensagem
+ * @param topico Tópico
+ * @param dados Conteúdo
+ * @param len Tamanho do conteúdo
+ * @param qos 0: enviada agora ou descartada; 1: guardada até o PUBACK
+ * @param reter O broker guarda a última mensagem retida do tópico para novos assinantes
+ * @return ERR_OK se enviada (QoS 0) ou guardada (QoS 1); ERR_CONN sem conexão (QoS 0);
+ *         ERR_MEM sem espaço no envio (QoS 0) ou na tabela (QoS 1: quem chama decide
+ *         se tenta de novo ou desiste; não entra em descartadas);
+ *         ERR_VAL se tópico + dados passam de MQTT_MENSAGEM_MAX
+ */
+err_t mqtt_publicar(const char *topico, const void *dados, uint16_t len, uint8_t qos, bool reter);
+
+/**
+ * Se a sessão com o broker está de pé
+ */
+bool mqtt_conectado(void);
+
+mqtt_estado_t mqtt_estado(void);
+
+/**
+ * @return Mensagens QoS 1 ainda sem PUBACK
+ */
+int mqtt_em_voo(void);
+
+const mqtt_estatisticas_t *mqtt_estatisticas(void);
+
+#endif
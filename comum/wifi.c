@@ -0,0 +1,222 @@
+#include <stdio.h>
+
+#include "pico/cyw43_arch.h"
+#include "pico/rand.h"
+#include "lwip/netif.h"
+#include "wifi.h"
+
+/***************************************************************
+ * VARIÁVEIS INTERNAS
+ **************************************************************/
+static const char *wifi_ssid;
+static const char *wifi_senha;
+static uint32_t wifi_auth;
+
+static wifi_estado_t estado = WIFI_PARADO;
+static volatile bool enlace_ok;             // Lido fora do contexto do lwIP (wifi_conectado)
+static absolute_time_t prazo;               // Fim da associação (ASSOCIANDO) ou da espera (ESPERA)
+static uint8_t falhas_seguidas;             // Zerado ao conectar
+static wifi_estatisticas_t estatisticas;
+
+static struct {
+    wifi_evento_fn fn;
+    void *arg;
+} ouvintes[WIFI_OUVINTES_MAX];
+static int n_ouvintes;
+
+static void trabalho_relogio(async_context_t *ctx, async_at_time_worker_t *worker);
+static void trabalho_aviso(async_context_t *ctx, async_when_pending_worker_t *worker);
+
+static async_at_time_worker_t worker_relogio = { .do_work = trabalho_relogio };
+static async_when_pending_worker_t worker_aviso = { .do_work = trabalho_aviso };
+NETIF_DECLARE_EXT_CALLBACK(netif_aviso)
+
+/***************************************************************
+ * FUNÇÕES INTERNAS
+ **************************************************************/
+/**
+ * (Re)agenda a próxima consulta ao driver
+ */
+static void agendar(uint32_t ms) {
+    async_context_t *ctx = cyw43_arch_async_context();
+    async_context_remove_at_time_worker(ctx, &worker_relogio);
+    async_context_add_at_time_worker_in_ms(ctx, &worker_relogio, ms);
+}
+
+static void publicar(bool conectado) {
+    enlace_ok = conectado;
+    for (int i = 0; i < n_ouvintes; i++) {
+        ouvintes[i].fn(ouvintes[i].arg, conectado);
+    }
+}
+
+/**
+ * Sorteia a espera da próxima tentativa: o teto dobra a cada falha
+ * seguida e a espera fica entre metade do teto e o teto
+ * @param status Status de falha do driver
+ */
+static uint32_t sortear_espera(int status) {
+    uint32_t teto = WIFI_BACKOFF_MAX_MS;
+    if (status != CYW43_LINK_BADAUTH && falhas_seguidas < 16 &&
+        ((uint32_t)WIFI_BACKOFF_MIN_MS << falhas_seguidas) < WIFI_BACKOFF_MAX_MS) {
+        teto = (uint32_t)WIFI_BACKOFF_MIN_MS << falhas_seguidas;
+    }
+    return teto / 2 + get_rand_32() % (teto / 2 + 1);
+}
+
+/**
+ * A tentativa não chegou ao IP: desiste dela e espera o backoff
+ * @param status Último status do driver
+ */
+static void falhar(int status) {
+    estatisticas.falhas++;
+    estatisticas.ultimo_erro = status;
+    cyw43_wifi_leave(&cyw43_state, CYW43_ITF_STA);     // Interrompe uma associação ainda em curso
+    estatisticas.espera_ms = sortear_espera(status);
+    if (falhas_seguidas < UINT8_MAX) {
+        falhas_seguidas++;
+    }
+    estado = WIFI_ESPERA;
+    prazo = make_timeout_time_ms(estatisticas.espera_ms);
+    printf("Wi-Fi: falha ao conectar (status %d), nova tentativa em %lu ms\n",
+           status, (unsigned long)estatisticas.espera_ms);
+    agendar(estatisticas.espera_ms);
+}
+
+static void iniciar_tentativa(void) {
+    estatisticas.tentativas++;
+    estado = WIFI_ASSOCIANDO;
+    prazo = make_timeout_time_ms(WIFI_ASSOCIACAO_MAX_MS);
+    int ret = cyw43_arch_wifi_connect_async(wifi_ssid, wifi_senha, wifi_auth);
+    if (ret != 0) {
+        falhar(ret);
+        return;
+    }
+    agendar(WIFI_VERIFICAR_MS);
+}
+
+static void conectar(void) {
+    estado = WIFI_CONECTADO;
+    falhas_seguidas = 0;
+    if (netif_default) {
+        printf("Wi-Fi conectado a %s, IP %s\n", wifi_ssid, ip4addr_ntoa(netif_ip4_addr(netif_default)));
+    }
+    publicar(true);
+    agendar(WIFI_VIGIA_MS);
+}
+
+/**
+ * Confere o status do driver e avança a máquina de estados
+ */
+static void avaliar(void) {
+    int status = cyw43_tcpip_link_status(&cyw43_state, CYW43_ITF_STA);
+    switch (estado) {
+    case WIFI_ASSOCIANDO:
+        if (status == CYW43_LINK_UP) {
+            conectar();
+        } else if ((status == CYW43_LINK_JOIN || status == CYW43_LINK_NOIP) && !time_reached(prazo)) {
+            agendar(WIFI_VERIFICAR_MS);
+        } else {
+            falhar(status);
+        }
+        break;
+
+    case WIFI_ESPERA:
+        if (status == CYW43_LINK_UP) {
+            conectar();                              // O driver voltou sozinho
+        } else if (time_reached(prazo)) {
+            iniciar_tentativa();
+        } else {
+            agendar((uint32_t)(absolute_time_diff_us(get_absolute_time(), prazo) / 1000));
+        }
+        break;
+
+    case WIFI_CONECTADO:
+        if (status == CYW43_LINK_UP) {
+            agendar(WIFI_VIGIA_MS);
+            break;
+        }
+        estatisticas.quedas++;
+        printf("Wi-Fi: enlace perdido (status %d)\n", status);
+        publicar(false);
+        if (status == CYW43_LINK_JOIN || status == CYW43_LINK_NOIP) {
+            // O driver ainda está reassociando (ou o DHCP renovando): espera por ele
+            estado = WIFI_ASSOCIANDO;
+            prazo = make_timeout_time_ms(WIFI_ASSOCIACAO_MAX_MS);
+            agendar(WIFI_VERIFICAR_MS);
+        } else {
+            iniciar_tentativa();                     // Primeira tentativa após uma queda sem espera
+        }
+        break;
+
+    default:
+        break;
+    }
+}
+
+static void trabalho_relogio(async_context_t *ctx, async_at_time_worker_t *worker) {
+    avaliar();
+}
+
+static void trabalho_aviso(async_context_t *ctx, async_when_pending_worker_t *worker) {
+    avaliar();
+}
+
+/**
+ * Aviso da netif (contexto do lwIP): só agenda a consulta ao driver
+ */
+static void netif_mudou(struct netif *netif, netif_nsc_reason_t motivo, const netif_ext_callback_args_t *args) {
+    if (motivo & (LWIP_NSC_LINK_CHANGED | LWIP_NSC_STATUS_CHANGED |
+                  LWIP_NSC_IPV4_ADDRESS_CHANGED | LWIP_NSC_IPV4_SETTINGS_CHANGED)) {
+        async_context_set_work_pending(cyw43_arch_async_context(), &worker_aviso);
+    }
+}
+
+/***************************************************************
+ * FUNÇÕES PÚBLICAS
+ **************************************************************/
+void wifi_iniciar(const char *ssid, const char *senha, uint32_t auth) {
+    wifi_ssid = ssid;
+    wifi_senha = senha;
+    wifi_auth = auth;
+
+    cyw43_arch_lwip_begin();
+    if (estado == WIFI_PARADO) {
+        netif_add_ext_callback(&netif_aviso, netif_mudou);
+        async_context_add_when_pending_worker(cyw43_arch_async_context(), &worker_aviso);
+        printf("Conectando a %s em segundo plano...\n", ssid);
+        iniciar_tentativa();
+    }
+    cyw43_arch_lwip_end();
+}
+
+bool wifi_ouvir(wifi_evento_fn fn, void *arg) {
+    bool ok = false;
+    cyw43_arch_lwip_begin();
+    if (n_ouvintes < WIFI_OUVINTES_MAX) {
+        ouvintes[n_ouvintes].fn = fn;
+        ouvintes[n_ouvintes].arg = arg;
+        n_ouvintes++;
+        ok = true;
+    }
+    cyw43_arch_lwip_end();
+    return ok;
+}
+
+void wifi_verificar(void) {
+    if (estado != WIFI_PARADO) {
+        async_context_set_work_pending(cyw43_arch_async_context(), &worker_aviso);
+    }
+}
+
+bool wifi_conectado(void) {
+    return enlace_ok;
+}
+
+wifi_estado_t wifi_estado(void) {
+    return estado;
+}
+
+const wifi_estatisticas_t *wifi_estatisticas(void) {
+    return &estatisticas;
+}
@@ -0,0 +1,104 @@
+#ifndef WIFI_H
+#define WIFI_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/***************************************************************
+ * GERENCIADOR DA CONEXÃO WI-FI
+ *
+ * Máquina de estados que associa à rede em segundo plano, sem
+ * bloquear: wifi_iniciar retorna na hora e o resto do firmware
+ * sobe enquanto o driver associa e o DHCP obtém o endereço.
+ *
+ *   ASSOCIANDO --(IP)--> CONECTADO --(queda)--> ASSOCIANDO
+ *       |                                           ^
+ *   (falha ou prazo)                                |
+ *       v                                           |
+ *    ESPERA ----------(backoff com jitter)----------+
+ *
+ * O estado vem de cyw43_tcpip_link_status, consultado quando a netif
+ * avisa uma mudança (callback estendido do lwIP: enlace, interface
+ * ou endereço) e, como rede de segurança, periodicamente. Cada falha
+ * seguida dobra a espera até WIFI_BACKOFF_MAX_MS; a espera sorteada
+ * fica entre metade e o total (jitter), para que vários dispositivos
+ * não voltem todos juntos depois de uma queda do roteador. Senha
+ * errada espera o máximo direto.
+ *
+ * Os subsistemas registram uma função para saber quando o enlace sobe
+ * ou cai e pausam o trabalho de rede em vez de insistir sem conexão.
+ * Tudo roda no contexto do lwIP (workers do async_context do CYW43).
+ **************************************************************/
+#ifndef WIFI_ASSOCIACAO_MAX_MS
+#define WIFI_ASSOCIACAO_MAX_MS 15000      // Associação + DHCP; depois disso é falha
+#endif
+#ifndef WIFI_BACKOFF_MIN_MS
+#define WIFI_BACKOFF_MIN_MS 1000          // Espera após a primeira falha
+#endif
+#ifndef WIFI_BACKOFF_MAX_MS
+#define WIFI_BACKOFF_MAX_MS 60000         // Teto da espera entre tentativas
+#endif
+#ifndef WIFI_VERIFICAR_MS
+#define WIFI_VERIFICAR_MS 250             // Consulta ao driver durante a associação
+#endif
+#ifndef WIFI_VIGIA_MS
+#define WIFI_VIGIA_MS 2000                // Consulta ao driver conectado (os avisos da netif chegam antes)
+#endif
+#ifndef WIFI_OUVINTES_MAX
+#define WIFI_OUVINTES_MAX 4
+#endif
+
+typedef enum {
+    WIFI_PARADO,                      // wifi_iniciar ainda não foi chamada
+    WIFI_ASSOCIANDO,                  // Associação ou DHCP em andamento
+    WIFI_CONECTADO,                   // Enlace de pé, com endereço IP
+    WIFI_ESPERA                       // Aguardando o backoff para tentar de novo
+} wifi_estado_t;
+
+typedef struct {
+    uint32_t tentativas;              // Associações iniciadas
+    uint32_t falhas;                  // Tentativas que não chegaram ao IP
+    uint32_t quedas;                  // Perdas do enlace depois de conectado
+    uint32_t espera_ms;               // Última espera sorteada
+    int ultimo_erro;                  // Último status de falha do driver (CYW43_LINK_*)
+} wifi_estatisticas_t;
+
+/**
+ * Função chamada quando o enlace sobe ou cai (contexto do lwIP)
+ * @param arg Argumento dado em wifi_ouvir
+ * @param conectado true: enlace com IP; false: enlace perdido
+ */
+typedef void (*wifi_evento_fn)(void *arg, bool conectado);
+
+/**
+ * Começa a conectar em segundo plano e retorna na hora. Chamar depois
+ * de cyw43_arch_init e cyw43_arch_enable_sta_mode
+ * @param ssid Nome da rede (precisa durar enquanto o firmware roda)
+ * @param senha Senha da rede (idem)
+ * @param auth Autenticação (CYW43_AUTH_*)
+ */
+void wifi_iniciar(const char *ssid, const char *senha, uint32_t auth);
+
+/**
+ * Registra uma função para os eventos de enlace. Se o enlace já está
+ * de pé, ela só é chamada na próxima mudança
+ * @return false se já há WIFI_OUVINTES_MAX funções registradas
+ */
+bool wifi_ouvir(wifi_evento_fn fn, void *arg);
+
+/**
+ * Pede uma consulta imediata ao driver, por exemplo depois de uma
+ * requisição que falhou (pode ser chamada de qualquer contexto)
+ */
+void wifi_verificar(void);
+
+/**
+ * Se o enlace está de pé, com IP
+ */
+bool wifi_conectado(void);
+
+wifi_estado_t wifi_estado(void);
+
+const wifi_estatisticas_t *wifi_estatisticas(void);
+
+#endif